@@ -13,6 +13,35 @@
 Source: https://www.gnu.org/software/libc/manual/html_node/Getopt-Long-Option-Example.html
 */
 
+// long options without short variant, values are outside of char range
+#define OPT_RING                    256
+#define OPT_RING_BLOCK_SIZE         257
+#define OPT_RING_BLOCKS             258
+#define OPT_RING_TIMEOUT            259
+#define OPT_WORKERS                 260
+#define OPT_BATCH                   261
+#define OPT_SNAPLEN                 262
+#define OPT_BUFFER_SIZE             263
+#define OPT_IMMEDIATE               264
+#define OPT_TIMEOUT                 265
+#define OPT_STATS_INTERVAL          266
+#define OPT_ADAPTIVE_BUFFER         267
+#define OPT_QTYPE                   268
+#define OPT_ZONE                    269
+#define OPT_RESPONSES_ONLY          270
+#define OPT_QUERIES_ONLY            271
+#define OPT_OPCODE                  272
+#define OPT_ORDERED                 273
+#define OPT_INDEX_CACHE             274
+#define OPT_ROTATE_SIZE             275
+#define OPT_ROTATE_TIME             276
+#define OPT_ROTATE_COUNT            277
+#define OPT_REPLAY                  278
+#define OPT_REPLAY_SPEED            279
+#define OPT_REPLAY_PPS              280
+#define OPT_QUARANTINE              281
+#define OPT_EDNS_STATS              282
+
 static struct option long_options[] =
 {
     {"interface",               required_argument,  0, 'i'},
@@ -22,6 +51,34 @@ static struct option long_options[] =
     {"verbose",                 no_argument,        0, 'v'},
     {"domainsFile",             no_argument,        0, 'd'},
     {"translationsFile",        no_argument,        0, 't'},
+    {"ring",                    no_argument,        0, OPT_RING},
+    {"ring-block-size",         required_argument,  0, OPT_RING_BLOCK_SIZE},
+    {"ring-blocks",             required_argument,  0, OPT_RING_BLOCKS},
+    {"ring-timeout",            required_argument,  0, OPT_RING_TIMEOUT},
+    {"workers",                 required_argument,  0, OPT_WORKERS},
+    {"batch",                   required_argument,  0, OPT_BATCH},
+    {"snaplen",                 required_argument,  0, OPT_SNAPLEN},
+    {"buffer-size",             required_argument,  0, OPT_BUFFER_SIZE},
+    {"immediate",               no_argument,        0, OPT_IMMEDIATE},
+    {"timeout",                 required_argument,  0, OPT_TIMEOUT},
+    {"stats-interval",          required_argument,  0, OPT_STATS_INTERVAL},
+    {"adaptive-buffer",         required_argument,  0, OPT_ADAPTIVE_BUFFER},
+    {"qtype",                   required_argument,  0, OPT_QTYPE},
+    {"zone",                    required_argument,  0, OPT_ZONE},
+    {"responses-only",          no_argument,        0, OPT_RESPONSES_ONLY},
+    {"queries-only",            no_argument,        0, OPT_QUERIES_ONLY},
+    {"opcode",                  required_argument,  0, OPT_OPCODE},
+    {"ordered",                 no_argument,        0, OPT_ORDERED},
+    {"index-cache",             no_argument,        0, OPT_INDEX_CACHE},
+    {"write",                   required_argument,  0, 'w'},
+    {"rotate-size",             required_argument,  0, OPT_ROTATE_SIZE},
+    {"rotate-time",             required_argument,  0, OPT_ROTATE_TIME},
+    {"rotate-count",            required_argument,  0, OPT_ROTATE_COUNT},
+    {"replay",                  no_argument,        0, OPT_REPLAY},
+    {"replay-speed",            required_argument,  0, OPT_REPLAY_SPEED},
+    {"replay-pps",              required_argument,  0, OPT_REPLAY_PPS},
+    {"quarantine",              required_argument,  0, OPT_QUARANTINE},
+    {"edns-stats",              no_argument,        0, OPT_EDNS_STATS},
     {0, 0, 0, 0}
 };
 
@@ -40,6 +97,194 @@ void copyArgToBuffer(char* optarg, Buffer* buffer)
     buffer->used = optLen + 1;
 }
 
+/**
+ * @brief Converts argument from optarg into unsigned number, exits program 
+ * if argument is not valid unsigned number
+ * 
+ * @param optarg Pointer to the source optarg
+ * @param optName Name of the option, used in error message
+ * @return unsigned Converted number
+ */
+unsigned argToUInt(char* optarg, const char* optName)
+{
+    if(optarg[0] == '\0' || !stringIsValidUInt(optarg) || strlen(optarg) > 9)
+    {
+        fprintf(stderr, "ERR: Option %s expects unsigned number, got '%s'\n", optName, optarg);
+        errHandling("", ERR_BAD_ARGS);
+    }
+
+    return (unsigned) strtoul(optarg, NULL, 10);
+}
+
+/**
+ * @brief Converts argument from optarg into positive real number, exits 
+ * program if argument is not valid positive number
+ * 
+ * @param optarg Pointer to the source optarg
+ * @param optName Name of the option, used in error message
+ * @return double Converted number
+ */
+double argToPositiveDouble(char* optarg, const char* optName)
+{
+    char* end;
+    double value = strtod(optarg, &end);
+
+    if(optarg[0] == '\0' || *end != '\0' || !(value > 0) || value > 1e6)
+    {
+        fprintf(stderr, "ERR: Option %s expects positive number, got '%s'\n", optName, optarg);
+        errHandling("", ERR_BAD_ARGS);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Sets replay mode, exits program if other mode was already set
+ * 
+ * @param config Pointer to the Config structure
+ * @param mode New mode
+ */
+void setReplayMode(Config* config, ReplayMode mode)
+{
+    if(config->replay.mode != REPLAY_OFF && config->replay.mode != mode)
+        errHandling("Options --replay-pps and --replay/--replay-speed cannot be used together", ERR_BAD_ARGS);
+
+    config->replay.mode = mode;
+}
+
+/**
+ * @brief Adds capture file into list of offline input files
+ * 
+ * @param config Pointer to the Config structure
+ * @param path Path to the file
+ */
+void addPcapFile(Config* config, const char* path)
+{
+    if(config->pcapFileCount == config->pcapFileMax)
+    {
+        unsigned newMax = (config->pcapFileMax > 0)? config->pcapFileMax * 2 : 16;
+        char** tmp = (char**) realloc(config->pcapFiles, sizeof(char*) * newMax);
+        if(tmp == NULL)
+            errHandling("Failed to allocate memory for list of capture files", ERR_MALLOC);
+
+        config->pcapFiles = tmp;
+        config->pcapFileMax = newMax;
+    }
+
+    config->pcapFiles[config->pcapFileCount] = strdup(path);
+    if(config->pcapFiles[config->pcapFileCount] == NULL)
+        errHandling("Failed to allocate memory for list of capture files", ERR_MALLOC);
+
+    config->pcapFileCount++;
+}
+
+/**
+ * @brief Adds interface into list of monitored interfaces, first interface
+ * is also stored into Config.interface
+ * 
+ * @param config Pointer to the Config structure
+ * @param name Name of the interface
+ */
+void addInterface(Config* config, const char* name)
+{
+    for(unsigned i = 0; i < config->interfaceCount; i++)
+    {
+        if(strcmp(config->interfaces[i], name) == 0)
+            errHandling("Interface cannot be monitored twice", ERR_BAD_ARGS);
+    }
+
+    if(config->interfaceCount == config->interfaceMax)
+    {
+        unsigned newMax = (config->interfaceMax > 0)? config->interfaceMax * 2 : 4;
+        char** tmp = (char**) realloc(config->interfaces, sizeof(char*) * newMax);
+        if(tmp == NULL)
+            errHandling("Failed to allocate memory for list of interfaces", ERR_MALLOC);
+
+        config->interfaces = tmp;
+        config->interfaceMax = newMax;
+    }
+
+    config->interfaces[config->interfaceCount] = strdup(name);
+    if(config->interfaces[config->interfaceCount] == NULL)
+        errHandling("Failed to allocate memory for list of interfaces", ERR_MALLOC);
+
+    if(config->interfaceCount == 0)
+        copyArgToBuffer((char*) name, config->interface);
+
+    config->interfaceCount++;
+}
+
+/**
+ * @brief Adds all regular files of directory (not recursively, hidden files
+ * are skipped) into list of offline input files, sorted by name
+ * 
+ * @param config Pointer to the Config structure
+ * @param path Path to the directory
+ */
+void addPcapDirectory(Config* config, const char* path)
+{
+    struct dirent** entries;
+    int count = scandir(path, &entries, NULL, alphasort);
+    if(count < 0)
+    {
+        fprintf(stderr, "ERR: Couldn't read directory %s\n", path);
+        errHandling("", ERR_FILE);
+    }
+
+    Buffer file;
+    bufferInit(&file);
+
+    for(int i = 0; i < count; i++)
+    {
+        struct stat info;
+        bufferClear(&file);
+        bufferAddString(&file, (char*) path);
+        bufferAddChar(&file, '/');
+        bufferAddString(&file, entries[i]->d_name);
+        bufferAddChar(&file, '\0');
+
+        if(entries[i]->d_name[0] != '.' && stat(file.data, &info) == 0 && S_ISREG(info.st_mode))
+            addPcapFile(config, file.data);
+
+        free(entries[i]);
+    }
+
+    bufferDestroy(&file);
+    free(entries);
+}
+
+/**
+ * @brief Adds argument of -p into list of offline input files, argument 
+ * can be file, directory or glob pattern (e.g. quoted "dns-*.pcap")
+ * 
+ * @param config Pointer to the Config structure
+ * @param arg Argument of -p
+ */
+void addPcapArgument(Config* config, const char* arg)
+{
+    struct stat info;
+    if(stat(arg, &info) == 0)
+    {
+        if(S_ISDIR(info.st_mode))
+            addPcapDirectory(config, arg);
+        else
+            addPcapFile(config, arg);
+        return;
+    }
+
+    glob_t matches;
+    if(strpbrk(arg, "*?[") == NULL || glob(arg, 0, NULL, &matches) != 0)
+    {
+        fprintf(stderr, "ERR: No capture file matches %s\n", arg);
+        errHandling("", ERR_NONEXISTING_FILE);
+    }
+
+    for(size_t i = 0; i < matches.gl_pathc; i++)
+        addPcapFile(config, matches.gl_pathv[i]);
+
+    globfree(&matches);
+}
+
 /**
  * @brief Handles program arguments and sets correct 
  * ProgramConfiguration (Config)
@@ -55,7 +300,7 @@ void argumentHandler(int argc, char* argv[], Config* config)
     int options_index;
 
     // \0 == PORT_OPTIONS, \1 DISPLAY_OPTIONS
-    while((opt = getopt_long(argc, argv, "ovht:i:p:d:t:", long_options, &options_index)) != -1)
+    while((opt = getopt_long(argc, argv, "ovht:i:p:d:t:w:", long_options, &options_index)) != -1)
     {
         switch (opt)
         {
@@ -72,20 +317,136 @@ void argumentHandler(int argc, char* argv[], Config* config)
                 copyArgToBuffer(optarg, config->translationsFile);
                 break;
             case 'p':
-                if(config->captureMode != NO_MODE)
+                if(config->captureMode == ONLINE_MODE)
                     errHandling("Arguments -i and -p cannot be used together", ERR_BAD_ARGS);
 
-                copyArgToBuffer(optarg, config->pcapFileName);
+                addPcapArgument(config, optarg);
                 config->captureMode = OFFLINE_MODE;
                 break;
             // ----------------------------------------------------------------
             case 'i':
-                if(config->captureMode != NO_MODE)
+                if(config->captureMode == OFFLINE_MODE)
                     errHandling("Arguments -i and -p cannot be used together", ERR_BAD_ARGS);
 
-                copyArgToBuffer(optarg, config->interface);
+                addInterface(config, optarg);
                 config->captureMode = ONLINE_MODE;
                 break;
+            // ----------------------------------------------------------------
+            case OPT_RING:
+                config->useRing = true;
+                break;
+            case OPT_RING_BLOCK_SIZE:
+                config->ringBlockSize = argToUInt(optarg, "--ring-block-size");
+                break;
+            case OPT_RING_BLOCKS:
+                config->ringBlockCount = argToUInt(optarg, "--ring-blocks");
+                break;
+            case OPT_RING_TIMEOUT:
+                config->ringRetireTimeout = argToUInt(optarg, "--ring-timeout");
+                break;
+            case OPT_WORKERS:
+                config->workerCount = argToUInt(optarg, "--workers");
+                if(config->workerCount == 0 || config->workerCount > MAX_WORKERS)
+                    errHandling("Option --workers expects number between 1 and " 
+                        STRINGIFY(MAX_WORKERS), ERR_BAD_ARGS);
+                break;
+            case OPT_BATCH:
+                config->batchSize = argToUInt(optarg, "--batch");
+                if(config->batchSize > BATCH_MAX_SIZE)
+                    errHandling("Option --batch expects number up to " 
+                        STRINGIFY(BATCH_MAX_SIZE), ERR_BAD_ARGS);
+                break;
+            case OPT_SNAPLEN:
+                config->snaplen = argToUInt(optarg, "--snaplen");
+                if(config->snaplen == 0)
+                    errHandling("Option --snaplen expects non zero number", ERR_BAD_ARGS);
+                break;
+            case OPT_BUFFER_SIZE:
+                config->bufferSize = argToUInt(optarg, "--buffer-size");
+                break;
+            case OPT_IMMEDIATE:
+                config->immediateMode = true;
+                break;
+            case OPT_TIMEOUT:
+                config->timeout = argToUInt(optarg, "--timeout");
+                break;
+            case OPT_STATS_INTERVAL:
+                config->statsInterval = argToUInt(optarg, "--stats-interval");
+                break;
+            case OPT_ADAPTIVE_BUFFER:
+                config->adaptiveMaxBuffer = argToUInt(optarg, "--adaptive-buffer");
+                break;
+            // ----------------------------------------------------------------
+            case OPT_QTYPE:
+                if(!dnsFilterAddQTypes(&(config->dnsFilter), optarg))
+                {
+                    fprintf(stderr, "ERR: Option --qtype got invalid type list '%s' "
+                        "(at most " STRINGIFY(DNS_FILTER_MAX_QTYPES) " types)\n", optarg);
+                    errHandling("", ERR_BAD_ARGS);
+                }
+                break;
+            case OPT_ZONE:
+                if(!dnsFilterAddZones(&(config->dnsFilter), optarg))
+                {
+                    fprintf(stderr, "ERR: Option --zone got invalid domain list '%s' "
+                        "(at most " STRINGIFY(DNS_FILTER_MAX_ZONES) " domains)\n", optarg);
+                    errHandling("", ERR_BAD_ARGS);
+                }
+                break;
+            case OPT_RESPONSES_ONLY:
+            case OPT_QUERIES_ONLY:
+                if(config->dnsFilter.qr != DNS_FILTER_QR_ANY)
+                    errHandling("Options --responses-only and --queries-only cannot be used together", ERR_BAD_ARGS);
+
+                config->dnsFilter.qr = (opt == OPT_RESPONSES_ONLY)? 
+                    DNS_FILTER_QR_RESPONSES : DNS_FILTER_QR_QUERIES;
+                break;
+            case OPT_OPCODE:
+                config->dnsFilter.opcode = argToUInt(optarg, "--opcode");
+                if(config->dnsFilter.opcode > 15)
+                    errHandling("Option --opcode expects number between 0 and 15", ERR_BAD_ARGS);
+                break;
+            // ----------------------------------------------------------------
+            case OPT_ORDERED:
+                config->ordered = true;
+                break;
+            case OPT_INDEX_CACHE:
+                config->indexCache = true;
+                break;
+            // ----------------------------------------------------------------
+            case 'w':
+                config->writePath = optarg;
+                break;
+            case OPT_ROTATE_SIZE:
+                config->rotateSize = argToUInt(optarg, "--rotate-size");
+                break;
+            case OPT_ROTATE_TIME:
+                config->rotateTime = argToUInt(optarg, "--rotate-time");
+                break;
+            case OPT_ROTATE_COUNT:
+                config->rotateCount = argToUInt(optarg, "--rotate-count");
+                break;
+            // ----------------------------------------------------------------
+            case OPT_REPLAY:
+                setReplayMode(config, REPLAY_SPEED);
+                break;
+            case OPT_REPLAY_SPEED:
+                setReplayMode(config, REPLAY_SPEED);
+                config->replay.speed = argToPositiveDouble(optarg, "--replay-speed");
+                break;
+            case OPT_REPLAY_PPS:
+                setReplayMode(config, REPLAY_PPS);
+                config->replay.pps = argToUInt(optarg, "--replay-pps");
+                if(config->replay.pps == 0)
+                    errHandling("Option --replay-pps expects non zero number", ERR_BAD_ARGS);
+                break;
+            // ----------------------------------------------------------------
+            case OPT_QUARANTINE:
+                config->quarantinePath = optarg;
+                break;
+            case OPT_EDNS_STATS:
+                config->ednsReport = true;
+                break;
             case 'h':
                 printCliHelpMenu("dns-monitor"); //TODO:
                 errHandling("", 0);
@@ -96,6 +457,30 @@ void argumentHandler(int argc, char* argv[], Config* config)
         }
     }
 
+    // shell expanded globs (-p dns-*.pcap) leave rest of files as operands
+    for(int i = optind; i < argc; i++)
+    {
+        if(config->captureMode != OFFLINE_MODE)
+        {
+            fprintf(stderr, "ERR: Unexpected argument '%s'\n", argv[i]);
+            errHandling("", ERR_BAD_ARGS);
+        }
+
+        addPcapArgument(config, argv[i]);
+    }
+
+    if(config->captureMode == OFFLINE_MODE)
+    {
+        if(config->pcapFileCount == 0)
+            errHandling("No capture file found", ERR_NONEXISTING_FILE);
+
+        copyArgToBuffer(config->pcapFiles[0], config->pcapFileName);
+    }
+
+    // live capture workers are fed by fanout group of rings
+    if(config->workerCount > 1 && config->captureMode == ONLINE_MODE)
+        config->useRing = true;
+
     // Check mandatory arguments
     if( config->interface->data == NULL && 
         config->captureMode != OFFLINE_MODE && 
@@ -103,6 +488,39 @@ void argumentHandler(int argc, char* argv[], Config* config)
     {
         errHandling("Interface not provided", ERR_BAD_ARGS);
     }
+
+    if(config->useRing && config->captureMode != ONLINE_MODE)
+    {
+        errHandling("Option --ring can be used only with -i", ERR_BAD_ARGS);
+    }
+
+    // rings and workers capture single interface, multiple interfaces are
+    // multiplexed by one epoll loop
+    if(config->interfaceCount > 1 && config->useRing)
+        errHandling("Options --ring and --workers can be used only with single -i", ERR_BAD_ARGS);
+
+    if(config->writePath == NULL && 
+        (config->rotateSize > 0 || config->rotateTime > 0 || config->rotateCount > 0))
+    {
+        errHandling("Options --rotate-size, --rotate-time and --rotate-count can be used only with -w", ERR_BAD_ARGS);
+    }
+
+    if(config->rotateCount > 0 && config->rotateSize == 0 && config->rotateTime == 0)
+        errHandling("Option --rotate-count requires --rotate-size or --rotate-time", ERR_BAD_ARGS);
+
+    // replay drives one packet loop, packet by packet
+    if(config->replay.mode != REPLAY_OFF)
+    {
+        if(config->captureMode != OFFLINE_MODE || config->pcapFileCount > 1)
+            errHandling("Replay options can be used only with single -p file", ERR_BAD_ARGS);
+
+        if(config->batchSize > 0 || config->workerCount > 1)
+            errHandling("Replay options cannot be used with --batch or --workers", ERR_BAD_ARGS);
+    }
+
+    // adaptive mode decides on drop rate of statistics interval
+    if(config->adaptiveMaxBuffer > 0 && config->statsInterval == 0)
+        config->statsInterval = DEFAULT_STATS_INTERVAL;
 }
 
 /**
@@ -111,20 +529,38 @@ void argumentHandler(int argc, char* argv[], Config* config)
 void printCliHelpMenu(const char* executableName)
 {
     printf(
-        "Usage: ./%s (-i <interface> | -p <pcapfile> | -o) "
+        "Usage: ./%s (-i <interface>... | -p <pcapfile>... | -o) "
         "[-v] [-d <domainsfile>] "
-        "[-t <translationsfile>]\n"
+        "[-t <translationsfile>] [--ring [--ring-block-size <BYTES>] "
+        "[--ring-blocks <N>] [--ring-timeout <MS>]] [--workers <N>]\n"
+        "       [--batch <K>] [--snaplen <BYTES>] [--buffer-size <BYTES>] "
+        "[--immediate] [--timeout <MS>]\n"
+        "       [--stats-interval <S>] [--adaptive-buffer <BYTES>]\n"
+        "       [--qtype <LIST>] [--zone <LIST>] [--responses-only | --queries-only] "
+        "[--opcode <N>] [--ordered] [--index-cache]\n"
+        "       [-w <file> [--rotate-size <MIB>] [--rotate-time <S>] [--rotate-count <N>]]\n"
+        "       [--replay | --replay-speed <X> | --replay-pps <N>] [--quarantine <file>]\n"
+        "       [--edns-stats]\n"
         "\n"
         "Mandatory options:\n"
         "\t-i | --interface                - Sets interface that program will\n" 
-        "\t                                  monitor for DNS communication\n"
+        "\t                                  monitor for DNS communication, can\n"
+        "\t                                  be repeated to monitor more \n"
+        "\t                                  interfaces at once\n"
         "\t-p | --pcapfile <PATH_TO_FILE>  - Opens a .pcapng file from which \n"
         "\t                                  program will read captured DNS \n"
-        "\t                                  communication\n"
+        "\t                                  communication, can be repeated and\n"
+        "\t                                  accepts more files, glob patterns \n"
+        "\t                                  and directories\n"
         "\t-o | --display-interfaces        - Displays available interfaces on \n"
         "\t                                  device. Devices with '*' before them\n"
         "\t                                  are flagged as non applicable by \n"
         "\t                                  pcap library.\n"
+        , executableName
+    );
+
+    // split into multiple calls, ISO C limits length of string literal
+    printf(
         "Non-mandatory options:\n"
         "\t-v | --verbose                  - Prints full details about DNS \n"
         "\t                                  communication, otherwise a output\n"
@@ -134,8 +570,81 @@ void printCliHelpMenu(const char* executableName)
         "\t-t | --translationsfile <PATH>  - All translations from domain name \n"
         "\t                                  to IP addresses will be stored in \n"
         "\t                                  <PATH> specified file\n"
+        "\t--ring                          - Captures using AF_PACKET TPACKET_V3\n"
+        "\t                                  memory-mapped ring instead of \n"
+        "\t                                  libpcap (only with -i)\n"
+        "\t--ring-block-size <BYTES>       - Size of one ring block, must be \n"
+        "\t                                  multiple of page size (default 4MiB)\n"
+        "\t--ring-blocks <N>               - Number of blocks in ring (default 64)\n"
+        "\t--ring-timeout <MS>             - Time after which kernel hands not \n"
+        "\t                                  full block to program (default 60ms)\n"
+        "\t--workers <N>                   - Captures on N cores, each worker has\n"
+        "\t                                  own ring in PACKET_FANOUT group \n"
+        "\t                                  hashed by flow (implies --ring), \n"
+        "\t                                  with -p processes N files at once\n"
+        "\t                                  (default number of CPUs), single \n"
+        "\t                                  file is split into chunks\n"
+        "\t--batch <K>                     - Pulls up to K packets at once and \n"
+        "\t                                  processes them stage by stage \n"
+        "\t                                  (0 = packet by packet, default)\n"
+        "\t--snaplen <BYTES>               - Maximum captured length of packet \n"
+        "\t                                  (default " STRINGIFY(DEFAULT_SNAPLEN) ", "
+        STRINGIFY(RING_DEFAULT_SNAPLEN) " with --ring)\n"
+        "\t--buffer-size <BYTES>           - Size of kernel capture buffer \n"
+        "\t                                  (default libpcap default, 2MiB)\n"
+        "\t--immediate                     - Delivers packets as soon as they \n"
+        "\t                                  arrive instead of buffering them\n"
+        "\t--timeout <MS>                  - Packet buffer timeout (default 1000)\n"
+        "\t--stats-interval <S>            - Prints received/dropped packet \n"
+        "\t                                  counters to stderr every S seconds\n"
+        "\t--adaptive-buffer <BYTES>       - Doubles capture buffer (or number \n"
+        "\t                                  of ring blocks) up to BYTES when \n"
+        "\t                                  more than 1%% of packets is dropped\n"
+        "\t                                  during statistics interval (default\n"
+        "\t                                  interval " STRINGIFY(DEFAULT_STATS_INTERVAL) "s, not with --workers)\n"
+    );
+
+    printf(
+        "\t--qtype <LIST>                  - Shows only messages asking for one \n"
+        "\t                                  of comma separated question types \n"
+        "\t                                  (names like A,AAAA,MX or numbers)\n"
+        "\t--zone <LIST>                   - Shows only messages whose question \n"
+        "\t                                  name is in one of comma separated \n"
+        "\t                                  domains (e.g. example.com)\n"
+        "\t--responses-only                - Shows only DNS responses\n"
+        "\t--queries-only                  - Shows only DNS queries\n"
+        "\t--opcode <N>                    - Shows only messages with OPCODE N\n"
+        "\t                                  (DNS filters are evaluated by kernel\n"
+        "\t                                  before packets are copied)\n"
+        "\t--ordered                       - Prints messages of multiple files \n"
+        "\t                                  in time order (output of files is\n"
+        "\t                                  buffered until it can be merged)\n"
+        "\t--index-cache                   - Stores record index of file split \n"
+        "\t                                  by --workers into <file>.idx, so \n"
+        "\t                                  next run does not scan file again\n"
+        "\t-w | --write <PATH>             - Writes captured DNS packets into \n"
+        "\t                                  pcapng file by own thread (packets\n"
+        "\t                                  are dropped from file, never from \n"
+        "\t                                  capture, when disk is slow)\n"
+        "\t--rotate-size <MIB>             - Starts new file <PATH>.<N> after \n"
+        "\t                                  MIB mebibytes\n"
+        "\t--rotate-time <S>               - Starts new file <PATH>.<N> after \n"
+        "\t                                  S seconds of capture\n"
+        "\t--rotate-count <N>              - Keeps only N newest files\n"
+        "\t--replay                        - Replays -p file at recorded speed\n"
+        "\t                                  and reports achieved rate, latency\n"
+        "\t                                  of stages and packet at which \n"
+        "\t                                  dissector fell behind\n"
+        "\t--replay-speed <X>              - Replays at X times recorded speed\n"
+        "\t--replay-pps <N>                - Replays at N packets per second\n"
+        "\t--quarantine <PATH>             - Writes malformed packets, which \n"
+        "\t                                  are skipped by dissector, into \n"
+        "\t                                  pcapng file\n"
+        "\t--edns-stats                    - Prints histograms of advertised \n"
+        "\t                                  EDNS0 UDP sizes (also of truncated\n"
+        "\t                                  responses) and of client subnet \n"
+        "\t                                  prefixes when program ends\n"
         "\t-h | --help                     - Prints this help menu end exits \n"
         "\t                                  program with code 0\n"
-        , executableName
     );
 }
\ No newline at end of file
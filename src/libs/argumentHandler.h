@@ -15,10 +15,14 @@
 
 #include "getopt.h"
 #include "string.h"
+#include "glob.h"
+#include "dirent.h"
+#include "sys/stat.h"
 
 #include "utils.h"
 #include "buffer.h"
 #include "programConfig.h"
+#include "packetBatch.h"
 
 // ----------------------------------------------------------------------------
 //  Structures and enums
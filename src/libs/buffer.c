@@ -88,25 +88,28 @@ void bufferCopy(Buffer* dst, Buffer* src)
  * @param buffer Input buffer
  * @param printHex prints characters that are non printable in () if set to true
  * as characters and other chars will be printed as hex codes
+ * @param output Stream where buffer is printed
  */
-void bufferPrint(Buffer* buffer, bool printHex)
+void bufferPrint(Buffer* buffer, bool printHex, FILE* output)
 {
     if(buffer->data == NULL || buffer->used == 0) { return; }
 
+    // printable characters are written in runs
+    size_t start = 0;
     for(size_t i = 0; i < buffer->used; i++)
     {
         char c = buffer->data[i];
-        // if( (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
         if( (c >= 0x20 && c <= 0x7e) )
-        {
-            printf("%c", c);
-        }
-        else
-        {
-            if(printHex)
-                printf("(%hhx)", (unsigned char)c);
-        }
+            continue;
+
+        fwrite(buffer->data + start, 1, i - start, output);
+        start = i + 1;
+
+        if(printHex)
+            fprintf(output, "(%hhx)", (unsigned char)c);
     }
+
+    fwrite(buffer->data + start, 1, buffer->used - start, output);
 }
 
 /**
@@ -147,6 +150,28 @@ void bufferAddChar(Buffer* buffer, char ch)
     buffer->used = buffer->used + 1;
 }
 
+/**
+ * @brief Adds length bytes to the end of buffer, buffer is grown at least
+ * twice, so repeated adding is not reallocating every time
+ * 
+ * @param buffer pointer to initialized buffer 
+ * @param bytes bytes that will be added, must not point into buffer
+ * @param length number of added bytes
+ */
+void bufferAddBytes(Buffer* buffer, const char* bytes, size_t length)
+{
+    if(buffer->used + length > buffer->allocated)
+    {
+        size_t grown = buffer->allocated * 2;
+        bufferResize(buffer, (grown > buffer->used + length)? grown : buffer->used + length);
+    }
+
+    if(length > 0)
+        memcpy(&(buffer->data[buffer->used]), bytes, length);
+
+    buffer->used = buffer->used + length;
+}
+
 /**
  * @brief Sets buffer used size to 0 and sets first byte to '\0'
  * 
@@ -80,8 +80,9 @@ size_t loadBufferFromStdin(Buffer* buffer, bool* eofDetected);
  * @param buffer Input buffer
  * @param printHex prints characters that are non printable in () if set to true
  * as characters and other chars will be printed as hex codes
+ * @param output Stream where buffer is printed
  */
-void bufferPrint(Buffer* buffer, bool printHex);
+void bufferPrint(Buffer* buffer, bool printHex, FILE* output);
 
 /**
  * @brief Destroys Buffer and frees memory
@@ -110,6 +111,16 @@ void bufferAddString(Buffer* buffer, char* string);
  */
 void bufferAddChar(Buffer* buffer, char ch);
 
+/**
+ * @brief Adds length bytes to the end of buffer, buffer is grown at least
+ * twice, so repeated adding is not reallocating every time
+ * 
+ * @param buffer pointer to initialized buffer 
+ * @param bytes bytes that will be added, must not point into buffer
+ * @param length number of added bytes
+ */
+void bufferAddBytes(Buffer* buffer, const char* bytes, size_t length);
+
 /**
  * @brief Sets buffer used size to 0 and sets first byte to '\0'
  * 
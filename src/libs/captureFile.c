@@ -0,0 +1,682 @@
+/**
+ * @file captureFile.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of memory-mapped pcap and pcapng reader
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "captureFile.h"
+
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_FILE_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_OPB 0x00000002       // obsolete packet block
+#define PCAPNG_SPB 0x00000003
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BOM 0x1A2B3C4D
+#define PCAPNG_BLOCK_MIN_LEN 12
+#define PCAPNG_SHB_MIN_LEN 16       // type, length, byte order magic, version
+
+#define PCAPNG_OPT_END 0
+#define PCAPNG_OPT_TSRESOL 9
+#define PCAPNG_OPT_TSOFFSET 14
+
+#define LINKTYPE_RAW 101            // pcap LINKTYPE that differs from DLT
+#define LINKTYPE_MASK 0x03FFFFFF    // upper bits carry FCS length
+
+#define CAPTURE_ERR(...) snprintf(file->errbuf, PCAP_ERRBUF_SIZE, __VA_ARGS__)
+
+/**
+ * @brief Reads 16 bit number in byte order of the file
+ *
+ * @param file Pointer to the CaptureFile
+ * @param ptr Pointer into mapping
+ * @return unsigned short Number in host order
+ */
+unsigned short captureRead16(CaptureFile* file, const unsigned char* ptr)
+{
+    unsigned short value;
+    memcpy(&value, ptr, sizeof(value));
+
+    return file->swapped? __builtin_bswap16(value) : value;
+}
+
+/**
+ * @brief Reads 32 bit number in byte order of the file
+ *
+ * @param file Pointer to the CaptureFile
+ * @param ptr Pointer into mapping
+ * @return unsigned Number in host order
+ */
+unsigned captureRead32(CaptureFile* file, const unsigned char* ptr)
+{
+    unsigned value;
+    memcpy(&value, ptr, sizeof(value));
+
+    return file->swapped? __builtin_bswap32(value) : value;
+}
+
+/**
+ * @brief Converts pcap LINKTYPE value into DLT value used by libpcap
+ *
+ * @param linkType LINKTYPE from file
+ * @return int DLT value
+ */
+int captureLinkTypeToDlt(unsigned linkType)
+{
+    linkType &= LINKTYPE_MASK;
+
+    if(linkType == LINKTYPE_RAW)
+        return DLT_RAW;
+
+    return (int) linkType;
+}
+
+/**
+ * @brief Reads pcap file header
+ *
+ * @param file Pointer to the CaptureFile
+ * @return true File header is valid
+ * @return false Unknown format
+ */
+bool captureReadPcapHeader(CaptureFile* file)
+{
+    if(file->size < PCAP_FILE_HEADER_LEN)
+        return false;
+
+    unsigned magic;
+    memcpy(&magic, file->map, sizeof(magic));
+
+    switch(magic)
+    {
+        case PCAP_MAGIC_USEC: break;
+        case PCAP_MAGIC_NSEC: file->nanoseconds = true; break;
+        case __builtin_bswap32(PCAP_MAGIC_USEC): file->swapped = true; break;
+        case __builtin_bswap32(PCAP_MAGIC_NSEC): file->swapped = file->nanoseconds = true; break;
+        default: return false;
+    }
+
+    file->snaplen = captureRead32(file, file->map + 16);
+    file->linkType = captureLinkTypeToDlt(captureRead32(file, file->map + 20));
+    file->offset = PCAP_FILE_HEADER_LEN;
+
+    return true;
+}
+
+/**
+ * @brief Reads Section Header Block, byte order of section is taken from it
+ * and interfaces of previous section are forgotten
+ *
+ * @param file Pointer to the CaptureFile
+ * @param block Start of the block
+ * @param left Number of mapped bytes from the start of the block
+ * @return true Block is valid
+ * @return false Block is truncated, unknown byte order or version
+ */
+bool captureReadSectionHeader(CaptureFile* file, const unsigned char* block, size_t left)
+{
+    // byte order magic and version are read before length of block is known
+    if(left < PCAPNG_SHB_MIN_LEN)
+        return false;
+
+    unsigned bom;
+    memcpy(&bom, block + 8, sizeof(bom));
+
+    if(bom == PCAPNG_BOM)
+        file->swapped = false;
+    else if(bom == __builtin_bswap32(PCAPNG_BOM))
+        file->swapped = true;
+    else
+        return false;
+
+    if(captureRead16(file, block + 12) != 1)
+        return false;
+
+    file->interfaceCount = 0;
+
+    return true;
+}
+
+/**
+ * @brief Reads Interface Description Block and its timestamp options
+ *
+ * @param file Pointer to the CaptureFile
+ * @param block Start of the block
+ * @param length Total length of the block
+ * @return true Block is valid
+ * @return false Block is malformed
+ */
+bool captureReadInterface(CaptureFile* file, const unsigned char* block, size_t length)
+{
+    if(length < 20)
+        return false;
+
+    if(file->interfaceCount == file->interfaceMax)
+    {
+        unsigned newMax = (file->interfaceMax > 0)? file->interfaceMax * 2 : 4;
+        CaptureInterface* tmp = (CaptureInterface*) realloc(file->interfaces,
+            sizeof(CaptureInterface) * newMax);
+        if(tmp == NULL)
+            errHandling("Failed to allocate memory for capture interfaces", ERR_MALLOC);
+
+        file->interfaces = tmp;
+        file->interfaceMax = newMax;
+    }
+
+    CaptureInterface* interface = &(file->interfaces[file->interfaceCount++]);
+    interface->linkType = captureLinkTypeToDlt(captureRead16(file, block + 8));
+    interface->tsUnits = 1000000;
+    interface->tsOffset = 0;
+
+    // options are between fixed fields and trailing block length
+    size_t ptr = 16;
+    while(ptr + 4 <= length - 4)
+    {
+        unsigned short code = captureRead16(file, block + ptr);
+        unsigned short optLen = captureRead16(file, block + ptr + 2);
+        if(code == PCAPNG_OPT_END || ptr + 4 + optLen > length - 4)
+            break;
+
+        if(code == PCAPNG_OPT_TSRESOL && optLen >= 1)
+        {
+            unsigned char resol = block[ptr + 4];
+            unsigned exponent = resol & 0x7f;
+            if(exponent > ((resol & 0x80)? 63 : 19))
+                return false;
+
+            interface->tsUnits = 1;
+            for(unsigned i = 0; i < exponent; i++)
+                interface->tsUnits *= (resol & 0x80)? 2 : 10;
+        }
+        else if(code == PCAPNG_OPT_TSOFFSET && optLen >= 8)
+        {
+            unsigned long long value = ((unsigned long long) captureRead32(file, block + ptr + 8) << 32) |
+                captureRead32(file, block + ptr + 4);
+            if(file->swapped)
+                value = (value << 32) | (value >> 32);
+            interface->tsOffset = (long long) value;
+        }
+
+        ptr += 4 + ((optLen + 3) & ~3u);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Finds link type of first interface of pcapng file, blocks are only
+ * inspected, reading continues from the start of the file
+ *
+ * @param file Pointer to the CaptureFile
+ * @return true File starts with valid Section Header Block
+ * @return false Unknown format
+ */
+bool captureReadPcapngHeader(CaptureFile* file)
+{
+    if(file->size < 28)
+        return false;
+
+    unsigned type;
+    memcpy(&type, file->map, sizeof(type));
+    if(type != PCAPNG_SHB || !captureReadSectionHeader(file, file->map, file->size))
+        return false;
+
+    file->pcapng = true;
+    file->linkType = DLT_EN10MB;
+    file->snaplen = 0;
+
+    size_t ptr = 0;
+    while(ptr + PCAPNG_BLOCK_MIN_LEN <= file->size)
+    {
+        unsigned blockType = captureRead32(file, file->map + ptr);
+        unsigned blockLen = captureRead32(file, file->map + ptr + 4);
+        if(blockLen < PCAPNG_BLOCK_MIN_LEN || ptr + blockLen > file->size)
+            break;
+
+        if(blockType == PCAPNG_IDB && blockLen >= 20)
+        {
+            file->linkType = captureLinkTypeToDlt(captureRead16(file, file->map + ptr + 8));
+            file->snaplen = captureRead32(file, file->map + ptr + 12);
+            break;
+        }
+
+        ptr += blockLen;
+    }
+
+    file->offset = 0;
+
+    return true;
+}
+
+/**
+ * @brief Maps savefile into memory and reads its header
+ *
+ * @param path Path to the file
+ * @param errbuf Buffer of PCAP_ERRBUF_SIZE characters for error message
+ * @return CaptureFile* Opened file or NULL if file can not be mapped or has
+ * unknown format
+ */
+CaptureFile* captureFileOpen(const char* path, char* errbuf)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    // pipes and empty files are left to libpcap
+    struct stat info;
+    if(fstat(fd, &info) < 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+    {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: not a regular non-empty file", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+    {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: mmap failed: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    // file is read once from start to end, kernel can read ahead
+    // aggressively and drop pages behind
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+
+    CaptureFile* file = (CaptureFile*) malloc(sizeof(CaptureFile));
+    if(file == NULL)
+        errHandling("Failed to allocate memory for CaptureFile", ERR_MALLOC);
+
+    memset(file, 0, sizeof(CaptureFile));
+    file->fd = fd;
+    file->map = (const unsigned char*) map;
+    file->size = info.st_size;
+    file->end = info.st_size;
+
+    if(!captureReadPcapHeader(file) && !captureReadPcapngHeader(file))
+    {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: unknown file format", path);
+        captureFileClose(file);
+        return NULL;
+    }
+
+    if(file->snaplen == 0)
+        file->snaplen = CAPTURE_FILE_DEFAULT_SNAPLEN;
+
+    return file;
+}
+
+/**
+ * @brief Unmaps file and frees it
+ *
+ * @param file Pointer to the CaptureFile, can be NULL
+ */
+void captureFileClose(CaptureFile* file)
+{
+    if(file == NULL)
+        return;
+
+    munmap((void*) file->map, file->size);
+    close(file->fd);
+
+    free(file->interfaces);
+    free(file->filter.bf_insns);
+    free(file);
+}
+
+/**
+ * @brief Sets filter that packets must pass, program is copied
+ *
+ * @param file Pointer to the CaptureFile
+ * @param fp Compiled filter
+ */
+void captureFileSetFilter(CaptureFile* file, struct bpf_program* fp)
+{
+    size_t size = sizeof(struct bpf_insn) * fp->bf_len;
+
+    free(file->filter.bf_insns);
+    file->filter.bf_insns = (struct bpf_insn*) malloc(size);
+    if(file->filter.bf_insns == NULL)
+        errHandling("Failed to allocate memory for capture filter", ERR_MALLOC);
+
+    memcpy(file->filter.bf_insns, fp->bf_insns, size);
+    file->filter.bf_len = fp->bf_len;
+    file->hasFilter = true;
+}
+
+/**
+ * @brief Reads next pcap record
+ *
+ * @param file Pointer to the CaptureFile
+ * @param data Pointer where pointer to packet data is stored
+ * @return int 1 packet was read, PCAP_ERROR_BREAK end of file, PCAP_ERROR
+ * truncated record
+ */
+int captureNextPcap(CaptureFile* file, const unsigned char** data)
+{
+    if(file->offset >= file->end)
+        return PCAP_ERROR_BREAK;
+
+    if(file->size - file->offset < PCAP_RECORD_HEADER_LEN)
+    {
+        CAPTURE_ERR("truncated dump file; tried to read %d header bytes, only got %zu",
+            PCAP_RECORD_HEADER_LEN, file->size - file->offset);
+        return PCAP_ERROR;
+    }
+
+    const unsigned char* record = file->map + file->offset;
+    unsigned caplen = captureRead32(file, record + 8);
+
+    if(file->size - file->offset - PCAP_RECORD_HEADER_LEN < caplen)
+    {
+        CAPTURE_ERR("truncated dump file; tried to read %u captured bytes, only got %zu",
+            caplen, file->size - file->offset - PCAP_RECORD_HEADER_LEN);
+        return PCAP_ERROR;
+    }
+
+    unsigned fraction = captureRead32(file, record + 4);
+
+    file->header.ts.tv_sec = captureRead32(file, record);
+    file->header.ts.tv_usec = file->nanoseconds? fraction / 1000 : fraction;
+    file->header.caplen = caplen;
+    file->header.len = captureRead32(file, record + 12);
+
+    *data = record + PCAP_RECORD_HEADER_LEN;
+    file->offset += PCAP_RECORD_HEADER_LEN + caplen;
+
+    return 1;
+}
+
+/**
+ * @brief Fills packet header timestamp from pcapng timestamp of interface
+ *
+ * @param file Pointer to the CaptureFile
+ * @param interface Interface that captured the packet
+ * @param high Upper 32 bits of timestamp
+ * @param low Lower 32 bits of timestamp
+ */
+void captureSetTimestamp(CaptureFile* file, CaptureInterface* interface,
+                        unsigned high, unsigned low)
+{
+    unsigned long long ts = ((unsigned long long) high << 32) | low;
+    unsigned long long units = interface->tsUnits;
+    unsigned long long fraction = ts % units;
+
+    file->header.ts.tv_sec = ts / units + interface->tsOffset;
+
+    if(units == 1000000)
+        file->header.ts.tv_usec = fraction;
+    else if(units > 1000000)
+        file->header.ts.tv_usec = fraction / (units / 1000000);
+    else
+        file->header.ts.tv_usec = fraction * 1000000 / units;
+}
+
+/**
+ * @brief Reads pcapng blocks until next packet block
+ *
+ * @param file Pointer to the CaptureFile
+ * @param data Pointer where pointer to packet data is stored
+ * @return int 1 packet was read, 0 header block was read (only with
+ * stopAtHeaders), PCAP_ERROR_BREAK end of file, PCAP_ERROR malformed block
+ */
+int captureNextPcapng(CaptureFile* file, const unsigned char** data)
+{
+    while(true)
+    {
+        if(file->offset >= file->end)
+            return PCAP_ERROR_BREAK;
+
+        const unsigned char* block = file->map + file->offset;
+        size_t left = file->size - file->offset;
+        if(left < PCAPNG_BLOCK_MIN_LEN)
+        {
+            CAPTURE_ERR("truncated pcapng block at offset %zu", file->offset);
+            return PCAP_ERROR;
+        }
+
+        unsigned type;
+        memcpy(&type, block, sizeof(type));
+        if(type == PCAPNG_SHB && !captureReadSectionHeader(file, block, left))
+        {
+            CAPTURE_ERR("invalid section header at offset %zu", file->offset);
+            return PCAP_ERROR;
+        }
+
+        type = captureRead32(file, block);
+        unsigned length = captureRead32(file, block + 4);
+        if(length < PCAPNG_BLOCK_MIN_LEN || length % 4 != 0 || length > left)
+        {
+            CAPTURE_ERR("invalid pcapng block length %u at offset %zu", length, file->offset);
+            return PCAP_ERROR;
+        }
+
+        file->offset += length;
+
+        unsigned interfaceId = 0;
+        unsigned caplen = 0;
+        unsigned origlen = 0;
+        const unsigned char* packet = NULL;
+        size_t dataMax = 0;
+
+        switch(type)
+        {
+            case PCAPNG_SHB:
+                if(file->stopAtHeaders)
+                    return 0;
+                continue;
+            case PCAPNG_IDB:
+                if(!captureReadInterface(file, block, length))
+                {
+                    CAPTURE_ERR("invalid interface description block");
+                    return PCAP_ERROR;
+                }
+                if(file->stopAtHeaders)
+                    return 0;
+                continue;
+            case PCAPNG_EPB:
+                if(length < 32)
+                    break;
+                interfaceId = captureRead32(file, block + 8);
+                caplen = captureRead32(file, block + 20);
+                origlen = captureRead32(file, block + 24);
+                packet = block + 28;
+                dataMax = length - 32;
+                break;
+            case PCAPNG_OPB:
+                if(length < 32)
+                    break;
+                interfaceId = captureRead16(file, block + 8);
+                caplen = captureRead32(file, block + 20);
+                origlen = captureRead32(file, block + 24);
+                packet = block + 28;
+                dataMax = length - 32;
+                break;
+            case PCAPNG_SPB:
+                if(length < 16)
+                    break;
+                origlen = captureRead32(file, block + 8);
+                packet = block + 12;
+                dataMax = length - 16;
+                caplen = (origlen < dataMax)? origlen : dataMax;
+                break;
+            default:
+                // statistics, name resolution, custom and unknown blocks
+                continue;
+        }
+
+        if(packet == NULL || caplen > dataMax)
+        {
+            CAPTURE_ERR("invalid packet block at offset %zu", file->offset - length);
+            return PCAP_ERROR;
+        }
+
+        if(interfaceId >= file->interfaceCount)
+        {
+            CAPTURE_ERR("packet block references unknown interface %u", interfaceId);
+            return PCAP_ERROR;
+        }
+
+        CaptureInterface* interface = &(file->interfaces[interfaceId]);
+
+        // dissector decodes single datalink, same as libpcap
+        if(interface->linkType != file->linkType)
+        {
+            if(!file->warnedLinkType)
+                fprintf(stderr, "WARNING: Skipping packets of interface %u with "
+                    "different datalink type\n", interfaceId);
+            file->warnedLinkType = true;
+            continue;
+        }
+
+        if(type == PCAPNG_SPB)
+        {
+            file->header.ts.tv_sec = 0;
+            file->header.ts.tv_usec = 0;
+        }
+        else
+            captureSetTimestamp(file, interface, captureRead32(file, block + 12),
+                captureRead32(file, block + 16));
+
+        file->header.caplen = caplen;
+        file->header.len = origlen;
+        *data = packet;
+
+        return 1;
+    }
+}
+
+/**
+ * @brief Returns next packet that passes filter, same as pcap_next_ex()
+ *
+ * @param file Pointer to the CaptureFile
+ * @param header Pointer where pointer to packet header is stored
+ * @param data Pointer where pointer to packet data (inside of mapping) is
+ * stored
+ * @return int 1 packet was read, 0 header block was read (only with
+ * stopAtHeaders), PCAP_ERROR_BREAK end of file, PCAP_ERROR malformed file
+ * (message is in file->errbuf)
+ */
+int captureFileNext(CaptureFile* file, struct pcap_pkthdr** header, const unsigned char** data)
+{
+    while(true)
+    {
+        int res = file->pcapng? captureNextPcapng(file, data) : captureNextPcap(file, data);
+        if(res != 1)
+            return res;
+
+        if(file->hasFilter && pcap_offline_filter(&(file->filter), &(file->header), *data) == 0)
+            continue;
+
+        *header = &(file->header);
+        return 1;
+    }
+}
+
+/**
+ * @brief Calls callback for up to count packets, same as pcap_dispatch()
+ *
+ * @param file Pointer to the CaptureFile
+ * @param count Maximum number of packets, zero or negative for all
+ * @param callback Function called for every packet
+ * @param user User data passed to the callback
+ * @return int Number of processed packets (0 at end of file) or PCAP_ERROR
+ */
+int captureFileDispatch(CaptureFile* file, int count, pcap_handler callback, unsigned char* user)
+{
+    int processed = 0;
+
+    while(count <= 0 || processed < count)
+    {
+        struct pcap_pkthdr* header;
+        const unsigned char* data;
+
+        int res = captureFileNext(file, &header, &data);
+        if(res == PCAP_ERROR_BREAK)
+            break;
+
+        // same as libpcap, error is returned even if some packets were processed
+        if(res == PCAP_ERROR)
+            return PCAP_ERROR;
+
+        callback(user, header, data);
+        processed++;
+    }
+
+    return processed;
+}
+
+/**
+ * @brief Moves reading to record or block boundary found by index scan,
+ * pcapng header blocks before it are read again so interfaces of its
+ * section are known
+ *
+ * @param file Pointer to the CaptureFile
+ * @param offset Start of record/block where reading continues
+ * @param end Reading ends at this offset as if file ended there
+ * @param headers Sorted offsets of all pcapng header blocks (SHB, IDB)
+ * @param headerCount Number of header blocks
+ * @return true Reading was moved
+ * @return false Offsets do not fit file or header block is invalid
+ */
+bool captureFileSeek(CaptureFile* file, size_t offset, size_t end,
+                    const size_t* headers, unsigned headerCount)
+{
+    if(offset > end || end > file->size)
+        return false;
+
+    if(file->pcapng)
+    {
+        file->interfaceCount = 0;
+
+        for(unsigned i = 0; i < headerCount && headers[i] < offset; i++)
+        {
+            if(file->size - headers[i] < PCAPNG_BLOCK_MIN_LEN)
+                return false;
+
+            const unsigned char* block = file->map + headers[i];
+            unsigned type;
+            memcpy(&type, block, sizeof(type));
+
+            // byte order of section is known only after its header is read
+            if(type == PCAPNG_SHB)
+            {
+                if(!captureReadSectionHeader(file, block, file->size - headers[i]))
+                    return false;
+                continue;
+            }
+
+            unsigned length = captureRead32(file, block + 4);
+            if(captureRead32(file, block) != PCAPNG_IDB || length > file->size - headers[i] ||
+                !captureReadInterface(file, block, length))
+            {
+                return false;
+            }
+        }
+    }
+    else if(offset < PCAP_FILE_HEADER_LEN)
+        return false;
+
+    file->offset = offset;
+    file->end = end;
+
+    return true;
+}
+
+#undef CAPTURE_ERR
@@ -0,0 +1,140 @@
+/**
+ * @file captureFile.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Native reader of pcap and pcapng savefiles. Whole file is mapped
+ * into memory (with sequential readahead) and packets are returned as
+ * slices pointing straight into the mapping, so no record is copied through
+ * stdio buffers. Interface mirrors pcap_next_ex() and pcap_dispatch(),
+ * filter is applied same way as libpcap does for savefiles.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pcap/pcap.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define CAPTURE_FILE_DEFAULT_SNAPLEN 262144
+
+/**
+ * @brief Interface described by pcapng Interface Description Block
+ */
+typedef struct CaptureInterface {
+    int linkType;
+    unsigned long long tsUnits;     // timestamp units per second
+    long long tsOffset;             // seconds added to every timestamp
+} CaptureInterface;
+
+/**
+ * @brief Opened savefile
+ */
+typedef struct CaptureFile {
+    int fd;
+    const unsigned char* map;
+    size_t size;
+    size_t offset;                  // start of next record/block
+    size_t end;                     // records are read up to here (whole file by default)
+
+    bool pcapng;
+    bool swapped;                   // file (section) has other byte order
+    bool nanoseconds;               // pcap only
+    int linkType;
+    unsigned snaplen;
+
+    // pcapng interfaces of current section
+    CaptureInterface* interfaces;
+    unsigned interfaceCount;
+    unsigned interfaceMax;
+    bool warnedLinkType;
+
+    // header blocks (SHB, IDB) are reported to index scan
+    bool stopAtHeaders;
+
+    struct bpf_program filter;
+    bool hasFilter;
+
+    struct pcap_pkthdr header;
+    char errbuf[PCAP_ERRBUF_SIZE];
+} CaptureFile;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Maps savefile into memory and reads its header
+ *
+ * @param path Path to the file
+ * @param errbuf Buffer of PCAP_ERRBUF_SIZE characters for error message
+ * @return CaptureFile* Opened file or NULL if file can not be mapped or has
+ * unknown format
+ */
+CaptureFile* captureFileOpen(const char* path, char* errbuf);
+
+/**
+ * @brief Unmaps file and frees it
+ *
+ * @param file Pointer to the CaptureFile, can be NULL
+ */
+void captureFileClose(CaptureFile* file);
+
+/**
+ * @brief Sets filter that packets must pass, program is copied
+ *
+ * @param file Pointer to the CaptureFile
+ * @param fp Compiled filter
+ */
+void captureFileSetFilter(CaptureFile* file, struct bpf_program* fp);
+
+/**
+ * @brief Returns next packet that passes filter, same as pcap_next_ex()
+ *
+ * @param file Pointer to the CaptureFile
+ * @param header Pointer where pointer to packet header is stored
+ * @param data Pointer where pointer to packet data (inside of mapping) is
+ * stored
+ * @return int 1 packet was read, 0 header block was read (only with
+ * stopAtHeaders), PCAP_ERROR_BREAK end of file, PCAP_ERROR malformed file
+ * (message is in file->errbuf)
+ */
+int captureFileNext(CaptureFile* file, struct pcap_pkthdr** header, const unsigned char** data);
+
+/**
+ * @brief Calls callback for up to count packets, same as pcap_dispatch()
+ *
+ * @param file Pointer to the CaptureFile
+ * @param count Maximum number of packets, zero or negative for all
+ * @param callback Function called for every packet
+ * @param user User data passed to the callback
+ * @return int Number of processed packets (0 at end of file) or PCAP_ERROR
+ */
+int captureFileDispatch(CaptureFile* file, int count, pcap_handler callback, unsigned char* user);
+
+/**
+ * @brief Moves reading to record or block boundary found by index scan,
+ * pcapng header blocks before it are read again so interfaces of its
+ * section are known
+ *
+ * @param file Pointer to the CaptureFile
+ * @param offset Start of record/block where reading continues
+ * @param end Reading ends at this offset as if file ended there
+ * @param headers Sorted offsets of all pcapng header blocks (SHB, IDB)
+ * @param headerCount Number of header blocks
+ * @return true Reading was moved
+ * @return false Offsets do not fit file or header block is invalid
+ */
+bool captureFileSeek(CaptureFile* file, size_t offset, size_t end,
+                    const size_t* headers, unsigned headerCount);
+
+#endif /*CAPTURE_FILE_H*/
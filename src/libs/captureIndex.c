@@ -0,0 +1,494 @@
+/**
+ * @file captureIndex.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of savefile index and its cache
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "captureIndex.h"
+#include "frameDecoder.h"
+#include "tcpReassembly.h"
+#include "ipReassembly.h"
+#include "dnsMessage.h"
+
+#include "string.h"
+#include "unistd.h"
+#include "sys/stat.h"
+#include "netinet/in.h"
+
+/**
+ * @brief Header of cache file, followed by entries and header block offsets
+ */
+typedef struct CaptureIndexHeader {
+    char magic[8];
+    unsigned long long fileSize;
+    long long mtimeSec;
+    long long mtimeNsec;
+    unsigned entrySize;             // cache is rejected if layout differs
+    unsigned entryCount;
+    unsigned headerCount;
+} CaptureIndexHeader;
+
+/**
+ * @brief Reassembly state of sequential reading rebuilt during index scan,
+ * messages completed by it are not dissected
+ */
+typedef struct CaptureIndexScan {
+    TcpFlowTable* tcpFlows;
+    IpFragTable* ipFrags;
+    const TcpFlowKey* key;          // addresses of current packet
+    unsigned char transport;        // protocol of current packet
+    time_t now;                     // timestamp of current packet
+} CaptureIndexScan;
+
+/**
+ * @brief Creates empty index
+ *
+ * @param size Size of indexed file
+ * @return CaptureIndex* Allocated index
+ */
+CaptureIndex* captureIndexCreate(size_t size)
+{
+    CaptureIndex* index = (CaptureIndex*) calloc(1, sizeof(CaptureIndex));
+    if(index == NULL)
+        errHandling("Failed to allocate memory for CaptureIndex", ERR_MALLOC);
+
+    index->size = size;
+
+    return index;
+}
+
+/**
+ * @brief Destroys index
+ *
+ * @param index Pointer to the CaptureIndex, can be NULL
+ */
+void captureIndexDestroy(CaptureIndex* index)
+{
+    if(index == NULL)
+        return;
+
+    free(index->entries);
+    free(index->headers);
+    free(index);
+}
+
+/**
+ * @brief Appends entry to the index
+ *
+ * @param index Pointer to the CaptureIndex
+ * @param offset Start of record/block
+ * @param ts Timestamp of packet that starts at offset
+ */
+void captureIndexAddEntry(CaptureIndex* index, size_t offset, struct timeval ts)
+{
+    if(index->count == index->max)
+    {
+        unsigned newMax = (index->max > 0)? index->max * 2 : 256;
+        CaptureIndexEntry* tmp = (CaptureIndexEntry*) realloc(index->entries,
+            sizeof(CaptureIndexEntry) * newMax);
+        if(tmp == NULL)
+            errHandling("Failed to allocate memory for CaptureIndex", ERR_MALLOC);
+
+        index->entries = tmp;
+        index->max = newMax;
+    }
+
+    CaptureIndexEntry* entry = &(index->entries[index->count++]);
+    entry->offset = offset;
+    entry->ts = ts;
+}
+
+/**
+ * @brief Appends offset of pcapng header block to the index
+ *
+ * @param index Pointer to the CaptureIndex
+ * @param offset Start of the block
+ */
+void captureIndexAddHeader(CaptureIndex* index, size_t offset)
+{
+    if(index->headerCount == index->headerMax)
+    {
+        unsigned newMax = (index->headerMax > 0)? index->headerMax * 2 : 8;
+        size_t* tmp = (size_t*) realloc(index->headers, sizeof(size_t) * newMax);
+        if(tmp == NULL)
+            errHandling("Failed to allocate memory for CaptureIndex", ERR_MALLOC);
+
+        index->headers = tmp;
+        index->headerMax = newMax;
+    }
+
+    index->headers[index->headerCount++] = offset;
+}
+
+/**
+ * @brief Ignores DNS message completed during index scan
+ *
+ * @param message Start of DNS message
+ * @param length Length of DNS message
+ * @param user Unused
+ */
+void captureIndexMessage(const unsigned char* message, size_t length, void* user)
+{
+    (void) message;
+    (void) length;
+    (void) user;
+}
+
+/**
+ * @brief Adds TCP segment to flows of scan, segment is checked and filtered
+ * by port same way as transportDissector() does it, so scan opens same flows
+ *
+ * @param scan Pointer to the CaptureIndexScan
+ * @param segment Start of TCP header
+ * @param length Length of TCP header and data
+ */
+void captureIndexSegment(CaptureIndexScan* scan, const unsigned char* segment, size_t length)
+{
+    struct tcphdr* tcp = (struct tcphdr*) segment;
+    if(length < sizeof(struct tcphdr) || length < (size_t) tcp->th_off * 4 ||
+        tcp->th_off * 4 < sizeof(struct tcphdr))
+        return;
+
+    TcpFlowKey key = *(scan->key);
+    key.srcPort = ntohs(tcp->th_sport);
+    key.dstPort = ntohs(tcp->th_dport);
+    if(key.srcPort != DNS_PORT && key.dstPort != DNS_PORT)
+        return;
+
+    tcpTableSegment(scan->tcpFlows, &key, tcp, segment + tcp->th_off * 4,
+        length - tcp->th_off * 4, scan->now, captureIndexMessage, NULL);
+}
+
+/**
+ * @brief Adds datagram reassembled during index scan to flows of scan
+ *
+ * @param payload Start of transport header
+ * @param length Length of datagram payload
+ * @param user Pointer to the CaptureIndexScan
+ */
+void captureIndexDatagram(const unsigned char* payload, size_t length, void* user)
+{
+    CaptureIndexScan* scan = (CaptureIndexScan*) user;
+
+    if(scan->transport == IPPROTO_TCP)
+        captureIndexSegment(scan, payload, length);
+}
+
+/**
+ * @brief Adds TCP segment or IP fragment to reassembly state of scan, same
+ * as decodedFrameDissector() adds it to state of sequential reading
+ *
+ * @param scan Pointer to the CaptureIndexScan
+ * @param linkType Datalink type of the file
+ * @param data Packet data
+ * @param length Captured length of the packet
+ * @param now Timestamp of the packet in seconds
+ */
+void captureIndexTrack(CaptureIndexScan* scan, int linkType, const unsigned char* data,
+                        size_t length, time_t now)
+{
+    DecodedFrame frame;
+    if(frameDecode(linkType, data, length, &frame) != DECODE_OK)
+        return;
+
+    // UDP datagrams are dissected without state
+    if(!frame.fragment && frame.transport != IPPROTO_TCP)
+        return;
+
+    TcpFlowKey key;
+    memset(&key, 0, sizeof(TcpFlowKey));
+    key.family = frame.family;
+    memcpy(key.src, frame.src, 16);
+    memcpy(key.dst, frame.dst, 16);
+
+    scan->key = &key;
+    scan->transport = frame.transport;
+    scan->now = now;
+
+    const unsigned char* segment = data + frame.transportOffset;
+    size_t segmentLen = frame.payloadEnd - frame.transportOffset;
+
+    if(!frame.fragment)
+    {
+        captureIndexSegment(scan, segment, segmentLen);
+        return;
+    }
+
+    // fragment cut by snapshot length can never complete its datagram
+    if(frame.truncated)
+        return;
+
+    IpFragKey fragKey;
+    memset(&fragKey, 0, sizeof(IpFragKey));
+    memcpy(fragKey.src, frame.src, 16);
+    memcpy(fragKey.dst, frame.dst, 16);
+    fragKey.id = frame.fragId;
+    fragKey.protocol = frame.transport;
+    fragKey.family = frame.family;
+
+    ipFragAdd(scan->ipFrags, &fragKey, frame.fragOffset, frame.moreFragments, segment,
+        segmentLen, now, captureIndexDatagram, scan);
+}
+
+/**
+ * @brief Builds index by reading all records of the file, entry is placed
+ * at first record after every stride bytes before which sequential reading
+ * has no TCP flow or fragmented datagram open, file with long connection
+ * can have only first entry
+ *
+ * @param path Path to the savefile
+ * @param errbuf Buffer of PCAP_ERRBUF_SIZE characters for error message
+ * @return CaptureIndex* Index or NULL if file can not be mapped or is
+ * malformed
+ */
+CaptureIndex* captureIndexBuild(const char* path, char* errbuf)
+{
+    CaptureFile* file = captureFileOpen(path, errbuf);
+    if(file == NULL)
+        return NULL;
+
+    CaptureIndex* index = captureIndexCreate(file->size);
+
+    size_t stride = file->size / CAPTURE_INDEX_ENTRIES;
+    if(stride < CAPTURE_INDEX_MIN_STRIDE)
+        stride = CAPTURE_INDEX_MIN_STRIDE;
+    size_t nextEntry = 0;
+
+    // packets of other datalink are reported by workers
+    file->stopAtHeaders = true;
+    file->warnedLinkType = true;
+
+    CaptureIndexScan scan;
+    scan.tcpFlows = tcpTableCreate();
+    scan.ipFrags = ipFragTableCreate();
+
+    while(true)
+    {
+        struct pcap_pkthdr* header;
+        const unsigned char* data;
+        size_t start = file->offset;
+
+        int res = captureFileNext(file, &header, &data);
+        if(res == PCAP_ERROR_BREAK)
+            break;
+
+        if(res == PCAP_ERROR)
+        {
+            memcpy(errbuf, file->errbuf, PCAP_ERRBUF_SIZE);
+            tcpTableDestroy(scan.tcpFlows);
+            ipFragTableDestroy(scan.ipFrags);
+            captureIndexDestroy(index);
+            captureFileClose(file);
+            return NULL;
+        }
+
+        if(res == 0)
+        {
+            captureIndexAddHeader(index, start);
+            continue;
+        }
+
+        // chunk started here must not miss bytes of message or fragments of
+        // datagram that sequential reading would have buffered
+        if(start >= nextEntry && tcpTableIdle(scan.tcpFlows, header->ts.tv_sec) &&
+            ipFragTableIdle(scan.ipFrags, header->ts.tv_sec))
+        {
+            captureIndexAddEntry(index, start, header->ts);
+            nextEntry = start + stride;
+        }
+
+        captureIndexTrack(&scan, file->linkType, data, header->caplen, header->ts.tv_sec);
+    }
+
+    tcpTableDestroy(scan.tcpFlows);
+    ipFragTableDestroy(scan.ipFrags);
+    captureFileClose(file);
+
+    return index;
+}
+
+/**
+ * @brief Returns path of cache file of savefile
+ *
+ * @param path Path to the savefile
+ * @return char* Allocated path
+ */
+char* captureIndexCachePath(const char* path)
+{
+    size_t length = strlen(path) + sizeof(CAPTURE_INDEX_SUFFIX);
+    char* cachePath = (char*) malloc(length);
+    if(cachePath == NULL)
+        errHandling("Failed to allocate memory for index path", ERR_MALLOC);
+
+    snprintf(cachePath, length, "%s" CAPTURE_INDEX_SUFFIX, path);
+
+    return cachePath;
+}
+
+/**
+ * @brief Fills cache header describing current state of savefile
+ *
+ * @param header Pointer to the CaptureIndexHeader
+ * @param info Status of the savefile
+ */
+void captureIndexFillHeader(CaptureIndexHeader* header, const struct stat* info)
+{
+    memset(header, 0, sizeof(CaptureIndexHeader));
+    memcpy(header->magic, CAPTURE_INDEX_MAGIC, sizeof(header->magic));
+    header->fileSize = info->st_size;
+    header->mtimeSec = info->st_mtim.tv_sec;
+    header->mtimeNsec = info->st_mtim.tv_nsec;
+    header->entrySize = sizeof(CaptureIndexEntry);
+}
+
+/**
+ * @brief Loads index from cache, cache of other version or of file that
+ * changed since it was written is ignored
+ *
+ * @param cachePath Path to the cache file
+ * @param info Status of the savefile
+ * @return CaptureIndex* Index or NULL if there is no valid cache
+ */
+CaptureIndex* captureIndexLoad(const char* cachePath, const struct stat* info)
+{
+    FILE* cache = fopen(cachePath, "rb");
+    if(cache == NULL)
+        return NULL;
+
+    CaptureIndexHeader expected;
+    CaptureIndexHeader header;
+    captureIndexFillHeader(&expected, info);
+
+    if(fread(&header, sizeof(header), 1, cache) != 1 ||
+        memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.fileSize != expected.fileSize || header.mtimeSec != expected.mtimeSec ||
+        header.mtimeNsec != expected.mtimeNsec || header.entrySize != expected.entrySize)
+    {
+        fclose(cache);
+        return NULL;
+    }
+
+    CaptureIndex* index = captureIndexCreate(info->st_size);
+    index->entries = (CaptureIndexEntry*) malloc(sizeof(CaptureIndexEntry) * (header.entryCount + 1));
+    index->headers = (size_t*) malloc(sizeof(size_t) * (header.headerCount + 1));
+    if(index->entries == NULL || index->headers == NULL)
+        errHandling("Failed to allocate memory for CaptureIndex", ERR_MALLOC);
+
+    index->count = index->max = header.entryCount;
+    index->headerCount = index->headerMax = header.headerCount;
+
+    bool valid = fread(index->entries, sizeof(CaptureIndexEntry), index->count, cache) == index->count &&
+        fread(index->headers, sizeof(size_t), index->headerCount, cache) == index->headerCount;
+
+    // offsets are used to seek, cache is trusted only when they are sane
+    for(unsigned i = 0; valid && i < index->count; i++)
+        valid = index->entries[i].offset < index->size &&
+            (i == 0 || index->entries[i - 1].offset < index->entries[i].offset);
+    for(unsigned i = 0; valid && i < index->headerCount; i++)
+        valid = index->headers[i] < index->size && (i == 0 || index->headers[i - 1] < index->headers[i]);
+
+    fclose(cache);
+
+    if(!valid)
+    {
+        captureIndexDestroy(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+/**
+ * @brief Stores index into cache, failure (e.g. read only directory) only
+ * means that next run scans file again
+ *
+ * @param index Pointer to the CaptureIndex
+ * @param cachePath Path to the cache file
+ * @param info Status of the savefile
+ */
+void captureIndexSave(CaptureIndex* index, const char* cachePath, const struct stat* info)
+{
+    FILE* cache = fopen(cachePath, "wb");
+    if(cache == NULL)
+    {
+        fprintf(stderr, "WARNING: Couldn't create index cache %s\n", cachePath);
+        return;
+    }
+
+    CaptureIndexHeader header;
+    captureIndexFillHeader(&header, info);
+    header.entryCount = index->count;
+    header.headerCount = index->headerCount;
+
+    bool written = fwrite(&header, sizeof(header), 1, cache) == 1 &&
+        fwrite(index->entries, sizeof(CaptureIndexEntry), index->count, cache) == index->count &&
+        fwrite(index->headers, sizeof(size_t), index->headerCount, cache) == index->headerCount;
+
+    if(fclose(cache) != 0 || !written)
+    {
+        fprintf(stderr, "WARNING: Couldn't write index cache %s\n", cachePath);
+        unlink(cachePath);
+    }
+}
+
+/**
+ * @brief Returns index of savefile, index is loaded from cache or built by
+ * scan of the file (and stored into cache)
+ *
+ * @param path Path to the savefile
+ * @param useCache Load and store <path>.idx
+ * @param errbuf Buffer of PCAP_ERRBUF_SIZE characters for error message
+ * @return CaptureIndex* Index or NULL if file can not be mapped or is
+ * malformed
+ */
+CaptureIndex* captureIndexGet(const char* path, bool useCache, char* errbuf)
+{
+    struct stat info;
+    if(!useCache || stat(path, &info) != 0 || !S_ISREG(info.st_mode))
+        return captureIndexBuild(path, errbuf);
+
+    char* cachePath = captureIndexCachePath(path);
+
+    CaptureIndex* index = captureIndexLoad(cachePath, &info);
+    if(index == NULL)
+    {
+        index = captureIndexBuild(path, errbuf);
+        if(index != NULL)
+            captureIndexSave(index, cachePath, &info);
+    }
+
+    free(cachePath);
+
+    return index;
+}
+
+/**
+ * @brief Splits file into chunks of about same number of entries, chunks
+ * start only at entries, so every chunk starts with empty reassembly state
+ *
+ * @param index Pointer to the CaptureIndex
+ * @param chunkCount Number of chunks, at most number of entries
+ * @return CaptureChunk* Allocated array of chunkCount chunks
+ */
+CaptureChunk* captureIndexSplit(CaptureIndex* index, unsigned chunkCount)
+{
+    CaptureChunk* chunks = (CaptureChunk*) malloc(sizeof(CaptureChunk) * chunkCount);
+    if(chunks == NULL)
+        errHandling("Failed to allocate memory for chunks", ERR_MALLOC);
+
+    for(unsigned i = 0; i < chunkCount; i++)
+    {
+        CaptureChunk* chunk = &(chunks[i]);
+        chunk->first = (unsigned) ((unsigned long long) index->count * i / chunkCount);
+        unsigned next = (unsigned) ((unsigned long long) index->count * (i + 1) / chunkCount);
+
+        // blocks before first entry are header blocks replayed by seek
+        chunk->start = index->entries[chunk->first].offset;
+        chunk->end = (next < index->count)? index->entries[next].offset : index->size;
+    }
+
+    return chunks;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file captureIndex.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Record offset index of pcap and pcapng savefile, used to split one
+ * big file into contiguous chunks that are processed in parallel. Index is
+ * built by single pass over records, TCP segments and IP fragments are
+ * tracked by reassembly tables during the pass and entries are placed only
+ * at records where no flow or datagram is open, so chunk can start with
+ * empty reassembly state. Index can be cached next to the file (<file>.idx),
+ * cache is valid while size and modification time of the file do not
+ * change.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef CAPTURE_INDEX_H
+#define CAPTURE_INDEX_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "sys/time.h"
+
+#include "utils.h"
+#include "captureFile.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define CAPTURE_INDEX_ENTRIES 4096          // wanted number of entries
+#define CAPTURE_INDEX_MIN_STRIDE 16384      // bytes between entries
+#define CAPTURE_INDEX_SUFFIX ".idx"
+#define CAPTURE_INDEX_MAGIC "DMIDX\0\0\2"   // 8 bytes, last byte is version
+
+/**
+ * @brief Point where chunk can start, no TCP flow or fragmented datagram is
+ * open before record at offset
+ */
+typedef struct CaptureIndexEntry {
+    size_t offset;                  // start of record/block
+    struct timeval ts;              // timestamp of first packet after offset
+} CaptureIndexEntry;
+
+/**
+ * @brief Index of one savefile
+ */
+typedef struct CaptureIndex {
+    CaptureIndexEntry* entries;
+    unsigned count;
+    unsigned max;
+
+    // pcapng SHB and IDB blocks, read again when chunk is opened
+    size_t* headers;
+    unsigned headerCount;
+    unsigned headerMax;
+
+    size_t size;                    // size of indexed file
+} CaptureIndex;
+
+/**
+ * @brief Contiguous part of file processed by one worker
+ */
+typedef struct CaptureChunk {
+    size_t start;
+    size_t end;
+    unsigned first;                 // first index entry of chunk
+} CaptureChunk;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Returns index of savefile, index is loaded from cache or built by
+ * scan of the file (and stored into cache)
+ *
+ * @param path Path to the savefile
+ * @param useCache Load and store <path>.idx
+ * @param errbuf Buffer of PCAP_ERRBUF_SIZE characters for error message
+ * @return CaptureIndex* Index or NULL if file can not be mapped or is
+ * malformed
+ */
+CaptureIndex* captureIndexGet(const char* path, bool useCache, char* errbuf);
+
+/**
+ * @brief Destroys index
+ *
+ * @param index Pointer to the CaptureIndex, can be NULL
+ */
+void captureIndexDestroy(CaptureIndex* index);
+
+/**
+ * @brief Splits file into chunks of about same number of entries, chunks
+ * start only at entries, so every chunk starts with empty reassembly state
+ *
+ * @param index Pointer to the CaptureIndex
+ * @param chunkCount Number of chunks, at most number of entries
+ * @return CaptureChunk* Allocated array of chunkCount chunks
+ */
+CaptureChunk* captureIndexSplit(CaptureIndex* index, unsigned chunkCount);
+
+#endif /*CAPTURE_INDEX_H*/
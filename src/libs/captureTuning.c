@@ -0,0 +1,217 @@
+/**
+ * @file captureTuning.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of periodic capture statistics reporting and
+ * adaptive capture buffer sizing
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "captureTuning.h"
+#include "programConfig.h"
+#include "pcapHandler.h"
+
+/**
+ * @brief Sets default values to the CaptureTuner and starts first interval
+ *
+ * @param tuner Pointer to the CaptureTuner
+ */
+void tunerInit(CaptureTuner* tuner)
+{
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &(tuner->lastReport));
+    tuner->lastRecv = 0;
+    tuner->lastDrop = 0;
+    tuner->lastIfDrop = 0;
+    memset(&(tuner->handle), 0, sizeof(PcapCounters));
+}
+
+/**
+ * @brief Doubles capture buffer (libpcap buffer or number of ring blocks) up
+ * to the config->adaptiveMaxBuffer and reopens capture with new size
+ *
+ * @param config Pointer to the Config structure
+ * @return true Capture was reopened
+ * @return false Buffer is already at its maximum or new handle/ring couldn't
+ * be opened
+ */
+bool tunerGrowBuffer(Config* config)
+{
+    if(config->cleanup.ring != NULL)
+    {
+        unsigned maxBlocks = config->adaptiveMaxBuffer / config->ringBlockSize;
+        unsigned newCount = config->ringBlockCount * 2;
+        if(newCount > maxBlocks)
+            newCount = maxBlocks;
+
+        if(newCount <= config->ringBlockCount)
+            return false;
+
+        fprintf(stderr, "Adaptive buffer: growing ring from %u to %u blocks\n",
+            config->ringBlockCount, newCount);
+
+        unsigned oldCount = config->ringBlockCount;
+        config->ringBlockCount = newCount;
+        if(!pcapRingReopen(config))
+        {
+            // most likely out of memory, keep current ring and stop growing
+            config->ringBlockCount = oldCount;
+            config->adaptiveMaxBuffer = 0;
+            return false;
+        }
+
+        return true;
+    }
+
+    unsigned current = (config->bufferSize > 0)? config->bufferSize : DEFAULT_PCAP_BUFFER_SIZE;
+    unsigned newSize = (current > config->adaptiveMaxBuffer / 2)?
+        config->adaptiveMaxBuffer : current * 2;
+
+    if(newSize <= current)
+        return false;
+
+    fprintf(stderr, "Adaptive buffer: growing capture buffer from %u to %u bytes\n",
+        current, newSize);
+
+    unsigned oldSize = config->bufferSize;
+    config->bufferSize = newSize;
+    if(!pcapReopen(config))
+    {
+        // bigger buffer was refused, keep current handle and stop growing
+        config->bufferSize = oldSize;
+        config->adaptiveMaxBuffer = 0;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Adds differences of libpcap counters since their last reading,
+ * counters are 32 bit and wrap around, so differences are taken modulo 2^32
+ *
+ * @param stats Counters read by pcap_stats()
+ * @param last Counters of same handle from last reading, replaced by stats
+ * @param deltaRecv Received packets, difference is added to it
+ * @param deltaDrop Dropped packets, difference is added to it
+ * @param deltaIfDrop Packets dropped by interface, difference is added to it
+ */
+void tunerAddPcapDeltas(const struct pcap_stat* stats, PcapCounters* last,
+                        unsigned long long* deltaRecv, unsigned long long* deltaDrop,
+                        unsigned long long* deltaIfDrop)
+{
+    *deltaRecv += (uint32_t) (stats->ps_recv - last->recv);
+    *deltaDrop += (uint32_t) (stats->ps_drop - last->drop);
+    *deltaIfDrop += (uint32_t) (stats->ps_ifdrop - last->ifDrop);
+
+    last->recv = stats->ps_recv;
+    last->drop = stats->ps_drop;
+    last->ifDrop = stats->ps_ifdrop;
+}
+
+/**
+ * @brief Checks if statistics interval elapsed, if so prints capture
+ * counters onto stderr and in adaptive mode grows capture buffer when drop
+ * rate of last interval is higher than ADAPTIVE_DROP_RATE
+ *
+ * @param config Pointer to the Config structure
+ * @return true Capture handle/ring was reopened with bigger buffer,
+ * pointers to it must be reloaded
+ * @return false Nothing changed
+ */
+bool tunerTick(Config* config)
+{
+    CaptureTuner* tuner = &(config->tuner);
+
+    // savefiles have no kernel counters
+    if(config->statsInterval == 0 || config->captureMode != ONLINE_MODE)
+        return false;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    if(now.tv_sec - tuner->lastReport.tv_sec < (time_t) config->statsInterval)
+        return false;
+
+    tuner->lastReport = now;
+
+    // ring counters are 64 bit totals, libpcap ones are summed from their
+    // differences into totals of tuner
+    unsigned long long deltaRecv = 0, deltaDrop = 0, deltaIfDrop = 0;
+    if(config->cleanup.ring != NULL)
+    {
+        ringUpdateStats(config->cleanup.ring);
+        deltaRecv = config->cleanup.ring->stats.packets - tuner->lastRecv;
+        deltaDrop = config->cleanup.ring->stats.drops - tuner->lastDrop;
+        // interface drops are not reported for AF_PACKET sockets
+    }
+    else if(config->cleanup.handle != NULL)
+    {
+        struct pcap_stat stats;
+        if(pcap_stats(config->cleanup.handle, &stats) != 0)
+        {
+            fprintf(stderr, "WARNING: Couldn't read capture statistics: %s\n",
+                pcap_geterr(config->cleanup.handle));
+            return false;
+        }
+
+        tunerAddPcapDeltas(&stats, &(tuner->handle), &deltaRecv, &deltaDrop, &deltaIfDrop);
+    }
+    else if(config->cleanup.live != NULL)
+    {
+        // interfaces share one buffer size, so their counters are summed
+        for(unsigned i = 0; i < config->cleanup.liveCount; i++)
+        {
+            LiveHandle* live = &(config->cleanup.live[i]);
+
+            struct pcap_stat stats;
+            if(pcap_stats(live->handle, &stats) != 0)
+            {
+                // counters of other handles were already taken into totals
+                fprintf(stderr, "WARNING: Couldn't read capture statistics of %s: %s\n",
+                    live->name, pcap_geterr(live->handle));
+                continue;
+            }
+
+            tunerAddPcapDeltas(&stats, &(live->counters), &deltaRecv, &deltaDrop, &deltaIfDrop);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    // ps_recv on linux includes also dropped packets
+    unsigned long long recv = tuner->lastRecv + deltaRecv;
+    unsigned long long drop = tuner->lastDrop + deltaDrop;
+    unsigned long long ifDrop = tuner->lastIfDrop + deltaIfDrop;
+    double dropRate = (deltaRecv > 0)? (double) deltaDrop / deltaRecv : 0.0;
+
+    tuner->lastRecv = recv;
+    tuner->lastDrop = drop;
+    tuner->lastIfDrop = ifDrop;
+
+    flockfile(stderr);
+    if(config->workerCount > 1)
+        fprintf(stderr, "Capture statistics (worker %u): ", config->workerId);
+    else
+        fprintf(stderr, "Capture statistics: ");
+
+    fprintf(stderr, "received %llu (+%llu), dropped %llu (+%llu, %.2f%%), "
+        "interface dropped %llu (+%llu)\n",
+        recv, deltaRecv, drop, deltaDrop, dropRate * 100.0, ifDrop, deltaIfDrop);
+    funlockfile(stderr);
+
+    // workers share one fanout group, their rings are not resized
+    if(config->adaptiveMaxBuffer == 0 || config->workerCount > 1 || dropRate <= ADAPTIVE_DROP_RATE)
+        return false;
+
+    if(!tunerGrowBuffer(config))
+        return false;
+
+    // libpcap counters start from zero on new handle, totals are kept
+    memset(&(tuner->handle), 0, sizeof(PcapCounters));
+    for(unsigned i = 0; i < config->cleanup.liveCount; i++)
+        memset(&(config->cleanup.live[i].counters), 0, sizeof(PcapCounters));
+
+    return true;
+}
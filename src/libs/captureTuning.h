@@ -0,0 +1,81 @@
+/**
+ * @file captureTuning.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Periodic reporting of kernel capture counters (ps_recv, ps_drop,
+ * ps_ifdrop or ring statistics) and adaptive growing of capture buffer when
+ * drop rate rises
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef CAPTURE_TUNING_H
+#define CAPTURE_TUNING_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "time.h"
+#include "stdint.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define DEFAULT_SNAPLEN BUFSIZ
+#define DEFAULT_TIMEOUT 1000                        // milliseconds
+#define DEFAULT_PCAP_BUFFER_SIZE (2 * 1024 * 1024)  // libpcap default on linux
+#define DEFAULT_STATS_INTERVAL 5                    // seconds, for adaptive mode
+#define ADAPTIVE_DROP_RATE 0.01                     // 1 % of received packets
+
+/**
+ * @brief Last values of 32 bit counters of one libpcap handle, counters
+ * wrap around, so only their differences are summed
+ */
+typedef struct PcapCounters {
+    uint32_t recv;
+    uint32_t drop;
+    uint32_t ifDrop;
+} PcapCounters;
+
+/**
+ * @brief State of periodic statistics reporting, counters from previous
+ * report are kept to compute per interval rates
+ */
+typedef struct CaptureTuner {
+    struct timespec lastReport;
+    unsigned long long lastRecv;
+    unsigned long long lastDrop;
+    unsigned long long lastIfDrop;
+    PcapCounters handle;        // single libpcap handle (not per -i handles)
+} CaptureTuner;
+
+// forward declaration, programConfig.h includes this header
+struct ProgramConfiguration;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Sets default values to the CaptureTuner and starts first interval
+ *
+ * @param tuner Pointer to the CaptureTuner
+ */
+void tunerInit(CaptureTuner* tuner);
+
+/**
+ * @brief Checks if statistics interval elapsed, if so prints capture
+ * counters onto stderr and in adaptive mode grows capture buffer when drop
+ * rate of last interval is higher than ADAPTIVE_DROP_RATE
+ *
+ * @param config Pointer to the Config structure
+ * @return true Capture handle/ring was reopened with bigger buffer,
+ * pointers to it must be reloaded
+ * @return false Nothing changed
+ */
+bool tunerTick(struct ProgramConfiguration* config);
+
+#endif /*CAPTURE_TUNING_H*/
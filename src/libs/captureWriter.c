@@ -0,0 +1,457 @@
+/**
+ * @file captureWriter.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of rotating pcapng writer thread
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "captureWriter.h"
+
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+#include "pcap/pcap.h"
+
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER 0x1A2B3C4D
+#define LINKTYPE_RAW 101            // pcap LINKTYPE that differs from DLT
+
+#define WRITER_QUEUE_MASK (WRITER_QUEUE_SIZE - 1)
+#define WRITER_ALIGN(x) (((x) + 7) & ~((size_t) 7))
+
+/**
+ * @brief Creates name of file with given sequence number, files are
+ * numbered only when rotation is enabled
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @param sequence Number of the file
+ * @param name Buffer of PATH_MAX characters
+ */
+void writerFileName(CaptureWriter* writer, unsigned sequence, char* name)
+{
+    if(writer->rotateSize == 0 && writer->rotateTime == 0)
+        snprintf(name, PATH_MAX, "%s", writer->path);
+    else
+        snprintf(name, PATH_MAX, "%s.%u", writer->path, sequence);
+}
+
+/**
+ * @brief Writes data into current file, first failure is reported and
+ * stops all other writing
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @param data Written data
+ * @param length Length of data
+ */
+void writerOutput(CaptureWriter* writer, const void* data, size_t length)
+{
+    if(writer->failed)
+        return;
+
+    if(fwrite(data, 1, length, writer->file) != length)
+    {
+        fprintf(stderr, "ERR: Failed to write capture file %s, writing stopped\n", writer->path);
+        writer->failed = true;
+        return;
+    }
+
+    writer->fileSize += length;
+}
+
+/**
+ * @brief Writes pcapng block with given body
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @param type Type of the block
+ * @param body Fixed part of block body
+ * @param bodyLength Length of fixed part
+ * @param data Variable part of body (packet data), can be NULL
+ * @param dataLength Length of variable part, padded to 4 bytes by zeros
+ */
+void writerBlock(CaptureWriter* writer, uint32_t type, const void* body, uint32_t bodyLength,
+                const unsigned char* data, uint32_t dataLength)
+{
+    static const unsigned char padding[4] = {0};
+    uint32_t paddingLength = (4 - (dataLength & 3)) & 3;
+    uint32_t total = 12 + bodyLength + dataLength + paddingLength;
+    uint32_t header[2] = {type, total};
+
+    writerOutput(writer, header, sizeof(header));
+    writerOutput(writer, body, bodyLength);
+    if(dataLength > 0)
+        writerOutput(writer, data, dataLength);
+    writerOutput(writer, padding, paddingLength);
+    writerOutput(writer, &total, sizeof(total));
+}
+
+/**
+ * @brief Opens file with current sequence number and writes section header,
+ * file that falls out of retention count is removed
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @return true File was opened
+ * @return false File couldn't be opened
+ */
+bool writerOpen(CaptureWriter* writer)
+{
+    char name[PATH_MAX];
+    writerFileName(writer, writer->sequence, name);
+
+    writer->file = fopen(name, "wb");
+    if(writer->file == NULL)
+    {
+        fprintf(stderr, "ERR: Couldn't open capture file %s for writing\n", name);
+        return false;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, WRITER_FILE_BUFFER);
+
+    if(writer->rotateCount > 0 && writer->sequence >= writer->rotateCount)
+    {
+        writerFileName(writer, writer->sequence - writer->rotateCount, name);
+        unlink(name);
+    }
+
+    writer->fileSize = 0;
+    writer->filePackets = 0;
+    writer->fileStart = 0;
+    writer->interfaceCount = 0;
+
+    // byte order magic, version 1.0, section length not specified
+    struct {
+        uint32_t byteOrder;
+        uint16_t major;
+        uint16_t minor;
+        int64_t sectionLength;
+    } __attribute__((packed)) section = {PCAPNG_BYTE_ORDER, 1, 0, -1};
+
+    writerBlock(writer, PCAPNG_SHB, &section, sizeof(section), NULL, 0);
+
+    return true;
+}
+
+/**
+ * @brief Closes current file and opens next one
+ *
+ * @param writer Pointer to the CaptureWriter
+ */
+void writerRotate(CaptureWriter* writer)
+{
+    if(fclose(writer->file) != 0 && !writer->failed)
+    {
+        fprintf(stderr, "ERR: Failed to write capture file %s, writing stopped\n", writer->path);
+        writer->failed = true;
+    }
+    writer->file = NULL;
+
+    writer->sequence++;
+    if(!writerOpen(writer))
+        writer->failed = true;
+}
+
+/**
+ * @brief Returns interface of current file for link type, interface
+ * description block is written when link type is seen first time
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @param linkType Datalink type (DLT_*) of the packet
+ * @return int Interface id or -1 if file has too many interfaces
+ */
+int writerInterface(CaptureWriter* writer, int linkType)
+{
+    for(unsigned i = 0; i < writer->interfaceCount; i++)
+    {
+        if(writer->interfaces[i] == linkType)
+            return i;
+    }
+
+    if(writer->interfaceCount == WRITER_MAX_INTERFACES)
+        return -1;
+
+    // files store LINKTYPE values, they differ from DLT only for raw IP
+    struct {
+        uint16_t linkType;
+        uint16_t reserved;
+        uint32_t snaplen;
+    } interface = {(linkType == DLT_RAW)? LINKTYPE_RAW : linkType, 0, writer->snaplen};
+
+    writerBlock(writer, PCAPNG_IDB, &interface, sizeof(interface), NULL, 0);
+
+    writer->interfaces[writer->interfaceCount] = linkType;
+    return writer->interfaceCount++;
+}
+
+/**
+ * @brief Writes one packet from queue as enhanced packet block, file is
+ * rotated before packet when it is over size or time limit
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @param record Packet record from queue
+ * @return true Packet was written
+ * @return false Packet was not written
+ */
+bool writerPacket(CaptureWriter* writer, WriterRecord* record)
+{
+    bool overSize = writer->rotateSize > 0 && writer->fileSize >= writer->rotateSize;
+    bool overTime = writer->rotateTime > 0 && writer->filePackets > 0 &&
+        record->sec >= writer->fileStart + (time_t) writer->rotateTime;
+
+    if(!writer->failed && (overSize || overTime))
+        writerRotate(writer);
+
+    if(writer->failed)
+        return false;
+
+    int interface = writerInterface(writer, record->linkType);
+    if(interface < 0)
+        return false;
+
+    if(writer->filePackets++ == 0)
+        writer->fileStart = record->sec;
+
+    // timestamps are in microseconds, default resolution of interface
+    uint64_t ts = (uint64_t) record->sec * 1000000 + record->usec;
+    uint32_t packet[5] = {interface, ts >> 32, ts & 0xFFFFFFFF, record->caplen, record->len};
+
+    writerBlock(writer, PCAPNG_EPB, packet, sizeof(packet),
+        (unsigned char*) (record + 1), record->caplen);
+
+    return !writer->failed;
+}
+
+/**
+ * @brief Writes all packets that are in queue now
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @param queue Pointer to the WriterQueue
+ * @return unsigned Number of packets taken from queue
+ */
+unsigned writerDrain(CaptureWriter* writer, WriterQueue* queue)
+{
+    size_t head = __atomic_load_n(&(queue->head), __ATOMIC_ACQUIRE);
+    size_t tail = queue->tail;
+    unsigned count = 0;
+
+    while(tail != head)
+    {
+        WriterRecord* record = (WriterRecord*) (queue->data + (tail & WRITER_QUEUE_MASK));
+
+        if(record->linkType != WRITER_RECORD_WRAP)
+        {
+            if(writerPacket(writer, record))
+                writer->written++;
+            else
+                writer->lost++;
+            count++;
+        }
+
+        tail += record->length;
+
+        // space is returned to producer packet by packet
+        __atomic_store_n(&(queue->tail), tail, __ATOMIC_RELEASE);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Thread function of writer, empties queues until writer is stopped
+ * and all queues are empty
+ *
+ * @param arg Pointer to the CaptureWriter
+ * @return void* Always NULL
+ */
+void* writerLooper(void* arg)
+{
+    CaptureWriter* writer = (CaptureWriter*) arg;
+    struct timespec idle = {0, WRITER_IDLE_SLEEP};
+    bool unflushed = false;
+
+    while(true)
+    {
+        // producers stopped before flag was cleared, so next pass empties
+        // queues completely
+        bool running = __atomic_load_n(&(writer->running), __ATOMIC_ACQUIRE);
+        unsigned queueCount = __atomic_load_n(&(writer->queueCount), __ATOMIC_ACQUIRE);
+
+        unsigned count = 0;
+        for(unsigned i = 0; i < queueCount; i++)
+            count += writerDrain(writer, writer->queues[i]);
+
+        if(count > 0)
+        {
+            unflushed = true;
+            continue;
+        }
+
+        if(!running)
+            break;
+
+        // packets reach disk at latest after one idle period
+        if(unflushed && !writer->failed)
+            fflush(writer->file);
+        unflushed = false;
+
+        nanosleep(&idle, NULL);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Creates writer, opens first file and starts writer thread
+ *
+ * @param path Path of output file, with rotation sequence number is appended
+ * @param rotateSize Size in bytes after which new file is started, 0 disables
+ * @param rotateTime Seconds of capture after which new file is started, 0
+ * disables
+ * @param rotateCount Number of newest files that are kept, 0 keeps all
+ * @param snaplen Snapshot length written into interface description
+ * @return CaptureWriter* Allocated writer, on error program is exited
+ */
+CaptureWriter* captureWriterCreate(const char* path, unsigned long rotateSize,
+                    unsigned rotateTime, unsigned rotateCount, unsigned snaplen)
+{
+    CaptureWriter* writer = (CaptureWriter*) calloc(1, sizeof(CaptureWriter));
+    if(writer == NULL)
+        errHandling("Failed to allocate memory for CaptureWriter", ERR_MALLOC);
+
+    writer->path = strdup(path);
+    if(writer->path == NULL)
+        errHandling("Failed to allocate memory for CaptureWriter", ERR_MALLOC);
+
+    writer->rotateSize = rotateSize;
+    writer->rotateTime = rotateTime;
+    writer->rotateCount = rotateCount;
+    writer->snaplen = snaplen;
+
+    if(!writerOpen(writer))
+    {
+        free(writer->path);
+        free(writer);
+        errHandling("", ERR_FILE);
+    }
+
+    pthread_mutex_init(&(writer->lock), NULL);
+    writer->running = true;
+
+    if(pthread_create(&(writer->thread), NULL, writerLooper, writer) != 0)
+        errHandling("Failed to create writer thread", ERR_INTERNAL);
+
+    return writer;
+}
+
+/**
+ * @brief Stops writer thread after all queued packets are written, closes
+ * file and prints number of packets that were not written
+ *
+ * @param writer Pointer to the CaptureWriter, can be NULL
+ */
+void captureWriterDestroy(CaptureWriter* writer)
+{
+    if(writer == NULL)
+        return;
+
+    __atomic_store_n(&(writer->running), false, __ATOMIC_RELEASE);
+    pthread_join(writer->thread, NULL);
+
+    if(writer->file != NULL && fclose(writer->file) != 0 && !writer->failed)
+        fprintf(stderr, "ERR: Failed to write capture file %s\n", writer->path);
+
+    unsigned long dropped = 0;
+    for(unsigned i = 0; i < writer->queueCount; i++)
+    {
+        dropped += writer->queues[i]->dropped;
+        free(writer->queues[i]->data);
+        free(writer->queues[i]);
+    }
+
+    fprintf(stderr, "Writer statistics (%s): %lu packets written into %u files, %lu "
+        "dropped (queue full), %lu not written\n",
+        writer->path, writer->written, writer->sequence + 1, dropped, writer->lost);
+
+    pthread_mutex_destroy(&(writer->lock));
+    free(writer->path);
+    free(writer);
+}
+
+/**
+ * @brief Creates queue for one capture loop, can be called while writer
+ * thread is running
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @return WriterQueue* Queue owned by writer
+ */
+WriterQueue* captureWriterQueue(CaptureWriter* writer)
+{
+    WriterQueue* queue = (WriterQueue*) calloc(1, sizeof(WriterQueue));
+    if(queue == NULL)
+        errHandling("Failed to allocate memory for WriterQueue", ERR_MALLOC);
+
+    queue->data = (unsigned char*) malloc(WRITER_QUEUE_SIZE);
+    if(queue->data == NULL)
+        errHandling("Failed to allocate memory for WriterQueue", ERR_MALLOC);
+
+    pthread_mutex_lock(&(writer->lock));
+    if(writer->queueCount == WRITER_MAX_QUEUES)
+        errHandling("Too many writer queues", ERR_INTERNAL);
+
+    // queue is visible to writer thread only after it is stored
+    writer->queues[writer->queueCount] = queue;
+    __atomic_store_n(&(writer->queueCount), writer->queueCount + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&(writer->lock));
+
+    return queue;
+}
+
+/**
+ * @brief Copies packet into queue, never blocks, packet is dropped when
+ * queue is full
+ *
+ * @param queue Pointer to the WriterQueue
+ * @param ts Timestamp of the packet
+ * @param caplen Captured length
+ * @param len Original length on wire
+ * @param linkType Datalink type (DLT_*) of the packet
+ * @param data Captured data
+ */
+void captureWriterPush(WriterQueue* queue, struct timeval ts, uint32_t caplen,
+                    uint32_t len, int linkType, const unsigned char* data)
+{
+    size_t length = WRITER_ALIGN(sizeof(WriterRecord) + caplen);
+    size_t head = queue->head;
+    size_t tail = __atomic_load_n(&(queue->tail), __ATOMIC_ACQUIRE);
+
+    // record is never split, rest of queue before its end is skipped
+    size_t toEnd = WRITER_QUEUE_SIZE - (head & WRITER_QUEUE_MASK);
+    size_t needed = (length > toEnd)? toEnd + length : length;
+
+    if(needed > WRITER_QUEUE_SIZE - (head - tail))
+    {
+        queue->dropped++;
+        return;
+    }
+
+    if(length > toEnd)
+    {
+        // wrap record has only length and link type, at least 8 bytes are left
+        WriterRecord* wrap = (WriterRecord*) (queue->data + (head & WRITER_QUEUE_MASK));
+        wrap->length = toEnd;
+        wrap->linkType = WRITER_RECORD_WRAP;
+        head += toEnd;
+    }
+
+    WriterRecord* record = (WriterRecord*) (queue->data + (head & WRITER_QUEUE_MASK));
+    record->length = length;
+    record->linkType = linkType;
+    record->sec = ts.tv_sec;
+    record->usec = ts.tv_usec;
+    record->caplen = caplen;
+    record->len = len;
+    memcpy(record + 1, data, caplen);
+
+    __atomic_store_n(&(queue->head), head + length, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file captureWriter.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Writing of captured DNS packets into rotating pcapng files. Capture
+ * loops only copy packets into their own lock-free single producer queue,
+ * files are written by dedicated writer thread, so slow disk never stops
+ * capture. When queue is full, packet is not written and is counted as lost.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef CAPTURE_WRITER_H
+#define CAPTURE_WRITER_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pthread.h"
+#include "stdint.h"
+#include "limits.h"
+#include "sys/time.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define WRITER_QUEUE_SIZE (8 * 1024 * 1024)     // bytes, power of two
+#define WRITER_MAX_QUEUES 65                    // main thread and MAX_WORKERS
+#define WRITER_MAX_INTERFACES 16                // link types in one file
+#define WRITER_FILE_BUFFER (1024 * 1024)        // stdio buffer of output file
+#define WRITER_IDLE_SLEEP 1000000               // ns, writer sleep when idle
+
+/**
+ * @brief Packet stored in queue, followed by captured data and padded to 8
+ * bytes
+ */
+typedef struct WriterRecord {
+    uint32_t length;                // whole record including padding
+    int32_t linkType;               // WRITER_RECORD_WRAP skips to queue start
+    int64_t sec;
+    int64_t usec;
+    uint32_t caplen;
+    uint32_t len;
+} WriterRecord;
+
+#define WRITER_RECORD_WRAP -1
+
+/**
+ * @brief Bytes ring filled by one capture loop and emptied by writer thread,
+ * head and tail only grow and are masked by size
+ */
+typedef struct WriterQueue {
+    unsigned char* data;
+    size_t head;                    // written by producer
+    char pad[64];                   // keeps head and tail in other cache lines
+    size_t tail;                    // written by writer thread
+    unsigned long dropped;          // packets that did not fit, producer only
+} WriterQueue;
+
+/**
+ * @brief Writer thread and its output files
+ */
+typedef struct CaptureWriter {
+    char* path;
+    unsigned long rotateSize;       // bytes, 0 = no size rotation
+    unsigned rotateTime;            // seconds, 0 = no time rotation
+    unsigned rotateCount;           // kept files, 0 = all files are kept
+
+    pthread_mutex_t lock;           // serializes creation of queues
+    WriterQueue* queues[WRITER_MAX_QUEUES];
+    unsigned queueCount;            // published with release store
+
+    // current file, touched only by writer thread after start
+    FILE* file;
+    unsigned sequence;              // number of current file
+    unsigned long fileSize;
+    unsigned long filePackets;
+    time_t fileStart;               // timestamp of first packet of file
+    int interfaces[WRITER_MAX_INTERFACES];  // link type of every IDB
+    unsigned interfaceCount;
+    unsigned snaplen;
+    bool failed;                    // writing failed, queues are only emptied
+    unsigned long written;
+    unsigned long lost;             // taken from queue, but not written
+
+    pthread_t thread;
+    bool running;
+} CaptureWriter;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Creates writer, opens first file and starts writer thread
+ *
+ * @param path Path of output file, with rotation sequence number is appended
+ * @param rotateSize Size in bytes after which new file is started, 0 disables
+ * @param rotateTime Seconds of capture after which new file is started, 0
+ * disables
+ * @param rotateCount Number of newest files that are kept, 0 keeps all
+ * @param snaplen Snapshot length written into interface description
+ * @return CaptureWriter* Allocated writer, on error program is exited
+ */
+CaptureWriter* captureWriterCreate(const char* path, unsigned long rotateSize,
+                    unsigned rotateTime, unsigned rotateCount, unsigned snaplen);
+
+/**
+ * @brief Stops writer thread after all queued packets are written, closes
+ * file and prints number of packets that were not written
+ *
+ * @param writer Pointer to the CaptureWriter, can be NULL
+ */
+void captureWriterDestroy(CaptureWriter* writer);
+
+/**
+ * @brief Creates queue for one capture loop, can be called while writer
+ * thread is running
+ *
+ * @param writer Pointer to the CaptureWriter
+ * @return WriterQueue* Queue owned by writer
+ */
+WriterQueue* captureWriterQueue(CaptureWriter* writer);
+
+/**
+ * @brief Copies packet into queue, never blocks, packet is dropped when
+ * queue is full
+ *
+ * @param queue Pointer to the WriterQueue
+ * @param ts Timestamp of the packet
+ * @param caplen Captured length
+ * @param len Original length on wire
+ * @param linkType Datalink type (DLT_*) of the packet
+ * @param data Captured data
+ */
+void captureWriterPush(WriterQueue* queue, struct timeval ts, uint32_t caplen,
+                    uint32_t len, int linkType, const unsigned char* data);
+
+#endif /*CAPTURE_WRITER_H*/
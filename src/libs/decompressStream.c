@@ -0,0 +1,542 @@
+/**
+ * @file decompressStream.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of streaming decompression of savefiles
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+// fopencookie() is GNU extension
+#define _GNU_SOURCE
+
+#include "decompressStream.h"
+
+#include "string.h"
+#include "errno.h"
+#include "sys/stat.h"
+
+#define DECOMPRESS_ERR(...) snprintf(stream->error, DECOMPRESS_ERR_LEN, __VA_ARGS__)
+
+/**
+ * @brief Recognizes compression format by magic bytes at start of file
+ *
+ * @param magic First bytes of the file
+ * @param length Number of bytes read
+ * @return CompressionType Format of the file
+ */
+CompressionType decompressDetect(const unsigned char* magic, size_t length)
+{
+    if(length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return COMPRESSION_GZIP;
+
+    if(length >= 4 && memcmp(magic, "\x28\xb5\x2f\xfd", 4) == 0)
+        return COMPRESSION_ZSTD;
+
+    if(length >= 6 && memcmp(magic, "\xfd" "7zXZ\x00", 6) == 0)
+        return COMPRESSION_XZ;
+
+    return COMPRESSION_NONE;
+}
+
+/**
+ * @brief Initializes decoder selected by stream->type
+ *
+ * @param stream Pointer to the DecompressStream
+ * @return true Decoder is ready
+ * @return false Decoder could not be initialized (message in stream->error)
+ */
+bool decompressInit(DecompressStream* stream)
+{
+    switch(stream->type)
+    {
+        case COMPRESSION_GZIP:
+            memset(&(stream->gzip), 0, sizeof(z_stream));
+            // 16 + MAX_WBITS accepts only gzip header
+            if(inflateInit2(&(stream->gzip), 16 + MAX_WBITS) != Z_OK)
+            {
+                DECOMPRESS_ERR("failed to initialize zlib");
+                return false;
+            }
+            return true;
+        case COMPRESSION_ZSTD:
+            stream->zstd = ZSTD_createDStream();
+            if(stream->zstd == NULL)
+            {
+                DECOMPRESS_ERR("failed to initialize zstd");
+                return false;
+            }
+            return true;
+        case COMPRESSION_XZ:
+            stream->xz = (lzma_stream) LZMA_STREAM_INIT;
+            // concatenated .xz streams are decoded as one, same as xz tool
+            if(lzma_stream_decoder(&(stream->xz), UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+            {
+                DECOMPRESS_ERR("failed to initialize liblzma");
+                return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Frees decoder selected by stream->type
+ *
+ * @param stream Pointer to the DecompressStream
+ */
+void decompressEnd(DecompressStream* stream)
+{
+    switch(stream->type)
+    {
+        case COMPRESSION_GZIP: inflateEnd(&(stream->gzip)); break;
+        case COMPRESSION_ZSTD: ZSTD_freeDStream(stream->zstd); break;
+        case COMPRESSION_XZ: lzma_end(&(stream->xz)); break;
+        default: break;
+    }
+}
+
+/**
+ * @brief Decompresses gzip data, concatenated members are decoded one
+ * after another same as by gzip tool
+ *
+ * @param stream Pointer to the DecompressStream
+ * @param io Input and output buffers, positions are moved
+ * @return DecompressStep Result of the step
+ */
+DecompressStep decompressGzipStep(DecompressStream* stream, DecompressIo* io)
+{
+    z_stream* z = &(stream->gzip);
+
+    if(stream->frameEnded && io->inPos < io->inLen)
+        inflateReset(z);
+
+    z->next_in = (unsigned char*) io->in + io->inPos;
+    z->avail_in = io->inLen - io->inPos;
+    z->next_out = io->out + io->outPos;
+    z->avail_out = io->outLen - io->outPos;
+
+    int res = inflate(z, Z_NO_FLUSH);
+
+    io->inPos = io->inLen - z->avail_in;
+    io->outPos = io->outLen - z->avail_out;
+
+    if(res == Z_STREAM_END)
+        return DECOMPRESS_END;
+
+    // Z_BUF_ERROR only means that no progress was possible
+    if(res == Z_OK || res == Z_BUF_ERROR)
+        return DECOMPRESS_MORE;
+
+    DECOMPRESS_ERR("%s", (z->msg != NULL)? z->msg : "corrupted gzip data");
+    return DECOMPRESS_ERROR;
+}
+
+/**
+ * @brief Decompresses zstd data, decoder continues with next frame by
+ * itself
+ *
+ * @param stream Pointer to the DecompressStream
+ * @param io Input and output buffers, positions are moved
+ * @return DecompressStep Result of the step
+ */
+DecompressStep decompressZstdStep(DecompressStream* stream, DecompressIo* io)
+{
+    ZSTD_inBuffer in = {io->in, io->inLen, io->inPos};
+    ZSTD_outBuffer out = {io->out, io->outLen, io->outPos};
+
+    size_t res = ZSTD_decompressStream(stream->zstd, &out, &in);
+
+    io->inPos = in.pos;
+    io->outPos = out.pos;
+
+    if(ZSTD_isError(res))
+    {
+        DECOMPRESS_ERR("%s", ZSTD_getErrorName(res));
+        return DECOMPRESS_ERROR;
+    }
+
+    // zero means that frame is complete and fully flushed
+    return (res == 0)? DECOMPRESS_END : DECOMPRESS_MORE;
+}
+
+/**
+ * @brief Decompresses xz data
+ *
+ * @param stream Pointer to the DecompressStream
+ * @param io Input and output buffers, positions are moved
+ * @return DecompressStep Result of the step
+ */
+DecompressStep decompressXzStep(DecompressStream* stream, DecompressIo* io)
+{
+    lzma_stream* xz = &(stream->xz);
+
+    xz->next_in = io->in + io->inPos;
+    xz->avail_in = io->inLen - io->inPos;
+    xz->next_out = io->out + io->outPos;
+    xz->avail_out = io->outLen - io->outPos;
+
+    // with LZMA_CONCATENATED end of stream is known only after input ends
+    lzma_ret res = lzma_code(xz, io->inputEnd? LZMA_FINISH : LZMA_RUN);
+
+    io->inPos = io->inLen - xz->avail_in;
+    io->outPos = io->outLen - xz->avail_out;
+
+    if(res == LZMA_STREAM_END)
+        return DECOMPRESS_END;
+
+    if(res == LZMA_OK || res == LZMA_BUF_ERROR)
+        return DECOMPRESS_MORE;
+
+    DECOMPRESS_ERR("liblzma error %d (corrupted xz data)", res);
+    return DECOMPRESS_ERROR;
+}
+
+/**
+ * @brief Waits for empty slot of ring
+ *
+ * @param stream Pointer to the DecompressStream
+ * @return unsigned char* Buffer of the slot or NULL if stream was closed
+ */
+unsigned char* decompressAcquire(DecompressStream* stream)
+{
+    pthread_mutex_lock(&(stream->lock));
+    while(stream->count == DECOMPRESS_SLOTS && !stream->stopped)
+        pthread_cond_wait(&(stream->emptied), &(stream->lock));
+
+    unsigned char* data = stream->stopped? NULL : stream->slots[stream->head].data;
+    pthread_mutex_unlock(&(stream->lock));
+
+    return data;
+}
+
+/**
+ * @brief Hands slot acquired by decompressAcquire() over to parser
+ *
+ * @param stream Pointer to the DecompressStream
+ * @param length Number of bytes written into the slot
+ */
+void decompressPublish(DecompressStream* stream, size_t length)
+{
+    if(length == 0)
+        return;
+
+    pthread_mutex_lock(&(stream->lock));
+    stream->slots[stream->head].length = length;
+    stream->head = (stream->head + 1) % DECOMPRESS_SLOTS;
+    stream->count++;
+    pthread_cond_signal(&(stream->filled));
+    pthread_mutex_unlock(&(stream->lock));
+}
+
+/**
+ * @brief Thread function that decompresses whole file into ring
+ *
+ * @param arg Pointer to the DecompressStream
+ * @return void* Always NULL
+ */
+void* decompressLooper(void* arg)
+{
+    DecompressStream* stream = (DecompressStream*) arg;
+
+    unsigned char* input = (unsigned char*) malloc(DECOMPRESS_INPUT_SIZE);
+    if(input == NULL)
+        errHandling("Failed to allocate memory for decompression", ERR_MALLOC);
+
+    DecompressIo io;
+    memset(&io, 0, sizeof(DecompressIo));
+    io.in = input;
+    io.outLen = DECOMPRESS_SLOT_SIZE;
+
+    DecompressStep (*step)(DecompressStream*, DecompressIo*) =
+        (stream->type == COMPRESSION_GZIP)? decompressGzipStep :
+        (stream->type == COMPRESSION_ZSTD)? decompressZstdStep : decompressXzStep;
+
+    while(true)
+    {
+        if(io.out == NULL)
+        {
+            io.out = decompressAcquire(stream);
+            io.outPos = 0;
+            if(io.out == NULL)
+                break;
+        }
+
+        if(io.inPos == io.inLen && !io.inputEnd)
+        {
+            io.inLen = fread(input, 1, DECOMPRESS_INPUT_SIZE, stream->input);
+            io.inPos = 0;
+            io.inputEnd = io.inLen == 0;
+
+            if(io.inputEnd && ferror(stream->input))
+            {
+                DECOMPRESS_ERR("read failed: %s", strerror(errno));
+                break;
+            }
+        }
+
+        size_t inPos = io.inPos;
+        size_t outPos = io.outPos;
+
+        DecompressStep res = step(stream, &io);
+        if(res == DECOMPRESS_ERROR)
+            break;
+
+        // output of frame can continue in other slot, frame is not finished
+        // until decoder says so
+        if(res == DECOMPRESS_END)
+            stream->frameEnded = true;
+        else if(io.inPos != inPos || io.outPos != outPos)
+            stream->frameEnded = false;
+
+        if(io.outPos == io.outLen)
+        {
+            decompressPublish(stream, io.outPos);
+            io.out = NULL;
+            continue;
+        }
+
+        if(io.inPos == inPos && io.outPos == outPos)
+        {
+            if(io.inputEnd)
+            {
+                if(!stream->frameEnded)
+                    DECOMPRESS_ERR("unexpected end of compressed data");
+                break;
+            }
+
+            if(io.inPos < io.inLen)
+            {
+                DECOMPRESS_ERR("decoder made no progress, corrupted data");
+                break;
+            }
+        }
+    }
+
+    if(io.out != NULL)
+        decompressPublish(stream, io.outPos);
+
+    free(input);
+
+    pthread_mutex_lock(&(stream->lock));
+    stream->finished = true;
+    pthread_cond_signal(&(stream->filled));
+    pthread_mutex_unlock(&(stream->lock));
+
+    return NULL;
+}
+
+/**
+ * @brief Reads decompressed data, fopencookie() read callback
+ *
+ * @param cookie Pointer to the DecompressStream
+ * @param buffer Destination buffer
+ * @param size Size of the buffer
+ * @return ssize_t Number of bytes read, 0 at end of data, -1 on error
+ */
+ssize_t decompressRead(void* cookie, char* buffer, size_t size)
+{
+    DecompressStream* stream = (DecompressStream*) cookie;
+
+    pthread_mutex_lock(&(stream->lock));
+
+    // slot is released only when next data are needed, so that seek can
+    // return into data that stdio already buffered
+    if(stream->count > 0 && stream->readOffset == stream->slots[stream->tail].length)
+    {
+        stream->tail = (stream->tail + 1) % DECOMPRESS_SLOTS;
+        stream->count--;
+        stream->readOffset = 0;
+        pthread_cond_signal(&(stream->emptied));
+    }
+
+    while(stream->count == 0 && !stream->finished)
+        pthread_cond_wait(&(stream->filled), &(stream->lock));
+
+    if(stream->count == 0)
+    {
+        pthread_mutex_unlock(&(stream->lock));
+        if(stream->error[0] == '\0')
+            return 0;
+
+        if(!stream->reported)
+            fprintf(stderr, "ERR: Decompression of %s failed: %s\n", stream->path, stream->error);
+        stream->reported = true;
+
+        errno = EIO;
+        return -1;
+    }
+    pthread_mutex_unlock(&(stream->lock));
+
+    // filled slot is not touched by decompression thread, one read never
+    // crosses end of slot
+    DecompressSlot* slot = &(stream->slots[stream->tail]);
+    size_t length = slot->length - stream->readOffset;
+    if(length > size)
+        length = size;
+
+    memcpy(buffer, slot->data + stream->readOffset, length);
+    stream->readOffset += length;
+    stream->position += length;
+
+    return length;
+}
+
+/**
+ * @brief Moves position in decompressed data, fopencookie() seek callback.
+ * Backward seek is possible only inside of slot that was read last, data
+ * skipped by forward seek are decompressed and dropped
+ *
+ * @param cookie Pointer to the DecompressStream
+ * @param offset Pointer to the wanted offset, set to the new position
+ * @param whence SEEK_SET or SEEK_CUR
+ * @return int 0 on success, -1 if position is not reachable
+ */
+int decompressSeek(void* cookie, off64_t* offset, int whence)
+{
+    DecompressStream* stream = (DecompressStream*) cookie;
+
+    off64_t target;
+    if(whence == SEEK_SET)
+        target = *offset;
+    else if(whence == SEEK_CUR)
+        target = stream->position + *offset;
+    else
+        target = -1;
+
+    if(target < stream->position)
+    {
+        // stdio asks for data it buffered from last read, slot still holds them
+        pthread_mutex_lock(&(stream->lock));
+        bool held = stream->count > 0;
+        pthread_mutex_unlock(&(stream->lock));
+
+        if(!held || target < stream->position - (off64_t) stream->readOffset)
+        {
+            errno = ESPIPE;
+            return -1;
+        }
+
+        stream->readOffset -= stream->position - target;
+        stream->position = target;
+    }
+
+    char skipped[4096];
+    while(stream->position < target)
+    {
+        size_t length = sizeof(skipped);
+        if((off64_t) length > target - stream->position)
+            length = target - stream->position;
+
+        ssize_t read = decompressRead(cookie, skipped, length);
+        if(read == 0)
+            errno = EINVAL;
+        if(read <= 0)
+            return -1;
+    }
+
+    *offset = stream->position;
+    return 0;
+}
+
+/**
+ * @brief Stops decompression thread and frees stream, fopencookie() close
+ * callback
+ *
+ * @param cookie Pointer to the DecompressStream
+ * @return int Always 0
+ */
+int decompressClose(void* cookie)
+{
+    DecompressStream* stream = (DecompressStream*) cookie;
+
+    pthread_mutex_lock(&(stream->lock));
+    stream->stopped = true;
+    pthread_cond_signal(&(stream->emptied));
+    pthread_mutex_unlock(&(stream->lock));
+
+    pthread_join(stream->thread, NULL);
+
+    decompressEnd(stream);
+    fclose(stream->input);
+
+    for(unsigned i = 0; i < DECOMPRESS_SLOTS; i++)
+        free(stream->slots[i].data);
+
+    pthread_mutex_destroy(&(stream->lock));
+    pthread_cond_destroy(&(stream->filled));
+    pthread_cond_destroy(&(stream->emptied));
+    free(stream->path);
+    free(stream);
+
+    return 0;
+}
+
+/**
+ * @brief Opens compressed savefile and starts its decompression thread,
+ * stream is stopped and freed when returned FILE is closed
+ *
+ * @param path Path to the file
+ * @return FILE* Stream with decompressed data or NULL if file is not
+ * regular file compressed by supported format
+ */
+FILE* decompressOpen(const char* path)
+{
+    // pipes can not be rewound after magic bytes are read
+    struct stat info;
+    if(stat(path, &info) != 0 || !S_ISREG(info.st_mode))
+        return NULL;
+
+    FILE* input = fopen(path, "rb");
+    if(input == NULL)
+        return NULL;
+
+    unsigned char magic[6];
+    size_t length = fread(magic, 1, sizeof(magic), input);
+    CompressionType type = decompressDetect(magic, length);
+    if(type == COMPRESSION_NONE || fseek(input, 0, SEEK_SET) != 0)
+    {
+        fclose(input);
+        return NULL;
+    }
+
+    DecompressStream* stream = (DecompressStream*) calloc(1, sizeof(DecompressStream));
+    if(stream == NULL)
+        errHandling("Failed to allocate memory for DecompressStream", ERR_MALLOC);
+
+    stream->input = input;
+    stream->type = type;
+    stream->path = strdup(path);
+    if(stream->path == NULL)
+        errHandling("Failed to allocate memory for DecompressStream", ERR_MALLOC);
+
+    for(unsigned i = 0; i < DECOMPRESS_SLOTS; i++)
+    {
+        stream->slots[i].data = (unsigned char*) malloc(DECOMPRESS_SLOT_SIZE);
+        if(stream->slots[i].data == NULL)
+            errHandling("Failed to allocate memory for DecompressStream", ERR_MALLOC);
+    }
+
+    if(!decompressInit(stream))
+    {
+        fprintf(stderr, "ERR: Decompression of %s failed: %s\n", path, stream->error);
+        errHandling("", ERR_INTERNAL);
+    }
+
+    pthread_mutex_init(&(stream->lock), NULL);
+    pthread_cond_init(&(stream->filled), NULL);
+    pthread_cond_init(&(stream->emptied), NULL);
+
+    if(pthread_create(&(stream->thread), NULL, decompressLooper, stream) != 0)
+        errHandling("Failed to create decompression thread", ERR_INTERNAL);
+
+    cookie_io_functions_t functions = {decompressRead, NULL, decompressSeek, decompressClose};
+    FILE* file = fopencookie(stream, "r", functions);
+    if(file == NULL)
+        errHandling("Failed to open decompressed stream", ERR_INTERNAL);
+
+    return file;
+}
+
+#undef DECOMPRESS_ERR
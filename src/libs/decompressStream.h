@@ -0,0 +1,125 @@
+/**
+ * @file decompressStream.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Transparent reading of gzip, zstd and xz compressed savefiles.
+ * Compression is recognized by magic bytes, file is decompressed by own
+ * thread into bounded ring of slots and parser reads decompressed data
+ * through ordinary FILE stream, so decompression and dissection run on
+ * different cores and nothing is written to disk.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef DECOMPRESS_STREAM_H
+#define DECOMPRESS_STREAM_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pthread.h"
+#include "zlib.h"
+#include "zstd.h"
+#include "lzma.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define DECOMPRESS_SLOTS 8                      // slots of ring
+#define DECOMPRESS_SLOT_SIZE (1024 * 1024)      // decompressed bytes per slot
+#define DECOMPRESS_INPUT_SIZE (256 * 1024)      // compressed bytes per read
+#define DECOMPRESS_ERR_LEN 256
+
+/**
+ * @brief Supported compression formats
+ */
+typedef enum CompressionType {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD,
+    COMPRESSION_XZ,
+} CompressionType;
+
+/**
+ * @brief Result of one decompression step
+ */
+typedef enum DecompressStep {
+    DECOMPRESS_MORE,                // frame continues
+    DECOMPRESS_END,                 // frame (gzip member, zstd frame, xz stream) ended
+    DECOMPRESS_ERROR,
+} DecompressStep;
+
+/**
+ * @brief Input and output of decompression step
+ */
+typedef struct DecompressIo {
+    const unsigned char* in;
+    size_t inPos;
+    size_t inLen;
+    bool inputEnd;                  // no other input will follow
+
+    unsigned char* out;
+    size_t outPos;
+    size_t outLen;
+} DecompressIo;
+
+/**
+ * @brief Decompressed data waiting for parser
+ */
+typedef struct DecompressSlot {
+    unsigned char* data;
+    size_t length;
+} DecompressSlot;
+
+/**
+ * @brief Compressed file read through decompression thread
+ */
+typedef struct DecompressStream {
+    FILE* input;
+    char* path;
+    CompressionType type;
+
+    // state of decoder, selected by type
+    union {
+        z_stream gzip;
+        ZSTD_DStream* zstd;
+        lzma_stream xz;
+    };
+    bool frameEnded;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;          // signalled when slot is filled
+    pthread_cond_t emptied;         // signalled when slot is read
+
+    DecompressSlot slots[DECOMPRESS_SLOTS];
+    unsigned head;                  // next slot filled by thread
+    unsigned tail;                  // slot read by parser
+    unsigned count;                 // filled slots
+    size_t readOffset;              // bytes of tail slot already read
+    int64_t position;               // decompressed bytes read by parser
+
+    bool finished;                  // thread filled its last slot
+    bool stopped;                   // parser closed stream
+    bool reported;                  // error was printed
+    char error[DECOMPRESS_ERR_LEN]; // empty if no error occurred
+} DecompressStream;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Opens compressed savefile and starts its decompression thread,
+ * stream is stopped and freed when returned FILE is closed
+ *
+ * @param path Path to the file
+ * @return FILE* Stream with decompressed data or NULL if file is not
+ * regular file compressed by supported format
+ */
+FILE* decompressOpen(const char* path);
+
+#endif /*DECOMPRESS_STREAM_H*/
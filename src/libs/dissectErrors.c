@@ -0,0 +1,78 @@
+/**
+ * @file dissectErrors.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of counters of skipped malformed packets
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "dissectErrors.h"
+
+/**
+ * @brief Returns short description of error class
+ *
+ * @param error Error class
+ * @return const char* Static string
+ */
+const char* dissectErrorName(DissectError error)
+{
+    switch(error)
+    {
+        case DISSECT_OK:                return "ok";
+        case DISSECT_SHORT_FRAME:       return "short frame";
+        case DISSECT_UNSUPPORTED:       return "unsupported protocol";
+        case DISSECT_SHORT_TRANSPORT:   return "short transport header";
+        case DISSECT_SHORT_HEADER:      return "short DNS header";
+        case DISSECT_BAD_NAME:          return "bad name";
+        case DISSECT_SHORT_RECORD:      return "short record";
+        default:                        return "unknown";
+    }
+}
+
+/**
+ * @brief Adds counters of one capture loop (worker) to another
+ *
+ * @param total Pointer to the DissectStats where counters are added
+ * @param stats Pointer to the added DissectStats
+ */
+void dissectStatsAdd(DissectStats* total, const DissectStats* stats)
+{
+    for(unsigned i = 0; i < DISSECT_ERROR_COUNT; i++)
+        total->errors[i] += stats->errors[i];
+
+    total->quarantined += stats->quarantined;
+}
+
+/**
+ * @brief Prints number of skipped packets per error class onto stderr,
+ * nothing is printed when no packet was skipped
+ *
+ * @param stats Pointer to the DissectStats
+ */
+void dissectStatsReport(const DissectStats* stats)
+{
+    unsigned long skipped = 0;
+    for(unsigned i = DISSECT_OK + 1; i < DISSECT_ERROR_COUNT; i++)
+        skipped += stats->errors[i];
+
+    if(skipped == 0)
+        return;
+
+    fprintf(stderr, "Malformed packets: %lu skipped (", skipped);
+
+    const char* separator = "";
+    for(unsigned i = DISSECT_OK + 1; i < DISSECT_ERROR_COUNT; i++)
+    {
+        if(stats->errors[i] == 0)
+            continue;
+
+        fprintf(stderr, "%s%s %lu", separator, dissectErrorName(i), stats->errors[i]);
+        separator = ", ";
+    }
+
+    fprintf(stderr, ")");
+    if(stats->quarantined > 0)
+        fprintf(stderr, ", %lu written into quarantine", stats->quarantined);
+    fprintf(stderr, "\n");
+}
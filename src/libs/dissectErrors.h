@@ -0,0 +1,75 @@
+/**
+ * @file dissectErrors.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Errors of dissection of one packet. Malformed packet is skipped
+ * instead of ending the program, so reassembly state and collected domains
+ * survive hostile traffic; skipped packets are counted per error class and
+ * can be written into quarantine file.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef DISSECT_ERRORS_H
+#define DISSECT_ERRORS_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Reason why packet was skipped, returned up the dissector call chain
+ */
+typedef enum DissectError {
+    DISSECT_OK,
+    DISSECT_SHORT_FRAME,            // packet ends inside link/network header
+    DISSECT_UNSUPPORTED,            // unknown link or network protocol
+    DISSECT_SHORT_TRANSPORT,        // packet ends inside UDP/TCP header
+    DISSECT_SHORT_HEADER,           // message shorter than DNS header
+    DISSECT_BAD_NAME,               // name leaves message or pointers loop
+    DISSECT_SHORT_RECORD,           // record fields or RDATA leave message
+    DISSECT_ERROR_COUNT,
+} DissectError;
+
+/**
+ * @brief Counters of skipped packets
+ */
+typedef struct DissectStats {
+    unsigned long errors[DISSECT_ERROR_COUNT];
+    unsigned long quarantined;      // skipped packets passed to quarantine
+} DissectStats;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Returns short description of error class
+ *
+ * @param error Error class
+ * @return const char* Static string
+ */
+const char* dissectErrorName(DissectError error);
+
+/**
+ * @brief Adds counters of one capture loop (worker) to another
+ *
+ * @param total Pointer to the DissectStats where counters are added
+ * @param stats Pointer to the added DissectStats
+ */
+void dissectStatsAdd(DissectStats* total, const DissectStats* stats);
+
+/**
+ * @brief Prints number of skipped packets per error class onto stderr,
+ * nothing is printed when no packet was skipped
+ *
+ * @param stats Pointer to the DissectStats
+ */
+void dissectStatsReport(const DissectStats* stats);
+
+#endif /*DISSECT_ERRORS_H*/
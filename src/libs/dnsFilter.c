@@ -0,0 +1,628 @@
+/**
+ * @file dnsFilter.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of DNS level filters compiled into classic BPF
+ *
+ * Source: https://www.kernel.org/doc/html/latest/networking/filter.html
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "dnsFilter.h"
+#include "packetDissector.h"
+
+#include "ctype.h"
+#include "string.h"
+
+#define IPV6_HEADER_LEN 40
+#define UDP_HEADER_LEN 8
+
+// scratch memory slots used by appended program
+#define MEM_QNAME_END 0
+#define MEM_QNAME_START 1
+
+/**
+ * @brief Appended BPF program that is being generated
+ */
+typedef struct BpfEmitter {
+    struct bpf_insn* insns;
+    unsigned len;
+    unsigned max;
+} BpfEmitter;
+
+/**
+ * @brief Sets filter so it accepts every DNS message
+ *
+ * @param filter Pointer to the DnsFilter
+ */
+void dnsFilterInit(DnsFilter* filter)
+{
+    filter->qr = DNS_FILTER_QR_ANY;
+    filter->opcode = DNS_FILTER_OPCODE_ANY;
+    filter->qtypeCount = 0;
+    filter->zoneCount = 0;
+}
+
+/**
+ * @brief Checks if filter contains any predicate
+ *
+ * @param filter Pointer to the DnsFilter
+ * @return true At least one predicate is set
+ * @return false Filter accepts everything
+ */
+bool dnsFilterIsActive(DnsFilter* filter)
+{
+    return filter->qr != DNS_FILTER_QR_ANY ||
+        filter->opcode != DNS_FILTER_OPCODE_ANY ||
+        filter->qtypeCount > 0 || filter->zoneCount > 0;
+}
+
+/**
+ * @brief Converts one question type name or number into its value
+ *
+ * @param name Name of the type, not terminated string
+ * @param len Length of the name
+ * @param type Pointer where value will be stored
+ * @return true Type is valid
+ * @return false Type is unknown
+ */
+bool parseQType(const char* name, size_t len, unsigned short* type)
+{
+    if(len == 0)
+        return false;
+
+    // names are taken from registry of record types
+    unsigned known = 0;
+    if(rrTypeByName(name, len, &known))
+    {
+        *type = (unsigned short) known;
+        return true;
+    }
+
+    unsigned long value = 0;
+    for(size_t i = 0; i < len; i++)
+    {
+        if(name[i] < '0' || name[i] > '9')
+            return false;
+
+        value = value * 10 + (name[i] - '0');
+        if(value > 0xffff)
+            return false;
+    }
+
+    *type = (unsigned short) value;
+    return true;
+}
+
+/**
+ * @brief Adds comma separated list of question types (names like A, AAAA,
+ * MX or numbers) into filter
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param list Comma separated list of types
+ * @return true All types were added
+ * @return false Unknown type or too many types
+ */
+bool dnsFilterAddQTypes(DnsFilter* filter, const char* list)
+{
+    while(true)
+    {
+        const char* end = strchr(list, ',');
+        size_t len = (end == NULL)? strlen(list) : (size_t) (end - list);
+
+        if(filter->qtypeCount >= DNS_FILTER_MAX_QTYPES)
+            return false;
+
+        if(!parseQType(list, len, &(filter->qtypes[filter->qtypeCount])))
+            return false;
+
+        filter->qtypeCount++;
+
+        if(end == NULL)
+            return true;
+
+        list = end + 1;
+    }
+}
+
+/**
+ * @brief Converts domain name into DnsFilterZone
+ *
+ * @param name Domain name, not terminated string
+ * @param len Length of the name
+ * @param zone Pointer to the zone that will be filled
+ * @return true Name is valid
+ * @return false Name contains empty or too long label or is too long
+ */
+bool parseZone(const char* name, size_t len, DnsFilterZone* zone)
+{
+    // trailing dot of fully qualified name is optional
+    if(len > 0 && name[len - 1] == '.')
+        len--;
+
+    if(len + 2 > DNS_NAME_MAX_LEN)
+        return false;
+
+    zone->nameLen = 0;
+    zone->wireLen = 0;
+
+    size_t labelStart = 0;
+    for(size_t i = 0; i <= len && len > 0; i++)
+    {
+        if(i < len && name[i] != '.')
+            continue;
+
+        size_t labelLen = i - labelStart;
+        if(labelLen == 0 || labelLen > 63)
+            return false;
+
+        zone->wire[zone->wireLen++] = (unsigned char) labelLen;
+        for(size_t j = labelStart; j < i; j++)
+            zone->wire[zone->wireLen++] = (unsigned char) tolower((unsigned char) name[j]);
+
+        labelStart = i + 1;
+    }
+
+    zone->wire[zone->wireLen++] = 0;
+
+    for(size_t i = 0; i < len; i++)
+        zone->name[i] = (char) tolower((unsigned char) name[i]);
+
+    zone->name[len] = '\0';
+    zone->nameLen = len;
+
+    return true;
+}
+
+/**
+ * @brief Adds comma separated list of domain suffixes into filter
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param list Comma separated list of domain names
+ * @return true All zones were added
+ * @return false Invalid domain name or too many zones
+ */
+bool dnsFilterAddZones(DnsFilter* filter, const char* list)
+{
+    while(true)
+    {
+        const char* end = strchr(list, ',');
+        size_t len = (end == NULL)? strlen(list) : (size_t) (end - list);
+
+        if(filter->zoneCount >= DNS_FILTER_MAX_ZONES || len == 0)
+            return false;
+
+        if(!parseZone(list, len, &(filter->zones[filter->zoneCount])))
+            return false;
+
+        filter->zoneCount++;
+
+        if(end == NULL)
+            return true;
+
+        list = end + 1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//  Kernel program
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Adds one instruction at the end of generated program
+ *
+ * @param bpf Pointer to the BpfEmitter
+ * @param code Instruction opcode
+ * @param jt Relative jump if condition is true
+ * @param jf Relative jump if condition is false
+ * @param k Generic field
+ */
+void bpfEmit(BpfEmitter* bpf, unsigned short code, unsigned char jt,
+            unsigned char jf, unsigned k)
+{
+    if(bpf->len >= bpf->max)
+        errHandling("Generated DNS filter is too long", ERR_INTERNAL);
+
+    bpf->insns[bpf->len].code = code;
+    bpf->insns[bpf->len].jt = jt;
+    bpf->insns[bpf->len].jf = jf;
+    bpf->insns[bpf->len].k = k;
+    bpf->len++;
+}
+
+/**
+ * @brief Generates walk over QNAME labels, unrolled DNS_FILTER_MAX_LABELS
+ * times because classic BPF can not jump backwards. X register must point
+ * at start of QNAME, at the end it points at terminating zero label.
+ * Compressed or too long names are accepted and decided in user space.
+ *
+ * @param bpf Pointer to the BpfEmitter
+ * @param accept Value returned by accepting instruction
+ */
+void bpfEmitNameWalk(BpfEmitter* bpf, unsigned accept)
+{
+    const unsigned stepLen = 9;
+    unsigned start = bpf->len;
+    unsigned fallback = start + stepLen * DNS_FILTER_MAX_LABELS;
+    unsigned done = fallback + 1;
+
+    for(unsigned i = 0; i < DNS_FILTER_MAX_LABELS; i++)
+    {
+        unsigned step = bpf->len;
+
+        bpfEmit(bpf, BPF_LD | BPF_B | BPF_IND, 0, 0, 0);       // A = label length
+        bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 5, 0, 0);      // end of name
+        bpfEmit(bpf, BPF_JMP | BPF_JSET | BPF_K, 5, 0, 0xc0);  // compression
+        bpfEmit(bpf, BPF_ALU | BPF_ADD | BPF_K, 0, 0, 1);
+        bpfEmit(bpf, BPF_ALU | BPF_ADD | BPF_X, 0, 0, 0);
+        bpfEmit(bpf, BPF_MISC | BPF_TAX, 0, 0, 0);             // X = next label
+        bpfEmit(bpf, BPF_JMP | BPF_JA, 0, 0, 2);
+        bpfEmit(bpf, BPF_JMP | BPF_JA, 0, 0, done - (step + 8));
+        bpfEmit(bpf, BPF_JMP | BPF_JA, 0, 0, fallback - (step + 9));
+    }
+
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+}
+
+/**
+ * @brief Generates check if QNAME ends with zone, bytes are compared with
+ * 0x20 bit set so comparison ignores case of letters (false positives are
+ * removed in user space). On match program accepts packet, otherwise
+ * continues after generated code.
+ *
+ * @param bpf Pointer to the BpfEmitter
+ * @param zone Pointer to the zone
+ * @param accept Value returned by accepting instruction
+ */
+void bpfEmitZone(BpfEmitter* bpf, DnsFilterZone* zone, unsigned accept)
+{
+    // zone is compared by words, rest by halfword and byte
+    unsigned offsets[DNS_NAME_MAX_LEN];
+    unsigned widths[DNS_NAME_MAX_LEN];
+    unsigned pieces = 0;
+    for(unsigned offset = 0; offset < zone->wireLen; pieces++)
+    {
+        unsigned rest = zone->wireLen - offset;
+        offsets[pieces] = offset;
+        widths[pieces] = (rest >= 4)? 4 : (rest >= 2)? 2 : 1;
+        offset += widths[pieces];
+    }
+
+    // skipped when QNAME is shorter than zone, otherwise X = start of suffix
+    bpfEmit(bpf, BPF_LDX | BPF_MEM, 0, 0, MEM_QNAME_START);
+    bpfEmit(bpf, BPF_LD | BPF_MEM, 0, 0, MEM_QNAME_END);
+    bpfEmit(bpf, BPF_ALU | BPF_SUB | BPF_X, 0, 0, 0);
+    bpfEmit(bpf, BPF_JMP | BPF_JGE | BPF_K, 0, 3 + pieces * 3 + 1, zone->wireLen - 1);
+    bpfEmit(bpf, BPF_LD | BPF_MEM, 0, 0, MEM_QNAME_END);
+    bpfEmit(bpf, BPF_ALU | BPF_SUB | BPF_K, 0, 0, zone->wireLen - 1);
+    bpfEmit(bpf, BPF_MISC | BPF_TAX, 0, 0, 0);
+
+    for(unsigned i = 0; i < pieces; i++)
+    {
+        unsigned value = 0;
+        unsigned mask = 0;
+        for(unsigned j = 0; j < widths[i]; j++)
+        {
+            value = (value << 8) | zone->wire[offsets[i] + j];
+            mask = (mask << 8) | 0x20;
+        }
+
+        unsigned short size = (widths[i] == 4)? BPF_W : (widths[i] == 2)? BPF_H : BPF_B;
+        unsigned remaining = (pieces - i - 1) * 3 + 1;
+
+        bpfEmit(bpf, BPF_LD | size | BPF_IND, 0, 0, offsets[i]);
+        bpfEmit(bpf, BPF_ALU | BPF_OR | BPF_K, 0, 0, mask);
+        bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 0, remaining, value | mask);
+    }
+
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+}
+
+/**
+ * @brief Generates DNS predicates, program starts with A register
+ * undefined and ends by returning accept or 0
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param bpf Pointer to the BpfEmitter
+ * @param link Link layer of the capture
+ * @param accept Value returned by accepting instructions
+ */
+void bpfEmitDns(DnsFilter* filter, BpfEmitter* bpf, const LinkLayer* link, unsigned accept)
+{
+    unsigned net = link->headerLen;
+    unsigned ipv4Type = ETH_TYPE_IPV4;
+    unsigned ipv6Type = ETH_TYPE_IPV6;
+
+    // A = network protocol, taken from EtherType or from IP version
+    if(link->typeOffset != LINK_TYPE_OFFSET_NONE)
+        bpfEmit(bpf, BPF_LD | BPF_H | BPF_ABS, 0, 0, link->typeOffset);
+    else
+    {
+        bpfEmit(bpf, BPF_LD | BPF_B | BPF_ABS, 0, 0, net);
+        bpfEmit(bpf, BPF_ALU | BPF_AND | BPF_K, 0, 0, 0xf0);
+        ipv4Type = 0x40;
+        ipv6Type = 0x60;
+    }
+
+    // X = start of DNS header, TCP, IP fragments, VLAN tagged frames and 
+    // IPv6 with extension headers are decided in user space
+    bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 13, 0, ipv6Type);
+    bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, ipv4Type);
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+    bpfEmit(bpf, BPF_LD | BPF_B | BPF_ABS, 0, 0, net + 9);
+    bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, IPPROTO_UDP);
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+    bpfEmit(bpf, BPF_LD | BPF_H | BPF_ABS, 0, 0, net + 6);
+    bpfEmit(bpf, BPF_JMP | BPF_JSET | BPF_K, 0, 1, IP_MF | IP_OFFMASK);
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+    bpfEmit(bpf, BPF_LDX | BPF_B | BPF_MSH, 0, 0, net);
+    bpfEmit(bpf, BPF_MISC | BPF_TXA, 0, 0, 0);
+    bpfEmit(bpf, BPF_ALU | BPF_ADD | BPF_K, 0, 0, net + UDP_HEADER_LEN);
+    bpfEmit(bpf, BPF_MISC | BPF_TAX, 0, 0, 0);
+    bpfEmit(bpf, BPF_JMP | BPF_JA, 0, 0, 4);
+    bpfEmit(bpf, BPF_LD | BPF_B | BPF_ABS, 0, 0, net + 6);
+    bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, IPPROTO_UDP);
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+    bpfEmit(bpf, BPF_LDX | BPF_IMM, 0, 0, net + IPV6_HEADER_LEN + UDP_HEADER_LEN);
+
+    if(filter->qr != DNS_FILTER_QR_ANY)
+    {
+        bpfEmit(bpf, BPF_LD | BPF_B | BPF_IND, 0, 0, 2);
+        if(filter->qr == DNS_FILTER_QR_RESPONSES)
+            bpfEmit(bpf, BPF_JMP | BPF_JSET | BPF_K, 1, 0, QR >> 8);
+        else
+            bpfEmit(bpf, BPF_JMP | BPF_JSET | BPF_K, 0, 1, QR >> 8);
+        bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, 0);
+    }
+
+    if(filter->opcode != DNS_FILTER_OPCODE_ANY)
+    {
+        bpfEmit(bpf, BPF_LD | BPF_B | BPF_IND, 0, 0, 2);
+        bpfEmit(bpf, BPF_ALU | BPF_AND | BPF_K, 0, 0, OPCODE >> 8);
+        bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, (unsigned) filter->opcode << 3);
+        bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, 0);
+    }
+
+    if(filter->qtypeCount == 0 && filter->zoneCount == 0)
+    {
+        bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, accept);
+        return;
+    }
+
+    // question section must be present
+    bpfEmit(bpf, BPF_LD | BPF_H | BPF_IND, 0, 0, 4);
+    bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0);
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, 0);
+
+    bpfEmit(bpf, BPF_MISC | BPF_TXA, 0, 0, 0);
+    bpfEmit(bpf, BPF_ALU | BPF_ADD | BPF_K, 0, 0, DNS_HEADER_LEN);
+    bpfEmit(bpf, BPF_MISC | BPF_TAX, 0, 0, 0);
+    bpfEmit(bpf, BPF_STX, 0, 0, MEM_QNAME_START);
+
+    bpfEmitNameWalk(bpf, accept);
+    bpfEmit(bpf, BPF_STX, 0, 0, MEM_QNAME_END);
+
+    if(filter->qtypeCount > 0)
+    {
+        // QTYPE follows right after terminating zero label
+        bpfEmit(bpf, BPF_LD | BPF_H | BPF_IND, 0, 0, 1);
+        for(unsigned i = 0; i < filter->qtypeCount; i++)
+            bpfEmit(bpf, BPF_JMP | BPF_JEQ | BPF_K, filter->qtypeCount - i, 0, filter->qtypes[i]);
+        bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, 0);
+    }
+
+    for(unsigned i = 0; i < filter->zoneCount; i++)
+        bpfEmitZone(bpf, &(filter->zones[i]), accept);
+
+    bpfEmit(bpf, BPF_RET | BPF_K, 0, 0, (filter->zoneCount > 0)? 0 : accept);
+}
+
+/**
+ * @brief Appends DNS predicates to program compiled from base filter, every
+ * accepting return of base program is redirected to appended code
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param fp Compiled base program, bf_insns is replaced by new array
+ * @param linkType Datalink type of the capture (DLT_*)
+ * @return true Program was extended
+ * @return false Program can not be extended (unsupported datalink or base
+ * program), predicates are checked only in user space
+ */
+bool dnsFilterAttach(DnsFilter* filter, struct bpf_program* fp, int linkType)
+{
+    if(!dnsFilterIsActive(filter))
+        return true;
+
+    const LinkLayer* link = linkLayerFind(linkType);
+    if(link == NULL)
+        return false;
+
+    // accepting value of base program (snapshot length) is reused
+    unsigned accept = 0;
+    for(unsigned i = 0; i < fp->bf_len; i++)
+    {
+        struct bpf_insn* insn = &(fp->bf_insns[i]);
+        if(BPF_CLASS(insn->code) != BPF_RET)
+            continue;
+
+        if(insn->code != (BPF_RET | BPF_K))
+            return false;
+
+        if(insn->k != 0)
+            accept = insn->k;
+    }
+
+    if(accept == 0)
+        return false;
+
+    BpfEmitter bpf;
+    bpf.max = fp->bf_len + DNS_FILTER_MAX_INSNS;
+    bpf.insns = (struct bpf_insn*) malloc(sizeof(struct bpf_insn) * bpf.max);
+    if(bpf.insns == NULL)
+        errHandling("Failed to allocate memory for DNS filter", ERR_MALLOC);
+
+    memcpy(bpf.insns, fp->bf_insns, sizeof(struct bpf_insn) * fp->bf_len);
+    bpf.len = fp->bf_len;
+
+    for(unsigned i = 0; i < fp->bf_len; i++)
+    {
+        struct bpf_insn* insn = &(bpf.insns[i]);
+        if(insn->code == (BPF_RET | BPF_K) && insn->k != 0)
+        {
+            insn->code = BPF_JMP | BPF_JA;
+            insn->k = fp->bf_len - (i + 1);
+        }
+    }
+
+    bpfEmitDns(filter, &bpf, link, accept);
+
+    free(fp->bf_insns);
+    fp->bf_insns = bpf.insns;
+    fp->bf_len = bpf.len;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+//  User space check
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Reads question name into lower case text without trailing dot
+ *
+ * @param dns Start of DNS message
+ * @param len Length of DNS message
+ * @param name Array of DNS_NAME_MAX_LEN + 1 characters
+ * @param nameLen Pointer where length of name is stored
+ * @param end Pointer where offset after name (in question) is stored
+ * @return true Name was read
+ * @return false Name is malformed
+ */
+bool readQuestionName(const unsigned char* dns, size_t len, char* name,
+                        unsigned* nameLen, size_t* end)
+{
+    size_t ptr = DNS_HEADER_LEN;
+    unsigned hops = 0;
+    bool jumped = false;
+
+    *nameLen = 0;
+    while(true)
+    {
+        if(ptr >= len)
+            return false;
+
+        unsigned char labelLen = dns[ptr];
+        if(labelLen == 0)
+        {
+            if(!jumped)
+                *end = ptr + 1;
+            break;
+        }
+
+        if((labelLen & 0xc0) == 0xc0)
+        {
+            if(ptr + 1 >= len || ++hops > DNS_NAME_MAX_HOPS)
+                return false;
+
+            if(!jumped)
+                *end = ptr + 2;
+
+            jumped = true;
+            ptr = ((labelLen & 0x3f) << 8) | dns[ptr + 1];
+            continue;
+        }
+
+        if(labelLen > DNS_LABEL_MAX_LEN || ptr + 1 + labelLen > len ||
+            *nameLen + labelLen + 1 > DNS_NAME_MAX_LEN)
+            return false;
+
+        if(*nameLen > 0)
+            name[(*nameLen)++] = '.';
+
+        for(unsigned i = 0; i < labelLen; i++)
+            name[(*nameLen)++] = (char) tolower(dns[ptr + 1 + i]);
+
+        ptr += 1 + labelLen;
+    }
+
+    name[*nameLen] = '\0';
+    return true;
+}
+
+/**
+ * @brief Checks if DNS message matches filter
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param dns Start of DNS message
+ * @param len Length of DNS message
+ * @return true Message matches or filter is not active
+ * @return false Message does not match
+ */
+bool dnsFilterMatch(DnsFilter* filter, const unsigned char* dns, size_t len)
+{
+    if(!dnsFilterIsActive(filter))
+        return true;
+
+    if(len < DNS_HEADER_LEN)
+        return false;
+
+    unsigned short flags = (dns[2] << 8) | dns[3];
+
+    if(filter->qr == DNS_FILTER_QR_RESPONSES && (flags & QR) == 0)
+        return false;
+
+    if(filter->qr == DNS_FILTER_QR_QUERIES && (flags & QR) != 0)
+        return false;
+
+    if(filter->opcode != DNS_FILTER_OPCODE_ANY && (int) ((flags & OPCODE) >> 11) != filter->opcode)
+        return false;
+
+    if(filter->qtypeCount == 0 && filter->zoneCount == 0)
+        return true;
+
+    if(((dns[4] << 8) | dns[5]) == 0)
+        return false;
+
+    char name[DNS_NAME_MAX_LEN + 1];
+    unsigned nameLen;
+    size_t end;
+    if(!readQuestionName(dns, len, name, &nameLen, &end) || end + 2 > len)
+        return false;
+
+    if(filter->qtypeCount > 0)
+    {
+        unsigned short qtype = (dns[end] << 8) | dns[end + 1];
+        bool found = false;
+        for(unsigned i = 0; i < filter->qtypeCount && !found; i++)
+            found = (filter->qtypes[i] == qtype);
+
+        if(!found)
+            return false;
+    }
+
+    if(filter->zoneCount == 0)
+        return true;
+
+    for(unsigned i = 0; i < filter->zoneCount; i++)
+    {
+        DnsFilterZone* zone = &(filter->zones[i]);
+        if(zone->nameLen == 0)
+            return true; // root zone
+
+        if(nameLen < zone->nameLen)
+            continue;
+
+        unsigned start = nameLen - zone->nameLen;
+        if(memcmp(name + start, zone->name, zone->nameLen) == 0 &&
+            (start == 0 || name[start - 1] == '.'))
+            return true;
+    }
+
+    return false;
+}
+
+#undef IPV6_HEADER_LEN
+#undef UDP_HEADER_LEN
+#undef MEM_QNAME_END
+#undef MEM_QNAME_START
@@ -0,0 +1,134 @@
+/**
+ * @file dnsFilter.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief DNS level filters (QR, opcode, question type and domain suffix)
+ * that are compiled into classic BPF and appended to the capture filter
+ * program, so packets that are not interesting are dropped by kernel before
+ * they are copied to user space. Predicates that BPF can not evaluate
+ * (compressed names, IPv6 extension headers, too many labels) are accepted
+ * by kernel and decided by dnsFilterMatch() in user space. TCP segments and
+ * IP fragments are always accepted, DNS messages are known only after
+ * stream or fragment reassembly.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef DNS_FILTER_H
+#define DNS_FILTER_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pcap/pcap.h"
+
+#include "utils.h"
+#include "dnsMessage.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define DNS_FILTER_MAX_QTYPES 16
+#define DNS_FILTER_MAX_ZONES 8
+#define DNS_FILTER_MAX_LABELS 16        // labels walked by kernel program
+#define DNS_FILTER_MAX_INSNS 2048       // upper bound of appended program
+
+#define DNS_FILTER_QR_ANY 0
+#define DNS_FILTER_QR_QUERIES 1
+#define DNS_FILTER_QR_RESPONSES 2
+
+#define DNS_FILTER_OPCODE_ANY -1
+
+/**
+ * @brief Domain suffix, stored both as text (lower case, without trailing
+ * dot) and in DNS wire format (length prefixed labels ending with zero)
+ */
+typedef struct DnsFilterZone {
+    char name[DNS_NAME_MAX_LEN + 1];
+    unsigned nameLen;
+    unsigned char wire[DNS_NAME_MAX_LEN];
+    unsigned wireLen;
+} DnsFilterZone;
+
+/**
+ * @brief Set of DNS predicates, all of them must match, qtypes and zones
+ * match if any of listed values matches
+ */
+typedef struct DnsFilter {
+    char qr;
+    int opcode;
+
+    unsigned short qtypes[DNS_FILTER_MAX_QTYPES];
+    unsigned qtypeCount;
+
+    DnsFilterZone zones[DNS_FILTER_MAX_ZONES];
+    unsigned zoneCount;
+} DnsFilter;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Sets filter so it accepts every DNS message
+ *
+ * @param filter Pointer to the DnsFilter
+ */
+void dnsFilterInit(DnsFilter* filter);
+
+/**
+ * @brief Checks if filter contains any predicate
+ *
+ * @param filter Pointer to the DnsFilter
+ * @return true At least one predicate is set
+ * @return false Filter accepts everything
+ */
+bool dnsFilterIsActive(DnsFilter* filter);
+
+/**
+ * @brief Adds comma separated list of question types (names like A, AAAA,
+ * MX or numbers) into filter
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param list Comma separated list of types
+ * @return true All types were added
+ * @return false Unknown type or too many types
+ */
+bool dnsFilterAddQTypes(DnsFilter* filter, const char* list);
+
+/**
+ * @brief Adds comma separated list of domain suffixes into filter
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param list Comma separated list of domain names
+ * @return true All zones were added
+ * @return false Invalid domain name or too many zones
+ */
+bool dnsFilterAddZones(DnsFilter* filter, const char* list);
+
+/**
+ * @brief Appends DNS predicates to program compiled from base filter, every
+ * accepting return of base program is redirected to appended code
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param fp Compiled base program, bf_insns is replaced by new array
+ * @param linkType Datalink type of the capture (DLT_*)
+ * @return true Program was extended
+ * @return false Program can not be extended (unsupported datalink or base
+ * program), predicates are checked only in user space
+ */
+bool dnsFilterAttach(DnsFilter* filter, struct bpf_program* fp, int linkType);
+
+/**
+ * @brief Checks if DNS message matches filter
+ *
+ * @param filter Pointer to the DnsFilter
+ * @param dns Start of DNS message
+ * @param len Length of DNS message
+ * @return true Message matches or filter is not active
+ * @return false Message does not match
+ */
+bool dnsFilterMatch(DnsFilter* filter, const unsigned char* dns, size_t len);
+
+#endif /*DNS_FILTER_H*/
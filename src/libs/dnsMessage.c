@@ -0,0 +1,631 @@
+/**
+ * @file dnsMessage.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of parse stage of DNS message
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "dnsMessage.h"
+#include "rrRegistry.h"
+#include "nameNormalize.h"
+
+/**
+ * @brief Checks that name starting at offset lies inside of message and
+ * keeps label (63) and name (255) length limits, compression pointers are
+ * followed up to DNS_NAME_MAX_HOPS times, so their loops end the check
+ *
+ * @param data Start of DNS message
+ * @param length Length of DNS message
+ * @param offset Offset of name in message
+ * @param nameLen Pointer where length of name at offset is stored (up to and
+ * including first compression pointer)
+ * @return DissectError DISSECT_OK or DISSECT_BAD_NAME
+ */
+DissectError dnsNameCheck(const unsigned char* data, size_t length, size_t offset,
+                        size_t* nameLen)
+{
+    size_t start = offset;
+    bool jumped = false;
+    unsigned hops = 0;
+    size_t wireLen = 1;             // root label
+
+    while(true)
+    {
+        if(offset >= length)
+            return DISSECT_BAD_NAME;
+
+        unsigned char lengthOctet = data[offset];
+        if(lengthOctet == 0)
+        {
+            if(!jumped)
+                *nameLen = offset + 1 - start;
+            return DISSECT_OK;
+        }
+
+        if((lengthOctet & 0xc0) == 0xc0)
+        {
+            if(offset + 1 >= length || ++hops > DNS_NAME_MAX_HOPS)
+                return DISSECT_BAD_NAME;
+
+            if(!jumped)
+                *nameLen = offset + 2 - start;
+            jumped = true;
+
+            offset = DNS_READ16(data + offset) & 0x3fff;
+            continue;
+        }
+
+        // reserved label types 01 and 10 are rejected too
+        wireLen += 1 + lengthOctet;
+        if(lengthOctet > DNS_LABEL_MAX_LEN || wireLen > DNS_NAME_MAX_LEN)
+            return DISSECT_BAD_NAME;
+
+        offset += 1 + lengthOctet;
+    }
+}
+
+/**
+ * @brief Reads resource record at offset
+ *
+ * @param message Pointer to the DnsMessage
+ * @param offset Pointer to the offset of record, moved after record
+ * @param record Pointer where record is stored
+ * @param checkRdata RDATA is checked by check of its type in registry
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError dnsRecordParse(DnsMessage* message, size_t* offset, DnsRecord* record,
+                            bool checkRdata)
+{
+    const unsigned char* data = message->data;
+    size_t length = message->length;
+    size_t ptr = *offset;
+    size_t nameLen = 0;
+
+    if(dnsNameCheck(data, length, ptr, &nameLen) != DISSECT_OK)
+        return DISSECT_BAD_NAME;
+    record->nameOffset = ptr;
+    ptr += nameLen;
+
+    // type, class, ttl and rdatalength
+    if(ptr + 10 > length)
+        return DISSECT_SHORT_RECORD;
+
+    record->type = DNS_READ16(data + ptr);
+    record->rrClass = DNS_READ16(data + ptr + 2);
+    record->ttl = DNS_READ32(data + ptr + 4);
+    record->rdataLength = DNS_READ16(data + ptr + 8);
+    record->rdataOffset = ptr + 10;
+
+    size_t rdata = record->rdataOffset;
+    size_t rdataEnd = rdata + record->rdataLength;
+    if(rdataEnd > length)
+        return DISSECT_SHORT_RECORD;
+
+    // addresses are read even from shorter RDATA, only message end matters
+    if((record->type == RRType_A && rdata + 4 > length) ||
+        (record->type == RRType_AAAA && rdata + 16 > length))
+        return DISSECT_SHORT_RECORD;
+
+    if(checkRdata)
+    {
+        RRDataCheck check = rrTypeFind(record->type)->check;
+        if(check != NULL)
+        {
+            DissectError error = check(message, record);
+            if(error != DISSECT_OK)
+                return error;
+        }
+    }
+
+    *offset = rdataEnd;
+    return DISSECT_OK;
+}
+
+/**
+ * @brief Returns section of record with given index
+ *
+ * @param message Pointer to the DnsMessage
+ * @param index Index of record in message
+ * @return DnsSection Section of record
+ */
+DnsSection dnsRecordSection(const DnsMessage* message, unsigned index)
+{
+    if(index < message->answers)
+        return DNS_SECTION_ANSWER;
+    if(index < (unsigned) message->answers + message->authorities)
+        return DNS_SECTION_AUTHORITY;
+    return DNS_SECTION_ADDITIONAL;
+}
+
+/**
+ * @brief Checks message as far as needs require and fills first window of
+ * records, after successful parse every name and field of needed parts can
+ * be read without further checks. Checking stops after last needed part:
+ * with DNS_NEED_HEADER alone malformed question and records are not
+ * detected, without DNS_NEED_RECORDS and DNS_NEED_EDNS malformed records are
+ * not detected and with DNS_NEED_EDNS but without DNS_NEED_RECORDS records
+ * after first OPT record are not checked
+ *
+ * @param message Pointer to the DnsMessage that is filled
+ * @param data Start of DNS message
+ * @param length Length of DNS message
+ * @param needs DNS_NEED_* flags of parts that are used afterwards, with
+ * DNS_NEED_RDATA RDATA of types known by registry (names, fixed fields) is
+ * checked too, only then it can be decoded, without DNS_NEED_RECORDS records
+ * are not stored
+ * @param cache Name cache that is emptied and used by message, can be NULL
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError dnsMessageParse(DnsMessage* message, const unsigned char* data,
+                            size_t length, unsigned needs, DnsNameCache* cache)
+{
+    if(length < DNS_HEADER_LEN)
+        return DISSECT_SHORT_HEADER;
+
+    // TCP length prefix and IP datagram can not carry longer message
+    if(length > DNS_MESSAGE_MAX_LEN)
+        return DISSECT_SHORT_RECORD;
+
+    message->data = data;
+    message->length = length;
+    message->needs = needs;
+
+    // without decoded names cache would be only emptied
+    message->cache = (needs & DNS_NEED_NAMES)? cache : NULL;
+    if(message->cache != NULL)
+        dnsNameCacheReset(cache);
+    message->id = DNS_READ16(data);
+    message->flags = DNS_READ16(data + 2);
+    message->questions = DNS_READ16(data + 4);
+    message->answers = DNS_READ16(data + 6);
+    message->authorities = DNS_READ16(data + 8);
+    message->additionals = DNS_READ16(data + 10);
+
+    message->recordCount = (unsigned) message->answers + message->authorities +
+                            message->additionals;
+    message->first = 0;
+    message->stored = 0;
+    message->hasQuestion = false;
+    message->edns.present = false;
+
+    bool keep = needs & DNS_NEED_RECORDS;
+    bool checkRdata = needs & DNS_NEED_RDATA;
+    bool edns = needs & DNS_NEED_EDNS;
+
+    // header line uses only counters, malformed rest of message is not detected
+    if(!(needs & DNS_NEED_QUESTION) && !keep && !edns)
+        return DISSECT_OK;
+
+    size_t ptr = DNS_HEADER_LEN;
+    size_t nameLen = 0;
+
+    // rest of questions is read as records, same as dissector always did
+    if(message->questions > 0)
+    {
+        if(dnsNameCheck(data, length, ptr, &nameLen) != DISSECT_OK)
+            return DISSECT_BAD_NAME;
+        message->questionOffset = ptr;
+        ptr += nameLen;
+
+        if(ptr + 4 > length)
+            return DISSECT_SHORT_RECORD;
+
+        message->questionType = DNS_READ16(data + ptr);
+        message->questionClass = DNS_READ16(data + ptr + 2);
+        message->hasQuestion = true;
+        ptr += 4;
+    }
+
+    // malformed records are not detected when nobody walks them
+    if(!keep && !edns)
+        return DISSECT_OK;
+
+    DnsRecord skipped;
+    for(unsigned i = 0; i < message->recordCount; i++)
+    {
+        bool store = keep && i < DNS_MESSAGE_MAX_RECORDS;
+        DnsRecord* record = store? &(message->records[i]) : &skipped;
+
+        DissectError error = dnsRecordParse(message, &ptr, record, checkRdata);
+        if(error != DISSECT_OK)
+            return error;
+
+        if(edns && record->type == RRType_OPT && !message->edns.present)
+        {
+            dnsEdnsParse(message, record, &(message->edns));
+
+            // records after OPT record are not checked, when they are not stored
+            if(!keep)
+                return DISSECT_OK;
+        }
+
+        if(store)
+        {
+            record->section = dnsRecordSection(message, i);
+            message->stored++;
+            message->next = ptr;
+        }
+    }
+
+    return DISSECT_OK;
+}
+
+/**
+ * @brief Reads EDNS0 information of OPT record, options are read only while
+ * they fit into RDATA
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record OPT record
+ * @param edns Pointer where information is stored
+ */
+void dnsEdnsParse(const DnsMessage* message, const DnsRecord* record, DnsEdns* edns)
+{
+    memset(edns, 0, sizeof(DnsEdns));
+    edns->present = true;
+    edns->udpSize = record->rrClass;
+    edns->extRcode = record->ttl >> 24;
+    edns->version = (record->ttl >> 16) & 0xff;
+    edns->dnssecOk = (record->ttl >> 15) & 1;
+
+    const unsigned char* data = message->data;
+    size_t ptr = record->rdataOffset;
+    size_t end = ptr + record->rdataLength;
+
+    // option code, option length and value
+    while(ptr + 4 <= end && ptr + 4 + DNS_READ16(data + ptr + 2) <= end)
+    {
+        unsigned code = DNS_READ16(data + ptr);
+        unsigned len = DNS_READ16(data + ptr + 2);
+        const unsigned char* value = data + ptr + 4;
+
+        // family, source and scope prefix, then address cut to source prefix
+        if(code == EDNS_OPTION_ECS && len >= 4 && !edns->hasEcs)
+        {
+            edns->hasEcs = true;
+            edns->ecsFamily = DNS_READ16(value);
+            edns->ecsSource = value[2];
+            edns->ecsScope = value[3];
+
+            size_t bytes = len - 4;
+            if(bytes > sizeof(edns->ecsAddress))
+                bytes = sizeof(edns->ecsAddress);
+            memcpy(edns->ecsAddress, value + 4, bytes);
+        }
+        else if(code == EDNS_OPTION_COOKIE && len >= 8 && len <= EDNS_COOKIE_MAX_LEN &&
+                edns->cookieLength == 0)
+        {
+            edns->cookieLength = len;
+            memcpy(edns->cookie, value, len);
+        }
+
+        ptr += 4 + len;
+    }
+}
+
+/**
+ * @brief Replaces records with next window of records of message
+ *
+ * @param message Pointer to the DnsMessage parsed by dnsMessageParse()
+ * @return true Next records were stored
+ * @return false All records of message were already stored
+ */
+bool dnsMessageNextRecords(DnsMessage* message)
+{
+    unsigned index = message->first + message->stored;
+    if(index >= message->recordCount || !(message->needs & DNS_NEED_RECORDS))
+        return false;
+
+    message->first = index;
+    message->stored = 0;
+
+    // whole message was checked by dnsMessageParse()
+    while(index < message->recordCount && message->stored < DNS_MESSAGE_MAX_RECORDS)
+    {
+        DnsRecord* record = &(message->records[message->stored]);
+        dnsRecordParse(message, &(message->next), record, false);
+        record->section = dnsRecordSection(message, index);
+
+        message->stored++;
+        index++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Allocates empty name cache
+ *
+ * @return DnsNameCache* Allocated cache, on error program is exited
+ */
+DnsNameCache* dnsNameCacheCreate()
+{
+    DnsNameCache* cache = (DnsNameCache*) malloc(sizeof(DnsNameCache));
+    if(cache == NULL)
+        errHandling("Failed to allocate memory for DNS name cache", ERR_MALLOC);
+
+    memset(cache, 0, sizeof(DnsNameCache));
+    bufferInit(&(cache->arena));
+    bufferInit(&(cache->folded));
+
+    return cache;
+}
+
+/**
+ * @brief Frees name cache
+ *
+ * @param cache Pointer to the DnsNameCache, can be NULL
+ */
+void dnsNameCacheDestroy(DnsNameCache* cache)
+{
+    if(cache == NULL)
+        return;
+
+    bufferDestroy(&(cache->arena));
+    bufferDestroy(&(cache->folded));
+    free(cache);
+}
+
+/**
+ * @brief Invalidates all entries of cache, called for every new message
+ *
+ * @param cache Pointer to the DnsNameCache
+ */
+void dnsNameCacheReset(DnsNameCache* cache)
+{
+    cache->generation++;
+    cache->entries = 0;
+    bufferSetUsed(&(cache->arena), 0);
+    bufferSetUsed(&(cache->folded), 0);
+
+    // generation 0 marks slots that were never used
+    if(cache->generation == 0)
+    {
+        memset(cache->slots, 0, sizeof(cache->slots));
+        cache->generation = 1;
+    }
+}
+
+/**
+ * @brief Finds decoded suffix starting at offset
+ *
+ * @param cache Pointer to the DnsNameCache
+ * @param offset Offset of label or compression pointer in message
+ * @param found Pointer where found entry is copied
+ * @return true Suffix was already decoded
+ * @return false Suffix is not in cache
+ */
+bool dnsNameCacheFind(const DnsNameCache* cache, size_t offset, DnsNameEntry* found)
+{
+    // table is never more than half full, so probing ends on free slot
+    unsigned slot = offset & (DNS_NAME_CACHE_SIZE - 1);
+    while(cache->slots[slot].generation == cache->generation)
+    {
+        if(cache->slots[slot].offset == offset)
+        {
+            *found = cache->slots[slot];
+            return true;
+        }
+        slot = (slot + 1) & (DNS_NAME_CACHE_SIZE - 1);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Stores decoded suffix, nothing is stored when table is half full
+ *
+ * @param cache Pointer to the DnsNameCache
+ * @param offset Offset of label or compression pointer in message
+ * @param position Start of decoded suffix in arena
+ * @param length Length of decoded suffix
+ * @param flags NAME_* flags of folded suffix
+ */
+void dnsNameCacheInsert(DnsNameCache* cache, size_t offset, size_t position, size_t length,
+                        unsigned flags)
+{
+    if(cache->entries >= DNS_NAME_CACHE_SIZE / 2)
+        return;
+
+    unsigned slot = offset & (DNS_NAME_CACHE_SIZE - 1);
+    while(cache->slots[slot].generation == cache->generation)
+    {
+        if(cache->slots[slot].offset == offset)
+            return;
+        slot = (slot + 1) & (DNS_NAME_CACHE_SIZE - 1);
+    }
+
+    DnsNameEntry* entry = &(cache->slots[slot]);
+    entry->generation = cache->generation;
+    entry->offset = offset;
+    entry->length = length;
+    entry->position = position;
+    entry->flags = flags;
+    cache->entries++;
+}
+
+/**
+ * @brief Decodes name into arena of message cache, decoding stops at first
+ * compression pointer whose target is cached, every label and pointer that
+ * was walked is stored as start of its own suffix. With DNS_NEED_FOLDED
+ * every new label is also folded and classified, flags of suffix are flags
+ * of its labels combined (label is the unit of all NAME_* checks)
+ *
+ * @param message Pointer to the parsed DnsMessage with cache
+ * @param offset Offset of name in message
+ * @return DnsNameEntry Decoded name in arena
+ */
+DnsNameEntry dnsNameCacheFill(const DnsMessage* message, size_t offset)
+{
+    DnsNameCache* cache = message->cache;
+    Buffer* arena = &(cache->arena);
+    Buffer* folded = &(cache->folded);
+    const unsigned char* data = message->data;
+    bool fold = message->needs & DNS_NEED_FOLDED;
+
+    size_t offsets[DNS_NAME_CACHE_LABELS];
+    size_t positions[DNS_NAME_CACHE_LABELS];
+    unsigned flags[DNS_NAME_CACHE_LABELS];
+    unsigned count = 0;
+
+    // flags of labels that did not fit into table and of cached suffix
+    unsigned tailFlags = 0;
+
+    DnsNameEntry name = {cache->generation, offset, 0, arena->used, 0};
+    DnsNameEntry suffix;
+
+    while(data[offset] != 0)
+    {
+        unsigned* labelFlags = &tailFlags;
+        if(count < DNS_NAME_CACHE_LABELS)
+        {
+            offsets[count] = offset;
+            positions[count] = arena->used;
+            flags[count] = 0;
+            labelFlags = &(flags[count]);
+            count++;
+        }
+
+        if(data[offset] & 0xc0)
+        {
+            offset = DNS_READ16(data + offset) & 0x3fff;
+            if(!dnsNameCacheFind(cache, offset, &suffix))
+                continue;
+
+            // resize can move arena, so source is taken after it
+            size_t used = arena->used;
+            bufferResize(arena, used + suffix.length);
+            memcpy(&(arena->data[used]), &(arena->data[suffix.position]), suffix.length);
+            bufferSetUsed(arena, used + suffix.length);
+
+            if(fold)
+            {
+                bufferResize(folded, used + suffix.length);
+                memcpy(&(folded->data[used]), &(folded->data[suffix.position]), suffix.length);
+                bufferSetUsed(folded, used + suffix.length);
+                tailFlags |= suffix.flags;
+            }
+            break;
+        }
+
+        size_t start = arena->used;
+        bufferAddBytes(arena, (const char*) &(data[offset + 1]), data[offset]);
+        bufferAddBytes(arena, ".", 1);
+
+        if(fold)
+        {
+            bufferAddBytes(folded, &(arena->data[start]), arena->used - start);
+            *labelFlags = nameNormalize(&(folded->data[start]), arena->used - start);
+        }
+
+        offset += 1 + data[offset];
+    }
+
+    // suffix of every walked label contains all labels after it
+    for(unsigned i = count; i > 0; i--)
+    {
+        tailFlags |= flags[i - 1];
+        flags[i - 1] = tailFlags;
+    }
+
+    for(unsigned i = 0; i < count; i++)
+        dnsNameCacheInsert(cache, offsets[i], positions[i], arena->used - positions[i], flags[i]);
+
+    name.length = arena->used - name.position;
+    name.flags = tailFlags;
+    return name;
+}
+
+/**
+ * @brief Appends name to the buffer, every label is followed by dot, name
+ * must be checked by dnsMessageParse(), with message cache suffixes that
+ * were already decoded are copied instead of being decoded again
+ *
+ * @param message Pointer to the parsed DnsMessage
+ * @param offset Offset of name in message
+ * @param buffer Buffer where name is appended
+ */
+void dnsNameDecode(const DnsMessage* message, size_t offset, Buffer* buffer)
+{
+    const unsigned char* data = message->data;
+    DnsNameCache* cache = message->cache;
+
+    if(cache != NULL)
+    {
+        DnsNameEntry name;
+        if(!dnsNameCacheFind(cache, offset, &name))
+            name = dnsNameCacheFill(message, offset);
+
+        if(name.length > 0)
+            bufferAddBytes(buffer, &(cache->arena.data[name.position]), name.length);
+        return;
+    }
+
+    while(data[offset] != 0)
+    {
+        if(data[offset] & 0xc0)
+        {
+            offset = DNS_READ16(data + offset) & 0x3fff;
+            continue;
+        }
+
+        bufferAddBytes(buffer, (const char*) &(data[offset + 1]), data[offset]);
+        bufferAddBytes(buffer, ".", 1);
+
+        offset += 1 + data[offset];
+    }
+}
+
+/**
+ * @brief Appends name folded to lower case to the buffer, same as
+ * nameNormalize() applied to dnsNameDecode(), with message parsed with
+ * DNS_NEED_FOLDED cached suffixes are folded and classified only once
+ *
+ * @param message Pointer to the parsed DnsMessage
+ * @param offset Offset of name in message
+ * @param buffer Buffer where name is appended
+ * @return unsigned NAME_* flags of name
+ */
+unsigned dnsNameDecodeFolded(const DnsMessage* message, size_t offset, Buffer* buffer)
+{
+    DnsNameCache* cache = message->cache;
+
+    if(cache != NULL && (message->needs & DNS_NEED_FOLDED))
+    {
+        DnsNameEntry name;
+        if(!dnsNameCacheFind(cache, offset, &name))
+            name = dnsNameCacheFill(message, offset);
+
+        if(name.length > 0)
+            bufferAddBytes(buffer, &(cache->folded.data[name.position]), name.length);
+        return name.flags;
+    }
+
+    size_t start = buffer->used;
+    dnsNameDecode(message, offset, buffer);
+    return nameNormalize(&(buffer->data[start]), buffer->used - start);
+}
+
+/**
+ * @brief Returns offset of first byte after name stored at offset (up to
+ * first compression pointer), name must be checked by dnsMessageParse()
+ *
+ * @param message Pointer to the parsed DnsMessage
+ * @param offset Offset of name in message
+ * @return size_t Offset after name
+ */
+size_t dnsNameEnd(const DnsMessage* message, size_t offset)
+{
+    const unsigned char* data = message->data;
+
+    while(data[offset] != 0)
+    {
+        if(data[offset] & 0xc0)
+            return offset + 2;
+
+        offset += 1 + data[offset];
+    }
+
+    return offset + 1;
+}
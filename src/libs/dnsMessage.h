@@ -0,0 +1,298 @@
+/**
+ * @file dnsMessage.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Parse stage of DNS message. Message is checked and its header,
+ * question and resource records are stored into fixed size DnsMessage as
+ * offsets into packet, nothing is copied. Names are decoded only when some
+ * consumer (printer, domain lists) asks for them, decoded suffixes are kept
+ * in per-message cache, so suffix shared by compression pointers is expanded
+ * only once.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef DNS_MESSAGE_H
+#define DNS_MESSAGE_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "stdint.h"
+#include "arpa/inet.h"
+
+#include "utils.h"
+#include "buffer.h"
+#include "dissectErrors.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define DNS_PORT 53
+#define DNS_HEADER_LEN 12
+#define DNS_MESSAGE_MAX_RECORDS 256     // records parsed at once
+#define DNS_MESSAGE_MAX_LEN 65535       // offsets are stored in 16 bits
+#define DNS_NAME_MAX_LEN 255            // wire format, including root label
+#define DNS_LABEL_MAX_LEN 63
+#define DNS_NAME_MAX_HOPS 16            // compression pointers of one name
+#define DNS_NAME_CACHE_SIZE 1024        // slots of name cache, power of two
+#define DNS_NAME_CACHE_LABELS 128       // cached suffixes of one decoded name
+
+// numbers in network byte order, read byte by byte (unaligned access)
+#define DNS_READ16(data) ((uint16_t) (((data)[0] << 8) | (data)[1]))
+#define DNS_READ32(data) (((uint32_t) DNS_READ16(data) << 16) | DNS_READ16((data) + 2))
+
+#define RRType_A 0x0001
+#define RRType_AAAA 0x001c
+#define RRType_NS 0x0002
+#define RRType_MX 0x000f
+#define RRType_SOA 0x0006
+#define RRType_CNAME 0x0005
+#define RRType_SRV 0x0021
+#define RRType_PTR 0x000c
+#define RRType_TXT 0x0010
+#define RRType_OPT 0x0029
+#define RRType_DS 0x002b
+#define RRType_RRSIG 0x002e
+#define RRType_DNSKEY 0x0030
+#define RRType_SVCB 0x0040
+#define RRType_HTTPS 0x0041
+#define RRType_ANY 0x00ff
+#define RRType_CAA 0x0101
+#define RRType_UNKNOWN 0x0000
+
+#define RRClass_IN 0x0001
+#define RRClass_UNKNOWN 0x0000
+
+// parts of message needed by consumers (output, lists, statistics), message
+// is checked only up to last needed part, parts that are not needed are not
+// stored
+#define DNS_NEED_HEADER 0x01            // counters and flags of header
+#define DNS_NEED_QUESTION 0x02          // first question is walked
+#define DNS_NEED_RECORDS 0x04           // records are stored and walked
+#define DNS_NEED_RDATA 0x08             // RDATA of all known types is checked
+#define DNS_NEED_NAMES 0x10             // names are decoded (name cache is used)
+#define DNS_NEED_EDNS 0x20              // first OPT record is parsed
+#define DNS_NEED_FOLDED 0x40            // names are also folded to lower case
+#define DNS_NEED_ALL 0x7f
+
+#define EDNS_OPTION_ECS 8               // client subnet (RFC 7871)
+#define EDNS_OPTION_COOKIE 10           // RFC 7873
+#define EDNS_COOKIE_MAX_LEN 40          // client (8) and server (8 - 32) cookie
+#define EDNS_ECS_FAMILY_IPV4 1
+#define EDNS_ECS_FAMILY_IPV6 2
+
+/**
+ * @brief Section of resource record
+ */
+typedef enum DnsSection {
+    DNS_SECTION_ANSWER,
+    DNS_SECTION_AUTHORITY,
+    DNS_SECTION_ADDITIONAL,
+} DnsSection;
+
+/**
+ * @brief One resource record, all offsets are from start of message
+ */
+typedef struct DnsRecord {
+    uint16_t nameOffset;            // owner name
+    uint16_t type;
+    uint16_t rrClass;
+    uint16_t rdataLength;
+    uint32_t ttl;
+    uint16_t rdataOffset;           // first byte after RDLENGTH
+    uint8_t section;                // DnsSection
+} DnsRecord;
+
+/**
+ * @brief EDNS0 information of first OPT record of message
+ */
+typedef struct DnsEdns {
+    bool present;
+    uint16_t udpSize;               // advertised UDP payload size (CLASS)
+    uint8_t extRcode;               // upper 8 bits of 12 bit RCODE
+    uint8_t version;
+    bool dnssecOk;                  // DO bit
+
+    bool hasEcs;
+    uint16_t ecsFamily;             // EDNS_ECS_FAMILY_*
+    uint8_t ecsSource;              // source prefix length
+    uint8_t ecsScope;               // scope prefix length
+    uint8_t ecsAddress[16];         // bytes that were not sent are zero
+
+    uint8_t cookieLength;           // 0 = no cookie
+    uint8_t cookie[EDNS_COOKIE_MAX_LEN];
+} DnsEdns;
+
+/**
+ * @brief Decoded suffix of name, starting at offset in message
+ */
+typedef struct DnsNameEntry {
+    uint32_t generation;            // entry is valid only for this generation
+    uint16_t offset;                // label or pointer in message
+    uint16_t length;                // decoded length, including dots
+    uint32_t position;              // start of decoded suffix in arena
+    uint8_t flags;                  // NAME_* flags of folded suffix
+} DnsNameEntry;
+
+/**
+ * @brief Table of decoded name suffixes of one message, table is emptied by
+ * increasing generation instead of clearing every slot
+ */
+typedef struct DnsNameCache {
+    uint32_t generation;
+    unsigned entries;               // entries of current generation
+    DnsNameEntry slots[DNS_NAME_CACHE_SIZE];
+    Buffer arena;                   // decoded suffixes
+    Buffer folded;                  // same suffixes folded to lower case, only
+                                    // with DNS_NEED_FOLDED, positions match arena
+} DnsNameCache;
+
+/**
+ * @brief Parsed DNS message, messages with more records than fit into 
+ * records are walked in windows by dnsMessageNextRecords()
+ */
+typedef struct DnsMessage {
+    const unsigned char* data;
+    size_t length;
+    DnsNameCache* cache;            // can be NULL, names are then not cached
+    unsigned needs;                 // DNS_NEED_* flags message was parsed with
+
+    uint16_t id;
+    uint16_t flags;
+    uint16_t questions;
+    uint16_t answers;
+    uint16_t authorities;
+    uint16_t additionals;
+
+    // only first question is read
+    bool hasQuestion;
+    uint16_t questionOffset;        // name of first question
+    uint16_t questionType;
+    uint16_t questionClass;
+
+    DnsEdns edns;
+
+    unsigned recordCount;           // answers + authorities + additionals
+    unsigned first;                 // index of records[0] in message
+    unsigned stored;                // valid entries of records
+    size_t next;                    // offset of record first + stored
+    DnsRecord records[DNS_MESSAGE_MAX_RECORDS];
+} DnsMessage;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Checks message as far as needs require and fills first window of
+ * records, after successful parse every name and field of needed parts can
+ * be read without further checks. Checking stops after last needed part:
+ * with DNS_NEED_HEADER alone malformed question and records are not
+ * detected, without DNS_NEED_RECORDS and DNS_NEED_EDNS malformed records are
+ * not detected and with DNS_NEED_EDNS but without DNS_NEED_RECORDS records
+ * after first OPT record are not checked
+ *
+ * @param message Pointer to the DnsMessage that is filled
+ * @param data Start of DNS message
+ * @param length Length of DNS message
+ * @param needs DNS_NEED_* flags of parts that are used afterwards, with
+ * DNS_NEED_RDATA RDATA of types known by registry (names, fixed fields) is 
+ * checked too, only then it can be decoded, without DNS_NEED_RECORDS records
+ * are not stored
+ * @param cache Name cache that is emptied and used by message, can be NULL
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError dnsMessageParse(DnsMessage* message, const unsigned char* data, 
+                            size_t length, unsigned needs, DnsNameCache* cache);
+
+/**
+ * @brief Reads EDNS0 information of OPT record, options are read only while
+ * they fit into RDATA
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record OPT record
+ * @param edns Pointer where information is stored
+ */
+void dnsEdnsParse(const DnsMessage* message, const DnsRecord* record, DnsEdns* edns);
+
+/**
+ * @brief Replaces records with next window of records of message
+ *
+ * @param message Pointer to the DnsMessage parsed by dnsMessageParse()
+ * @return true Next records were stored
+ * @return false All records of message were already stored
+ */
+bool dnsMessageNextRecords(DnsMessage* message);
+
+/**
+ * @brief Checks that name starting at offset lies inside of message and
+ * keeps label (63) and name (255) length limits, compression pointers are
+ * followed up to DNS_NAME_MAX_HOPS times, so their loops end the check
+ *
+ * @param data Start of DNS message
+ * @param length Length of DNS message
+ * @param offset Offset of name in message
+ * @param nameLen Pointer where length of name at offset is stored (up to and
+ * including first compression pointer)
+ * @return DissectError DISSECT_OK or DISSECT_BAD_NAME
+ */
+DissectError dnsNameCheck(const unsigned char* data, size_t length, size_t offset, 
+                        size_t* nameLen);
+
+/**
+ * @brief Allocates empty name cache
+ *
+ * @return DnsNameCache* Allocated cache, on error program is exited
+ */
+DnsNameCache* dnsNameCacheCreate();
+
+/**
+ * @brief Frees name cache
+ *
+ * @param cache Pointer to the DnsNameCache, can be NULL
+ */
+void dnsNameCacheDestroy(DnsNameCache* cache);
+
+/**
+ * @brief Invalidates all entries of cache, called for every new message
+ *
+ * @param cache Pointer to the DnsNameCache
+ */
+void dnsNameCacheReset(DnsNameCache* cache);
+
+/**
+ * @brief Appends name to the buffer, every label is followed by dot, name
+ * must be checked by dnsMessageParse(), with message cache suffixes that
+ * were already decoded are copied instead of being decoded again
+ *
+ * @param message Pointer to the parsed DnsMessage
+ * @param offset Offset of name in message
+ * @param buffer Buffer where name is appended
+ */
+void dnsNameDecode(const DnsMessage* message, size_t offset, Buffer* buffer);
+
+/**
+ * @brief Appends name folded to lower case to the buffer, same as
+ * nameNormalize() applied to dnsNameDecode(), with message parsed with
+ * DNS_NEED_FOLDED cached suffixes are folded and classified only once
+ *
+ * @param message Pointer to the parsed DnsMessage
+ * @param offset Offset of name in message
+ * @param buffer Buffer where name is appended
+ * @return unsigned NAME_* flags of name
+ */
+unsigned dnsNameDecodeFolded(const DnsMessage* message, size_t offset, Buffer* buffer);
+
+/**
+ * @brief Returns offset of first byte after name stored at offset (up to
+ * first compression pointer), name must be checked by dnsMessageParse()
+ *
+ * @param message Pointer to the parsed DnsMessage
+ * @param offset Offset of name in message
+ * @return size_t Offset after name
+ */
+size_t dnsNameEnd(const DnsMessage* message, size_t offset);
+
+#endif /*DNS_MESSAGE_H*/
@@ -0,0 +1,174 @@
+/**
+ * @file ednsStats.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of aggregated EDNS0 statistics
+ *
+ * Source: RFC 6891, RFC 7871, RFC 7873
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "ednsStats.h"
+
+#define FLAG_QR 0x8000
+#define FLAG_TC 0x0200
+
+/**
+ * @brief Upper bounds (inclusive) of buckets of UDP payload size, common
+ * sizes have bucket of their own
+ */
+static const unsigned ednsSizeBounds[EDNS_SIZE_BUCKETS] = {
+    511, 512, 1023, 1231, 1232, 1399, 1400, 1451, 1452, 1471, 1472, 2047, 4095, 4096,
+    65535,
+};
+
+/**
+ * @brief Returns bucket of UDP payload size
+ *
+ * @param size Advertised UDP payload size
+ * @return unsigned Index of bucket
+ */
+unsigned ednsSizeBucket(unsigned size)
+{
+    unsigned bucket = 0;
+    while(size > ednsSizeBounds[bucket])
+        bucket++;
+
+    return bucket;
+}
+
+/**
+ * @brief Counts parsed message
+ *
+ * @param stats Pointer to the EdnsStats
+ * @param message Message parsed by dnsMessageParse()
+ */
+void ednsStatsCount(EdnsStats* stats, const DnsMessage* message)
+{
+    const DnsEdns* edns = &(message->edns);
+    EdnsDirection direction = (message->flags & FLAG_QR)? EDNS_RESPONSE : EDNS_QUERY;
+    bool truncated = direction == EDNS_RESPONSE && (message->flags & FLAG_TC);
+
+    stats->messages[direction]++;
+    if(truncated)
+        stats->truncated++;
+
+    if(!edns->present)
+        return;
+
+    unsigned bucket = ednsSizeBucket(edns->udpSize);
+    stats->edns[direction]++;
+    stats->sizes[direction][bucket]++;
+    if(truncated)
+    {
+        stats->truncatedEdns++;
+        stats->truncatedSizes[bucket]++;
+    }
+
+    if(edns->dnssecOk)
+        stats->dnssecOk[direction]++;
+    if(edns->cookieLength > 0)
+        stats->cookies[direction]++;
+
+    if(!edns->hasEcs)
+        return;
+
+    // query carries source prefix, response scope prefix that answer is valid for
+    stats->ecs[direction]++;
+    unsigned prefix = (direction == EDNS_QUERY)? edns->ecsSource : edns->ecsScope;
+    if(edns->ecsFamily == EDNS_ECS_FAMILY_IPV4 && prefix < EDNS_ECS_IPV4_PREFIXES)
+        stats->ecsIPv4[direction][prefix]++;
+    else if(edns->ecsFamily == EDNS_ECS_FAMILY_IPV6 && prefix < EDNS_ECS_IPV6_PREFIXES)
+        stats->ecsIPv6[direction][prefix]++;
+}
+
+/**
+ * @brief Adds counters of one capture loop (worker) to another
+ *
+ * @param total Pointer to the EdnsStats where counters are added
+ * @param stats Pointer to the added EdnsStats
+ */
+void ednsStatsAdd(EdnsStats* total, const EdnsStats* stats)
+{
+    // structure holds only unsigned long counters
+    unsigned long* dst = (unsigned long*) total;
+    const unsigned long* src = (const unsigned long*) stats;
+
+    for(size_t i = 0; i < sizeof(EdnsStats) / sizeof(unsigned long); i++)
+        dst[i] += src[i];
+}
+
+/**
+ * @brief Prints rows of client subnet prefixes of one family
+ *
+ * @param family Name of address family
+ * @param queries Counters of source prefixes of queries
+ * @param responses Counters of scope prefixes of responses
+ * @param count Number of prefix lengths
+ */
+void ednsPrefixesReport(const char* family, const unsigned long* queries,
+                        const unsigned long* responses, unsigned count)
+{
+    for(unsigned i = 0; i < count; i++)
+    {
+        if(queries[i] == 0 && responses[i] == 0)
+            continue;
+
+        fprintf(stderr, "  %-4s /%-11u %12lu %12lu\n", family, i, queries[i], responses[i]);
+    }
+}
+
+/**
+ * @brief Prints counters, histogram of UDP payload sizes and histogram of
+ * client subnet prefixes onto stderr
+ *
+ * @param stats Pointer to the EdnsStats
+ */
+void ednsStatsReport(const EdnsStats* stats)
+{
+    fprintf(stderr, "EDNS statistics:\n");
+    for(unsigned d = 0; d < EDNS_DIRECTIONS; d++)
+    {
+        fprintf(stderr, "  %-9s %lu, with OPT %lu, DO %lu, cookie %lu, client subnet %lu\n",
+            (d == EDNS_QUERY)? "queries" : "responses", stats->messages[d], stats->edns[d],
+            stats->dnssecOk[d], stats->cookies[d], stats->ecs[d]);
+    }
+    fprintf(stderr, "  truncated responses %lu, with OPT %lu\n", stats->truncated,
+        stats->truncatedEdns);
+
+    fprintf(stderr, "  %-16s %12s %12s %12s\n", "UDP size", "queries", "responses",
+        "truncated");
+    fprintf(stderr, "  %-16s %12lu %12lu %12lu\n", "no OPT",
+        stats->messages[EDNS_QUERY] - stats->edns[EDNS_QUERY],
+        stats->messages[EDNS_RESPONSE] - stats->edns[EDNS_RESPONSE],
+        stats->truncated - stats->truncatedEdns);
+
+    for(unsigned i = 0; i < EDNS_SIZE_BUCKETS; i++)
+    {
+        if(stats->sizes[EDNS_QUERY][i] == 0 && stats->sizes[EDNS_RESPONSE][i] == 0)
+            continue;
+
+        char range[16];
+        unsigned low = (i == 0)? 0 : ednsSizeBounds[i - 1] + 1;
+        if(low == ednsSizeBounds[i])
+            snprintf(range, sizeof(range), "%u", low);
+        else
+            snprintf(range, sizeof(range), "%u-%u", low, ednsSizeBounds[i]);
+
+        fprintf(stderr, "  %-16s %12lu %12lu %12lu\n", range, stats->sizes[EDNS_QUERY][i],
+            stats->sizes[EDNS_RESPONSE][i], stats->truncatedSizes[i]);
+    }
+
+    if(stats->ecs[EDNS_QUERY] == 0 && stats->ecs[EDNS_RESPONSE] == 0)
+        return;
+
+    fprintf(stderr, "  %-16s %12s %12s\n", "client subnet", "source", "scope");
+    ednsPrefixesReport("IPv4", stats->ecsIPv4[EDNS_QUERY], stats->ecsIPv4[EDNS_RESPONSE],
+        EDNS_ECS_IPV4_PREFIXES);
+    ednsPrefixesReport("IPv6", stats->ecsIPv6[EDNS_QUERY], stats->ecsIPv6[EDNS_RESPONSE],
+        EDNS_ECS_IPV6_PREFIXES);
+}
+
+#undef FLAG_QR
+#undef FLAG_TC
@@ -0,0 +1,90 @@
+/**
+ * @file ednsStats.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Aggregated EDNS0 statistics used for tuning of resolver buffer
+ * sizes. Advertised UDP payload sizes of queries and responses are counted
+ * in histogram together with truncated responses, client subnet prefixes
+ * are counted per address family (source prefix of queries, scope prefix of
+ * responses).
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef EDNS_STATS_H
+#define EDNS_STATS_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "stdio.h"
+
+#include "utils.h"
+#include "dnsMessage.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define EDNS_SIZE_BUCKETS 15            // see ednsSizeBounds in ednsStats.c
+#define EDNS_ECS_IPV4_PREFIXES 33       // prefix lengths 0 - 32
+#define EDNS_ECS_IPV6_PREFIXES 129      // prefix lengths 0 - 128
+
+/**
+ * @brief Direction of message, index of per direction counters
+ */
+typedef enum EdnsDirection {
+    EDNS_QUERY,
+    EDNS_RESPONSE,
+    EDNS_DIRECTIONS,
+} EdnsDirection;
+
+/**
+ * @brief Counters of DNS messages and their EDNS0 information
+ */
+typedef struct EdnsStats {
+    unsigned long messages[EDNS_DIRECTIONS];
+    unsigned long edns[EDNS_DIRECTIONS];            // with OPT record
+    unsigned long dnssecOk[EDNS_DIRECTIONS];
+    unsigned long cookies[EDNS_DIRECTIONS];
+    unsigned long ecs[EDNS_DIRECTIONS];
+
+    unsigned long truncated;                        // responses with TC bit
+    unsigned long truncatedEdns;                    // ... that carry OPT
+
+    unsigned long sizes[EDNS_DIRECTIONS][EDNS_SIZE_BUCKETS];
+    unsigned long truncatedSizes[EDNS_SIZE_BUCKETS];
+
+    unsigned long ecsIPv4[EDNS_DIRECTIONS][EDNS_ECS_IPV4_PREFIXES];
+    unsigned long ecsIPv6[EDNS_DIRECTIONS][EDNS_ECS_IPV6_PREFIXES];
+} EdnsStats;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Counts parsed message
+ *
+ * @param stats Pointer to the EdnsStats
+ * @param message Message parsed by dnsMessageParse()
+ */
+void ednsStatsCount(EdnsStats* stats, const DnsMessage* message);
+
+/**
+ * @brief Adds counters of one capture loop (worker) to another
+ *
+ * @param total Pointer to the EdnsStats where counters are added
+ * @param stats Pointer to the added EdnsStats
+ */
+void ednsStatsAdd(EdnsStats* total, const EdnsStats* stats);
+
+/**
+ * @brief Prints counters, histogram of UDP payload sizes and histogram of
+ * client subnet prefixes onto stderr
+ *
+ * @param stats Pointer to the EdnsStats
+ */
+void ednsStatsReport(const EdnsStats* stats);
+
+#endif /*EDNS_STATS_H*/
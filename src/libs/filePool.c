@@ -0,0 +1,241 @@
+/**
+ * @file filePool.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of work-stealing distribution of capture files
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "filePool.h"
+#include "captureFile.h"
+
+#include "string.h"
+#include "sys/stat.h"
+
+/**
+ * @brief File with key by which it is sorted
+ */
+typedef struct FileOrder {
+    char* path;
+    struct timeval ts;
+    long long size;
+} FileOrder;
+
+/**
+ * @brief Compares files by timestamp of first packet, qsort() callback
+ *
+ * @param a Pointer to the first FileOrder
+ * @param b Pointer to the second FileOrder
+ * @return int Negative, zero or positive as in strcmp()
+ */
+int fileOrderCompareTime(const void* a, const void* b)
+{
+    const FileOrder* first = (const FileOrder*) a;
+    const FileOrder* second = (const FileOrder*) b;
+
+    if(timercmp(&(first->ts), &(second->ts), <))
+        return -1;
+    if(timercmp(&(first->ts), &(second->ts), >))
+        return 1;
+
+    return strcmp(first->path, second->path);
+}
+
+/**
+ * @brief Compares files by size from the biggest, qsort() callback
+ *
+ * @param a Pointer to the first FileOrder
+ * @param b Pointer to the second FileOrder
+ * @return int Negative, zero or positive as in strcmp()
+ */
+int fileOrderCompareSize(const void* a, const void* b)
+{
+    const FileOrder* first = (const FileOrder*) a;
+    const FileOrder* second = (const FileOrder*) b;
+
+    if(first->size != second->size)
+        return (first->size > second->size)? -1 : 1;
+
+    return strcmp(first->path, second->path);
+}
+
+/**
+ * @brief Reads timestamp of first packet of file, files that can not be
+ * mapped get zero timestamp so they are processed first
+ *
+ * @param path Path to the file
+ * @param ts Pointer where timestamp is stored
+ */
+void filePeekTime(const char* path, struct timeval* ts)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    struct pcap_pkthdr* header;
+    const unsigned char* data;
+
+    ts->tv_sec = 0;
+    ts->tv_usec = 0;
+
+    CaptureFile* file = captureFileOpen(path, errbuf);
+    if(file == NULL)
+        return;
+
+    if(captureFileNext(file, &header, &data) == 1)
+        *ts = header->ts;
+
+    captureFileClose(file);
+}
+
+/**
+ * @brief Sorts files in order in which they should be processed, either by
+ * timestamp of first packet (for time ordered output) or by size from the
+ * biggest (so big files do not end up last)
+ *
+ * @param files Array of file paths, sorted in place
+ * @param count Number of files
+ * @param byTime Sort by timestamp of first packet instead of size
+ * @param bounds If not NULL, filled with timestamp of first packet of every
+ * file in sorted order (zero if it could not be read)
+ */
+void filePoolSortFiles(char** files, unsigned count, bool byTime, struct timeval* bounds)
+{
+    FileOrder* order = (FileOrder*) calloc(count, sizeof(FileOrder));
+    if(order == NULL)
+        errHandling("Failed to allocate memory for file order", ERR_MALLOC);
+
+    for(unsigned i = 0; i < count; i++)
+    {
+        order[i].path = files[i];
+
+        if(byTime)
+        {
+            filePeekTime(files[i], &(order[i].ts));
+            continue;
+        }
+
+        struct stat info;
+        if(stat(files[i], &info) == 0)
+            order[i].size = info.st_size;
+    }
+
+    qsort(order, count, sizeof(FileOrder), byTime? fileOrderCompareTime : fileOrderCompareSize);
+
+    for(unsigned i = 0; i < count; i++)
+    {
+        files[i] = order[i].path;
+        if(bounds != NULL)
+            bounds[i] = order[i].ts;
+    }
+
+    free(order);
+}
+
+/**
+ * @brief Creates pool, files are dealt round robin so every worker starts
+ * with files from beginning of the order
+ *
+ * @param fileCount Number of files, indices 0 to fileCount - 1 are handed out
+ * @param workerCount Number of workers
+ * @return FilePool* Allocated pool
+ */
+FilePool* filePoolCreate(unsigned fileCount, unsigned workerCount)
+{
+    FilePool* pool = (FilePool*) malloc(sizeof(FilePool));
+    if(pool == NULL)
+        errHandling("Failed to allocate memory for FilePool", ERR_MALLOC);
+
+    pool->workerCount = workerCount;
+    pool->deques = (FileDeque*) calloc(workerCount, sizeof(FileDeque));
+    if(pool->deques == NULL)
+        errHandling("Failed to allocate memory for FilePool", ERR_MALLOC);
+
+    for(unsigned i = 0; i < workerCount; i++)
+    {
+        FileDeque* deque = &(pool->deques[i]);
+        pthread_mutex_init(&(deque->lock), NULL);
+
+        deque->files = (unsigned*) malloc(sizeof(unsigned) * (fileCount / workerCount + 1));
+        if(deque->files == NULL)
+            errHandling("Failed to allocate memory for FilePool", ERR_MALLOC);
+
+        for(unsigned file = i; file < fileCount; file += workerCount)
+            deque->files[deque->tail++] = file;
+    }
+
+    return pool;
+}
+
+/**
+ * @brief Destroys pool
+ *
+ * @param pool Pointer to the FilePool, can be NULL
+ */
+void filePoolDestroy(FilePool* pool)
+{
+    if(pool == NULL)
+        return;
+
+    for(unsigned i = 0; i < pool->workerCount; i++)
+    {
+        pthread_mutex_destroy(&(pool->deques[i].lock));
+        free(pool->deques[i].files);
+    }
+
+    free(pool->deques);
+    free(pool);
+}
+
+/**
+ * @brief Takes next file for worker, from its own deque or stolen from
+ * other worker
+ *
+ * @param pool Pointer to the FilePool
+ * @param workerId Index of the worker
+ * @param file Pointer where index of the file is stored
+ * @return true File was taken
+ * @return false All files were taken
+ */
+bool filePoolNext(FilePool* pool, unsigned workerId, unsigned* file)
+{
+    FileDeque* own = &(pool->deques[workerId]);
+
+    pthread_mutex_lock(&(own->lock));
+    bool found = own->head < own->tail;
+    if(found)
+        *file = own->files[own->head++];
+    pthread_mutex_unlock(&(own->lock));
+
+    // files are never added, so once every deque is seen empty pool is done
+    while(!found)
+    {
+        FileDeque* victim = NULL;
+        unsigned victimLoad = 0;
+
+        for(unsigned i = 1; i < pool->workerCount; i++)
+        {
+            FileDeque* deque = &(pool->deques[(workerId + i) % pool->workerCount]);
+
+            pthread_mutex_lock(&(deque->lock));
+            unsigned load = deque->tail - deque->head;
+            pthread_mutex_unlock(&(deque->lock));
+
+            if(load > victimLoad)
+            {
+                victim = deque;
+                victimLoad = load;
+            }
+        }
+
+        if(victim == NULL)
+            return false;
+
+        // victim could have been emptied since it was inspected
+        pthread_mutex_lock(&(victim->lock));
+        found = victim->head < victim->tail;
+        if(found)
+            *file = victim->files[--victim->tail];
+        pthread_mutex_unlock(&(victim->lock));
+    }
+
+    return true;
+}
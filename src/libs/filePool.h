@@ -0,0 +1,92 @@
+/**
+ * @file filePool.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Work-stealing distribution of capture files between workers. Every
+ * worker owns deque of file indices and takes files from its front, worker
+ * with empty deque steals from back of the most loaded deque, so few huge
+ * files do not leave other workers idle.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef FILE_POOL_H
+#define FILE_POOL_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pthread.h"
+#include "sys/time.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Files assigned to one worker
+ */
+typedef struct FileDeque {
+    pthread_mutex_t lock;
+    unsigned* files;
+    unsigned head;                  // next file taken by owner
+    unsigned tail;                  // one past last file, thieves take tail - 1
+} FileDeque;
+
+/**
+ * @brief Pool of files shared by all workers
+ */
+typedef struct FilePool {
+    FileDeque* deques;
+    unsigned workerCount;
+} FilePool;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Sorts files in order in which they should be processed, either by
+ * timestamp of first packet (for time ordered output) or by size from the
+ * biggest (so big files do not end up last)
+ *
+ * @param files Array of file paths, sorted in place
+ * @param count Number of files
+ * @param byTime Sort by timestamp of first packet instead of size
+ * @param bounds If not NULL, filled with timestamp of first packet of every
+ * file in sorted order (zero if it could not be read)
+ */
+void filePoolSortFiles(char** files, unsigned count, bool byTime, struct timeval* bounds);
+
+/**
+ * @brief Creates pool, files are dealt round robin so every worker starts
+ * with files from beginning of the order
+ *
+ * @param fileCount Number of files, indices 0 to fileCount - 1 are handed out
+ * @param workerCount Number of workers
+ * @return FilePool* Allocated pool
+ */
+FilePool* filePoolCreate(unsigned fileCount, unsigned workerCount);
+
+/**
+ * @brief Destroys pool
+ *
+ * @param pool Pointer to the FilePool, can be NULL
+ */
+void filePoolDestroy(FilePool* pool);
+
+/**
+ * @brief Takes next file for worker, from its own deque or stolen from
+ * other worker
+ *
+ * @param pool Pointer to the FilePool
+ * @param workerId Index of the worker
+ * @param file Pointer where index of the file is stored
+ * @return true File was taken
+ * @return false All files were taken
+ */
+bool filePoolNext(FilePool* pool, unsigned workerId, unsigned* file);
+
+#endif /*FILE_POOL_H*/
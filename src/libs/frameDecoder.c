@@ -0,0 +1,275 @@
+/**
+ * @file frameDecoder.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of link and network layer decoding
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "frameDecoder.h"
+
+#include "string.h"
+#include "sys/socket.h"
+#include "arpa/inet.h"
+#include "netinet/ip.h"
+#include "netinet/ip6.h"
+
+#define READ_SHORT(ptr) ((unsigned short) (((ptr)[0] << 8) | (ptr)[1]))
+
+DecodeResult decodeIPv4(const unsigned char* packet, size_t length, size_t offset,
+                        DecodedFrame* frame);
+DecodeResult decodeIPv6(const unsigned char* packet, size_t length, size_t offset,
+                        DecodedFrame* frame);
+
+/**
+ * @brief Supported datalink types
+ */
+static const LinkLayer linkLayers[] = {
+    {DLT_EN10MB,        14, 12,                     true},
+    {DLT_LINUX_SLL,     16, 14,                     true},
+#ifdef DLT_LINUX_SLL2 // libpcap 1.10 and newer
+    {DLT_LINUX_SLL2,    20, 0,                      true},
+#endif
+    {DLT_RAW,           0,  LINK_TYPE_OFFSET_NONE,  false},
+    {DLT_IPV4,          0,  LINK_TYPE_OFFSET_NONE,  false},
+    {DLT_IPV6,          0,  LINK_TYPE_OFFSET_NONE,  false},
+    // address family in 4 bytes of host (NULL) or network (LOOP) order
+    {DLT_NULL,          4,  LINK_TYPE_OFFSET_NONE,  false},
+    {DLT_LOOP,          4,  LINK_TYPE_OFFSET_NONE,  false},
+};
+
+/**
+ * @brief Supported network protocols
+ */
+static const struct {
+    unsigned short etherType;
+    NetworkDecoder decode;
+} networkLayers[] = {
+    {ETH_TYPE_IPV4, decodeIPv4},
+    {ETH_TYPE_IPV6, decodeIPv6},
+};
+
+/**
+ * @brief Finds description of datalink type
+ *
+ * @param linkType Datalink type (DLT_*)
+ * @return const LinkLayer* Description of link layer, NULL if datalink is not
+ * supported
+ */
+const LinkLayer* linkLayerFind(int linkType)
+{
+    for(unsigned i = 0; i < sizeof(linkLayers) / sizeof(linkLayers[0]); i++)
+    {
+        if(linkLayers[i].linkType == linkType)
+            return &(linkLayers[i]);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Checks if EtherType belongs to 802.1Q or 802.1ad tag
+ *
+ * @param etherType EtherType
+ * @return true EtherType is followed by VLAN tag
+ * @return false EtherType is not VLAN tag
+ */
+bool isVlanType(unsigned short etherType)
+{
+    return etherType == ETH_TYPE_VLAN || etherType == ETH_TYPE_QINQ ||
+        etherType == ETH_TYPE_QINQ_OLD;
+}
+
+/**
+ * @brief Decodes IPv4 header including options
+ *
+ * @param packet Raw frame data
+ * @param length Captured length of the frame
+ * @param offset Offset of network header
+ * @param frame Pointer where decoded information is stored
+ * @return DecodeResult Result of decoding
+ */
+DecodeResult decodeIPv4(const unsigned char* packet, size_t length, size_t offset,
+                        DecodedFrame* frame)
+{
+    struct iphdr* ipv4 = (struct iphdr*) (packet + offset);
+    if(length < offset + sizeof(struct iphdr) || ipv4->ihl * 4 < sizeof(struct iphdr) ||
+        length < offset + ipv4->ihl * 4)
+        return DECODE_SHORT;
+
+    frame->family = AF_INET;
+    memcpy(frame->src, &(ipv4->saddr), 4);
+    memcpy(frame->dst, &(ipv4->daddr), 4);
+    frame->transport = ipv4->protocol;
+
+    // total length can be zero for segmentation offloaded packets
+    unsigned short totalLen = ntohs(ipv4->tot_len);
+    if(totalLen >= ipv4->ihl * 4)
+    {
+        frame->truncated = offset + totalLen > length;
+        if(!frame->truncated)
+            frame->payloadEnd = offset + totalLen;
+    }
+
+    unsigned short fragField = ntohs(ipv4->frag_off);
+    if(fragField & (IP_MF | IP_OFFMASK))
+    {
+        frame->fragment = true;
+        frame->moreFragments = fragField & IP_MF;
+        frame->fragOffset = (fragField & IP_OFFMASK) * 8;
+        frame->fragId = ntohs(ipv4->id);
+    }
+
+    frame->transportOffset = offset + ipv4->ihl * 4;
+
+    return DECODE_OK;
+}
+
+/**
+ * @brief Decodes IPv6 header and walks its extension header chain, chain
+ * of fragments other than the first one ends at fragment header
+ *
+ * @param packet Raw frame data
+ * @param length Captured length of the frame
+ * @param offset Offset of network header
+ * @param frame Pointer where decoded information is stored
+ * @return DecodeResult Result of decoding
+ */
+DecodeResult decodeIPv6(const unsigned char* packet, size_t length, size_t offset,
+                        DecodedFrame* frame)
+{
+    struct ip6_hdr* ipv6 = (struct ip6_hdr*) (packet + offset);
+    if(length < offset + sizeof(struct ip6_hdr))
+        return DECODE_SHORT;
+
+    frame->family = AF_INET6;
+    memcpy(frame->src, &(ipv6->ip6_src), 16);
+    memcpy(frame->dst, &(ipv6->ip6_dst), 16);
+    frame->transport = ipv6->ip6_nxt;
+    offset += sizeof(struct ip6_hdr);
+
+    // zero payload length is used by jumbograms
+    if(ntohs(ipv6->ip6_plen) > 0)
+    {
+        frame->truncated = offset + ntohs(ipv6->ip6_plen) > length;
+        if(!frame->truncated)
+            frame->payloadEnd = offset + ntohs(ipv6->ip6_plen);
+    }
+
+    for(unsigned i = 0; i < MAX_IPV6_EXT_HEADERS; i++)
+    {
+        size_t headerLen;
+        switch(frame->transport)
+        {
+            case IPPROTO_HOPOPTS:
+            case IPPROTO_ROUTING:
+            case IPPROTO_DSTOPTS:
+            case IPPROTO_MH:
+                if(length < offset + 2)
+                    return DECODE_SHORT;
+                headerLen = (packet[offset + 1] + 1) * 8;
+                break;
+            case IPPROTO_AH:
+                if(length < offset + 2)
+                    return DECODE_SHORT;
+                headerLen = (packet[offset + 1] + 2) * 4;
+                break;
+            case IPPROTO_FRAGMENT:;
+                struct ip6_frag* frag = (struct ip6_frag*) (packet + offset);
+                if(length < offset + sizeof(struct ip6_frag))
+                    return DECODE_SHORT;
+
+                frame->moreFragments = frag->ip6f_offlg & IP6F_MORE_FRAG;
+                frame->fragOffset = ntohs(frag->ip6f_offlg & IP6F_OFF_MASK);
+                frame->fragId = ntohl(frag->ip6f_ident);
+                // atomic fragment (RFC 6946) is processed as whole packet
+                frame->fragment = frame->moreFragments || frame->fragOffset > 0;
+                headerLen = sizeof(struct ip6_frag);
+                break;
+            default:
+                frame->transportOffset = offset;
+                return DECODE_OK;
+        }
+
+        if(length < offset + headerLen)
+            return DECODE_SHORT;
+
+        frame->transport = packet[offset];
+        offset += headerLen;
+
+        // headers after fragment header are part of fragmented payload
+        if(frame->fragment)
+            break;
+    }
+
+    frame->transportOffset = offset;
+
+    return DECODE_OK;
+}
+
+/**
+ * @brief Decodes link and network layer headers of frame
+ *
+ * @param linkType Datalink type of the capture (DLT_*)
+ * @param packet Raw frame data
+ * @param length Captured length of the frame
+ * @param frame Pointer where decoded information is stored
+ * @return DecodeResult Result of decoding
+ */
+DecodeResult frameDecode(int linkType, const unsigned char* packet, size_t length,
+                        DecodedFrame* frame)
+{
+    memset(frame, 0, sizeof(DecodedFrame));
+
+    const LinkLayer* link = linkLayerFind(linkType);
+    if(link == NULL)
+        return DECODE_UNSUPPORTED;
+
+    size_t offset = link->headerLen;
+    if(length < offset + 1)
+        return DECODE_SHORT;
+
+    if(link->typeOffset != LINK_TYPE_OFFSET_NONE)
+    {
+        frame->etherType = READ_SHORT(packet + link->typeOffset);
+
+        for(unsigned i = 0; i < MAX_VLAN_TAGS && link->vlanTags && isVlanType(frame->etherType); i++)
+        {
+            // tag control information followed by EtherType of inner frame
+            if(length < offset + 4)
+                return DECODE_SHORT;
+
+            frame->etherType = READ_SHORT(packet + offset + 2);
+            offset += 4;
+        }
+    }
+    else
+    {
+        switch(packet[offset] >> 4)
+        {
+            case 4: frame->etherType = ETH_TYPE_IPV4; break;
+            case 6: frame->etherType = ETH_TYPE_IPV6; break;
+            default: return DECODE_UNSUPPORTED;
+        }
+    }
+
+    frame->network = packet + offset;
+    frame->payloadEnd = length;
+
+    for(unsigned i = 0; i < sizeof(networkLayers) / sizeof(networkLayers[0]); i++)
+    {
+        if(networkLayers[i].etherType != frame->etherType)
+            continue;
+
+        DecodeResult result = networkLayers[i].decode(packet, length, offset, frame);
+        if(result == DECODE_OK && frame->payloadEnd < frame->transportOffset)
+            return DECODE_SHORT;
+
+        return result;
+    }
+
+    return DECODE_UNSUPPORTED;
+}
+
+#undef READ_SHORT
@@ -0,0 +1,119 @@
+/**
+ * @file frameDecoder.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Table driven decoding of link and network layer headers. Link
+ * layer is selected by datalink type of the capture (Ethernet with 802.1Q
+ * and QinQ tags, Linux cooked SLL and SLL2 used by "any" device, raw IP and
+ * BSD loopback), network layer by EtherType (IPv4 with options, IPv6 with
+ * extension header chain). Result is offset and length of transport
+ * segment, so later stages do not have to know how packet was captured.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pcap/pcap.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define ETH_TYPE_IPV6 0x86DD
+#define ETH_TYPE_IPV4 0x0800
+#define ETH_TYPE_VLAN 0x8100
+#define ETH_TYPE_QINQ 0x88A8
+#define ETH_TYPE_QINQ_OLD 0x9100
+
+#define MAX_VLAN_TAGS 4             // stacked 802.1Q/802.1ad tags
+#define MAX_IPV6_EXT_HEADERS 8      // extension headers walked before giving up
+
+// link layer carries no EtherType, network protocol is read from IP version
+#define LINK_TYPE_OFFSET_NONE -1
+
+/**
+ * @brief Result of frameDecode()
+ */
+typedef enum DecodeResult {
+    DECODE_OK,
+    DECODE_SHORT,           // packet ends inside of a header
+    DECODE_UNSUPPORTED,     // link or network protocol is not supported
+} DecodeResult;
+
+/**
+ * @brief Link and network layer information of one frame
+ */
+typedef struct DecodedFrame {
+    unsigned short etherType;       // ETH_TYPE_IPV4 or ETH_TYPE_IPV6
+    const unsigned char* network;   // start of IP header
+
+    unsigned char family;           // AF_INET or AF_INET6
+    unsigned char src[16];          // IPv4 addresses use first 4 bytes
+    unsigned char dst[16];
+
+    unsigned char transport;        // protocol after all extension headers
+    size_t transportOffset;         // start of transport header in frame
+    size_t payloadEnd;              // end of IP payload, padding is excluded
+    bool truncated;                 // IP payload was cut by snapshot length
+
+    bool fragment;
+    bool moreFragments;
+    size_t fragOffset;              // in bytes
+    unsigned fragId;
+} DecodedFrame;
+
+/**
+ * @brief Decodes network header of frame
+ *
+ * @param packet Raw frame data
+ * @param length Captured length of the frame
+ * @param offset Offset of network header
+ * @param frame Pointer where decoded information is stored
+ * @return DecodeResult Result of decoding
+ */
+typedef DecodeResult (*NetworkDecoder)(const unsigned char* packet, size_t length,
+                                        size_t offset, DecodedFrame* frame);
+
+/**
+ * @brief Supported datalink type
+ */
+typedef struct LinkLayer {
+    int linkType;                   // DLT_*
+    unsigned headerLen;             // fixed length of link header
+    int typeOffset;                 // offset of EtherType or LINK_TYPE_OFFSET_NONE
+    bool vlanTags;                  // tagged frames can be captured
+} LinkLayer;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Finds description of datalink type
+ *
+ * @param linkType Datalink type (DLT_*)
+ * @return const LinkLayer* Description of link layer, NULL if datalink is not
+ * supported
+ */
+const LinkLayer* linkLayerFind(int linkType);
+
+/**
+ * @brief Decodes link and network layer headers of frame
+ *
+ * @param linkType Datalink type of the capture (DLT_*)
+ * @param packet Raw frame data
+ * @param length Captured length of the frame
+ * @param frame Pointer where decoded information is stored
+ * @return DecodeResult Result of decoding
+ */
+DecodeResult frameDecode(int linkType, const unsigned char* packet, size_t length,
+                        DecodedFrame* frame);
+
+#endif /*FRAME_DECODER_H*/
@@ -0,0 +1,361 @@
+/**
+ * @file ipReassembly.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of IPv4 and IPv6 fragment reassembly
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "ipReassembly.h"
+
+#include "string.h"
+#include "sys/socket.h"
+
+#define MIN_DATAGRAM_BUFFER 2048
+
+/**
+ * @brief Allocates empty fragment table
+ *
+ * @return IpFragTable* Pointer to the table
+ */
+IpFragTable* ipFragTableCreate()
+{
+    IpFragTable* table = (IpFragTable*) malloc(sizeof(IpFragTable));
+    if(table == NULL)
+        errHandling("Failed to allocate memory for IP fragment table", ERR_MALLOC);
+
+    memset(table, 0, sizeof(IpFragTable));
+
+    return table;
+}
+
+/**
+ * @brief Computes hash of datagram key (FNV-1a)
+ *
+ * @param key Pointer to the key
+ * @return unsigned Index of bucket
+ */
+unsigned ipFragHash(const IpFragKey* key)
+{
+    unsigned hash = 2166136261u;
+
+    for(unsigned i = 0; i < 16; i++)
+        hash = (hash ^ key->src[i]) * 16777619u;
+    for(unsigned i = 0; i < 16; i++)
+        hash = (hash ^ key->dst[i]) * 16777619u;
+
+    hash = (hash ^ key->id) * 16777619u;
+    hash = (hash ^ key->protocol) * 16777619u;
+    hash = (hash ^ key->family) * 16777619u;
+
+    return hash & (IP_FRAG_BUCKETS - 1);
+}
+
+/**
+ * @brief Compares two datagram keys
+ *
+ * @param first First key
+ * @param second Second key
+ * @return true Keys identify same datagram
+ * @return false Keys are different
+ */
+bool ipFragKeyEqual(const IpFragKey* first, const IpFragKey* second)
+{
+    return first->id == second->id &&
+        first->protocol == second->protocol &&
+        first->family == second->family &&
+        memcmp(first->src, second->src, 16) == 0 &&
+        memcmp(first->dst, second->dst, 16) == 0;
+}
+
+/**
+ * @brief Removes datagram from table and frees it
+ *
+ * @param table Pointer to the table
+ * @param datagram Pointer to the datagram
+ */
+void ipFragRemove(IpFragTable* table, IpFragDatagram* datagram)
+{
+    IpFragDatagram** link = &(table->buckets[ipFragHash(&(datagram->key))]);
+    while(*link != datagram)
+        link = &((*link)->hashNext);
+
+    *link = datagram->hashNext;
+
+    if(datagram->lruPrev != NULL)
+        datagram->lruPrev->lruNext = datagram->lruNext;
+    else
+        table->lruHead = datagram->lruNext;
+
+    if(datagram->lruNext != NULL)
+        datagram->lruNext->lruPrev = datagram->lruPrev;
+    else
+        table->lruTail = datagram->lruPrev;
+
+    table->memoryUsed -= datagram->allocated;
+    table->datagramCount--;
+
+    free(datagram->data);
+    free(datagram);
+}
+
+/**
+ * @brief Evicts datagrams that were not completed in IP_FRAG_TIMEOUT
+ *
+ * @param table Pointer to the table
+ * @param now Current time in seconds
+ */
+void ipFragExpire(IpFragTable* table, time_t now)
+{
+    while(table->lruTail != NULL && table->lruTail->created + IP_FRAG_TIMEOUT < now)
+    {
+        ipFragRemove(table, table->lruTail);
+        table->evicted++;
+    }
+}
+
+/**
+ * @brief Finds datagram in table
+ *
+ * @param table Pointer to the table
+ * @param key Key of the datagram
+ * @return IpFragDatagram* Found datagram or NULL
+ */
+IpFragDatagram* ipFragFind(IpFragTable* table, const IpFragKey* key)
+{
+    IpFragDatagram* datagram = table->buckets[ipFragHash(key)];
+    while(datagram != NULL && !ipFragKeyEqual(&(datagram->key), key))
+        datagram = datagram->hashNext;
+
+    return datagram;
+}
+
+/**
+ * @brief Creates new datagram, oldest datagram is evicted when table is full
+ *
+ * @param table Pointer to the table
+ * @param key Key of the datagram
+ * @param now Current time in seconds
+ * @return IpFragDatagram* Created datagram
+ */
+IpFragDatagram* ipFragCreate(IpFragTable* table, const IpFragKey* key, time_t now)
+{
+    if(table->datagramCount >= IP_FRAG_MAX_DATAGRAMS)
+    {
+        ipFragRemove(table, table->lruTail);
+        table->evicted++;
+    }
+
+    IpFragDatagram* datagram = (IpFragDatagram*) malloc(sizeof(IpFragDatagram));
+    if(datagram == NULL)
+        errHandling("Failed to allocate memory for IP datagram", ERR_MALLOC);
+
+    memset(datagram, 0, sizeof(IpFragDatagram));
+    datagram->key = *key;
+    datagram->created = now;
+
+    unsigned hash = ipFragHash(key);
+    datagram->hashNext = table->buckets[hash];
+    table->buckets[hash] = datagram;
+    table->datagramCount++;
+
+    datagram->lruNext = table->lruHead;
+    if(table->lruHead != NULL)
+        table->lruHead->lruPrev = datagram;
+    table->lruHead = datagram;
+
+    if(table->lruTail == NULL)
+        table->lruTail = datagram;
+
+    return datagram;
+}
+
+/**
+ * @brief Makes sure datagram buffer can hold given number of bytes, other
+ * datagrams are evicted (oldest first) when memory limit would be exceeded
+ *
+ * @param table Pointer to the table
+ * @param datagram Pointer to the datagram
+ * @param needed Required size of buffer
+ * @return true Buffer is large enough
+ * @return false Memory limit was reached
+ */
+bool ipFragReserve(IpFragTable* table, IpFragDatagram* datagram, size_t needed)
+{
+    if(needed <= datagram->allocated)
+        return true;
+
+    size_t newSize = (datagram->allocated > 0)? datagram->allocated : MIN_DATAGRAM_BUFFER;
+    while(newSize < needed)
+        newSize *= 2;
+
+    size_t grow = newSize - datagram->allocated;
+    while(table->memoryUsed + grow > IP_FRAG_MAX_MEMORY && table->lruTail != datagram)
+    {
+        ipFragRemove(table, table->lruTail);
+        table->evicted++;
+    }
+
+    if(table->memoryUsed + grow > IP_FRAG_MAX_MEMORY)
+        return false;
+
+    unsigned char* tmp = (unsigned char*) realloc(datagram->data, newSize);
+    if(tmp == NULL)
+        errHandling("Failed to reallocate memory for IP datagram", ERR_MALLOC);
+
+    datagram->data = tmp;
+    datagram->allocated = newSize;
+    table->memoryUsed += grow;
+
+    return true;
+}
+
+/**
+ * @brief Checks if 8 byte block of datagram was already received
+ *
+ * @param datagram Pointer to the datagram
+ * @param block Index of the block
+ * @return true Block was received
+ * @return false Block is missing
+ */
+bool ipFragHasBlock(IpFragDatagram* datagram, unsigned block)
+{
+    return datagram->received[block / 8] & (1 << (block % 8));
+}
+
+/**
+ * @brief Adds fragment to its datagram and calls handler when datagram is
+ * complete
+ *
+ * @param table Pointer to the table
+ * @param key Datagram of the fragment
+ * @param offset Offset of fragment data in bytes
+ * @param more More fragments flag
+ * @param data Fragment data
+ * @param length Length of fragment data
+ * @param now Timestamp of the fragment in seconds
+ * @param handler Function called with reassembled payload
+ * @param user User data passed to the handler
+ */
+void ipFragAdd(IpFragTable* table, const IpFragKey* key, size_t offset, bool more,
+                const unsigned char* data, size_t length, time_t now,
+                IpDatagramHandler handler, void* user)
+{
+    ipFragExpire(table, now);
+
+    size_t end = offset + length;
+
+    // every fragment but the last one carries multiple of 8 bytes
+    if(end > IP_FRAG_MAX_LEN || (more && (length == 0 || length % IP_FRAG_BLOCK != 0)))
+        return;
+
+    IpFragDatagram* datagram = ipFragFind(table, key);
+    if(datagram == NULL)
+        datagram = ipFragCreate(table, key, now);
+
+    unsigned first = offset / IP_FRAG_BLOCK;
+    unsigned last = (end + IP_FRAG_BLOCK - 1) / IP_FRAG_BLOCK;
+
+    // last fragment must agree with already received ones
+    if(!more)
+    {
+        bool inconsistent = datagram->totalLen != 0 && datagram->totalLen != end;
+        for(unsigned i = last; i < IP_FRAG_BLOCKS && !inconsistent; i++)
+            inconsistent = ipFragHasBlock(datagram, i);
+
+        if(inconsistent)
+        {
+            ipFragRemove(table, datagram);
+            return;
+        }
+
+        datagram->totalLen = end;
+    }
+    else if(datagram->totalLen != 0 && end > datagram->totalLen)
+    {
+        ipFragRemove(table, datagram);
+        return;
+    }
+
+    if(datagram->key.family == AF_INET6)
+    {
+        unsigned present = 0;
+        for(unsigned i = first; i < last; i++)
+            present += ipFragHasBlock(datagram, i);
+
+        // exact duplicates are ignored, other overlaps discard datagram
+        if(present > 0 && (present != last - first ||
+            memcmp(datagram->data + offset, data, length) != 0))
+        {
+            table->overlaps++;
+            ipFragRemove(table, datagram);
+            return;
+        }
+    }
+
+    if(!ipFragReserve(table, datagram, end))
+    {
+        ipFragRemove(table, datagram);
+        table->evicted++;
+        return;
+    }
+
+    // IPv4 overlaps keep bytes that arrived first
+    for(unsigned i = first; i < last; i++)
+    {
+        if(ipFragHasBlock(datagram, i))
+        {
+            table->overlaps++;
+            continue;
+        }
+
+        size_t blockStart = (size_t) i * IP_FRAG_BLOCK;
+        size_t blockLen = (end - blockStart < IP_FRAG_BLOCK)? end - blockStart : IP_FRAG_BLOCK;
+
+        memcpy(datagram->data + blockStart, data + (blockStart - offset), blockLen);
+        datagram->received[i / 8] |= 1 << (i % 8);
+        datagram->receivedBlocks++;
+    }
+
+    if(datagram->totalLen == 0 ||
+        datagram->receivedBlocks != (datagram->totalLen + IP_FRAG_BLOCK - 1) / IP_FRAG_BLOCK)
+        return;
+
+    handler(datagram->data, datagram->totalLen, user);
+    ipFragRemove(table, datagram);
+}
+
+/**
+ * @brief Checks if no datagram is being reassembled at time now, datagrams
+ * older than IP_FRAG_TIMEOUT are evicted first (same as next fragment would do)
+ *
+ * @param table Pointer to the table
+ * @param now Current time in seconds
+ * @return true Table holds no datagram
+ * @return false Some datagram is still incomplete
+ */
+bool ipFragTableIdle(IpFragTable* table, time_t now)
+{
+    ipFragExpire(table, now);
+
+    return table->datagramCount == 0;
+}
+
+/**
+ * @brief Frees all datagrams and table itself
+ *
+ * @param table Pointer to the table, can be NULL
+ */
+void ipFragTableDestroy(IpFragTable* table)
+{
+    if(table == NULL)
+        return;
+
+    while(table->lruTail != NULL)
+        ipFragRemove(table, table->lruTail);
+
+    free(table);
+}
+
+#undef MIN_DATAGRAM_BUFFER
@@ -0,0 +1,142 @@
+/**
+ * @file ipReassembly.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Reassembly of fragmented IPv4 and IPv6 datagrams (mostly large
+ * EDNS0 responses over UDP). Fragments are kept in bounded hash table keyed
+ * by (source, destination, identification, protocol), received parts are
+ * tracked in 8 byte blocks. Overlapping IPv4 fragments keep bytes that
+ * arrived first, overlapping IPv6 fragments discard whole datagram (RFC
+ * 5722). Incomplete datagrams are evicted after timeout or when table runs
+ * out of slots or memory.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef IP_REASSEMBLY_H
+#define IP_REASSEMBLY_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "time.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define IP_FRAG_BUCKETS 256                 // power of two
+#define IP_FRAG_MAX_DATAGRAMS 1024
+#define IP_FRAG_MAX_MEMORY (16 * 1024 * 1024)   // bytes buffered by all datagrams
+#define IP_FRAG_TIMEOUT 30                  // seconds since first fragment
+#define IP_FRAG_MAX_LEN 0xffff              // payload of reassembled datagram
+#define IP_FRAG_BLOCK 8                     // fragment offset unit
+#define IP_FRAG_BLOCKS ((IP_FRAG_MAX_LEN + IP_FRAG_BLOCK) / IP_FRAG_BLOCK)
+
+/**
+ * @brief Identification of fragmented datagram, IPv4 addresses are stored in
+ * first 4 bytes
+ */
+typedef struct IpFragKey {
+    unsigned char src[16];
+    unsigned char dst[16];
+    unsigned id;
+    unsigned char protocol;
+    unsigned char family;
+} IpFragKey;
+
+/**
+ * @brief Datagram that is being reassembled
+ */
+typedef struct IpFragDatagram {
+    IpFragKey key;
+
+    unsigned char* data;
+    size_t allocated;
+    // length of payload, known after last fragment arrives, zero before
+    size_t totalLen;
+
+    unsigned char received[IP_FRAG_BLOCKS / 8 + 1];  // bitmap of 8 byte blocks
+    unsigned receivedBlocks;
+
+    time_t created;
+
+    struct IpFragDatagram* hashNext;
+    struct IpFragDatagram* lruPrev;     // created later
+    struct IpFragDatagram* lruNext;     // created earlier
+} IpFragDatagram;
+
+/**
+ * @brief Hash table of datagrams, datagrams are also kept in list ordered by
+ * time of first fragment so oldest can be evicted first
+ */
+typedef struct IpFragTable {
+    IpFragDatagram* buckets[IP_FRAG_BUCKETS];
+    IpFragDatagram* lruHead;
+    IpFragDatagram* lruTail;
+
+    unsigned datagramCount;
+    size_t memoryUsed;
+    unsigned long long evicted;
+    unsigned long long overlaps;
+} IpFragTable;
+
+/**
+ * @brief Function called for every reassembled datagram
+ *
+ * @param payload Payload of the datagram (starts at transport header)
+ * @param length Length of the payload
+ * @param user User data given to ipFragAdd()
+ */
+typedef void (*IpDatagramHandler)(const unsigned char* payload, size_t length, void* user);
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Allocates empty fragment table
+ *
+ * @return IpFragTable* Pointer to the table
+ */
+IpFragTable* ipFragTableCreate();
+
+/**
+ * @brief Frees all datagrams and table itself
+ *
+ * @param table Pointer to the table, can be NULL
+ */
+void ipFragTableDestroy(IpFragTable* table);
+
+/**
+ * @brief Adds fragment to its datagram and calls handler when datagram is
+ * complete
+ *
+ * @param table Pointer to the table
+ * @param key Datagram of the fragment
+ * @param offset Offset of fragment data in bytes
+ * @param more More fragments flag
+ * @param data Fragment data
+ * @param length Length of fragment data
+ * @param now Timestamp of the fragment in seconds
+ * @param handler Function called with reassembled payload
+ * @param user User data passed to the handler
+ */
+void ipFragAdd(IpFragTable* table, const IpFragKey* key, size_t offset, bool more,
+                const unsigned char* data, size_t length, time_t now,
+                IpDatagramHandler handler, void* user);
+
+/**
+ * @brief Checks if no datagram is being reassembled at time now, datagrams
+ * older than IP_FRAG_TIMEOUT are evicted first (same as next fragment would do)
+ *
+ * @param table Pointer to the table
+ * @param now Current time in seconds
+ * @return true Table holds no datagram
+ * @return false Some datagram is still incomplete
+ */
+bool ipFragTableIdle(IpFragTable* table, time_t now);
+
+#endif /*IP_REASSEMBLY_H*/
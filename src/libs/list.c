@@ -74,7 +74,7 @@ void listClear(BufferList* list)
 
     list->first = NULL;
     list->last = NULL;
-    list->last = 0;
+    list->len = 0;
 }
 
 
@@ -211,7 +211,7 @@ void listPrintContents(BufferList* list)
     for(unsigned i = 1; elem != NULL; i++)
     {
         printf("%u.", i);
-        bufferPrint(elem->data, 0);
+        bufferPrint(elem->data, 0, stdout);
         printf("\n");
 
         elem = elem->next;
@@ -0,0 +1,281 @@
+/**
+ * @file nameNormalize.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of normalization of decoded domain names
+ *
+ * Source: RFC 952, RFC 1123 (LDH rule), RFC 4343 (case insensitivity)
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "nameNormalize.h"
+
+#include "stdio.h"
+#include "string.h"
+
+#ifdef __AVX2__
+#include "immintrin.h"
+#elif defined(__SSE2__)
+#include "emmintrin.h"
+#endif
+
+/**
+ * @brief Checks if some label of name starts or ends with hyphen
+ *
+ * @param name Decoded name, labels are separated by dots
+ * @param len Length of name
+ * @return true Hyphen is on edge of label
+ * @return false All hyphens are inside of labels
+ */
+bool nameHyphenEdges(const char* name, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        if(name[i] != '-')
+            continue;
+
+        if(i == 0 || name[i - 1] == '.' || i + 1 == len || name[i + 1] == '.')
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Folds and classifies bytes one by one
+ *
+ * @param name Part of decoded name
+ * @param len Length of part
+ * @param hyphen Pointer that is set when part contains hyphen
+ * @return unsigned NAME_* flags of part (without hyphen placement)
+ */
+unsigned nameClassifyScalar(char* name, size_t len, bool* hyphen)
+{
+    unsigned flags = 0;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        unsigned char c = name[i];
+
+        if(c >= 'A' && c <= 'Z')
+        {
+            c += 'a' - 'A';
+            name[i] = c;
+            flags |= NAME_FOLDED;
+        }
+
+        if(c == '-')
+            *hyphen = true;
+        else if(!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.'))
+            flags |= NAME_NON_LDH;
+
+        if(c < 0x21 || c > 0x7e)
+            flags |= NAME_SUSPICIOUS;
+    }
+
+    return flags;
+}
+
+/**
+ * @brief Scalar version of nameNormalize(), used when SIMD is not available
+ *
+ * @param name Decoded name, labels are separated by dots
+ * @param len Length of name
+ * @return unsigned NAME_* flags of name
+ */
+unsigned nameNormalizeScalar(char* name, size_t len)
+{
+    bool hyphen = false;
+    unsigned flags = nameClassifyScalar(name, len, &hyphen);
+
+    if(hyphen && nameHyphenEdges(name, len))
+        flags |= NAME_NON_LDH;
+
+    return flags;
+}
+
+#ifdef __AVX2__
+
+// bytes of v that are in range [low, low + count), unsigned saturating
+// subtraction is zero only for them
+#define SIMD_IN_RANGE(v, low, count) _mm256_cmpeq_epi8(_mm256_subs_epu8(              \
+    _mm256_sub_epi8((v), _mm256_set1_epi8(low)), _mm256_set1_epi8((count) - 1)),     \
+    _mm256_setzero_si256())
+
+#define SIMD_WIDTH 32
+
+/**
+ * @brief Folds and classifies 32 bytes at once
+ *
+ * @param name Part of decoded name, at least 32 bytes long
+ * @param hyphen Pointer that is set when part contains hyphen
+ * @return unsigned NAME_* flags of part (without hyphen placement)
+ */
+unsigned nameClassifySimd(char* name, bool* hyphen)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i*) name);
+
+    __m256i upper = SIMD_IN_RANGE(v, 'A', 26);
+    __m256i folded = _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    _mm256_storeu_si256((__m256i*) name, folded);
+
+    __m256i hyphens = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'));
+    __m256i ldh = _mm256_or_si256(
+        _mm256_or_si256(SIMD_IN_RANGE(folded, 'a', 26), SIMD_IN_RANGE(v, '0', 10)),
+        _mm256_or_si256(hyphens, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'))));
+    __m256i printable = SIMD_IN_RANGE(v, 0x21, 0x7e - 0x21 + 1);
+
+    unsigned flags = 0;
+    if(_mm256_movemask_epi8(upper) != 0)
+        flags |= NAME_FOLDED;
+    if((unsigned) _mm256_movemask_epi8(ldh) != 0xffffffffu)
+        flags |= NAME_NON_LDH;
+    if((unsigned) _mm256_movemask_epi8(printable) != 0xffffffffu)
+        flags |= NAME_SUSPICIOUS;
+    if(_mm256_movemask_epi8(hyphens) != 0)
+        *hyphen = true;
+
+    return flags;
+}
+
+#elif defined(__SSE2__)
+
+// bytes of v that are in range [low, low + count), unsigned saturating
+// subtraction is zero only for them
+#define SIMD_IN_RANGE(v, low, count) _mm_cmpeq_epi8(_mm_subs_epu8(                     \
+    _mm_sub_epi8((v), _mm_set1_epi8(low)), _mm_set1_epi8((count) - 1)),              \
+    _mm_setzero_si128())
+
+#define SIMD_WIDTH 16
+
+/**
+ * @brief Folds and classifies 16 bytes at once
+ *
+ * @param name Part of decoded name, at least 16 bytes long
+ * @param hyphen Pointer that is set when part contains hyphen
+ * @return unsigned NAME_* flags of part (without hyphen placement)
+ */
+unsigned nameClassifySimd(char* name, bool* hyphen)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*) name);
+
+    __m128i upper = SIMD_IN_RANGE(v, 'A', 26);
+    __m128i folded = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128((__m128i*) name, folded);
+
+    __m128i hyphens = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+    __m128i ldh = _mm_or_si128(
+        _mm_or_si128(SIMD_IN_RANGE(folded, 'a', 26), SIMD_IN_RANGE(v, '0', 10)),
+        _mm_or_si128(hyphens, _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))));
+    __m128i printable = SIMD_IN_RANGE(v, 0x21, 0x7e - 0x21 + 1);
+
+    unsigned flags = 0;
+    if(_mm_movemask_epi8(upper) != 0)
+        flags |= NAME_FOLDED;
+    if(_mm_movemask_epi8(ldh) != 0xffff)
+        flags |= NAME_NON_LDH;
+    if(_mm_movemask_epi8(printable) != 0xffff)
+        flags |= NAME_SUSPICIOUS;
+    if(_mm_movemask_epi8(hyphens) != 0)
+        *hyphen = true;
+
+    return flags;
+}
+
+#endif
+
+/**
+ * @brief Folds name to lower case in place and validates its labels
+ *
+ * @param name Decoded name, labels are separated by dots
+ * @param len Length of name
+ * @return unsigned NAME_* flags of name
+ */
+unsigned nameNormalize(char* name, size_t len)
+{
+#ifdef SIMD_WIDTH
+    bool hyphen = false;
+    unsigned flags = 0;
+
+    if(len < SIMD_WIDTH)
+    {
+        // short name is padded by letters, that are neither folded nor flagged
+        char chunk[SIMD_WIDTH];
+        memset(chunk, 'a', SIMD_WIDTH);
+        memcpy(chunk, name, len);
+        flags = nameClassifySimd(chunk, &hyphen);
+        memcpy(name, chunk, len);
+    }
+    else
+    {
+        size_t i = 0;
+        for(; i + SIMD_WIDTH <= len; i += SIMD_WIDTH)
+            flags |= nameClassifySimd(name + i, &hyphen);
+
+        // last chunk overlaps already folded bytes, folding them again is
+        // harmless and they are not counted as folded twice
+        if(i < len)
+            flags |= nameClassifySimd(name + len - SIMD_WIDTH, &hyphen);
+    }
+
+    if(hyphen && nameHyphenEdges(name, len))
+        flags |= NAME_NON_LDH;
+
+    return flags;
+#else
+    return nameNormalizeScalar(name, len);
+#endif
+}
+
+/**
+ * @brief Counts flags of one normalized name
+ *
+ * @param stats Pointer to the NameStats
+ * @param flags Flags returned by nameNormalize()
+ */
+void nameStatsCount(NameStats* stats, unsigned flags)
+{
+    stats->names++;
+    if(flags & NAME_FOLDED)
+        stats->folded++;
+    if(flags & NAME_NON_LDH)
+        stats->nonLdh++;
+    if(flags & NAME_SUSPICIOUS)
+        stats->suspicious++;
+}
+
+/**
+ * @brief Adds counters of one capture loop (worker) to another
+ *
+ * @param total Pointer to the NameStats where counters are added
+ * @param stats Pointer to the added NameStats
+ */
+void nameStatsAdd(NameStats* total, const NameStats* stats)
+{
+    total->names += stats->names;
+    total->folded += stats->folded;
+    total->nonLdh += stats->nonLdh;
+    total->suspicious += stats->suspicious;
+}
+
+/**
+ * @brief Prints number of stored names that are not LDH or contain
+ * suspicious bytes onto stderr, nothing is printed when all names were clean
+ *
+ * @param stats Pointer to the NameStats
+ */
+void nameStatsReport(const NameStats* stats)
+{
+    if(stats->nonLdh == 0 && stats->suspicious == 0)
+        return;
+
+    fprintf(stderr, "Stored names: %lu (%lu folded to lower case, %lu not LDH, "
+        "%lu with control, space or non ASCII bytes)\n", stats->names, stats->folded,
+        stats->nonLdh, stats->suspicious);
+}
+
+#ifdef SIMD_WIDTH
+#undef SIMD_IN_RANGE
+#undef SIMD_WIDTH
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file nameNormalize.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Normalization of decoded domain names before they are stored into
+ * domain and translation lists. ASCII letters are folded to lower case, so
+ * names differing only in case are stored once, and characters are checked
+ * against LDH (letters, digits, hyphen) rules in the same pass. Kernel
+ * processes 32 (AVX2) or 16 (SSE2) bytes at once, scalar version is used
+ * when compiler targets neither.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef NAME_NORMALIZE_H
+#define NAME_NORMALIZE_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "stddef.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define NAME_FOLDED 0x01                // upper case letter was folded
+#define NAME_NON_LDH 0x02               // character other than letter, digit,
+                                        // hyphen or label starting/ending by hyphen
+#define NAME_SUSPICIOUS 0x04            // control, space or non ASCII byte
+
+/**
+ * @brief Counters of normalized names
+ */
+typedef struct NameStats {
+    unsigned long names;
+    unsigned long folded;
+    unsigned long nonLdh;
+    unsigned long suspicious;
+} NameStats;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Folds name to lower case in place and validates its labels
+ *
+ * @param name Decoded name, labels are separated by dots
+ * @param len Length of name
+ * @return unsigned NAME_* flags of name
+ */
+unsigned nameNormalize(char* name, size_t len);
+
+/**
+ * @brief Scalar version of nameNormalize(), used when SIMD is not available
+ *
+ * @param name Decoded name, labels are separated by dots
+ * @param len Length of name
+ * @return unsigned NAME_* flags of name
+ */
+unsigned nameNormalizeScalar(char* name, size_t len);
+
+/**
+ * @brief Counts flags of one normalized name
+ *
+ * @param stats Pointer to the NameStats
+ * @param flags Flags returned by nameNormalize()
+ */
+void nameStatsCount(NameStats* stats, unsigned flags);
+
+/**
+ * @brief Adds counters of one capture loop (worker) to another
+ *
+ * @param total Pointer to the NameStats where counters are added
+ * @param stats Pointer to the added NameStats
+ */
+void nameStatsAdd(NameStats* total, const NameStats* stats);
+
+/**
+ * @brief Prints number of stored names that are not LDH or contain
+ * suspicious bytes onto stderr, nothing is printed when all names were clean
+ *
+ * @param stats Pointer to the NameStats
+ */
+void nameStatsReport(const NameStats* stats);
+
+#endif /*NAME_NORMALIZE_H*/
@@ -4,20 +4,19 @@
 #define TIMEZONE_LEN sizeof("+00:00")
 
 /**
- * @brief Returns array of characters with correct timestamp in RFC 3339 format
+ * @brief Formats timestamp in RFC 3339 format into provided array
  * 
  * @param tv timestamp
- * @param config Pointer to the Config structure that holds program settings to 
- * set desired behaviour of program and also allocated all allocated variables
- * @return char* 
+ * @param rtcTime Array of at least RFC3339_TIME_LEN characters
+ * @return char* Pointer to rtcTime
  */
-char* getTimestamp(struct timeval tv, Config* config)
+char* formatTimestamp(struct timeval tv, char* rtcTime)
 {
-    char* rtcTime = config->cleanup.timeptr;
-
     time_t time = tv.tv_sec;
 
-    struct tm *tm_info = localtime(&time);
+    // reentrant version, workers format timestamps concurrently
+    struct tm tmStorage;
+    struct tm *tm_info = localtime_r(&time, &tmStorage);
     if (tm_info == NULL)
     {
         errHandling("Failed to convert time to UTC", ERR_INTERNAL);
@@ -32,6 +31,19 @@ char* getTimestamp(struct timeval tv, Config* config)
     return rtcTime;
 }
 
+/**
+ * @brief Returns array of characters with correct timestamp in RFC 3339 format
+ * 
+ * @param tv timestamp
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return char* 
+ */
+char* getTimestamp(struct timeval tv, Config* config)
+{
+    return formatTimestamp(tv, config->cleanup.timeptr);
+}
+
 #undef TIMEZONE_LEN
 
 /**
@@ -43,6 +55,10 @@ char* getTimestamp(struct timeval tv, Config* config)
  */
 void domainNameHandler(Buffer* newEntry, BufferList* list)
 {
+    // root name is decoded as empty, it has no dot to delete
+    if(newEntry->used == 0)
+        return;
+
     if(listSearch(list, newEntry) == false)
     {
         // delete last .
@@ -67,11 +83,12 @@ void translationNameHandler(Buffer* newEntry, Buffer* tmp, BufferList* list, boo
 {
     if(!secondPart)
     {
-        // delete last .
-        bufferSetUsed(newEntry, newEntry->used - 1);
+        // delete last ., root name leaves tmp empty
+        if(newEntry->used > 0)
+            bufferSetUsed(newEntry, newEntry->used - 1);
         bufferCopy(tmp, newEntry);
     }
-    else if(secondPart)
+    else if(secondPart && tmp->used > 0)
     {
         bufferAddChar(tmp, ' ');
         bufferAppend(tmp, newEntry);
@@ -84,6 +101,48 @@ void translationNameHandler(Buffer* newEntry, Buffer* tmp, BufferList* list, boo
 
 
 
+/**
+ * @brief Moves records from src list into dst list, records that are already 
+ * present in dst are skipped
+ * 
+ * @param dst Destination list
+ * @param src Source list, is cleared afterwards
+ */
+void mergeList(BufferList* dst, BufferList* src)
+{
+    Record* elem = src->first;
+    while(elem != NULL)
+    {
+        if(listSearch(dst, elem->data) == false)
+            listAddRecord(dst, elem->data);
+
+        elem = elem->next;
+    }
+
+    listClear(src);
+}
+
+/**
+ * @brief Merges domain and translation lists of all workers into lists of
+ * main Config
+ * 
+ * @param config Pointer to the main Config structure
+ */
+void mergeWorkerLists(Config* config)
+{
+    if(config->workers == NULL)
+        return;
+
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        if(config->workers[i] == NULL)
+            continue;
+
+        mergeList(config->domainList, config->workers[i]->domainList);
+        mergeList(config->translationsList, config->workers[i]->translationsList);
+    }
+}
+
 /**
  * @brief Save domain names and translated ip addresses to the user provided files
  * 
@@ -92,6 +151,8 @@ void translationNameHandler(Buffer* newEntry, Buffer* tmp, BufferList* list, boo
  */
 void saveToFiles(Config* config)
 {
+    mergeWorkerLists(config);
+
     if(config->domainsFile->data != NULL)
     {
         FILE* domFile = fopen(config->domainsFile->data, "w");
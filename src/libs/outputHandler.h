@@ -28,6 +28,15 @@
 //  Functions
 // ----------------------------------------------------------------------------
 
+/**
+ * @brief Formats timestamp in RFC 3339 format into provided array
+ * 
+ * @param tv timestamp
+ * @param rtcTime Array of at least RFC3339_TIME_LEN characters
+ * @return char* Pointer to rtcTime
+ */
+char* formatTimestamp(struct timeval tv, char* rtcTime);
+
 /**
  * @brief Returns array of characters with correct timestamp in RFC 3339 format
  * 
@@ -58,6 +67,23 @@ void domainNameHandler(Buffer* newEntry, BufferList* list);
  */
 void translationNameHandler(Buffer* newEntry, Buffer* tmp, BufferList* list, bool secondPart);
 
+/**
+ * @brief Moves records from src list into dst list, records that are already 
+ * present in dst are skipped
+ * 
+ * @param dst Destination list
+ * @param src Source list, is cleared afterwards
+ */
+void mergeList(BufferList* dst, BufferList* src);
+
+/**
+ * @brief Merges domain and translation lists of all workers into lists of
+ * main Config
+ * 
+ * @param config Pointer to the main Config structure
+ */
+void mergeWorkerLists(Config* config);
+
 /**
  * @brief Save domain names and translated ip addresses to the user provided files
  * 
@@ -0,0 +1,144 @@
+/**
+ * @file packetBatch.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of batch of received packets
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "packetBatch.h"
+
+#include "string.h"
+
+/**
+ * @brief Allocates batch for capacity packets
+ *
+ * @param batch Pointer to the batch
+ * @param capacity Maximum number of packets in batch
+ */
+void batchInit(PacketBatch* batch, unsigned capacity)
+{
+    batch->entries = (BatchEntry*) malloc(sizeof(BatchEntry) * capacity);
+    batch->arena = (unsigned char*) malloc(BATCH_INITIAL_ARENA_SIZE);
+
+    if(batch->entries == NULL || batch->arena == NULL)
+        errHandling("Failed to allocate memory for packet batch", ERR_MALLOC);
+
+    batch->capacity = capacity;
+    batch->arenaSize = BATCH_INITIAL_ARENA_SIZE;
+    batchClear(batch);
+}
+
+/**
+ * @brief Removes all packets from batch, allocated memory is kept
+ *
+ * @param batch Pointer to the batch
+ */
+void batchClear(PacketBatch* batch)
+{
+    batch->count = 0;
+    batch->arenaUsed = 0;
+}
+
+/**
+ * @brief Checks if batch can not accept more packets
+ *
+ * @param batch Pointer to the batch
+ * @return true Batch is full
+ * @return false Batch can accept more packets
+ */
+bool batchIsFull(PacketBatch* batch)
+{
+    return batch->count >= batch->capacity;
+}
+
+/**
+ * @brief Adds packet into batch without copying, data must stay valid
+ * until batch is processed
+ *
+ * @param batch Pointer to the batch
+ * @param header Pcap header of the packet
+ * @param data Raw packet data
+ */
+void batchAddReference(PacketBatch* batch, const struct pcap_pkthdr* header,
+                        const unsigned char* data)
+{
+    if(batchIsFull(batch))
+        errHandling("Packet batch overflow", ERR_INTERNAL);
+
+    BatchEntry* entry = &(batch->entries[batch->count]);
+    entry->header = *header;
+    entry->data = data;
+    batch->count++;
+}
+
+/**
+ * @brief Callback for pcap_dispatch(), copies packet into batch arena
+ *
+ * @param user Pointer to the PacketBatch
+ * @param header Pcap header of the packet
+ * @param data Raw packet data, valid only during callback
+ */
+void batchPcapCallback(unsigned char* user, const struct pcap_pkthdr* header,
+                        const unsigned char* data)
+{
+    PacketBatch* batch = (PacketBatch*) user;
+
+    if(batchIsFull(batch))
+        errHandling("Packet batch overflow", ERR_INTERNAL);
+
+    if(batch->arenaUsed + header->caplen > batch->arenaSize)
+    {
+        size_t newSize = batch->arenaSize * 2;
+        while(batch->arenaUsed + header->caplen > newSize)
+            newSize *= 2;
+
+        unsigned char* tmp = (unsigned char*) realloc(batch->arena, newSize);
+        if(tmp == NULL)
+            errHandling("Failed to reallocate memory for packet batch", ERR_MALLOC);
+
+        batch->arena = tmp;
+        batch->arenaSize = newSize;
+    }
+
+    BatchEntry* entry = &(batch->entries[batch->count]);
+    entry->header = *header;
+    entry->data = NULL; // resolved in batchFinalize(), arena can still move
+    entry->arenaOffset = batch->arenaUsed;
+
+    memcpy(batch->arena + batch->arenaUsed, data, header->caplen);
+    batch->arenaUsed += header->caplen;
+    batch->count++;
+}
+
+/**
+ * @brief Resolves data pointers of copied packets, must be called after
+ * last packet was added, because arena can be moved when it grows
+ *
+ * @param batch Pointer to the batch
+ */
+void batchFinalize(PacketBatch* batch)
+{
+    for(unsigned i = 0; i < batch->count; i++)
+    {
+        if(batch->entries[i].data == NULL)
+            batch->entries[i].data = batch->arena + batch->entries[i].arenaOffset;
+    }
+}
+
+/**
+ * @brief Frees memory of batch
+ *
+ * @param batch Pointer to the batch
+ */
+void batchDestroy(PacketBatch* batch)
+{
+    free(batch->entries);
+    free(batch->arena);
+
+    batch->entries = NULL;
+    batch->arena = NULL;
+    batch->capacity = 0;
+    batchClear(batch);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file packetBatch.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Batch of received packets that are processed together stage by
+ * stage (timestamps, classification, dissection, output) instead of one
+ * packet going through all stages at once
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef PACKET_BATCH_H
+#define PACKET_BATCH_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pcap/pcap.h"
+
+#include "utils.h"
+#include "frameDecoder.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define BATCH_DEFAULT_SIZE 64
+#define BATCH_MAX_SIZE 65536
+#define BATCH_INITIAL_ARENA_SIZE (64 * 1024)
+
+/**
+ * @brief One packet in batch, data either point into capture buffer (ring)
+ * or into batch arena (libpcap, its buffer is reused between callbacks)
+ */
+typedef struct BatchEntry {
+    struct pcap_pkthdr header;
+    const unsigned char* data;
+    size_t arenaOffset;
+    char timestamp[RFC3339_TIME_LEN];
+
+    // link and network layers, decoded by classification stage
+    DecodeResult decoded;
+    DecodedFrame frame;
+} BatchEntry;
+
+/**
+ * @brief Batch of up to capacity packets
+ */
+typedef struct PacketBatch {
+    BatchEntry* entries;
+    unsigned count;
+    unsigned capacity;
+
+    unsigned char* arena;
+    size_t arenaUsed;
+    size_t arenaSize;
+} PacketBatch;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Allocates batch for capacity packets
+ *
+ * @param batch Pointer to the batch
+ * @param capacity Maximum number of packets in batch
+ */
+void batchInit(PacketBatch* batch, unsigned capacity);
+
+/**
+ * @brief Removes all packets from batch, allocated memory is kept
+ *
+ * @param batch Pointer to the batch
+ */
+void batchClear(PacketBatch* batch);
+
+/**
+ * @brief Checks if batch can not accept more packets
+ *
+ * @param batch Pointer to the batch
+ * @return true Batch is full
+ * @return false Batch can accept more packets
+ */
+bool batchIsFull(PacketBatch* batch);
+
+/**
+ * @brief Adds packet into batch without copying, data must stay valid
+ * until batch is processed
+ *
+ * @param batch Pointer to the batch
+ * @param header Pcap header of the packet
+ * @param data Raw packet data
+ */
+void batchAddReference(PacketBatch* batch, const struct pcap_pkthdr* header,
+                        const unsigned char* data);
+
+/**
+ * @brief Callback for pcap_dispatch(), copies packet into batch arena
+ *
+ * @param user Pointer to the PacketBatch
+ * @param header Pcap header of the packet
+ * @param data Raw packet data, valid only during callback
+ */
+void batchPcapCallback(unsigned char* user, const struct pcap_pkthdr* header,
+                        const unsigned char* data);
+
+/**
+ * @brief Resolves data pointers of copied packets, must be called after
+ * last packet was added, because arena can be moved when it grows
+ *
+ * @param batch Pointer to the batch
+ */
+void batchFinalize(PacketBatch* batch);
+
+/**
+ * @brief Frees memory of batch
+ *
+ * @param batch Pointer to the batch
+ */
+void batchDestroy(PacketBatch* batch);
+
+#endif /*PACKET_BATCH_H*/
@@ -10,152 +10,418 @@
 #include "packetDissector.h"
 
 /**
- * @brief Dissects frame into correct segments and prints relevant info
+ * @brief Context of TCP segment passed to tcpMessageHandler()
+ */
+typedef struct TcpMessageContext
+{
+    PacketInfo* info;
+    Config* config;
+    DissectError error;         // first error of messages completed by segment
+} TcpMessageContext;
+
+/**
+ * @brief Context of IP fragment passed to ipDatagramHandler()
+ */
+typedef struct IpDatagramContext
+{
+    PacketInfo* info;
+    TcpFlowKey* key;
+    Config* config;
+    DissectError error;
+} IpDatagramContext;
+
+/**
+ * @brief Prints DNS message reassembled from TCP stream
+ * 
+ * @param message Start of DNS message
+ * @param length Length of DNS message
+ * @param user Pointer to the TcpMessageContext
+ */
+void tcpMessageHandler(const unsigned char* message, size_t length, void* user)
+{
+    TcpMessageContext* context = (TcpMessageContext*) user;
+
+    // rest of messages in stream is still printed
+    DissectError error = dnsMessageDissector(context->info, message, length, context->config);
+    if(context->error == DISSECT_OK)
+        context->error = error;
+}
+
+/**
+ * @brief Dissects datagram reassembled from IP fragments
+ * 
+ * @param payload Start of transport header
+ * @param length Length of datagram payload
+ * @param user Pointer to the IpDatagramContext
+ */
+void ipDatagramHandler(const unsigned char* payload, size_t length, void* user)
+{
+    IpDatagramContext* context = (IpDatagramContext*) user;
+
+    context->error = transportDissector(context->info, context->key, payload, length, 
+                                        context->config);
+}
+
+/**
+ * @brief Dissects frame into correct segments and prints every DNS message 
+ * carried by it (TCP segment can complete zero or more messages, IP 
+ * fragment is printed when it completes its datagram)
  * 
  * @param packet Byte array containing raw packet data
- * @param length Length of the packet
+ * @param length Captured length of the packet
+ * @param ts Time when packet was captured
+ * @param timestamp Already formatted timestamp of the packet
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why (part of) packet was skipped
  */
-void frameDissector(packet_t packet, size_t length, Config* config)
+DissectError frameDissector(packet_t packet, size_t length, struct timeval ts,
+                    const char* timestamp, Config* config)
 {     
-    EthernetHeader* eth;
-    eth = (EthernetHeader *) packet;
+    DecodedFrame frame;
+    DecodeResult decoded = frameDecode(config->linkType, packet, length, &frame);
 
-    unsigned offset = sizeof(EthernetHeader);
-
-    if(length < offset)
-        errHandling("Received packet is not long enough, probably malfunctioned packet (in frame Dissector 1)", ERR_BAD_PACKET);
+    return decodedFrameDissector(packet, length, decoded, &frame, ts, timestamp, config);
+}
 
+/**
+ * @brief Dissects frame whose link and network layers were already decoded
+ * by frameDecode() (batch classifies all its packets before dissecting them)
+ * and prints every DNS message carried by it
+ * 
+ * @param packet Byte array containing raw packet data
+ * @param length Captured length of the packet
+ * @param decoded Result of frameDecode()
+ * @param frame Decoded link and network layers of the packet
+ * @param ts Time when packet was captured
+ * @param timestamp Already formatted timestamp of the packet
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why (part of) packet was skipped
+ */
+DissectError decodedFrameDissector(packet_t packet, size_t length, DecodeResult decoded,
+                    const DecodedFrame* frame, struct timeval ts, const char* timestamp,
+                    Config* config)
+{
+    // length is printed only by debug build
+    (void) length;
 
-    // unsigned short etherType = ntohs(((unsigned short*) (eth->etherType))[0]);
-    unsigned short etherType = ntohs( PACKET_2_SHORT(eth->etherType) );
-    switch( etherType )
+    switch(decoded)
     {
-        case ETH_TYPE_IPV4:
-            if(length < offset + sizeof(struct iphdr))
-                errHandling("Received packet is not long enough, probably malfunctioned packet (in frame Dissector 2)", ERR_BAD_PACKET);
-
-            ipv4Dissector(packet + offset, config->verbose);
-            offset += sizeof(struct iphdr);
-            break;
-        case ETH_TYPE_IPV6:
-            if(length < offset + sizeof(struct ip6_hdr))
-                errHandling("Received packet is not long enough, probably malfunctioned packet (in frame Dissector 3)", ERR_BAD_PACKET);
-
-            ipv6Dissector(packet + offset, config->verbose);
-            offset += sizeof(struct ip6_hdr);
+        case DECODE_OK:
             break;
-        default:
-            debugPrint(stdout, "DEBUG: Unknown EtherType: (%hhx %hhx)\n", eth->etherType[0], eth->etherType[1]);
+        case DECODE_SHORT:
+            return DISSECT_SHORT_FRAME;
+        case DECODE_UNSUPPORTED:
             #ifdef DEBUG
                 debugPrint(stdout, "Packet:\n");
                 printBytes(packet, length, ' ');
                 debugPrint(stdout, "\n");
             #endif
-            errHandling("Unknown ether type", ERR_UNKNOWN_PROTOCOL);
-            break;
+            return DISSECT_UNSUPPORTED;
+    }
+
+    PacketInfo info;
+    info.timestamp = timestamp;
+    info.seconds = ts.tv_sec;
+    info.etherType = frame->etherType;
+    info.network = frame->network;
+    info.transport = frame->transport;
+
+    TcpFlowKey key;
+    memset(&key, 0, sizeof(TcpFlowKey));
+    key.family = frame->family;
+    memcpy(key.src, frame->src, 16);
+    memcpy(key.dst, frame->dst, 16);
+
+    packet_t segment = packet + frame->transportOffset;
+    size_t segmentLen = frame->payloadEnd - frame->transportOffset;
+
+    if(frame->fragment)
+    {
+        // fragment cut by snapshot length can never complete its datagram
+        if(frame->truncated)
+            return DISSECT_OK;
+
+        IpFragKey fragKey;
+        memset(&fragKey, 0, sizeof(IpFragKey));
+        memcpy(fragKey.src, frame->src, 16);
+        memcpy(fragKey.dst, frame->dst, 16);
+        fragKey.id = frame->fragId;
+        fragKey.protocol = frame->transport;
+        fragKey.family = frame->family;
+
+        IpDatagramContext context = {&info, &key, config, DISSECT_OK};
+        ipFragAdd(config->ipFrags, &fragKey, frame->fragOffset, frame->moreFragments, 
+            segment, segmentLen, info.seconds, ipDatagramHandler, &context);
+        return context.error;
     }
 
-    if(length < offset + sizeof(struct udphdr))
-        errHandling("Received packet is not long enough, probably malfunctioned packet (in frame Dissector 4)", ERR_BAD_PACKET);
+    return transportDissector(&info, &key, segment, segmentLen, config);
+}
+
+/**
+ * @brief Dissects UDP or TCP part of the packet and prints every DNS 
+ * message carried by it. Capture filter passes also fragments and IPv6 
+ * packets with extension headers, so ports are checked here.
+ * 
+ * @param info Network information of the packet, transport information is
+ * filled in
+ * @param key Flow key with addresses filled in, ports are filled in for TCP
+ * @param segment Start of transport header
+ * @param length Length of transport header and data
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why (part of) packet was skipped
+ */
+DissectError transportDissector(PacketInfo* info, TcpFlowKey* key, packet_t segment,
+                        size_t length, Config* config)
+{
+    if(info->transport == IPPROTO_UDP)
+    {
+        if(length < sizeof(struct udphdr))
+            return DISSECT_SHORT_TRANSPORT;
+
+        struct udphdr* udp = (struct udphdr*) segment;
+        info->srcPort = ntohs(udp->source);
+        info->dstPort = ntohs(udp->dest);
+        if(info->srcPort != DNS_PORT && info->dstPort != DNS_PORT)
+            return DISSECT_OK;
+
+        return dnsMessageDissector(info, segment + sizeof(struct udphdr), 
+            length - sizeof(struct udphdr), config);
+    }
+
+    if(info->transport == IPPROTO_TCP)
+    {
+        struct tcphdr* tcp = (struct tcphdr*) segment;
+        if(length < sizeof(struct tcphdr) || length < (size_t) tcp->th_off * 4 ||
+            tcp->th_off * 4 < sizeof(struct tcphdr))
+            return DISSECT_SHORT_TRANSPORT;
+
+        info->srcPort = ntohs(tcp->th_sport);
+        info->dstPort = ntohs(tcp->th_dport);
+        if(info->srcPort != DNS_PORT && info->dstPort != DNS_PORT)
+            return DISSECT_OK;
+
+        key->srcPort = info->srcPort;
+        key->dstPort = info->dstPort;
+
+        TcpMessageContext context = {info, config, DISSECT_OK};
+        tcpTableSegment(config->tcpFlows, key, tcp, segment + tcp->th_off * 4, 
+            length - tcp->th_off * 4, info->seconds, tcpMessageHandler, &context);
+        return context.error;
+    }
+
+    // e.g. ICMPv6 behind extension headers, filter can not tell it apart
+    debugPrint(stdout, "DEBUG: Ignored transport protocol %hhu\n", info->transport);
+    return DISSECT_OK;
+}
+
+/**
+ * @brief Prints one DNS message together with addresses and ports of packet
+ * that carried it
+ * 
+ * @param info Network and transport information of the packet
+ * @param dns Start of DNS message
+ * @param length Length of DNS message
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why message was skipped
+ */
+DissectError dnsMessageDissector(PacketInfo* info, packet_t dns, size_t length, Config* config)
+{
+    FILE* output = config->output;
+
+    // kernel accepts packets for which DNS filter couldn't be evaluated
+    if(!dnsFilterMatch(&(config->dnsFilter), dns, length))
+        return DISSECT_OK;
+
+    // nothing is printed or stored for message malformed in parts that are
+    // needed, names inside of RDATA are read only in verbose mode
+    DnsMessage message;
+    DissectError error = dnsMessageParse(&message, dns, length, config->dnsNeeds, 
+                                        config->nameCache);
+    if(error != DISSECT_OK)
+        return error;
+
+    if(config->ednsReport)
+        ednsStatsCount(&(config->ednsStats), &message);
+
+    // header of message is formatted into text and written at once
+    char text[DISSECT_TEXT_LEN];
+    size_t len = 0;
+    size_t timestampLen = strlen(info->timestamp);
 
     if(config->verbose)
-        udpDissector(packet + offset);
-        
-    offset += sizeof(struct udphdr);
+        len += FORMAT_LITERAL(text, "Timestamp: ");
+    memcpy(text + len, info->timestamp, timestampLen);
+    len += timestampLen;
+    if(config->verbose)
+        text[len++] = '\n';
+
+    if(info->etherType == ETH_TYPE_IPV4)
+        len += ipv4Dissector(info->network, config->verbose, text + len);
+    else
+        len += ipv6Dissector(info->network, config->verbose, text + len);
 
-    if(length < offset + sizeof(struct DNSHeader))
-        errHandling("Received packet is not long enough, probably malfunctioned packet (in frame Dissector 5)", ERR_BAD_PACKET);
+    if(config->verbose)
+        len += portDissector(info, text + len);
 
     if(config->verbose)
-        verboseDNSDissector(packet + offset);
+        len += verboseDNSDissector(&message, text + len);
     else
-        dnsDissector(packet + offset);
+        len += dnsDissector(&message, text + len);
 
-    rrDissector(packet + offset, config, length - offset - sizeof(struct DNSHeader));
-}
+    fwrite(text, 1, len, output);
 
-// ----------------------------------------------------------------------------
-// IPv4 and IPv6
-// ----------------------------------------------------------------------------
+    // plain output without lists prints only header
+    if(config->dnsNeeds & (DNS_NEED_QUESTION | DNS_NEED_RECORDS))
+        rrDissector(&message, config);
 
+    fprintf(output, "\n");
+
+    return DISSECT_OK;
+}
 
 /**
- * @brief Prints DNS information in non-verbose mode
+ * @brief Returns parts of DNS messages that are printed, stored into lists
+ * or counted with current program arguments, dissection of message stops 
+ * after them
  * 
- * @param packet Byte array containing raw packet
+ * @param config Pointer to the Config structure with handled arguments
+ * @return unsigned DNS_NEED_* flags
  */
-void dnsDissector(packet_t packet)
+unsigned dissectorNeeds(const Config* config)
 {
-    DNSHeader* dns = (struct DNSHeader*) packet;
-    unsigned short correctedFlags = ntohs(dns->flags);
-
-    printf("(%c ",      (correctedFlags & QR)? 'R' : 'Q');
-    printf("%hu/",      ntohs(dns->noQuestions));
-    printf("%hu/",      ntohs(dns->noAnswers));
-    printf("%hu/",      ntohs(dns->noAuthority));
-    printf("%hu)",    ntohs(dns->noAdditional));
+    // header line is printed for every message
+    unsigned needs = DNS_NEED_HEADER;
+
+    // translations are stored only together with domains
+    if(config->verbose || config->domainsFile->data != NULL)
+        needs |= DNS_NEED_QUESTION | DNS_NEED_RECORDS | DNS_NEED_NAMES;
+
+    // stored names are folded to lower case
+    if(config->domainsFile->data != NULL)
+        needs |= DNS_NEED_FOLDED;
+
+    // lists need only owner names and addresses of A and AAAA records
+    if(config->verbose)
+        needs |= DNS_NEED_RDATA;
+
+    if(config->ednsReport)
+        needs |= DNS_NEED_EDNS;
+
+    return needs;
 }
 
+// ----------------------------------------------------------------------------
+// DNS message
+// ----------------------------------------------------------------------------
+
 /**
- * @brief Prints DNS information 
+ * @brief Formats DNS information in non-verbose mode
  * 
- * @param packet Byte array containing raw packet, must start at RDATA
+ * @param message Parsed DNS message
+ * @param out Where text is written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void verboseDNSDissector(packet_t packet)
+size_t dnsDissector(const DnsMessage* message, char* out)
 {
-    DNSHeader* dns = (struct DNSHeader*) packet;
-    unsigned short correctedFlags = ntohs(dns->flags);
-
-    printf("Identifier: 0x%hhX%hhX\n", 
-        ((unsigned char) (ntohs(dns->transactionID) >> 8)),
-        ((unsigned char) ntohs(dns->transactionID)));
-    printf("Flags:");
-    printf("QR=%c,",        (correctedFlags & QR)? '1' : '0');
-    printf("OPCODE=%u,",    (correctedFlags & OPCODE) >> 11);
-    printf("AA=%c,",        (correctedFlags & AA)? '1' : '0');
-    printf("TC=%c,",        (correctedFlags & TC)? '1' : '0');
-    printf("RD=%c,",        (correctedFlags & RD)? '1' : '0');
-    printf("RA=%c,",        (correctedFlags & RA)? '1' : '0');
-    printf("Z=%u,",         (correctedFlags & _Z) >> 4);
-    printf("RCODE=%u\n",     correctedFlags & RCODE);
+    char* ptr = out;
+
+    *ptr++ = '(';
+    *ptr++ = (message->flags & QR)? 'R' : 'Q';
+    *ptr++ = ' ';
+    ptr += formatU32(ptr, message->questions);
+    *ptr++ = '/';
+    ptr += formatU32(ptr, message->answers);
+    *ptr++ = '/';
+    ptr += formatU32(ptr, message->authorities);
+    *ptr++ = '/';
+    ptr += formatU32(ptr, message->additionals);
+    *ptr++ = ')';
+
+    return ptr - out;
 }
 
 /**
- * @brief Prints MX Preference part of RDATA
+ * @brief Formats DNS information 
  * 
- * @param packet Byte array containing raw packet, must start at PREFERENCE part 
- * of DNS MX packet part
+ * @param message Parsed DNS message
+ * @param out Where text is written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void handleMXPreference(packet_t packet)
+size_t verboseDNSDissector(const DnsMessage* message, char* out)
 {
-    // +2 is because first is data rdatalen (2 bytes) and then is rdata 
-    // containing mx preference 
-    printf("%hu ", ntohs(PACKET_2_SHORT(packet + 2) ));
+    unsigned short flags = message->flags;
+    char* ptr = out;
+
+    // bytes of identifier are written without leading zeros
+    ptr += FORMAT_LITERAL(ptr, "Identifier: 0x");
+    ptr += formatHex(ptr, (unsigned char) (message->id >> 8));
+    ptr += formatHex(ptr, (unsigned char) message->id);
+
+    ptr += FORMAT_LITERAL(ptr, "\nFlags:QR=");
+    *ptr++ = (flags & QR)? '1' : '0';
+    ptr += FORMAT_LITERAL(ptr, ",OPCODE=");
+    ptr += formatU32(ptr, (flags & OPCODE) >> 11);
+    ptr += FORMAT_LITERAL(ptr, ",AA=");
+    *ptr++ = (flags & AA)? '1' : '0';
+    ptr += FORMAT_LITERAL(ptr, ",TC=");
+    *ptr++ = (flags & TC)? '1' : '0';
+    ptr += FORMAT_LITERAL(ptr, ",RD=");
+    *ptr++ = (flags & RD)? '1' : '0';
+    ptr += FORMAT_LITERAL(ptr, ",RA=");
+    *ptr++ = (flags & RA)? '1' : '0';
+    ptr += FORMAT_LITERAL(ptr, ",Z=");
+    ptr += formatU32(ptr, (flags & _Z) >> 4);
+    ptr += FORMAT_LITERAL(ptr, ",RCODE=");
+    ptr += formatU32(ptr, flags & RCODE);
+    *ptr++ = '\n';
+
+    return ptr - out;
 }
 
-unsigned handleSectionContent(packet_t resourceRecords, packet_t packet, Config* config, unsigned ptr, size_t maxLen, bool valid)
+/**
+ * @brief Prints resource record and stores its names and addresses into 
+ * lists, owner name and RDATA are decoded only when they are printed or
+ * stored
+ * 
+ * @param message Parsed DNS message
+ * @param record Resource record
+ * @param config Pointer to the Config structure
+ * @param valid Record has supported type and class and is printed
+ */
+void handleSectionContent(const DnsMessage* message, const DnsRecord* record, 
+                        Config* config, bool valid)
 {
+    FILE* output = config->output;
+
     Buffer* bufferPtr = config->addressToPrint;
-    unsigned type;
-    unsigned ptrOld = ptr;
+    const RRTypeInfo* info = rrTypeFind(record->type);
 
-    // bufferPtr already contains correct NAME, print it
-    IF_VERBOSE_AND_VALID {
-        bufferPrint(bufferPtr, 1);
-    };
+    // owner, TTL and class of pseudo record (OPT) are printed by its decoder
+    bool header = valid && !(info->flags & RR_PSEUDO);
 
-    IF_VERBOSE_AND_VALID {
-        handleRRTTL(resourceRecords + ptr + TTL_LEN);
-    };
-    IF_VERBOSE_AND_VALID {
-        handleRRClass(resourceRecords + ptr + CLASS_LEN);
-    };
-    
-    type = handleRRType(resourceRecords + ptr, config->verbose);
+    bool stored = config->domainsFile->data != NULL && (info->flags & RR_STORE_DOMAIN);
 
-    ptr += TTL_LEN + CLASS_LEN + TYPE_LEN;
+    if(config->verbose && header) {
+        dnsNameDecode(message, record->nameOffset, bufferPtr);
+        bufferPrint(bufferPtr, 1, output);
+        handleRRTTL(record->ttl, output);
+        handleRRClass(record->rrClass, output);
+    }
+
+    // names are printed as they were sent, stored ones are folded to lower
+    // case, name cache folds every suffix of message only once
+    if(stored) {
+        bufferClear(bufferPtr);
+        nameStatsCount(&(config->nameStats),
+                        dnsNameDecodeFolded(message, record->nameOffset, bufferPtr));
+    }
+    
+    handleRRType(record->type, config->verbose? output : NULL);
     
     // store domain names for A,AAAA and NS
     STORE_DOMAIN(
@@ -167,16 +433,15 @@ unsigned handleSectionContent(packet_t resourceRecords, packet_t packet, Config*
         translationNameHandler(bufferPtr, config->tmpListEntry, config->translationsList, false);
         );
 
-    if(type == RRType_MX) {
-        IF_VERBOSE_AND_VALID {
-            handleMXPreference(resourceRecords + ptr);
-        };
-    }
     bufferClear(bufferPtr);
-    ptr += handleRRRData(resourceRecords + ptr, type, packet, bufferPtr, ptr, maxLen, config);
+
+    // without verbose output RDATA is needed only for translations
+    bool translated = stored && (info->flags & RR_STORE_TRANSLATION);
+    if(info->decode != NULL && ((config->verbose && valid) || translated))
+        info->decode(message, record, bufferPtr, (config->verbose && valid)? output : NULL);
         
     IF_VERBOSE_AND_VALID {
-        bufferPrint(bufferPtr, 1);
+        bufferPrint(bufferPtr, 1, output);
     };
 
     STORE_TRANSLATIONS(
@@ -184,385 +449,144 @@ unsigned handleSectionContent(packet_t resourceRecords, packet_t packet, Config*
         );
     
     bufferClear(bufferPtr);
-    IF_VERBOSE_AND_VALID { printf("\n"); };
-
-    return ptr - ptrOld;
+    IF_VERBOSE_AND_VALID { fprintf(output, "\n"); };
 }
 
 /**
- * @brief Dissects DNS packet into parts and prints relevant information
+ * @brief Prints question and all resource records of message and stores 
+ * their domain names and translations into lists
  * 
- * @param packet Packet to be dissected, must be at a start of DNS part of the packet
+ * @param message Message parsed by dnsMessageParse()
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
- * @param maxLen Maximum allowed length of packet
  */
-void rrDissector(packet_t packet, Config* config, size_t maxLen)
+void rrDissector(DnsMessage* message, Config* config)
 {
-    Buffer* bufferPtr = config->addressToPrint;
+    FILE* output = config->output;
 
-    // dns header to know number of queries to be expected
-    DNSHeader* dns = (struct DNSHeader*) packet;
-    packet_t resourceRecords = packet + sizeof(struct DNSHeader);
-    
-    // pointer in packet byte array, offset...
-    unsigned ptr = 0;
+    Buffer* bufferPtr = config->addressToPrint;
 
     bool valid = false;
-    if(ntohs(dns->noQuestions) > 0)
+    if(message->hasQuestion && (message->needs & DNS_NEED_QUESTION))
     {
-        ptr += handleRRName(resourceRecords, packet, bufferPtr, ptr, maxLen);     
-
-        LEN_CHECK(0);
-
-        valid = isValidTypeOrClass(resourceRecords + ptr);
+        valid = rrTypeValid(message->questionType, message->questionClass);
 
         IF_VERBOSE{
-            printf("\n[Question Section]\n");
+            fprintf(output, "\n[Question Section]\n");
         };
 
+        IF_VERBOSE_AND_VALID{
+            dnsNameDecode(message, message->questionOffset, bufferPtr);
+            bufferPrint(bufferPtr, 1, output);
+        }
+
         if(config->domainsFile->data != NULL)
+        {
+            bufferClear(bufferPtr);
+            nameStatsCount(&(config->nameStats),
+                            dnsNameDecodeFolded(message, message->questionOffset, bufferPtr));
             domainNameHandler(bufferPtr, config->domainList);
-
-        IF_VERBOSE_AND_VALID{
-            bufferPrint(bufferPtr, 1);
         }
 
         bufferClear(bufferPtr);
 
         IF_VERBOSE_AND_VALID{
-            // +2 for two zero bytes after name
-            handleRRClass(resourceRecords + ptr + 2);
+            handleRRClass(message->questionClass, output);
         }
 
         IF_VERBOSE_AND_VALID{
-            handleRRType(resourceRecords + ptr, config->verbose);
+            handleRRType(message->questionType, output);
         }
-        ptr += 4; // +2 for the type, +2 for the type
 
         if(valid == false && config->verbose) {
-            printf("DNS record type is not supported");
+            fprintf(output, "DNS record type is not supported");
         }
 
         if(config->verbose)
-            printf("\n");
+            fprintf(output, "\n");
     }
 
-    unsigned repeat = 0;
-    for(unsigned i = 0; i < 3; i++)
+    // records of long messages are parsed in windows
+    int section = -1;
+    do
     {
-        // how many records are in each section
-        switch(i)
+        for(unsigned i = 0; i < message->stored; i++)
         {
-            case 0: repeat = ntohs(dns->noAnswers);
-                break;
-            case 1: repeat = ntohs(dns->noAuthority);
-                break;
-            case 2: repeat = ntohs(dns->noAdditional);
-                break;
-        }
+            const DnsRecord* record = &(message->records[i]);
 
-        if(repeat > 0 && config->verbose) 
-        {
-           switch(i)
+            if(record->section != section && config->verbose) 
             {
-                case 0: printf("\n[Answer Section]\n"); break;
-                case 1: printf("\n[Authority Section]\n"); break;
-                case 2: printf("\n[Additional Section]\n");break;
+                switch(record->section)
+                {
+                    case DNS_SECTION_ANSWER: fprintf(output, "\n[Answer Section]\n"); break;
+                    case DNS_SECTION_AUTHORITY: fprintf(output, "\n[Authority Section]\n"); break;
+                    case DNS_SECTION_ADDITIONAL: fprintf(output, "\n[Additional Section]\n");break;
+                }
             }
-        }
-
-        for(unsigned i = 0; i < repeat; i++)
-        {
-            ptr += handleRRName(resourceRecords+ptr, packet, bufferPtr, ptr, maxLen);
-            // +4 for ttl, +2 for class, +2 for type
-            LEN_CHECK(8);
+            section = record->section;
 
             // ignore unknown resource record types
-            valid = isValidTypeOrClass(resourceRecords + ptr);
+            valid = rrTypeValid(record->type, record->rrClass);
 
             if(valid == false && config->verbose) {
-                printf("DNS record type is not supported\n");
+                fprintf(output, "DNS record type is not supported\n");
             }
 
-            ptr += handleSectionContent(resourceRecords, packet, config, ptr, maxLen, valid);
-        }
-    }
-
-}
-
-
-/**
- * @brief Checks if new query contains supported type of class
- * 
- * @param data Byte array containing raw packet data starting at Type section 
- * DNS message
- * @return true Is valid/known message type/class
- * @return false Is not valid/known message type/class
- */
-bool isValidTypeOrClass(packet_t data)
-{
-    bool valid = false;
-    // no need for offset
-    switch (ntohs( PACKET_2_SHORT(data) ))
-    // switch (ntohs(((unsigned short*)(data))[0]))
-    {
-        case RRType_A:
-        case RRType_AAAA:
-        case RRType_NS:
-        case RRType_MX:
-        case RRType_SOA:
-        case RRType_CNAME:
-        case RRType_SRV:
-            valid = true;
-            break;
-    }
-
-    if(valid == false)
-        return false;
-
-    // +2 is offset after name to the class
-    switch (ntohs( PACKET_2_SHORT(data + 2) ))
-    // switch (ntohs(((unsigned short*)(data + 2))[0]))
-    {
-        case RRClass_IN:
-            valid = true;
-            break;
-        default:
-            valid = false;            
-    }
-
-    return valid;
-}
-
-/**
- * @brief Stores correct domain name into Buffer
- * 
- * @param data Byte array containing raw packet, must start at RDATA
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
- * @return int Return length of NAME segment
- */
-unsigned handleRRName(packet_t data, packet_t dataWOptr, 
-                        Buffer* bufferPtr, size_t currLen, size_t maxLen)
-{
-    unsigned ptr = 0;
-    for(;1;)
-    {
-        const unsigned char lengthOctet = (data)[ptr];
-        if(lengthOctet == 0)
-        {
-            ptr++;
-            return ptr;
-        }
-        else if(lengthOctet & 0xc0)
-        {
-            const unsigned short jumpPtr = ((data[ptr] << 8) | data[ptr + 1]) & 0x3fff;
-            
-            handleRRName(dataWOptr + jumpPtr, dataWOptr, bufferPtr, currLen + ptr, maxLen);
-
-            // return ptr + 2 for the jump pointer
-            return ptr + 2;
-        }
-
-        ptr++; // increase pointer to go from length octet to data
-
-        for(unsigned char i = 0; i < lengthOctet; i++, ptr++)
-        {
-            bufferAddChar(bufferPtr, (data)[ptr]);
+            handleSectionContent(message, record, config, valid);
         }
-        bufferAddChar(bufferPtr, '.');
-    }
-    
-    return 0;
+    } while(dnsMessageNextRecords(message));
 }
 
 
 /**
- * @brief Stores correct IP address or domain name into Buffer
+ * @brief Prints Time To Live onto output
  * 
- * @param data Byte array containing raw packet, must start at RDATA
- * @param type Sign if A or AAAA type is detected (this will be IP address)
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
- * @param config Pointer to the Config structure
- * @return int Return length of RDATA segment
+ * @param ttl Time To Live of record
+ * @param output Stream where TTL is printed
  */
-int handleRRRData(packet_t data, unsigned type, 
-                    packet_t dataWOptr, Buffer* bufferPtr, 
-                    size_t currLen, size_t maxLen, Config* config)
+void handleRRTTL(uint32_t ttl, FILE* output)
 {
-    if(currLen + 2 > maxLen) {
-        errHandling("Received packet is not long enough, probably malfunctioned packet (in handleRRRData 1)", ERR_BAD_PACKET);            
-    }
-    // unsigned short dataLen = ntohs(((unsigned short*)(data))[0]);
-    unsigned short dataLen = ntohs( PACKET_2_SHORT(data) );
-
-    if(currLen + dataLen + 2 > maxLen) {
-        debugPrint(stdout, "(currLen=%li, maxLen=%li, dataLen=%u)", currLen, maxLen, dataLen);
-        errHandling("Received packet is not long enough, probably malfunctioned packet (in handleRRRData 2)", ERR_BAD_PACKET);    
-    }
-    switch (type)
-    {
-    case RRType_A:
-            printIPv4(((uint32_t*) (data + 2))[0], bufferPtr);
-        break;
-    case RRType_AAAA:
-            printIPv6((uint32_t*) (data + 2), bufferPtr);
-        break;
-    case RRType_MX:
-        if(config->verbose)
-            handleRRName(data + RDATALEN_LEN + MX_PREFERENCE_LEN, dataWOptr, bufferPtr, currLen, maxLen);
-        break;
-    case RRType_SOA:;
-        if(config->verbose)
-            handleSOA(data, dataWOptr, bufferPtr, currLen, maxLen);
-        break;
-    case RRType_SRV:;
-        if(config->verbose)
-            handleSRV(data, dataWOptr, bufferPtr, currLen, maxLen);
-        break;
-    case RRType_NS:;
-    case RRType_CNAME:;
-        if(config->verbose)
-            handleRRName(data + RDATALEN_LEN, dataWOptr, bufferPtr, currLen, maxLen);
-        break;
-    default:
-        break;
-    }
-
-    return dataLen + RDATALEN_LEN; // +2 is for the two bytes of dataLen 
+    char text[1 + FORMAT_U32_MAX_LEN] = {' '};
+    fwrite(text, 1, 1 + formatU32(text + 1, ttl), output);
 }
 
-/**
- * @brief Handles correct printing of SRV packets
- * @param data Byte array containing raw packet, must start at RDATA
- * @param type Sign if A or AAAA type is detected (this will be IP address)
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
- */
-void handleSRV(packet_t data, packet_t dataWOptr, Buffer* bufferPtr, size_t currLen, size_t maxLen)
-{
-        unsigned ptr = RDATALEN_LEN;
-        // priority (length 2 octets unsigned short)
-        printf("%u ", ntohs( PACKET_2_SHORT(data + ptr) ));
-        ptr += 2;
-
-        // weight (length 2 octets unsigned short)
-        printf("%u ", ntohs( PACKET_2_SHORT(data + ptr) ));
-        ptr += 2;
-
-        // port (length 2 octets unsigned short)
-        printf("%u ", ntohs( PACKET_2_SHORT(data + ptr) ));
-        ptr += 2;
-
-        handleRRName(data + ptr, dataWOptr, bufferPtr, currLen, maxLen);
-}
-
-/**
- * @brief Handles correct printing of SOA packets
- * @param data Byte array containing raw packet, must start at RDATA
- * @param type Sign if A or AAAA type is detected (this will be IP address)
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
- */
-void handleSOA(packet_t data, packet_t dataWOptr, Buffer* bufferPtr, size_t currLen, size_t maxLen)
-{
-    // primary name server
-    unsigned ptr = RDATALEN_LEN; 
-    ptr += handleRRName(data + ptr, dataWOptr, bufferPtr, currLen, maxLen);
-    // responsible authority mailbox
-    ptr += handleRRName(data + ptr, dataWOptr, bufferPtr, currLen, maxLen);
-
-    // serial number (length 4 octets = unsigned int)
-    printf("%u ", ntohl( PACKET_2_UINT(data + ptr) ));
-    ptr += 4;
-
-    // refresh interval (length 4 octets = unsigned int)
-    printf("%u ", ntohl( PACKET_2_UINT(data + ptr) ));
-    ptr += 4;
-
-    // retry interval (length 4 octets = unsigned int)
-    printf("%u ", ntohl( PACKET_2_UINT(data + ptr) ));
-    ptr += 4;
-
-    // expire interval (length 4 octets = unsigned int)
-    printf("%u ", ntohl( PACKET_2_UINT(data + ptr) ));
-    ptr += 4;
-
-    // minimum ttl (length 4 octets = unsigned int)
-    printf("%u ", ntohl( PACKET_2_UINT(data + ptr) ));
-    ptr += 4;
-}
 
 /**
- * @brief Prints Time To Live onto standard output
+ * @brief Prints name of Resource Record Type from registry onto output
  * 
- * @param data Byte array containing raw packet starting at TTL position
+ * @param type Type of record
+ * @param output Stream where type is printed, NULL if type should not be 
+ * printed
+ * @return int Returns detected type, RRType_UNKNOWN for unknown type
  */
-void handleRRTTL(packet_t data)
+int handleRRType(unsigned type, FILE* output)
 {
-    printf(" %lu", (unsigned long)ntohl(((unsigned long*)(data))[0]));
-}
-
+    const char* name = rrTypeFind(type)->name;
+    if(name == NULL)
+        return RRType_UNKNOWN;
 
-/**
- * @brief Prints Resource Record Type onto standard ouput 
- * 
- * @param data Byte array containing raw packet starting at Type position
- * @param print if set to true prints type
- * @return int Returns detected type
- */
-int handleRRType(packet_t data, bool print)
-{
-    switch (ntohs( PACKET_2_SHORT(data) ))
+    if(output != NULL)
     {
-        case RRType_A:      if(print) { printf("A "); }
-            return RRType_A;
-            break;
-        case RRType_AAAA:   if(print) {  printf("AAAA "); }
-            return RRType_AAAA;
-            break; 
-        case RRType_NS:     if(print) { printf("NS "); }
-            return RRType_NS;
-            break; 
-        case RRType_MX:     if(print) { printf("MX "); }
-            return RRType_MX;
-            break; 
-        case RRType_SOA:    if(print) { printf("SOA "); }
-            return RRType_SOA;
-            break; 
-        case RRType_CNAME:  if(print) { printf("CNAME "); }
-            return RRType_CNAME;
-            break; 
-        case RRType_SRV:    if(print) { printf("SRV "); }
-            return RRType_SRV;
-            break; 
+        fputs(name, output);
+        fputc(' ', output);
     }
 
-    return RRType_UNKNOWN;
+    return type;
 }
 
 
 /**
- * @brief Prints Resource Record Class onto standard ouput 
+ * @brief Prints Resource Record Class onto output
  * 
- * @param data Byte array containing raw packet starting at Class position
+ * @param rrClass Class of record
+ * @param output Stream where class is printed
  * @return int Returns detected class
  */
-int handleRRClass(packet_t data)
+int handleRRClass(unsigned rrClass, FILE* output)
 {
-    switch (ntohs( PACKET_2_SHORT(data) ))
+    switch (rrClass)
     {
-        case RRClass_IN: printf(" IN ");
+        case RRClass_IN: fprintf(output, " IN ");
             return RRClass_IN;
             break;
         default: return RRType_UNKNOWN;
@@ -570,45 +594,58 @@ int handleRRClass(packet_t data)
 }
 
 
+// ----------------------------------------------------------------------------
+// IPv4 and IPv6
+// ----------------------------------------------------------------------------
+
 /**
- * @brief Dissector of IPv4 protocol
+ * @brief Formats transport protocol and src and dst port
  * 
- * @param protocol Protocol to be dissected
- * @param packet Pointer to the packet
- * @param length Maximum length that you can read
+ * @param info Network and transport information of the packet
+ * @param out Where text is written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void ipv4ProtocolDissector(unsigned char protocol, packet_t packet, size_t length)
+size_t portDissector(PacketInfo* info, char* out)
 {
-    if(length){}
-    switch (protocol)
-    {
-    case IPv4_PROTOCOL_UDP:;
-        struct udphdr* udp = (struct udphdr*) packet;
-        printf("SrcPort: UDP/%u\n", ntohs(udp->uh_sport)); 
-        printf("DstPort: UDP/%u\n", ntohs(udp->uh_dport)); 
-        break;    
-    default:
-        errHandling("Unknown transport layer protocol", 9/*TODO:*/);
-        break;
-    }
-}
+    char* ptr = out;
 
+    ptr += FORMAT_LITERAL(ptr, "SrcPort: ");
+    ptr += (info->transport == IPPROTO_TCP)? FORMAT_LITERAL(ptr, "TCP/") : FORMAT_LITERAL(ptr, "UDP/");
+    ptr += formatU32(ptr, info->srcPort);
+    ptr += FORMAT_LITERAL(ptr, "\nDstPort: ");
+    ptr += (info->transport == IPPROTO_TCP)? FORMAT_LITERAL(ptr, "TCP/") : FORMAT_LITERAL(ptr, "UDP/");
+    ptr += formatU32(ptr, info->dstPort);
+    *ptr++ = '\n';
+
+    return ptr - out;
+}
 
-// ----------------------------------------------------------------------------
-// IPv4 and IPv6
-// ----------------------------------------------------------------------------
 
 /**
- * @brief Prints UDP information like src and dst port
+ * @brief Formats source and destination address of IPv4 or IPv6 packet
  * 
- * @param packet Byte array containing raw packet data with offset to udp header 
+ * @param src Formatted source address
+ * @param srcLen Length of source address
+ * @param dst Formatted destination address
+ * @param dstLen Length of destination address
+ * @param verbose Setting if information display is should be detailed or not
+ * @param out Where text is written
+ * @return size_t Number of written characters
  */
-void udpDissector(packet_t packet)
+size_t addressDissector(const char* src, size_t srcLen, const char* dst, size_t dstLen,
+                        bool verbose, char* out)
 {
-    struct udphdr* udp = (struct udphdr*) packet; 
+    char* ptr = out;
 
-    printf("SrcPort: UDP/%hu\n", ntohs(udp->source));
-    printf("DstPort: UDP/%hu\n", ntohs(udp->dest));
+    ptr += verbose? FORMAT_LITERAL(ptr, "SrcIP: ") : FORMAT_LITERAL(ptr, " ");
+    memcpy(ptr, src, srcLen);
+    ptr += srcLen;
+    ptr += verbose? FORMAT_LITERAL(ptr, "\nDstIP: ") : FORMAT_LITERAL(ptr, " -> ");
+    memcpy(ptr, dst, dstLen);
+    ptr += dstLen;
+    *ptr++ = verbose? '\n' : ' ';
+
+    return ptr - out;
 }
 
 
@@ -617,99 +654,39 @@ void udpDissector(packet_t packet)
  * 
  * @param packet Pointer to the packet, must start at Internet Protocol
  * @param verbose Setting if information display is should be detailed or not
+ * @param out Where addresses are written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void ipv4Dissector(packet_t packet, bool verbose)
+size_t ipv4Dissector(packet_t packet, bool verbose, char* out)
 {
     struct iphdr* ipv4 = (struct iphdr*) packet;
 
-    if(verbose)
-    {
-        printf("SrcIP: ");
-        printIPv4(ipv4->saddr, NULL);
-        printf("\n");
+    char src[FORMAT_IPV4_MAX_LEN];
+    char dst[FORMAT_IPV4_MAX_LEN];
+    size_t srcLen = formatIPv4(src, (const unsigned char*) &(ipv4->saddr));
+    size_t dstLen = formatIPv4(dst, (const unsigned char*) &(ipv4->daddr));
 
-        printf("DstIP: ");
-        printIPv4(ipv4->daddr, NULL);
-        printf("\n");
-    }
-    else
-    {
-        printf(" ");
-        printIPv4(ipv4->saddr, NULL);
-        printf(" -> ");
-        printIPv4(ipv4->daddr, NULL);
-        printf(" ");
-    }
+    return addressDissector(src, srcLen, dst, dstLen, verbose, out);
 }
 
 
 /**
- * @brief Prints IPv4 address in correct endian
+ * @brief Prints IPv4 address
  * 
- * @param address IPv4 address
+ * @param address IPv4 address in network byte order
  * @param bufferPtr Buffer to which will the IPv4 address stored, if NULL 
- * address will be printed onto stdout
+ * address will be printed onto output
+ * @param output Stream used when bufferPtr is NULL
  */
-void printIPv4(u_int32_t address, Buffer* bufferPtr)
+void printIPv4(u_int32_t address, Buffer* bufferPtr, FILE* output)
 {
-    u_int32_t addressCorrected = ntohl(address);
-
+    char text[FORMAT_IPV4_MAX_LEN];
+    size_t len = formatIPv4(text, (const unsigned char*) &address);
 
     if(bufferPtr == NULL)
-    {
-        for(short i = 24 ; i >= 0 ; i -= 8)
-        {
-            printf("%hu", ((unsigned short)((addressCorrected >> i) & 0xFF)));
-
-            if(i != 0)
-            {
-                printf(".");
-            }
-        }
-
-        return;
-    }
-
-    unsigned char number = 0;
-    short unsigned int hundreds = 0;
-    short unsigned int tens = 0;
-    short unsigned int ones = 0;
-
-    char tmp[4] = {0};
-    for(short i = 24 ; i >= 0 ; i -= 8)
-    {
-        // break numerical value into printable chars
-        number = (addressCorrected >> i) & 0xFF;
-        hundreds = (int) number/100;
-        tens = (int) (number%100) / 10;
-        ones = (int) ((number%100) % 10);
-
-        number = 0; // reuse number for digit counting
-        if(hundreds > 0)
-        {
-            tmp[number] = '0' + hundreds;
-            number++;
-        }
-
-        if(tens > 0 || number > 0)
-        {
-            tmp[number] = '0' + tens;
-            number++;
-        }
-            
-        tmp[number] = '0' + ones;
-        number++;
-        
-        tmp[number] = 0;
-
-        bufferAddString(bufferPtr, tmp);
-
-        if(i != 0)
-        {
-            bufferAddChar(bufferPtr, '.');
-        }
-    }
-
+        fwrite(text, 1, len, output);
+    else
+        bufferAddBytes(bufferPtr, text, len);
 }
 
 
@@ -718,50 +695,37 @@ void printIPv4(u_int32_t address, Buffer* bufferPtr)
  * 
  * @param packet Pointer to the packet, must start at Internet Protocol
  * @param verbose Setting if information display is should be detailed or not
- * @return unsigned char Pointer where IP protocol ends, and protocol stars
+ * @param out Where addresses are written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void ipv6Dissector(packet_t packet, bool verbose)
+size_t ipv6Dissector(packet_t packet, bool verbose, char* out)
 {
     struct ip6_hdr* ipv6 = (struct ip6_hdr*) packet;
 
-    if(verbose)
-    {
-        printf("SrcIP: ");
-        printIPv6(ipv6->ip6_src.__in6_u.__u6_addr32, NULL);
-        printf("\n");
+    char src[FORMAT_IPV6_MAX_LEN];
+    char dst[FORMAT_IPV6_MAX_LEN];
+    size_t srcLen = formatIPv6(src, ipv6->ip6_src.s6_addr);
+    size_t dstLen = formatIPv6(dst, ipv6->ip6_dst.s6_addr);
 
-        printf("DstIP: ");
-        printIPv6(ipv6->ip6_dst.__in6_u.__u6_addr32, NULL);
-        printf("\n");
-    }
-    else
-    {
-        printf(" ");
-        printIPv6(ipv6->ip6_src.__in6_u.__u6_addr32, NULL);
-        printf(" -> ");
-        printIPv6(ipv6->ip6_dst.__in6_u.__u6_addr32, NULL);
-        printf(" ");
-    }
+    return addressDissector(src, srcLen, dst, dstLen, verbose, out);
 }
 
 /**
- * @brief Prints IPv6 address in correct system endian
+ * @brief Prints IPv6 address
  * 
- * @param address Pointer to u_int32_t[4] containing IPv6 address
+ * @param address Pointer to u_int32_t[4] containing IPv6 address in network
+ * byte order
  * @param bufferPtr Pointer to Buffer where IPv6 will be stored, if NULL
- * stdout will be used instead
+ * output will be used instead
+ * @param output Stream used when bufferPtr is NULL
  */
-void printIPv6(u_int32_t* address, Buffer* bufferPtr)
+void printIPv6(u_int32_t* address, Buffer* bufferPtr, FILE* output)
 {
-    char buffer[40];
-    inet_ntop(AF_INET6, address, buffer, 40);
-    
+    char text[FORMAT_IPV6_MAX_LEN];
+    size_t len = formatIPv6(text, (const unsigned char*) address);
+
     if(bufferPtr == NULL)
-    {
-        printf("%s", buffer);
-    }
+        fwrite(text, 1, len, output);
     else
-    {
-        bufferAddString(bufferPtr, buffer);
-    }
+        bufferAddBytes(bufferPtr, text, len);
 }
@@ -26,14 +26,20 @@
 #include "buffer.h"
 #include "programConfig.h"
 #include "outputHandler.h"
+#include "tcpReassembly.h"
+#include "ipReassembly.h"
+#include "frameDecoder.h"
+#include "dnsMessage.h"
+#include "rrRegistry.h"
+#include "nameNormalize.h"
+#include "textFormat.h"
 
 // ----------------------------------------------------------------------------
 //  Structures, enums and defines
 // ----------------------------------------------------------------------------
 
 #define ETHERNET_ADDR_LEN 6
-#define ETH_TYPE_IPV6 0x86DD
-#define ETH_TYPE_IPV4 0x0800
+#define DISSECT_TEXT_LEN 512     // formatted header of one message
 
 #define QR 0x8000       // 1000 0000 0000 0000
 #define OPCODE 0x7800   // 0111 1000 0000 0000
@@ -44,43 +50,17 @@
 #define _Z 0x0070       // 0000 0000 0111 0000
 #define RCODE 0x000f    // 0000 0000 0000 1111
 
-#define RRType_A 0x0001
-#define RRType_AAAA 0x001c
-#define RRType_NS 0x0002
-#define RRType_MX 0x000f
-#define RRType_SOA 0x0006
-#define RRType_CNAME 0x0005
-#define RRType_SRV 0x0021
-#define RRType_UNKNOWN 0x0000
-
-#define RRClass_IN 0x0001
-#define RRClass_UNKNOWN 0x0000
-
-#define TTL_LEN 4
-#define CLASS_LEN 2
-#define TYPE_LEN 2
-#define MX_PREFERENCE_LEN 2
-#define RDATALEN_LEN 2
-
 typedef const unsigned char* packet_t;
 
 #define IS_IP() (type == RRType_A || type == RRType_AAAA)
 
-#define LEN_CHECK(var)                  \
-    if(maxLen < ptr + var)              \
-    {                                   \
-        errHandling("Received packet is not long enough, probably malfunctioned packet", ERR_BAD_PACKET); \
-    }
-
 #define IF_VERBOSE if(config->verbose)
 
 #define IF_VERBOSE_AND_VALID if(config->verbose && valid)
 
-#define STORE_DOMAIN(arg) if(config->domainsFile->data != NULL && (type == RRType_A || type == RRType_AAAA || type == RRType_NS)) {arg;} 
+#define STORE_DOMAIN(arg) if(config->domainsFile->data != NULL && (info->flags & RR_STORE_DOMAIN)) {arg;} 
 
-#define STORE_TRANSLATIONS(arg) if(config->domainsFile->data != NULL && ((type == RRType_A || type == RRType_AAAA))) {arg;} 
-
-#define PACKET_2_SHORT(packet) ((unsigned short*)(packet))[0]
+#define STORE_TRANSLATIONS(arg) if(config->domainsFile->data != NULL && (info->flags & RR_STORE_TRANSLATION)) {arg;} 
 
 #define PACKET_2_UINT(packet) ((unsigned*)(packet))[0]
 
@@ -95,196 +75,227 @@ typedef struct EthernetHeader
     unsigned char etherType[2];
 } EthernetHeader; 
 
-typedef struct DNSHeader
+/**
+ * @brief Network and transport layer information of received packet that 
+ * is needed to print DNS messages carried by it
+ */
+typedef struct PacketInfo
 {
-    unsigned short transactionID;
-    unsigned short flags;
-    unsigned short noQuestions;
-    unsigned short noAnswers;
-    unsigned short noAuthority;
-    unsigned short noAdditional;
-} DNSHeader;
+    const char* timestamp;
+    time_t seconds;
+
+    unsigned short etherType;
+    packet_t network;
 
-#define IPv4_PROTOCOL_UDP 0x11
+    unsigned char transport;
+    unsigned short srcPort;
+    unsigned short dstPort;
+} PacketInfo;
 
 // ----------------------------------------------------------------------------
 //  Functions
 // ----------------------------------------------------------------------------
 
 /**
- * @brief Dissects frame into correct segments and prints relevant info
+ * @brief Dissects frame into correct segments and prints every DNS message 
+ * carried by it (TCP segment can complete zero or more messages, IP 
+ * fragment is printed when it completes its datagram)
  * 
  * @param packet Byte array containing raw packet data
- * @param length Length of the packet
+ * @param length Captured length of the packet
+ * @param ts Time when packet was captured
+ * @param timestamp Already formatted timestamp of the packet
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why (part of) packet was skipped
  */
-void frameDissector(packet_t packet, size_t length, Config* config);
-
-
-// ----------------------------------------------------------------------------
-// IPv4 and IPv6
-// ----------------------------------------------------------------------------
+DissectError frameDissector(packet_t packet, size_t length, struct timeval ts,
+                    const char* timestamp, Config* config);
 
 /**
- * @brief Prints DNS information, transaction id/identifier and flags
+ * @brief Dissects frame whose link and network layers were already decoded
+ * by frameDecode() (batch classifies all its packets before dissecting them)
+ * and prints every DNS message carried by it
  * 
  * @param packet Byte array containing raw packet data
+ * @param length Captured length of the packet
+ * @param decoded Result of frameDecode()
+ * @param frame Decoded link and network layers of the packet
+ * @param ts Time when packet was captured
+ * @param timestamp Already formatted timestamp of the packet
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why (part of) packet was skipped
  */
-void dnsDissector(packet_t packet);
+DissectError decodedFrameDissector(packet_t packet, size_t length, DecodeResult decoded,
+                    const DecodedFrame* frame, struct timeval ts, const char* timestamp,
+                    Config* config);
 
 /**
- * @brief Prints DNS information 
+ * @brief Dissects UDP or TCP part of the packet and prints every DNS 
+ * message carried by it. Capture filter passes also fragments and IPv6 
+ * packets with extension headers, so ports are checked here.
  * 
- * @param packet Byte array containing raw packet, must start at RDATA
+ * @param info Network information of the packet, transport information is
+ * filled in
+ * @param key Flow key with addresses filled in, ports are filled in for TCP
+ * @param segment Start of transport header
+ * @param length Length of transport header and data
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return DissectError DISSECT_OK or reason why (part of) packet was skipped
  */
-void verboseDNSDissector(packet_t packet);
+DissectError transportDissector(PacketInfo* info, TcpFlowKey* key, packet_t segment,
+                        size_t length, Config* config);
 
 /**
- * @brief Dissects DNS packet into parts and prints relevant information
+ * @brief Prints one DNS message together with addresses and ports of packet
+ * that carried it
  * 
- * @param packet Packet to be dissected, must be at a start of DNS part of the packet
+ * @param info Network and transport information of the packet
+ * @param dns Start of DNS message
+ * @param length Length of DNS message
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
- * @param maxLen Maximum allowed length of packet
+ * @return DissectError DISSECT_OK or reason why message was skipped
  */
-void rrDissector(packet_t packet, Config* config, size_t maxLen);
+DissectError dnsMessageDissector(PacketInfo* info, packet_t dns, size_t length, Config* config);
 
 /**
- * @brief Checks if new query contains supported type of class
+ * @brief Returns parts of DNS messages that are printed, stored into lists
+ * or counted with current program arguments, dissection of message stops 
+ * after them
  * 
- * @param data Byte array containing raw packet data starting at Type section 
- * DNS message
- * @return true Is valid/known message type/class
- * @return false Is not valid/known message type/class
+ * @param config Pointer to the Config structure with handled arguments
+ * @return unsigned DNS_NEED_* flags
  */
-bool isValidTypeOrClass(packet_t data);
+unsigned dissectorNeeds(const Config* config);
 
-/**
- * @brief Stores correct domain name into Buffer
- * 
- * @param data Byte array containing raw packet, must start at RDATA
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param addr2Print Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
- * @return int Return length of NAME segment
- */
-unsigned handleRRName(packet_t data, packet_t dataWOptr, 
-                        Buffer* addr2Print, size_t currLen, size_t maxLen);
 
+// ----------------------------------------------------------------------------
+// IPv4 and IPv6
+// ----------------------------------------------------------------------------
 
 /**
- * @brief Stores correct IP address or domain name into Buffer
+ * @brief Formats DNS information in non-verbose mode
  * 
- * @param data Byte array containing raw packet, must start at RDATA
- * @param type Sign if A or AAAA type is detected (this will be IP address)
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
- * @param config Pointer to the Config structure
- * @return int Return length of RDATA segment
+ * @param message Parsed DNS message
+ * @param out Where text is written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-int handleRRRData(packet_t data, unsigned type, 
-                    packet_t dataWOptr, Buffer* bufferPtr, 
-                    size_t currLen, size_t maxLen, Config* config);
+size_t dnsDissector(const DnsMessage* message, char* out);
 
 /**
- * @brief Handles correct printing of SRV packets
- * @param data Byte array containing raw packet, must start at RDATA
- * @param type Sign if A or AAAA type is detected (this will be IP address)
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
+ * @brief Formats DNS information 
+ * 
+ * @param message Parsed DNS message
+ * @param out Where text is written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void handleSRV(packet_t data, packet_t dataWOptr, Buffer* bufferPtr, size_t currLen, size_t maxLen);
+size_t verboseDNSDissector(const DnsMessage* message, char* out);
 
 /**
- * @brief Handles correct printing of SOA packets
+ * @brief Prints resource record and stores its names and addresses into 
+ * lists, owner name and RDATA are decoded only when they are printed or
+ * stored
  * 
- * @param data Byte array containing raw packet, must start at RDATA
- * @param type Sign if A or AAAA type is detected (this will be IP address)
- * @param dataWOptr Byte array that starts at DNS part of packet (without offset to RDATA)
- * @param bufferPtr Buffer to which characters will be stored into
- * @param currLen Current length of packet
- * @param maxLen Maximum allowed length of packet
+ * @param message Parsed DNS message
+ * @param record Resource record
+ * @param config Pointer to the Config structure
+ * @param valid Record has supported type and class and is printed
  */
-void handleSOA(packet_t data, packet_t dataWOptr, Buffer* bufferPtr, size_t currLen, size_t maxLen);
+void handleSectionContent(const DnsMessage* message, const DnsRecord* record, 
+                        Config* config, bool valid);
 
 /**
- * @brief Prints Time To Live onto standard output
+ * @brief Prints question and all resource records of message and stores 
+ * their domain names and translations into lists
  * 
- * @param data yte array containing raw packet starting at TTL position
+ * @param message Message parsed by dnsMessageParse()
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
  */
-void handleRRTTL(packet_t data);
+void rrDissector(DnsMessage* message, Config* config);
 
 /**
- * @brief Prints Resource Record Type onto standard ouput 
+ * @brief Prints Time To Live onto output
  * 
- * @param data Byte array containing raw packet starting at Type position
- * @param print if set to true prints type
- * @return int Returns detected type
+ * @param ttl Time To Live of record
+ * @param output Stream where TTL is printed
  */
-int handleRRType(packet_t data, bool print);
+void handleRRTTL(uint32_t ttl, FILE* output);
 
 /**
- * @brief Prints Resource Record Class onto standard ouput 
+ * @brief Prints name of Resource Record Type from registry onto output
  * 
- * @param data Byte array containing raw packet starting at Class position
- * @return int Returns detected class
+ * @param type Type of record
+ * @param output Stream where type is printed, NULL if type should not be 
+ * printed
+ * @return int Returns detected type, RRType_UNKNOWN for unknown type
  */
-int handleRRClass(packet_t data);
+int handleRRType(unsigned type, FILE* output);
 
 /**
- * @brief Dissector of IPv4 protocol
+ * @brief Prints Resource Record Class onto output
  * 
- * @param protocol Protocol to be dissected
- * @param packet Pointer to the packet
- * @param length Maximum length that you can read
+ * @param rrClass Class of record
+ * @param output Stream where class is printed
+ * @return int Returns detected class
  */
-void ipv4ProtocolDissector(unsigned char protocol, packet_t packet, size_t length);
+int handleRRClass(unsigned rrClass, FILE* output);
 
 // ----------------------------------------------------------------------------
 // IPv4 and IPv6
 // ----------------------------------------------------------------------------
 
 /**
- * @brief Prints UDP information like src and dst port
+ * @brief Formats transport protocol and src and dst port
  * 
- * @param packet Byte array containing raw packet data with offset to udp header 
+ * @param info Network and transport information of the packet
+ * @param out Where text is written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void udpDissector(packet_t packet);
+size_t portDissector(PacketInfo* info, char* out);
 
 /**
  * @brief Dissects IPv4 protocol 
  * 
  * @param packet Pointer to the packet, must start at Internet Protocol
+ * @param verbose Setting if information display is should be detailed or not
+ * @param out Where addresses are written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void ipv4Dissector(packet_t packet, bool verbose);
+size_t ipv4Dissector(packet_t packet, bool verbose, char* out);
 
 /**
- * @brief Prints IPv4 address in correct endian
+ * @brief Prints IPv4 address
  * 
- * @param address IPv4 address
- * @param addr2Print buffer to which will the IPv4 address stored, if NULL 
- * address will be printed onto stdout
+ * @param address IPv4 address in network byte order
+ * @param bufferPtr Buffer to which will the IPv4 address stored, if NULL 
+ * address will be printed onto output
+ * @param output Stream used when bufferPtr is NULL
  */
-void printIPv4(u_int32_t address, Buffer* addr2Print);
+void printIPv4(u_int32_t address, Buffer* bufferPtr, FILE* output);
 
 /**
  * @brief Dissects IPv6 protocol 
  * 
  * @param packet Pointer to the packet, must start at Internet Protocol
+ * @param verbose Setting if information display is should be detailed or not
+ * @param out Where addresses are written, at least DISSECT_TEXT_LEN / 4 bytes
+ * @return size_t Number of written characters
  */
-void ipv6Dissector(packet_t packet, bool verbose);
+size_t ipv6Dissector(packet_t packet, bool verbose, char* out);
 
 /**
- * @brief Prints IPv6 address in correct system endian
+ * @brief Prints IPv6 address
  * 
- * @param address pointer to u_int32_t[4]   
+ * @param address Pointer to u_int32_t[4] containing IPv6 address in network
+ * byte order
+ * @param bufferPtr Pointer to Buffer where IPv6 will be stored, if NULL
+ * output will be used instead
+ * @param output Stream used when bufferPtr is NULL
  */
-void printIPv6(u_int32_t* address, Buffer* addr2Print);
+void printIPv6(u_int32_t* address, Buffer* bufferPtr, FILE* output);
 
-#endif /*PACKET_DISSECTOR_H*/
\ No newline at end of file
+#endif /*PACKET_DISSECTOR_H*/
@@ -44,14 +44,38 @@
  */
 pcap_t* pcapOfflineSetup(Config* config)
 {
-    // open file for reading captured packets
-    config->cleanup.pcapFile = fopen(config->pcapFileName->data, "r");
+    // regular pcap/pcapng files are mapped into memory and read natively,
+    // libpcap handle is then used only for filter compilation
+    config->cleanup.captureFile = captureFileOpen(config->pcapFileName->data, 
+        config->cleanup.pcapErrbuff);
 
+    if(config->cleanup.captureFile != NULL)
+    {
+        return pcap_open_dead(config->cleanup.captureFile->linkType, 
+            config->cleanup.captureFile->snaplen);
+    }
+
+    // compressed files are decompressed by own thread while libpcap parses
+    // them, pipes and formats unknown to captureFile are left to libpcap
+    config->cleanup.pcapFile = decompressOpen(config->pcapFileName->data);
     if(config->cleanup.pcapFile == NULL)
-        errHandling("Couldn't open file for reading captured packets", ERR_FILE);
+        config->cleanup.pcapFile = fopen(config->pcapFileName->data, "r");
+
+    if(config->cleanup.pcapFile == NULL)
+    {
+        snprintf(config->cleanup.pcapErrbuff, PCAP_ERRBUF_SIZE, "%s", strerror(errno));
+        return NULL;
+    }
 
     // return pcap handle
-    return pcap_fopen_offline(config->cleanup.pcapFile, config->cleanup.pcapErrbuff);
+    pcap_t* handle = pcap_fopen_offline(config->cleanup.pcapFile, config->cleanup.pcapErrbuff);
+    if(handle == NULL)
+    {
+        fclose(config->cleanup.pcapFile);
+        config->cleanup.pcapFile = NULL;
+    }
+
+    return handle;
 }
 
 /**
@@ -104,11 +128,51 @@ void findDevices(Config* config, pcap_if_t** allDevices)
     }
 }
 
+/**
+ * @brief Creates and activates live handle on interface with capture settings
+ * from config
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface
+ * @return pcap_t* Activated handle or NULL, error message is stored in 
+ * config->cleanup.pcapErrbuff
+ */
+pcap_t* pcapCreateLive(Config* config, const char* name)
+{
+    pcap_t* handle = pcap_create(name, config->cleanup.pcapErrbuff);
+    if(handle == NULL)
+        return NULL;
+
+    // same as pcap_open_live(), but with values from config
+    pcap_set_snaplen(handle, config->snaplen);
+    pcap_set_promisc(handle, true);
+    pcap_set_timeout(handle, config->timeout);
+    pcap_set_immediate_mode(handle, config->immediateMode);
+    if(config->bufferSize > 0)
+        pcap_set_buffer_size(handle, config->bufferSize);
+
+    int res = pcap_activate(handle);
+    if(res < 0)
+    {
+        snprintf(config->cleanup.pcapErrbuff, PCAP_ERRBUF_SIZE, "%s: %s",
+            pcap_statustostr(res), pcap_geterr(handle));
+        pcap_close(handle);
+        return NULL;
+    }
+
+    if(res > 0)
+        fprintf(stderr, "WARNING: %s: %s\n", pcap_statustostr(res), pcap_geterr(handle));
+
+    return handle;
+}
+
 /**
  * @brief Opens online network interface from which a data traffic will be read
  * 
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface
  * @param allDevices Pointer to the pointer containing all devices
  * @return pcap_t* Returns handle to which is applied filter and then used for
  * reading captured data
@@ -116,7 +180,8 @@ void findDevices(Config* config, pcap_if_t** allDevices)
  * @author Tim Carstens
  * Source: https://www.tcpdump.org/pcap.html
  */
-pcap_t* pcapOnlineSetup(Config* config, pcap_if_t** allDevices, pcap_if_t** device)
+pcap_t* pcapOnlineSetup(Config* config, const char* name, pcap_if_t** allDevices, 
+                        pcap_if_t** device)
 {   
     // Get all devices
     findDevices(config, allDevices);
@@ -125,7 +190,7 @@ pcap_t* pcapOnlineSetup(Config* config, pcap_if_t** allDevices, pcap_if_t** devi
     *device = *allDevices;
 
     // find correct device from list, based on its name, jump out of while if found match
-    while(strcmp((*device)->name, config->interface->data) != 0)
+    while(strcmp((*device)->name, name) != 0)
     {
         if((*device)->next != NULL)
         {
@@ -134,31 +199,121 @@ pcap_t* pcapOnlineSetup(Config* config, pcap_if_t** allDevices, pcap_if_t** devi
         else
         {
             pcap_freealldevs(*allDevices);
+            *allDevices = NULL;
 
             // if end of list found, end with error
-            fprintf(stderr, "ERR: %s was not found\n", config->interface->data);
+            fprintf(stderr, "ERR: %s was not found\n", name);
             errHandling("", ERR_LIBPCAP);
         }
     }
 
-    // return pcap handle
-    return pcap_open_live((*device)->name, BUFSIZ, true, 1000, config->cleanup.pcapErrbuff);
+    return pcapCreateLive(config, (*device)->name);
 }
 
 
 /**
- * @brief Setups PCAP library to correctly capture traffic and set filters to 
- * accept only relevant internet traffic. 
+ * @brief Compiles filter expression that accepts only relevant internet 
+ * traffic
+ * 
+ * @param handle PCAP handle for which will be filter compiled
+ * @param fp Pointer to the structure where compiled filter will be stored,
+ * fp->bf_insns must be freed by caller
+ * @param net IP address of sniffing device, for offline can be set to zero
+ * 
+ * @author Tim Carstens
+ * Source: https://www.tcpdump.org/pcap.html
+ */
+void pcapCompileFilter(pcap_t* handle, struct bpf_program* fp, bpf_u_int32 net)
+{
+    // Creating a filter to only look for certain traffic
+    // Filter expression
+    Buffer expr;
+    bufferInit(&expr);
+    // fragments after the first one carry no ports and BPF can not walk 
+    // IPv6 extension headers, such packets are passed to user space and 
+    // matched there (after reassembly)
+    char* dns = "((udp || tcp) && (port 53 || ip[6:2] & 0x1fff != 0)) || "
+        "(ip6 && (ip6[6] == 0 || ip6[6] == 43 || ip6[6] == 44 || ip6[6] == 51 || ip6[6] == 60))";
+    bufferAddString(&expr, dns);
+
+    // tagged frames (802.1Q, QinQ) are matched with offsets moved by tags,
+    // libpcap supports "vlan" only on Ethernet
+    if(pcap_datalink(handle) == DLT_EN10MB)
+    {
+        bufferAddString(&expr, " || (vlan && (");
+        bufferAddString(&expr, dns);
+        bufferAddString(&expr, ")) || (vlan && vlan && (");
+        bufferAddString(&expr, dns);
+        bufferAddString(&expr, "))");
+    }
+    bufferAddChar(&expr, 0);
+
+    // Compile the filter
+    if(pcap_compile(handle, fp, expr.data, 0, net) == PCAP_ERROR)
+    {
+        fprintf(stderr, "ERR: Couldn't parse filter %s: %s\n", expr.data, pcap_geterr(handle));
+        bufferDestroy(&expr);
+        errHandling("", ERR_LIBPCAP);
+    }
+
+    bufferDestroy(&expr);
+}
+
+/**
+ * @brief Appends DNS level predicates from config to compiled filter, if 
+ * they can not be expressed in BPF user space check is used alone
  * 
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
- * @param allDevices Pointer to the pointer containing all devices
+ * @param fp Compiled filter
+ * @param linkType Datalink type of the capture
+ */
+void pcapAttachDnsFilter(Config* config, struct bpf_program* fp, int linkType)
+{
+    // warning is printed only once, reopened captures and workers are silent;
+    // workers attach filters concurrently, so flag is swapped atomically
+    static bool warned = false;
+
+    if(!dnsFilterAttach(&(config->dnsFilter), fp, linkType) &&
+        !__atomic_exchange_n(&warned, true, __ATOMIC_RELAXED))
+    {
+        fprintf(stderr, "WARNING: DNS filters can not be compiled into BPF, "
+            "packets are filtered in user space\n");
+    }
+}
+
+/**
+ * @brief Closes handle (and savefile) that pcapTryOpen() could not finish
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param handle Opened handle
+ */
+void pcapOpenFailed(Config* config, pcap_t* handle)
+{
+    // pcap_close() closes also config->cleanup.pcapFile
+    pcap_close(handle);
+    config->cleanup.pcapFile = NULL;
+
+    captureFileClose(config->cleanup.captureFile);
+    config->cleanup.captureFile = NULL;
+}
+
+/**
+ * @brief Opens savefile from config or given interface and sets filters to 
+ * accept only relevant internet traffic, failure is printed onto stderr but
+ * does not end the program (file workers skip files that can not be read)
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface, ignored in offline mode
  * @return pcap_t* PCAP handle for further working with/reading captured data
+ * or NULL, nothing stays opened
  * 
  * @author Tim Carstens
  * Source: https://www.tcpdump.org/pcap.html
  */
-pcap_t* pcapSetup(Config* config)
+pcap_t* pcapTryOpen(Config* config, const char* name)
 {
     pcap_t* handle;
     pcap_if_t* device = NULL;
@@ -168,19 +323,23 @@ pcap_t* pcapSetup(Config* config)
     if(config->captureMode == OFFLINE_MODE)
         handle = pcapOfflineSetup(config);
     else
-        handle = pcapOnlineSetup(config, allDevices, &device);
+        handle = pcapOnlineSetup(config, name, allDevices, &device);
 
     if(handle == NULL)
     {
-        fprintf(stderr, "ERR: Couldn't open device %s: %s\n", device->name, config->cleanup.pcapErrbuff);
-        errHandling("", ERR_LIBPCAP);
+        fprintf(stderr, "ERR: Couldn't open %s: %s\n", (device != NULL)? device->name : 
+            config->pcapFileName->data, config->cleanup.pcapErrbuff);
+        return NULL;
     }
     
-    // Check handle can work with ethernet (DLT_EN10MB)
-    if(pcap_datalink(handle) != DLT_EN10MB)
+    // Check handle provides link layer that dissector can decode
+    config->linkType = pcap_datalink(handle);
+    if(linkLayerFind(config->linkType) == NULL)
     {
-        fprintf(stderr, "ERR: Device %s doesn't provide Ethernet headers - not supported\n", device->name);
-        errHandling("", ERR_LIBPCAP);
+        fprintf(stderr, "ERR: Datalink %s is not supported\n", 
+            pcap_datalink_val_to_name(config->linkType));
+        pcapOpenFailed(config, handle);
+        return NULL;
     }
 
     bpf_u_int32 net = 0; // IP address of sniffing device, for offline can be set to zero
@@ -190,38 +349,428 @@ pcap_t* pcapSetup(Config* config)
         bpf_u_int32 mask; // The netmask of our sniffing device
         if(pcap_lookupnet(device->name, &net, &mask, config->cleanup.pcapErrbuff))
         {
-            net = 0;
-            mask = 0;
             fprintf(stderr, "ERR: Can't get netmask for device %s\n", device->name);
-            errHandling("", ERR_LIBPCAP);
+            pcapOpenFailed(config, handle);
+            return NULL;
         }
     }
 
-    // Creating a filter to only look for certain traffic
-    // Filter expression
-    Buffer expr;
-    bufferInit(&expr);
-    bufferAddString(&expr, "udp && port 53");
-    bufferAddChar(&expr, 0);
-
     struct bpf_program fp; // Stuct that holds compiled filter expression
 
-    // Compile the filter
-    if(pcap_compile(handle, &fp, expr.data, 0, net) == PCAP_ERROR)
+    pcapCompileFilter(handle, &fp, net);
+    pcapAttachDnsFilter(config, &fp, config->linkType);
+
+    // Set the filter
+    if(config->cleanup.captureFile != NULL)
+        captureFileSetFilter(config->cleanup.captureFile, &fp);
+    else if(pcap_setfilter(handle, &fp) == -1)
     {
-        fprintf(stderr, "ERR: Couldn't parse filter %s: %s\n", expr.data, pcap_geterr(handle));
+        fprintf(stderr, "ERR: Couldn't install filter: %s\n", pcap_geterr(handle));
+        free(fp.bf_insns);
+        pcapOpenFailed(config, handle);
+        return NULL;
+    }
+    
+    free(fp.bf_insns);
+
+    return handle;
+}
+
+/**
+ * @brief Opens savefile from config or given interface and sets filters to 
+ * accept only relevant internet traffic, on error program is exited
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface, ignored in offline mode
+ * @return pcap_t* PCAP handle for further working with/reading captured data
+ */
+pcap_t* pcapOpen(Config* config, const char* name)
+{
+    pcap_t* handle = pcapTryOpen(config, name);
+    if(handle == NULL)
+        errHandling("", ERR_LIBPCAP);
+
+    return handle;
+}
+
+/**
+ * @brief Setups PCAP library to correctly capture traffic and set filters to 
+ * accept only relevant internet traffic. 
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return pcap_t* PCAP handle for further working with/reading captured data
+ */
+pcap_t* pcapSetup(Config* config)
+{
+    return pcapOpen(config, config->interface->data);
+}
+
+/**
+ * @brief Opens non-blocking handle on every interface from config and 
+ * registers their descriptors into one epoll instance, index of handle in 
+ * config->cleanup.live is stored as event data
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ */
+void pcapLiveSetup(Config* config)
+{
+    config->cleanup.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(config->cleanup.epollFd < 0)
+    {
+        perror("ERR: epoll_create1");
         errHandling("", ERR_LIBPCAP);
     }
 
-    // Set the filter
-    if(pcap_setfilter(handle, &fp) == -1)
+    config->cleanup.live = (LiveHandle*) calloc(config->interfaceCount, sizeof(LiveHandle));
+    if(config->cleanup.live == NULL)
+        errHandling("Failed to allocate memory for live handles", ERR_MALLOC);
+
+    for(unsigned i = 0; i < config->interfaceCount; i++)
+    {
+        LiveHandle* live = &(config->cleanup.live[i]);
+        live->name = config->interfaces[i];
+        live->handle = pcapOpen(config, live->name);
+        live->linkType = config->linkType;
+        config->cleanup.liveCount++;
+
+        // every interface looks devices up again
+        pcap_freealldevs(config->cleanup.allDevices);
+        config->cleanup.allDevices = NULL;
+
+        if(pcap_setnonblock(live->handle, 1, config->cleanup.pcapErrbuff) == PCAP_ERROR)
+        {
+            fprintf(stderr, "ERR: Couldn't set %s non-blocking: %s\n", live->name,
+                config->cleanup.pcapErrbuff);
+            errHandling("", ERR_LIBPCAP);
+        }
+
+        int fd = pcap_get_selectable_fd(live->handle);
+        if(fd < 0)
+        {
+            fprintf(stderr, "ERR: Interface %s can not be polled\n", live->name);
+            errHandling("", ERR_LIBPCAP);
+        }
+
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        if(epoll_ctl(config->cleanup.epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            perror("ERR: epoll_ctl");
+            errHandling("", ERR_LIBPCAP);
+        }
+    }
+}
+
+/**
+ * @brief Opens TPACKET_V3 ring on network interface from config and attaches
+ * same filter as pcapSetup() would
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param fanoutGroup PACKET_FANOUT group id that ring joins, zero if ring 
+ * should not be part of any group
+ * @return RingCapture* Opened ring, on error program is exited
+ */
+RingCapture* pcapRingOpen(Config* config, unsigned fanoutGroup)
+{
+    // libpcap is used only as filter compiler, handle is not capturing; in
+    // TPACKET_V3 accept length of the filter is snapshot length of frames
+    pcap_t* dead = pcap_open_dead(DLT_EN10MB, config->snaplen);
+    if(dead == NULL)
+        errHandling("Failed to create pcap handle for filter compilation", ERR_LIBPCAP);
+
+    struct bpf_program fp;
+    pcapCompileFilter(dead, &fp, PCAP_NETMASK_UNKNOWN);
+    pcap_close(dead);
+    config->linkType = DLT_EN10MB;
+    pcapAttachDnsFilter(config, &fp, DLT_EN10MB);
+
+    // Config.interface shares union with tmpListEntry, that is overwritten
+    // by dissector, so name is read from list of interfaces (ring captures
+    // single interface)
+    RingCapture* ring = ringSetup(config->interfaces[0], config->ringBlockSize,
+        config->ringBlockCount, config->ringRetireTimeout, &fp, fanoutGroup, 
+        config->cleanup.pcapErrbuff);
+
+    free(fp.bf_insns);
+
+    return ring;
+}
+
+/**
+ * @brief Opens TPACKET_V3 ring on network interface from config and attaches
+ * same filter as pcapSetup() would
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param fanoutGroup PACKET_FANOUT group id that ring joins, zero if ring 
+ * should not be part of any group
+ * @return RingCapture* Opened ring, on error program is exited
+ */
+RingCapture* pcapRingSetup(Config* config, unsigned fanoutGroup)
+{
+    RingCapture* ring = pcapRingOpen(config, fanoutGroup);
+
+    if(ring == NULL)
     {
-        fprintf(stderr, "ERR: Couldn't install filter %s: %s\n", expr.data, pcap_geterr(handle));
+        fprintf(stderr, "ERR: Couldn't open ring on device %s: %s\n", 
+            config->interfaces[0], config->cleanup.pcapErrbuff);
         errHandling("", ERR_LIBPCAP);
     }
-    
+
+    return ring;
+}
+
+/**
+ * @brief Opens second live handle on interface that is already captured, with
+ * current settings from config and same filter; unlike pcapOpen() failure
+ * does not end the program
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface
+ * @param linkType Datalink type of the handle that is replaced
+ * @param nonBlocking Handle is polled by epoll loop
+ * @return pcap_t* New handle or NULL, error message is stored in 
+ * config->cleanup.pcapErrbuff
+ */
+pcap_t* pcapReopenHandle(Config* config, const char* name, int linkType, bool nonBlocking)
+{
+    char* errbuf = config->cleanup.pcapErrbuff;
+
+    pcap_t* handle = pcapCreateLive(config, name);
+    if(handle == NULL)
+        return NULL;
+
+    // dissector state (and epoll loop) expect same link layer
+    if(pcap_datalink(handle) != linkType)
+    {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "datalink changed");
+        pcap_close(handle);
+        return NULL;
+    }
+
+    bpf_u_int32 net, mask;
+    if(pcap_lookupnet(name, &net, &mask, errbuf))
+    {
+        pcap_close(handle);
+        return NULL;
+    }
+
+    // same expression as for current handle, so it compiles
+    struct bpf_program fp;
+    pcapCompileFilter(handle, &fp, net);
+    pcapAttachDnsFilter(config, &fp, linkType);
+
+    int res = pcap_setfilter(handle, &fp);
     free(fp.bf_insns);
-    bufferDestroy(&expr);
+
+    if(res == -1)
+    {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", pcap_geterr(handle));
+        pcap_close(handle);
+        return NULL;
+    }
+
+    if(nonBlocking && pcap_setnonblock(handle, 1, errbuf) == PCAP_ERROR)
+    {
+        pcap_close(handle);
+        return NULL;
+    }
 
     return handle;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Replaces handles of all interfaces of epoll loop by new ones, new 
+ * handles are opened and registered before old ones are closed
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return true Handles were replaced
+ * @return false Some handle couldn't be opened, old handles are still used
+ */
+bool pcapReopenLive(Config* config)
+{
+    unsigned count = config->cleanup.liveCount;
+    pcap_t** handles = (pcap_t**) calloc(count, sizeof(pcap_t*));
+    if(handles == NULL)
+        return false;
+
+    unsigned opened = 0;
+    for(; opened < count; opened++)
+    {
+        LiveHandle* live = &(config->cleanup.live[opened]);
+        handles[opened] = pcapReopenHandle(config, live->name, live->linkType, true);
+        if(handles[opened] == NULL)
+        {
+            fprintf(stderr, "WARNING: Couldn't reopen %s: %s\n", live->name,
+                config->cleanup.pcapErrbuff);
+            break;
+        }
+
+        // old descriptor stays registered until its handle is closed
+        int fd = pcap_get_selectable_fd(handles[opened]);
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = opened};
+        if(fd < 0 || epoll_ctl(config->cleanup.epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            fprintf(stderr, "WARNING: Couldn't poll reopened %s\n", live->name);
+            pcap_close(handles[opened]);
+            break;
+        }
+    }
+
+    // closing handle removes its descriptor from epoll instance
+    bool replaced = (opened == count);
+    for(unsigned i = 0; i < opened; i++)
+    {
+        if(replaced)
+        {
+            pcap_close(config->cleanup.live[i].handle);
+            config->cleanup.live[i].handle = handles[i];
+        }
+        else
+        {
+            pcap_close(handles[i]);
+        }
+    }
+
+    free(handles);
+    return replaced;
+}
+
+/**
+ * @brief Opens live libpcap handle again with current settings from config 
+ * (e.g. bigger buffer size) and replaces current handle by it, current 
+ * handle is closed only after new one was opened
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return true Handle was replaced
+ * @return false New handle couldn't be opened (e.g. buffer size was 
+ * refused), old handle is still used
+ */
+bool pcapReopen(Config* config)
+{
+    // kernel counters of old handles are lost
+    if(config->cleanup.live != NULL)
+        return pcapReopenLive(config);
+
+    // single interface, Config.interface is overwritten by dissector
+    pcap_t* handle = pcapReopenHandle(config, config->interfaces[0], config->linkType,
+                                        false);
+    if(handle == NULL)
+    {
+        fprintf(stderr, "WARNING: Couldn't reopen %s: %s\n", config->interfaces[0],
+            config->cleanup.pcapErrbuff);
+        return false;
+    }
+
+    pcap_close(config->cleanup.handle);
+    config->cleanup.handle = handle;
+
+    return true;
+}
+
+/**
+ * @brief Opens new ring with current settings from config and replaces old 
+ * one with it, kernel counters of old ring are kept
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return true Ring was replaced
+ * @return false New ring couldn't be opened, old ring is still used
+ */
+bool pcapRingReopen(Config* config)
+{
+    // new ring is opened before old one is closed, so packets arriving during
+    // reopen are captured by new ring; blocks old ring retired but looper did
+    // not read yet are unmapped with it, those packets are lost and kernel
+    // does not count them as drops
+    RingCapture* ring = pcapRingOpen(config, 0);
+    if(ring == NULL)
+    {
+        fprintf(stderr, "WARNING: Couldn't open ring on device %s: %s\n", 
+            config->interfaces[0], config->cleanup.pcapErrbuff);
+        return false;
+    }
+
+    ringUpdateStats(config->cleanup.ring);
+    ring->stats = config->cleanup.ring->stats;
+
+    ringDestroy(config->cleanup.ring);
+    config->cleanup.ring = ring;
+
+    return true;
+}
+/**
+ * @brief Reads next packet from capture opened by pcapSetup(), same as 
+ * pcap_next_ex()
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param header Pointer where pointer to packet header is stored
+ * @param data Pointer where pointer to packet data is stored
+ * @return int Same values as pcap_next_ex()
+ */
+int pcapNext(Config* config, struct pcap_pkthdr** header, const unsigned char** data)
+{
+    if(config->cleanup.captureFile != NULL)
+        return captureFileNext(config->cleanup.captureFile, header, data);
+
+    return pcap_next_ex(config->cleanup.handle, header, data);
+}
+
+/**
+ * @brief Processes packets from capture opened by pcapSetup(), same as 
+ * pcap_dispatch()
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param count Maximum number of processed packets
+ * @param callback Function called for every packet
+ * @param user User data passed to the callback
+ * @return int Same values as pcap_dispatch()
+ */
+int pcapDispatch(Config* config, int count, pcap_handler callback, unsigned char* user)
+{
+    if(config->cleanup.captureFile != NULL)
+        return captureFileDispatch(config->cleanup.captureFile, count, callback, user);
+
+    return pcap_dispatch(config->cleanup.handle, count, callback, user);
+}
+
+/**
+ * @brief Returns message of last error of pcapNext() or pcapDispatch()
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return char* Error message
+ */
+char* pcapGetError(Config* config)
+{
+    if(config->cleanup.captureFile != NULL)
+        return config->cleanup.captureFile->errbuf;
+
+    return pcap_geterr(config->cleanup.handle);
+}
+
+/**
+ * @brief Closes capture opened by pcapSetup() in offline mode, so next file
+ * can be opened with same config
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ */
+void pcapClose(Config* config)
+{
+    // pcap_close() closes also config->cleanup.pcapFile
+    pcap_close(config->cleanup.handle);
+    config->cleanup.handle = NULL;
+    config->cleanup.pcapFile = NULL;
+
+    captureFileClose(config->cleanup.captureFile);
+    config->cleanup.captureFile = NULL;
+}
@@ -38,12 +38,18 @@
 
 #include "unistd.h"
 #include "string.h"
+#include "errno.h"
 #include "sys/types.h"
 #include "pcap/pcap.h"
 #include "arpa/inet.h"
+#include "sys/epoll.h"
 
 #include "utils.h"
 #include "programConfig.h"
+#include "ringCapture.h"
+#include "frameDecoder.h"
+#include "captureFile.h"
+#include "decompressStream.h"
 
 // ----------------------------------------------------------------------------
 //  Structures and enums
@@ -79,6 +85,7 @@ void findDevices(Config* config, pcap_if_t** allDevices);
  * 
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface
  * @param allDevices Pointer to the pointer containing all devices
  * @return pcap_t* Returns handle to which is applied filter and then used for
  * reading captured data
@@ -86,20 +93,170 @@ void findDevices(Config* config, pcap_if_t** allDevices);
  * @author Tim Carstens
  * Source: https://www.tcpdump.org/pcap.html
  */
-pcap_t* pcapOnlineSetup(Config* config, pcap_if_t** allDevices, pcap_if_t** device);
+pcap_t* pcapOnlineSetup(Config* config, const char* name, pcap_if_t** allDevices, 
+                        pcap_if_t** device);
 
 /**
- * @brief Setups PCAP library to correctly capture traffic and set filters to 
- * accept only relevant internet traffic. 
+ * @brief Compiles filter expression that accepts only relevant internet 
+ * traffic
+ * 
+ * @param handle PCAP handle for which will be filter compiled
+ * @param fp Pointer to the structure where compiled filter will be stored,
+ * fp->bf_insns must be freed by caller
+ * @param net IP address of sniffing device, for offline can be set to zero
+ * 
+ * @author Tim Carstens
+ * Source: https://www.tcpdump.org/pcap.html
+ */
+void pcapCompileFilter(pcap_t* handle, struct bpf_program* fp, bpf_u_int32 net);
+
+/**
+ * @brief Appends DNS level predicates from config to compiled filter, if 
+ * they can not be expressed in BPF user space check is used alone
  * 
  * @param config Pointer to the Config structure that holds program settings to 
  * set desired behaviour of program and also allocated all allocated variables
- * @param allDevices Pointer to the pointer containing all devices
+ * @param fp Compiled filter
+ * @param linkType Datalink type of the capture
+ */
+void pcapAttachDnsFilter(Config* config, struct bpf_program* fp, int linkType);
+
+/**
+ * @brief Opens savefile from config or given interface and sets filters to 
+ * accept only relevant internet traffic, failure is printed onto stderr but
+ * does not end the program (file workers skip files that can not be read)
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface, ignored in offline mode
  * @return pcap_t* PCAP handle for further working with/reading captured data
+ * or NULL, nothing stays opened
  * 
  * @author Tim Carstens
  * Source: https://www.tcpdump.org/pcap.html
  */
+pcap_t* pcapTryOpen(Config* config, const char* name);
+
+/**
+ * @brief Opens savefile from config or given interface and sets filters to 
+ * accept only relevant internet traffic, on error program is exited
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param name Name of the interface, ignored in offline mode
+ * @return pcap_t* PCAP handle for further working with/reading captured data
+ */
+pcap_t* pcapOpen(Config* config, const char* name);
+
+/**
+ * @brief Setups PCAP library to correctly capture traffic and set filters to 
+ * accept only relevant internet traffic. 
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return pcap_t* PCAP handle for further working with/reading captured data
+ */
 pcap_t* pcapSetup(Config* config);
 
+/**
+ * @brief Opens non-blocking handle on every interface from config and 
+ * registers their descriptors into one epoll instance, index of handle in 
+ * config->cleanup.live is stored as event data
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ */
+void pcapLiveSetup(Config* config);
+
+/**
+ * @brief Opens TPACKET_V3 ring on network interface from config and attaches
+ * same filter as pcapSetup() would
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param fanoutGroup PACKET_FANOUT group id that ring joins, zero if ring 
+ * should not be part of any group
+ * @return RingCapture* Opened ring, on error program is exited
+ */
+RingCapture* pcapRingSetup(Config* config, unsigned fanoutGroup);
+
+/**
+ * @brief Same as pcapRingSetup(), but on error returns NULL and leaves
+ * message in config->cleanup.pcapErrbuff instead of exiting
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param fanoutGroup PACKET_FANOUT group id that ring joins, zero if ring 
+ * should not be part of any group
+ * @return RingCapture* Opened ring or NULL on error
+ */
+RingCapture* pcapRingOpen(Config* config, unsigned fanoutGroup);
+
+/**
+ * @brief Opens live libpcap handle again with current settings from config 
+ * (e.g. bigger buffer size) and replaces current handle by it, current 
+ * handle is closed only after new one was opened
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return true Handle was replaced
+ * @return false New handle couldn't be opened (e.g. buffer size was 
+ * refused), old handle is still used
+ */
+bool pcapReopen(Config* config);
+
+/**
+ * @brief Opens new ring with current settings from config and replaces old 
+ * one with it, kernel counters of old ring are kept
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return true Ring was replaced
+ * @return false New ring couldn't be opened, old ring is still used
+ */
+bool pcapRingReopen(Config* config);
+
+/**
+ * @brief Reads next packet from capture opened by pcapSetup(), same as 
+ * pcap_next_ex()
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param header Pointer where pointer to packet header is stored
+ * @param data Pointer where pointer to packet data is stored
+ * @return int Same values as pcap_next_ex()
+ */
+int pcapNext(Config* config, struct pcap_pkthdr** header, const unsigned char** data);
+
+/**
+ * @brief Processes packets from capture opened by pcapSetup(), same as 
+ * pcap_dispatch()
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @param count Maximum number of processed packets
+ * @param callback Function called for every packet
+ * @param user User data passed to the callback
+ * @return int Same values as pcap_dispatch()
+ */
+int pcapDispatch(Config* config, int count, pcap_handler callback, unsigned char* user);
+
+/**
+ * @brief Returns message of last error of pcapNext() or pcapDispatch()
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ * @return char* Error message
+ */
+char* pcapGetError(Config* config);
+
+/**
+ * @brief Closes capture opened by pcapSetup() in offline mode, so next file
+ * can be opened with same config
+ * 
+ * @param config Pointer to the Config structure that holds program settings to 
+ * set desired behaviour of program and also allocated all allocated variables
+ */
+void pcapClose(Config* config);
+
 #endif /*PCAP_HANDLER_H*/
\ No newline at end of file
@@ -25,6 +25,7 @@ void setupConfig(Config* config)
 {
     config->captureMode = NO_MODE;
     config->verbose = 0;
+    config->linkType = DLT_EN10MB;
     // ------------------------------------------------------------------------
     config->interface = malloc(sizeof(Buffer));
     if(config->interface == NULL)
@@ -110,8 +111,255 @@ void setupConfig(Config* config)
 
     config->cleanup.allDevices = NULL;
     config->cleanup.handle = NULL;
+    config->cleanup.live = NULL;
+    config->cleanup.liveCount = 0;
+    config->cleanup.epollFd = -1;
     config->cleanup.pcapFile = NULL;
+    config->cleanup.captureFile = NULL;
+    config->cleanup.ring = NULL;
     config->displayDevices = false;
+
+    config->useRing = false;
+    config->ringBlockSize = RING_DEFAULT_BLOCK_SIZE;
+    config->ringBlockCount = RING_DEFAULT_BLOCK_COUNT;
+    config->ringRetireTimeout = RING_DEFAULT_RETIRE_TIMEOUT;
+
+    config->snaplen = 0;                // default of capture method, see main()
+    config->bufferSize = 0;
+    config->immediateMode = false;
+    config->timeout = DEFAULT_TIMEOUT;
+
+    config->statsInterval = 0;
+    config->adaptiveMaxBuffer = 0;
+    tunerInit(&(config->tuner));
+
+    dnsFilterInit(&(config->dnsFilter));
+    config->tcpFlows = tcpTableCreate();
+    config->ipFrags = ipFragTableCreate();
+    config->nameCache = dnsNameCacheCreate();
+    config->dnsNeeds = DNS_NEED_ALL;
+
+    config->batchSize = 0;
+
+    config->pcapFiles = NULL;
+    config->pcapFileCount = 0;
+    config->pcapFileMax = 0;
+    config->interfaces = NULL;
+    config->interfaceCount = 0;
+    config->interfaceMax = 0;
+    config->ordered = false;
+    config->reorderChunk = NULL;
+    config->indexCache = false;
+    config->output = stdout;
+
+    config->writePath = NULL;
+    config->rotateSize = 0;
+    config->rotateTime = 0;
+    config->rotateCount = 0;
+    config->writer = NULL;
+    config->writerQueue = NULL;
+
+    memset(&(config->dissectStats), 0, sizeof(DissectStats));
+    config->quarantinePath = NULL;
+    config->quarantine = NULL;
+    config->quarantineQueue = NULL;
+
+    config->ednsReport = false;
+    memset(&(config->ednsStats), 0, sizeof(EdnsStats));
+    memset(&(config->nameStats), 0, sizeof(NameStats));
+
+    replayInit(&(config->replay));
+
+    config->workerCount = 0;
+    config->workerId = 0;
+    config->workers = NULL;
+}
+
+/**
+ * @brief Prints kernel drop counters of ring onto stderr and destroys it
+ * 
+ * @param config Pointer to the Config that owns the ring
+ */
+void destroyRing(Config* config)
+{
+    RingCapture* ring = config->cleanup.ring;
+
+    ringUpdateStats(ring);
+
+    if(config->workerCount > 1)
+        fprintf(stderr, "Ring statistics (worker %u): ", config->workerId);
+    else
+        fprintf(stderr, "Ring statistics: ");
+
+    fprintf(stderr, "%llu packets received, %llu dropped by kernel, "
+        "%llu queue freezes\n",
+        ring->stats.packets, ring->stats.drops, ring->stats.freezeCount);
+
+    ringDestroy(ring);
+    config->cleanup.ring = NULL;
+}
+
+/**
+ * @brief Prints kernel drop counters of live libpcap handle onto stderr and 
+ * closes it
+ * 
+ * @param config Pointer to the Config that owns the handle
+ */
+void destroyHandle(Config* config)
+{
+    struct pcap_stat stats;
+
+    // savefiles have no kernel counters
+    if(config->captureMode == ONLINE_MODE && pcap_stats(config->cleanup.handle, &stats) == 0)
+    {
+        fprintf(stderr, "Capture statistics: %u packets received, %u dropped "
+            "by kernel, %u dropped by interface\n",
+            stats.ps_recv, stats.ps_drop, stats.ps_ifdrop);
+    }
+
+    pcap_close(config->cleanup.handle);
+    config->cleanup.handle = NULL;
+}
+
+/**
+ * @brief Prints kernel drop counters of every live interface onto stderr,
+ * closes their handles and epoll instance
+ * 
+ * @param config Pointer to the Config that owns the handles
+ */
+void destroyLiveHandles(Config* config)
+{
+    for(unsigned i = 0; i < config->cleanup.liveCount; i++)
+    {
+        LiveHandle* live = &(config->cleanup.live[i]);
+        struct pcap_stat stats;
+
+        if(pcap_stats(live->handle, &stats) == 0)
+        {
+            if(config->cleanup.liveCount > 1)
+                fprintf(stderr, "Capture statistics (%s): ", live->name);
+            else
+                fprintf(stderr, "Capture statistics: ");
+
+            fprintf(stderr, "%u packets received, %u dropped by kernel, "
+                "%u dropped by interface\n",
+                stats.ps_recv, stats.ps_drop, stats.ps_ifdrop);
+        }
+
+        pcap_close(live->handle);
+    }
+
+    free(config->cleanup.live);
+    config->cleanup.live = NULL;
+    config->cleanup.liveCount = 0;
+
+    if(config->cleanup.epollFd >= 0)
+        close(config->cleanup.epollFd);
+    config->cleanup.epollFd = -1;
+}
+
+/**
+ * @brief Creates Config for capture worker, settings are copied from parent,
+ * buffers and lists used during dissection are allocated separately so 
+ * worker can run in its own thread
+ * 
+ * @param parent Main Config from which are settings copied
+ * @param workerId Index of the worker
+ * @return Config* Allocated worker Config
+ */
+Config* setupWorkerConfig(Config* parent, unsigned workerId)
+{
+    Config* config = (Config*) malloc(sizeof(Config));
+    if(config == NULL)
+        errHandling("Failed to allocate memory for worker Config", ERR_MALLOC);
+
+    // copy all settings, shared pointers (domainsFile, translationsFile, 
+    // pcapFiles) are only read by workers
+    *config = *parent;
+    config->workers = NULL;
+    config->workerId = workerId;
+
+    config->tmpListEntry = malloc(sizeof(Buffer));
+    config->addressToPrint = malloc(sizeof(Buffer));
+    config->domainList = (BufferList*) malloc(sizeof(BufferList));
+    config->translationsList = (BufferList*) malloc(sizeof(BufferList));
+    config->cleanup.timeptr = (char*) malloc(RFC3339_TIME_LEN);
+    config->cleanup.pcapErrbuff = (char*) malloc(PCAP_ERRBUF_SIZE);
+
+    if(config->tmpListEntry == NULL || config->addressToPrint == NULL ||
+        config->domainList == NULL || config->translationsList == NULL ||
+        config->cleanup.timeptr == NULL || config->cleanup.pcapErrbuff == NULL)
+    {
+        errHandling("Failed to allocate memory for worker Config", ERR_MALLOC);
+    }
+
+    bufferInit(config->tmpListEntry);
+    bufferInit(config->addressToPrint);
+    listInit(config->domainList);
+    listInit(config->translationsList);
+    config->tcpFlows = tcpTableCreate();
+    config->ipFrags = ipFragTableCreate();
+    config->nameCache = dnsNameCacheCreate();
+
+    config->cleanup.handle = NULL;
+    config->cleanup.live = NULL;
+    config->cleanup.liveCount = 0;
+    config->cleanup.epollFd = -1;
+    config->cleanup.allDevices = NULL;
+    config->cleanup.pcapFile = NULL;
+    config->cleanup.captureFile = NULL;
+    config->cleanup.ring = NULL;
+
+    config->reorderChunk = NULL;
+
+    // every worker pushes packets into its own queue
+    if(parent->writer != NULL)
+        config->writerQueue = captureWriterQueue(parent->writer);
+    if(parent->quarantine != NULL)
+        config->quarantineQueue = captureWriterQueue(parent->quarantine);
+
+    // counters are summed into parent when program ends
+    memset(&(config->dissectStats), 0, sizeof(DissectStats));
+    memset(&(config->ednsStats), 0, sizeof(EdnsStats));
+    memset(&(config->nameStats), 0, sizeof(NameStats));
+
+    return config;
+}
+
+/**
+ * @brief Destroys and frees worker Config, its lists must be merged into 
+ * parent before calling this function
+ * 
+ * @param config Pointer to worker Config created by setupWorkerConfig()
+ */
+void destroyWorkerConfig(Config* config)
+{
+    if(config == NULL)
+        return;
+
+    bufferDestroy(config->tmpListEntry);
+    free(config->tmpListEntry);
+    bufferDestroy(config->addressToPrint);
+    free(config->addressToPrint);
+
+    listDestroy(config->domainList);
+    listDestroy(config->translationsList);
+    tcpTableDestroy(config->tcpFlows);
+    ipFragTableDestroy(config->ipFrags);
+    dnsNameCacheDestroy(config->nameCache);
+
+    free(config->cleanup.timeptr);
+    free(config->cleanup.pcapErrbuff);
+
+    if(config->cleanup.ring != NULL)
+        destroyRing(config);
+
+    // worker stopped in the middle of file
+    if(config->cleanup.handle != NULL)
+        pcap_close(config->cleanup.handle);
+    captureFileClose(config->cleanup.captureFile);
+
+    free(config);
 }
 
 #include "outputHandler.h"
@@ -124,12 +372,64 @@ void setupConfig(Config* config)
  */
 void destroyConfig(Config* config)
 {
-    // save results into a files
+    // save results into a files, worker lists are merged there
     saveToFiles(config);
 
+    if(config->replay.mode != REPLAY_OFF)
+        replayReport(&(config->replay));
+
+    if(config->workers != NULL)
+    {
+        for(unsigned i = 0; i < config->workerCount; i++)
+        {
+            if(config->workers[i] != NULL)
+            {
+                dissectStatsAdd(&(config->dissectStats), &(config->workers[i]->dissectStats));
+                ednsStatsAdd(&(config->ednsStats), &(config->workers[i]->ednsStats));
+                nameStatsAdd(&(config->nameStats), &(config->workers[i]->nameStats));
+            }
+            destroyWorkerConfig(config->workers[i]);
+        }
+
+        free(config->workers);
+        config->workers = NULL;
+    }
+
+    dissectStatsReport(&(config->dissectStats));
+    if(config->ednsReport)
+        ednsStatsReport(&(config->ednsStats));
+    nameStatsReport(&(config->nameStats));
+
+    // all capture loops stopped, writer only writes rest of its queues
+    captureWriterDestroy(config->writer);
+    config->writer = NULL;
+    captureWriterDestroy(config->quarantine);
+    config->quarantine = NULL;
+
     FREE_BUFFERS;
     FREE_LISTS;
 
+    tcpTableDestroy(config->tcpFlows);
+    config->tcpFlows = NULL;
+    ipFragTableDestroy(config->ipFrags);
+    config->ipFrags = NULL;
+    dnsNameCacheDestroy(config->nameCache);
+    config->nameCache = NULL;
+
+    for(unsigned i = 0; i < config->pcapFileCount; i++)
+        free(config->pcapFiles[i]);
+    free(config->pcapFiles);
+    config->pcapFiles = NULL;
+
+    // names of live handles point into interfaces
+    if(config->cleanup.live != NULL)
+        destroyLiveHandles(config);
+
+    for(unsigned i = 0; i < config->interfaceCount; i++)
+        free(config->interfaces[i]);
+    free(config->interfaces);
+    config->interfaces = NULL;
+
     config->interface = NULL;
     config->pcapFileName = NULL;
     config->domainsFile = NULL;
@@ -142,7 +442,13 @@ void destroyConfig(Config* config)
     config->cleanup.pcapErrbuff = NULL;
 
     if(config->cleanup.handle != NULL)
-        pcap_close(config->cleanup.handle);
+        destroyHandle(config);
+
+    captureFileClose(config->cleanup.captureFile);
+    config->cleanup.captureFile = NULL;
+
+    if(config->cleanup.ring != NULL)
+        destroyRing(config);
         
     pcap_freealldevs(config->cleanup.allDevices);
 
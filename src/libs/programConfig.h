@@ -16,20 +16,52 @@
 #include "utils.h"
 #include "buffer.h"
 #include "list.h"
+#include "ringCapture.h"
+#include "captureTuning.h"
+#include "dnsFilter.h"
+#include "tcpReassembly.h"
+#include "ipReassembly.h"
+#include "captureFile.h"
+#include "reorderBuffer.h"
+#include "captureWriter.h"
+#include "replayPacer.h"
+#include "dissectErrors.h"
+#include "dnsMessage.h"
+#include "ednsStats.h"
+#include "nameNormalize.h"
 
 #include "pcap/pcap.h"
+#include "unistd.h"
 
 // ----------------------------------------------------------------------------
 //  Structures and enums
 // ----------------------------------------------------------------------------
+/**
+ * @brief Live libpcap capture of one interface, captures of all interfaces
+ * are multiplexed by one epoll loop
+ */
+typedef struct LiveHandle {
+    pcap_t* handle;
+    const char* name;           // points into Config.interfaces
+    int linkType;               // datalink type (DLT_*) of the interface
+    PcapCounters counters;      // last statistics, read by capture tuner
+} LiveHandle;
+
 typedef struct CleanUp {
     char* timeptr; 
     pcap_t* handle;
+    LiveHandle* live;           // one handle per -i, replaces handle online
+    unsigned liveCount;
+    int epollFd;
     pcap_if_t* allDevices;
     char* pcapErrbuff;
     FILE* pcapFile;
+    CaptureFile* captureFile;   // memory-mapped savefile, replaces handle reading
+    RingCapture* ring;
 } CleanUp;
 
+#define MAX_WORKERS 64
+
 #define NO_MODE 0
 #define OFFLINE_MODE 1 
 #define ONLINE_MODE 2
@@ -40,6 +72,101 @@ typedef struct ProgramConfiguration
     bool verbose;
     bool displayDevices;
 
+    // datalink type (DLT_*) of opened capture, selects link layer decoder
+    int linkType;
+
+    // TPACKET_V3 ring backend (live capture only)
+    bool useRing;
+    unsigned ringBlockSize;
+    unsigned ringBlockCount;
+    unsigned ringRetireTimeout;
+
+    // libpcap capture tuning (pcap_create()/pcap_set_*()), live capture only
+    unsigned snaplen;           // 0 until default of capture method is chosen
+    unsigned bufferSize;        // 0 keeps libpcap default
+    bool immediateMode;
+    unsigned timeout;
+
+    // periodic capture statistics (0 = disabled), adaptive buffer growing
+    // up to adaptiveMaxBuffer bytes (0 = disabled)
+    unsigned statsInterval;
+    unsigned adaptiveMaxBuffer;
+    CaptureTuner tuner;
+
+    // DNS level predicates evaluated by kernel (appended BPF) and user space
+    DnsFilter dnsFilter;
+
+    // DNS over TCP reassembly, every worker has its own table
+    TcpFlowTable* tcpFlows;
+
+    // IPv4/IPv6 fragment reassembly, every worker has its own table
+    IpFragTable* ipFrags;
+
+    // decoded name suffixes of current DNS message, every worker has its own
+    DnsNameCache* nameCache;
+
+    // DNS_NEED_* parts of DNS messages used by output, lists and statistics,
+    // set by dissectorNeeds() after arguments are handled
+    unsigned dnsNeeds;
+
+    // number of packets pulled and processed together, 0 disables batching
+    unsigned batchSize;
+
+    // offline input, -p can be repeated and accepts globs and directories,
+    // multiple files are processed by pool of workers
+    char** pcapFiles;
+    unsigned pcapFileCount;
+    unsigned pcapFileMax;
+
+    // output of parallel file workers is merged into time order
+    bool ordered;
+    ReorderChunk* reorderChunk;     // chunk of file processed by worker
+
+    // single file split into chunks by workers, index is cached next to it
+    bool indexCache;
+
+    // stream where dissected messages are printed
+    FILE* output;
+
+    // captured packets written into rotating pcapng files (-w), every
+    // capture loop has its own queue of shared writer
+    char* writePath;
+    unsigned rotateSize;            // MiB, 0 = no size rotation
+    unsigned rotateTime;            // seconds, 0 = no time rotation
+    unsigned rotateCount;           // kept files, 0 = all files are kept
+    CaptureWriter* writer;
+    WriterQueue* writerQueue;
+
+    // malformed packets are skipped and counted, with --quarantine they are
+    // also written into pcapng file by its own writer
+    DissectStats dissectStats;
+    char* quarantinePath;
+    CaptureWriter* quarantine;
+    WriterQueue* quarantineQueue;
+
+    // EDNS0 statistics (UDP sizes, client subnets) printed at exit with
+    // --edns-stats, every worker counts its own messages
+    bool ednsReport;
+    EdnsStats ednsStats;
+
+    // stored names folded to lower case and checked against LDH rules,
+    // names that are not LDH are reported at exit
+    NameStats nameStats;
+
+    // savefile replayed at recorded speed or fixed rate (load testing)
+    ReplayPacer replay;
+
+    // multi-core capture, each worker has its own Config with own buffers,
+    // lists and ring that are merged into main Config at the end
+    unsigned workerCount;
+    unsigned workerId;
+    struct ProgramConfiguration** workers;
+
+    // live input, -i can be repeated, all interfaces share dissector state
+    char** interfaces;
+    unsigned interfaceCount;
+    unsigned interfaceMax;
+
     union
     {
         Buffer* interface;
@@ -78,4 +205,23 @@ void setupConfig(Config* config);
  */
 void destroyConfig(Config* config);
 
+/**
+ * @brief Creates Config for capture worker, settings are copied from parent,
+ * buffers and lists used during dissection are allocated separately so 
+ * worker can run in its own thread
+ * 
+ * @param parent Main Config from which are settings copied
+ * @param workerId Index of the worker
+ * @return Config* Allocated worker Config
+ */
+Config* setupWorkerConfig(Config* parent, unsigned workerId);
+
+/**
+ * @brief Destroys and frees worker Config, its lists must be merged into 
+ * parent before calling this function
+ * 
+ * @param config Pointer to worker Config created by setupWorkerConfig()
+ */
+void destroyWorkerConfig(Config* config);
+
 #endif /*PROGRAM_CONFIG_H*/
\ No newline at end of file
@@ -0,0 +1,338 @@
+/**
+ * @file reorderBuffer.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of reorder buffer merging output of parallel workers
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "reorderBuffer.h"
+
+#include "string.h"
+
+/**
+ * @brief Compares entries by timestamp, entries with same timestamp keep
+ * order in which they were printed, qsort() callback
+ *
+ * @param a Pointer to the first ReorderEntry
+ * @param b Pointer to the second ReorderEntry
+ * @return int Negative, zero or positive as in strcmp()
+ */
+int reorderEntryCompare(const void* a, const void* b)
+{
+    const ReorderEntry* first = (const ReorderEntry*) a;
+    const ReorderEntry* second = (const ReorderEntry*) b;
+
+    if(timercmp(&(first->ts), &(second->ts), <))
+        return -1;
+    if(timercmp(&(first->ts), &(second->ts), >))
+        return 1;
+
+    return (first->offset < second->offset)? -1 : (first->offset > second->offset);
+}
+
+/**
+ * @brief Frees text and entries of chunk
+ *
+ * @param chunk Pointer to the ReorderChunk
+ */
+void reorderChunkFree(ReorderChunk* chunk)
+{
+    if(chunk->stream != NULL)
+        fclose(chunk->stream);
+    chunk->stream = NULL;
+
+    free(chunk->text);
+    chunk->text = NULL;
+    free(chunk->entries);
+    chunk->entries = NULL;
+    chunk->count = chunk->max = 0;
+}
+
+/**
+ * @brief Creates reorder buffer
+ *
+ * @param bounds Timestamp of first packet of every file, files must be
+ * sorted by it, NULL if chunks are written out by reorderDrainInOrder()
+ * @param chunkCount Number of files
+ * @param producers Number of workers that write into buffer
+ * @return ReorderBuffer* Allocated reorder buffer
+ */
+ReorderBuffer* reorderCreate(struct timeval* bounds, unsigned chunkCount, unsigned producers)
+{
+    ReorderBuffer* reorder = (ReorderBuffer*) malloc(sizeof(ReorderBuffer));
+    if(reorder == NULL)
+        errHandling("Failed to allocate memory for ReorderBuffer", ERR_MALLOC);
+
+    reorder->chunks = (ReorderChunk*) calloc(chunkCount, sizeof(ReorderChunk));
+    reorder->ready = (unsigned*) malloc(sizeof(unsigned) * (chunkCount + 1));
+    if(reorder->chunks == NULL || reorder->ready == NULL)
+        errHandling("Failed to allocate memory for ReorderBuffer", ERR_MALLOC);
+
+    for(unsigned i = 0; bounds != NULL && i < chunkCount; i++)
+        reorder->chunks[i].bound = bounds[i];
+
+    pthread_mutex_init(&(reorder->lock), NULL);
+    pthread_cond_init(&(reorder->changed), NULL);
+    reorder->chunkCount = chunkCount;
+    reorder->pending = 0;
+    reorder->readyCount = 0;
+    reorder->producers = producers;
+
+    return reorder;
+}
+
+/**
+ * @brief Destroys reorder buffer and output that was not written out
+ *
+ * @param reorder Pointer to the ReorderBuffer, can be NULL
+ */
+void reorderDestroy(ReorderBuffer* reorder)
+{
+    if(reorder == NULL)
+        return;
+
+    for(unsigned i = 0; i < reorder->chunkCount; i++)
+        reorderChunkFree(&(reorder->chunks[i]));
+
+    pthread_mutex_destroy(&(reorder->lock));
+    pthread_cond_destroy(&(reorder->changed));
+    free(reorder->chunks);
+    free(reorder->ready);
+    free(reorder);
+}
+
+/**
+ * @brief Starts chunk of file, returned chunk is owned by caller until
+ * reorderEnd() is called
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param index Index of the file
+ * @return ReorderChunk* Chunk whose stream receives output of the file
+ */
+ReorderChunk* reorderBegin(ReorderBuffer* reorder, unsigned index)
+{
+    ReorderChunk* chunk = &(reorder->chunks[index]);
+
+    chunk->stream = open_memstream(&(chunk->text), &(chunk->textLen));
+    if(chunk->stream == NULL)
+        errHandling("Failed to open memory stream for ordered output", ERR_MALLOC);
+
+    return chunk;
+}
+
+/**
+ * @brief Marks start of output of next packet
+ *
+ * @param chunk Pointer to the ReorderChunk
+ * @param ts Timestamp of the packet
+ */
+void reorderMark(ReorderChunk* chunk, struct timeval ts)
+{
+    long offset = ftell(chunk->stream);
+
+    // previous packet printed nothing (e.g. filtered out), reuse its entry
+    if(chunk->count > 0 && chunk->entries[chunk->count - 1].offset == (size_t) offset)
+    {
+        chunk->entries[chunk->count - 1].ts = ts;
+        return;
+    }
+
+    if(chunk->count == chunk->max)
+    {
+        unsigned newMax = (chunk->max > 0)? chunk->max * 2 : 256;
+        ReorderEntry* tmp = (ReorderEntry*) realloc(chunk->entries, sizeof(ReorderEntry) * newMax);
+        if(tmp == NULL)
+            errHandling("Failed to allocate memory for reorder entries", ERR_MALLOC);
+
+        chunk->entries = tmp;
+        chunk->max = newMax;
+    }
+
+    chunk->entries[chunk->count].ts = ts;
+    chunk->entries[chunk->count].offset = offset;
+    chunk->count++;
+}
+
+/**
+ * @brief Finishes chunk and hands it over to reorderDrain()
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param chunk Pointer to the ReorderChunk returned by reorderBegin()
+ */
+void reorderEnd(ReorderBuffer* reorder, ReorderChunk* chunk)
+{
+    fclose(chunk->stream);
+    chunk->stream = NULL;
+
+    // lengths are known only now, entries without output are dropped
+    unsigned kept = 0;
+    for(unsigned i = 0; i < chunk->count; i++)
+    {
+        size_t end = (i + 1 < chunk->count)? chunk->entries[i + 1].offset : chunk->textLen;
+        chunk->entries[i].length = end - chunk->entries[i].offset;
+        if(chunk->entries[i].length > 0)
+            chunk->entries[kept++] = chunk->entries[i];
+    }
+    chunk->count = kept;
+
+    // packets inside of one file need not be ordered (multiple interfaces)
+    if(chunk->count > 1)
+        qsort(chunk->entries, chunk->count, sizeof(ReorderEntry), reorderEntryCompare);
+
+    pthread_mutex_lock(&(reorder->lock));
+    chunk->done = true;
+    reorder->ready[reorder->readyCount++] = chunk - reorder->chunks;
+    pthread_cond_signal(&(reorder->changed));
+    pthread_mutex_unlock(&(reorder->lock));
+}
+
+/**
+ * @brief Announces that worker will not finish any other chunk
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ */
+void reorderProducerExit(ReorderBuffer* reorder)
+{
+    pthread_mutex_lock(&(reorder->lock));
+    reorder->producers--;
+    pthread_cond_signal(&(reorder->changed));
+    pthread_mutex_unlock(&(reorder->lock));
+}
+
+/**
+ * @brief Writes out packets of finished chunks up to watermark, chunks that
+ * were written out completely are freed and removed from active chunks
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param active Indices of finished chunks with packets not written out yet
+ * @param activeCount Pointer to the number of active chunks
+ * @param watermark Newest timestamp that can be written out, NULL if all
+ * packets can be written out
+ * @param output Stream where output is written
+ */
+void reorderWrite(ReorderBuffer* reorder, unsigned* active, unsigned* activeCount,
+                  struct timeval* watermark, FILE* output)
+{
+    while(*activeCount > 0)
+    {
+        // number of active chunks is small (about number of workers)
+        unsigned oldest = 0;
+        for(unsigned i = 1; i < *activeCount; i++)
+        {
+            ReorderChunk* chunk = &(reorder->chunks[active[i]]);
+            ReorderChunk* best = &(reorder->chunks[active[oldest]]);
+            if(timercmp(&(chunk->entries[chunk->next].ts), &(best->entries[best->next].ts), <))
+                oldest = i;
+        }
+
+        ReorderChunk* chunk = &(reorder->chunks[active[oldest]]);
+        ReorderEntry* entry = &(chunk->entries[chunk->next]);
+        if(watermark != NULL && timercmp(&(entry->ts), watermark, >))
+            break;
+
+        fwrite(chunk->text + entry->offset, 1, entry->length, output);
+        chunk->next++;
+
+        if(chunk->next == chunk->count)
+        {
+            reorderChunkFree(chunk);
+            active[oldest] = active[--(*activeCount)];
+        }
+    }
+}
+
+/**
+ * @brief Writes out output of packets in time order until all workers
+ * exited, called by main thread while workers are running
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param output Stream where output is written
+ */
+void reorderDrain(ReorderBuffer* reorder, FILE* output)
+{
+    unsigned* active = (unsigned*) malloc(sizeof(unsigned) * (reorder->chunkCount + 1));
+    unsigned activeCount = 0;
+    if(active == NULL)
+        errHandling("Failed to allocate memory for reorder buffer", ERR_MALLOC);
+
+    pthread_mutex_lock(&(reorder->lock));
+    while(true)
+    {
+        for(unsigned i = 0; i < reorder->readyCount; i++)
+        {
+            unsigned index = reorder->ready[i];
+
+            // chunk without any output would never be selected as oldest
+            if(reorder->chunks[index].count == 0)
+                reorderChunkFree(&(reorder->chunks[index]));
+            else
+                active[activeCount++] = index;
+        }
+        reorder->readyCount = 0;
+
+        while(reorder->pending < reorder->chunkCount && reorder->chunks[reorder->pending].done)
+            reorder->pending++;
+
+        // when no worker is left, no other chunk will be finished
+        bool finished = reorder->producers == 0;
+        bool limited = !finished && reorder->pending < reorder->chunkCount;
+        struct timeval watermark;
+        if(limited)
+            watermark = reorder->chunks[reorder->pending].bound;
+
+        pthread_mutex_unlock(&(reorder->lock));
+
+        reorderWrite(reorder, active, &activeCount, limited? &watermark : NULL, output);
+
+        pthread_mutex_lock(&(reorder->lock));
+
+        if(finished)
+            break;
+
+        if(reorder->readyCount == 0 && reorder->producers > 0)
+            pthread_cond_wait(&(reorder->changed), &(reorder->lock));
+    }
+    pthread_mutex_unlock(&(reorder->lock));
+
+    fflush(output);
+    free(active);
+}
+
+/**
+ * @brief Writes out whole chunks in order of their indices until all of
+ * them are written or all workers exited, used when chunks are consecutive
+ * parts of one file
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param output Stream where output is written
+ */
+void reorderDrainInOrder(ReorderBuffer* reorder, FILE* output)
+{
+    pthread_mutex_lock(&(reorder->lock));
+    while(reorder->pending < reorder->chunkCount)
+    {
+        ReorderChunk* chunk = &(reorder->chunks[reorder->pending]);
+        if(!chunk->done)
+        {
+            // workers stopped before chunk was finished
+            if(reorder->producers == 0)
+                break;
+
+            pthread_cond_wait(&(reorder->changed), &(reorder->lock));
+            continue;
+        }
+
+        reorder->pending++;
+        pthread_mutex_unlock(&(reorder->lock));
+
+        fwrite(chunk->text, 1, chunk->textLen, output);
+        reorderChunkFree(chunk);
+
+        pthread_mutex_lock(&(reorder->lock));
+    }
+    pthread_mutex_unlock(&(reorder->lock));
+
+    fflush(output);
+}
@@ -0,0 +1,149 @@
+/**
+ * @file reorderBuffer.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Reorder buffer that merges output of files processed in parallel
+ * into single time ordered stream. Every file is a chunk, worker writes its
+ * output into memory stream and marks where output of every packet starts.
+ * Finished chunks are merged by packet timestamps, packet is released once
+ * no unfinished file can contain earlier packet (watermark is timestamp of
+ * first packet of oldest unfinished file). Chunks of one file split between
+ * workers are written out whole in order of their indices.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "pthread.h"
+#include "sys/time.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Output of one packet
+ */
+typedef struct ReorderEntry {
+    struct timeval ts;
+    size_t offset;                  // start in chunk text
+    size_t length;
+} ReorderEntry;
+
+/**
+ * @brief Output of one file
+ */
+typedef struct ReorderChunk {
+    FILE* stream;                   // open while file is processed
+    char* text;
+    size_t textLen;
+
+    ReorderEntry* entries;
+    unsigned count;
+    unsigned max;
+    unsigned next;                  // next entry to be written out
+
+    struct timeval bound;           // no packet of file is older
+    bool done;
+} ReorderChunk;
+
+/**
+ * @brief Chunks of all files, ordered by their bounds
+ */
+typedef struct ReorderBuffer {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    ReorderChunk* chunks;
+    unsigned chunkCount;
+    unsigned pending;               // first chunk that is not done
+
+    // chunks finished by workers, not yet taken by reorderDrain()
+    unsigned* ready;
+    unsigned readyCount;
+
+    unsigned producers;             // workers that can still finish chunks
+} ReorderBuffer;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Creates reorder buffer
+ *
+ * @param bounds Timestamp of first packet of every file, files must be
+ * sorted by it, NULL if chunks are written out by reorderDrainInOrder()
+ * @param chunkCount Number of files
+ * @param producers Number of workers that write into buffer
+ * @return ReorderBuffer* Allocated reorder buffer
+ */
+ReorderBuffer* reorderCreate(struct timeval* bounds, unsigned chunkCount, unsigned producers);
+
+/**
+ * @brief Destroys reorder buffer and output that was not written out
+ *
+ * @param reorder Pointer to the ReorderBuffer, can be NULL
+ */
+void reorderDestroy(ReorderBuffer* reorder);
+
+/**
+ * @brief Starts chunk of file, returned chunk is owned by caller until
+ * reorderEnd() is called
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param index Index of the file
+ * @return ReorderChunk* Chunk whose stream receives output of the file
+ */
+ReorderChunk* reorderBegin(ReorderBuffer* reorder, unsigned index);
+
+/**
+ * @brief Marks start of output of next packet
+ *
+ * @param chunk Pointer to the ReorderChunk
+ * @param ts Timestamp of the packet
+ */
+void reorderMark(ReorderChunk* chunk, struct timeval ts);
+
+/**
+ * @brief Finishes chunk and hands it over to reorderDrain()
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param chunk Pointer to the ReorderChunk returned by reorderBegin()
+ */
+void reorderEnd(ReorderBuffer* reorder, ReorderChunk* chunk);
+
+/**
+ * @brief Announces that worker will not finish any other chunk
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ */
+void reorderProducerExit(ReorderBuffer* reorder);
+
+/**
+ * @brief Writes out output of packets in time order until all workers
+ * exited, called by main thread while workers are running
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param output Stream where output is written
+ */
+void reorderDrain(ReorderBuffer* reorder, FILE* output);
+
+/**
+ * @brief Writes out whole chunks in order of their indices until all of
+ * them are written or all workers exited, used when chunks are consecutive
+ * parts of one file
+ *
+ * @param reorder Pointer to the ReorderBuffer
+ * @param output Stream where output is written
+ */
+void reorderDrainInOrder(ReorderBuffer* reorder, FILE* output);
+
+#endif /*REORDER_BUFFER_H*/
@@ -0,0 +1,228 @@
+/**
+ * @file replayPacer.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of time-accurate savefile replay
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "replayPacer.h"
+
+#include "errno.h"
+#include "string.h"
+
+/**
+ * @brief Sets replay off
+ *
+ * @param pacer Pointer to the ReplayPacer
+ */
+void replayInit(ReplayPacer* pacer)
+{
+    memset(pacer, 0, sizeof(ReplayPacer));
+    pacer->mode = REPLAY_OFF;
+    pacer->speed = 1.0;
+}
+
+/**
+ * @brief Returns monotonic time
+ *
+ * @return uint64_t Nanoseconds
+ */
+uint64_t replayNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Adds one measurement to the stage
+ *
+ * @param stage Pointer to the ReplayStage
+ * @param ns Measured nanoseconds
+ */
+void replayStageAdd(ReplayStage* stage, uint64_t ns)
+{
+    unsigned bucket = (ns == 0)? 0 : 64 - __builtin_clzll(ns);
+    if(bucket >= REPLAY_BUCKETS)
+        bucket = REPLAY_BUCKETS - 1;
+
+    stage->buckets[bucket]++;
+    stage->count++;
+    stage->total += ns;
+    if(ns > stage->max)
+        stage->max = ns;
+}
+
+/**
+ * @brief Returns upper bound of bucket that contains given percentile
+ *
+ * @param stage Pointer to the ReplayStage
+ * @param percentile Wanted percentile (0 - 100)
+ * @return uint64_t Nanoseconds, precise to power of two
+ */
+uint64_t replayStagePercentile(ReplayStage* stage, double percentile)
+{
+    unsigned long wanted = stage->count * percentile / 100;
+    unsigned long seen = 0;
+
+    for(unsigned i = 0; i < REPLAY_BUCKETS; i++)
+    {
+        seen += stage->buckets[i];
+        if(seen > wanted)
+            return (i == 0)? 0 : ((uint64_t) 1 << i);
+    }
+
+    return stage->max;
+}
+
+/**
+ * @brief Computes time at which packet is due
+ *
+ * @param pacer Pointer to the ReplayPacer
+ * @param ts Recorded timestamp of the packet
+ * @return uint64_t Monotonic nanoseconds
+ */
+uint64_t replaySchedule(ReplayPacer* pacer, struct timeval ts)
+{
+    if(pacer->mode == REPLAY_PPS)
+        return pacer->start + (uint64_t) (pacer->packets * (1e9 / pacer->pps));
+
+    // packets out of order (multiple interfaces) are not delayed back
+    double offset = (ts.tv_sec - pacer->firstTs.tv_sec) * 1e9 +
+                    (ts.tv_usec - pacer->firstTs.tv_usec) * 1e3;
+    uint64_t scheduled = pacer->start;
+    if(offset > 0)
+        scheduled += (uint64_t) (offset / pacer->speed);
+
+    return (scheduled > pacer->scheduled)? scheduled : pacer->scheduled;
+}
+
+/**
+ * @brief Records reading of packet and waits until packet is due
+ *
+ * @param pacer Pointer to the ReplayPacer
+ * @param ts Recorded timestamp of the packet
+ * @param readStart Time from replayNow() before packet was read
+ */
+void replayPace(ReplayPacer* pacer, struct timeval ts, uint64_t readStart)
+{
+    uint64_t now = replayNow();
+    replayStageAdd(&(pacer->read), now - readStart);
+
+    if(!pacer->started)
+    {
+        pacer->started = true;
+        pacer->start = pacer->scheduled = pacer->windowStart = now;
+        pacer->firstTs = ts;
+    }
+
+    pacer->scheduled = replaySchedule(pacer, ts);
+
+    // rate offered to dissector is measured on schedule, not on real time
+    if(pacer->scheduled - pacer->windowStart >= REPLAY_WINDOW)
+    {
+        pacer->offeredRate = pacer->windowPackets * 1e9 / (pacer->scheduled - pacer->windowStart);
+        pacer->windowStart = pacer->scheduled;
+        pacer->windowPackets = 0;
+    }
+    pacer->windowPackets++;
+
+    if(now < pacer->scheduled)
+    {
+        struct timespec due = {pacer->scheduled / 1000000000, pacer->scheduled % 1000000000};
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR)
+            continue;
+
+        replayStageAdd(&(pacer->lag), 0);
+        pacer->dissectStart = replayNow();
+        return;
+    }
+
+    uint64_t lag = now - pacer->scheduled;
+    replayStageAdd(&(pacer->lag), lag);
+
+    if(!pacer->behind && lag > REPLAY_BEHIND_LAG)
+    {
+        pacer->behind = true;
+        pacer->behindPacket = pacer->packets + 1;
+        pacer->behindTs = ts;
+        pacer->behindAt = pacer->scheduled - pacer->start;
+        pacer->behindRate = (pacer->offeredRate > 0)? pacer->offeredRate :
+            pacer->windowPackets * 1e9 / (pacer->scheduled - pacer->windowStart + 1);
+    }
+
+    pacer->dissectStart = now;
+}
+
+/**
+ * @brief Records dissection of packet passed to replayPace()
+ *
+ * @param pacer Pointer to the ReplayPacer
+ */
+void replayDissected(ReplayPacer* pacer)
+{
+    replayStageAdd(&(pacer->dissect), replayNow() - pacer->dissectStart);
+    pacer->packets++;
+}
+
+/**
+ * @brief Prints latency distribution of one stage
+ *
+ * @param name Name of the stage
+ * @param stage Pointer to the ReplayStage
+ */
+void replayStagePrint(const char* name, ReplayStage* stage)
+{
+    double avg = (stage->count > 0)? (double) stage->total / stage->count : 0;
+
+    fprintf(stderr, "  %-8s avg %10.0f ns, p50 < %10llu ns, p99 < %10llu ns, max %10llu ns\n",
+        name, avg, (unsigned long long) replayStagePercentile(stage, 50),
+        (unsigned long long) replayStagePercentile(stage, 99),
+        (unsigned long long) stage->max);
+}
+
+/**
+ * @brief Prints achieved rate, latency of stages and point where dissector
+ * fell behind onto stderr, nothing is printed if no packet was replayed
+ *
+ * @param pacer Pointer to the ReplayPacer
+ */
+void replayReport(ReplayPacer* pacer)
+{
+    // program ended before first packet (e.g. bad arguments)
+    if(!pacer->started)
+        return;
+
+    double elapsed = (replayNow() - pacer->start) / 1e9;
+    double planned = (pacer->scheduled - pacer->start) / 1e9;
+
+    fprintf(stderr, "Replay statistics: %lu packets in %.3f s, achieved %.0f pps",
+        pacer->packets, elapsed, (elapsed > 0)? pacer->packets / elapsed : 0);
+
+    if(pacer->mode == REPLAY_PPS)
+        fprintf(stderr, " (target %u pps)\n", pacer->pps);
+    else
+        fprintf(stderr, " (target %.0f pps at %gx recorded speed)\n",
+            (planned > 0)? pacer->packets / planned : 0, pacer->speed);
+
+    replayStagePrint("read", &(pacer->read));
+    replayStagePrint("dissect", &(pacer->dissect));
+    replayStagePrint("lag", &(pacer->lag));
+
+    if(pacer->behind)
+    {
+        fprintf(stderr, "  dissector fell behind at packet %lu, %.3f s into replay (%.3f s "
+            "into capture), at offered rate %.0f pps\n", pacer->behindPacket,
+            pacer->behindAt / 1e9, (pacer->behindTs.tv_sec - pacer->firstTs.tv_sec) +
+            (pacer->behindTs.tv_usec - pacer->firstTs.tv_usec) / 1e6,
+            pacer->behindRate);
+    }
+    else
+    {
+        fprintf(stderr, "  dissector kept up with schedule (lag never exceeded %d ms)\n",
+            REPLAY_BEHIND_LAG / 1000000);
+    }
+}
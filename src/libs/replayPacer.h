@@ -0,0 +1,126 @@
+/**
+ * @file replayPacer.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Time-accurate replay of savefile for load testing. Packets are
+ * handed to dissector at recorded speed, at multiple of it or at fixed rate,
+ * latency of reading, dissection and lag behind schedule is measured and
+ * first packet at which dissector fell behind is reported.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef REPLAY_PACER_H
+#define REPLAY_PACER_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "stdint.h"
+#include "time.h"
+#include "sys/time.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define REPLAY_BUCKETS 40                       // log2 buckets of nanoseconds
+#define REPLAY_BEHIND_LAG 10000000              // ns, lag that counts as behind
+#define REPLAY_WINDOW 1000000000                // ns, window of offered rate
+
+/**
+ * @brief How packets are scheduled
+ */
+typedef enum ReplayMode {
+    REPLAY_OFF,
+    REPLAY_SPEED,                   // recorded gaps divided by speed
+    REPLAY_PPS,                     // fixed number of packets per second
+} ReplayMode;
+
+/**
+ * @brief Latency distribution of one stage
+ */
+typedef struct ReplayStage {
+    unsigned long count;
+    uint64_t total;                 // ns
+    uint64_t max;                   // ns
+    unsigned long buckets[REPLAY_BUCKETS];  // bucket i holds [2^(i-1), 2^i) ns
+} ReplayStage;
+
+/**
+ * @brief State of replay
+ */
+typedef struct ReplayPacer {
+    ReplayMode mode;
+    double speed;
+    unsigned pps;
+
+    bool started;
+    uint64_t start;                 // monotonic ns of first packet
+    uint64_t scheduled;             // monotonic ns of last scheduled packet
+    struct timeval firstTs;
+    unsigned long packets;
+    uint64_t dissectStart;
+
+    ReplayStage read;               // pcapNext()
+    ReplayStage dissect;            // processPacket()
+    ReplayStage lag;                // delay behind schedule
+
+    // offered rate of last complete window
+    uint64_t windowStart;
+    unsigned long windowPackets;
+    double offeredRate;
+
+    // first packet whose lag exceeded REPLAY_BEHIND_LAG
+    bool behind;
+    unsigned long behindPacket;
+    struct timeval behindTs;
+    uint64_t behindAt;              // ns after start of replay
+    double behindRate;
+} ReplayPacer;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Sets replay off
+ *
+ * @param pacer Pointer to the ReplayPacer
+ */
+void replayInit(ReplayPacer* pacer);
+
+/**
+ * @brief Returns monotonic time
+ *
+ * @return uint64_t Nanoseconds
+ */
+uint64_t replayNow();
+
+/**
+ * @brief Records reading of packet and waits until packet is due
+ *
+ * @param pacer Pointer to the ReplayPacer
+ * @param ts Recorded timestamp of the packet
+ * @param readStart Time from replayNow() before packet was read
+ */
+void replayPace(ReplayPacer* pacer, struct timeval ts, uint64_t readStart);
+
+/**
+ * @brief Records dissection of packet passed to replayPace()
+ *
+ * @param pacer Pointer to the ReplayPacer
+ */
+void replayDissected(ReplayPacer* pacer);
+
+/**
+ * @brief Prints achieved rate, latency of stages and point where dissector
+ * fell behind onto stderr, nothing is printed if no packet was replayed
+ *
+ * @param pacer Pointer to the ReplayPacer
+ */
+void replayReport(ReplayPacer* pacer);
+
+#endif /*REPLAY_PACER_H*/
@@ -0,0 +1,300 @@
+/**
+ * @file ringCapture.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of AF_PACKET TPACKET_V3 ring capture backend
+ *
+ * Source: https://www.kernel.org/doc/html/latest/networking/packet_mmap.html
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "ringCapture.h"
+
+#include "errno.h"
+#include "poll.h"
+#include "string.h"
+#include "unistd.h"
+#include "net/if.h"
+#include "net/if_arp.h"
+#include "sys/ioctl.h"
+#include "sys/mman.h"
+#include "sys/socket.h"
+#include "arpa/inet.h"
+#include "linux/filter.h"
+#include "linux/if_ether.h"
+
+#define RING_ERR(...) \
+    snprintf(errbuff, PCAP_ERRBUF_SIZE, __VA_ARGS__)
+
+/**
+ * @brief Opens AF_PACKET socket on interface, maps TPACKET_V3 ring and
+ * attaches filter to it
+ *
+ * @param interface Name of the network interface
+ * @param blockSize Size of one block in bytes, must be multiple of page size
+ * @param blockCount Number of blocks in ring
+ * @param retireTimeout Timeout in milliseconds after which kernel retires
+ * not full block to user space
+ * @param filter Compiled BPF filter that will be attached to the socket
+ * @param fanoutGroup If not zero socket joins PACKET_FANOUT group with this
+ * id, packets are then distributed between group members by flow hash
+ * @param errbuff Buffer of PCAP_ERRBUF_SIZE where error message is stored
+ * @return RingCapture* Pointer to allocated ring or NULL on error
+ */
+RingCapture* ringSetup(const char* interface, unsigned blockSize,
+                        unsigned blockCount, unsigned retireTimeout,
+                        struct bpf_program* filter, unsigned fanoutGroup,
+                        char* errbuff)
+{
+    if(blockSize == 0 || blockSize % getpagesize() != 0 || blockSize % RING_FRAME_SIZE != 0)
+    {
+        RING_ERR("Ring block size %u is not multiple of page size", blockSize);
+        return NULL;
+    }
+
+    if(blockCount == 0)
+    {
+        RING_ERR("Ring must contain at least one block");
+        return NULL;
+    }
+
+    unsigned ifIndex = if_nametoindex(interface);
+    if(ifIndex == 0)
+    {
+        RING_ERR("Interface %s was not found", interface);
+        return NULL;
+    }
+
+    RingCapture* ring = (RingCapture*) malloc(sizeof(RingCapture));
+    if(ring == NULL)
+    {
+        RING_ERR("Failed to allocate memory for RingCapture");
+        return NULL;
+    }
+
+    memset(ring, 0, sizeof(RingCapture));
+    ring->map = MAP_FAILED;
+    ring->blockSize = blockSize;
+    ring->blockCount = blockCount;
+
+    // with protocol 0 socket receives nothing until it is bound to interface,
+    // so frames of other interfaces never end up in the ring
+    ring->fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if(ring->fd < 0)
+    {
+        RING_ERR("Failed to open AF_PACKET socket: %s", strerror(errno));
+        free(ring);
+        return NULL;
+    }
+
+    // dissector expects ethernet headers, same as DLT_EN10MB check for pcap
+    // (loopback also carries ethernet headers filled with zeros)
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+    if(ioctl(ring->fd, SIOCGIFHWADDR, &ifr) < 0 || 
+        (ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER && ifr.ifr_hwaddr.sa_family != ARPHRD_LOOPBACK))
+    {
+        RING_ERR("Device %s doesn't provide Ethernet headers - not supported", interface);
+        goto error;
+    }
+    ring->loopback = (ifr.ifr_hwaddr.sa_family == ARPHRD_LOOPBACK);
+
+    int version = TPACKET_V3;
+    if(setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+    {
+        RING_ERR("Kernel does not support TPACKET_V3: %s", strerror(errno));
+        goto error;
+    }
+
+    // filter is attached before ring is created so no unfiltered packet
+    // ends up in the ring
+    struct sock_fprog program;
+    program.len = filter->bf_len;
+    program.filter = (struct sock_filter*) filter->bf_insns;
+    if(setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0)
+    {
+        RING_ERR("Couldn't attach filter to socket: %s", strerror(errno));
+        goto error;
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = blockSize;
+    req.tp_block_nr = blockCount;
+    req.tp_frame_size = RING_FRAME_SIZE;
+    req.tp_frame_nr = (blockSize / RING_FRAME_SIZE) * blockCount;
+    req.tp_retire_blk_tov = retireTimeout;
+    req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+
+    if(setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+    {
+        RING_ERR("Couldn't create ring (%u x %u B): %s", blockCount, blockSize, strerror(errno));
+        goto error;
+    }
+
+    ring->mapSize = (size_t) blockSize * blockCount;
+    ring->map = mmap(NULL, ring->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, 0);
+    if(ring->map == MAP_FAILED)
+    {
+        RING_ERR("Couldn't map ring into memory: %s", strerror(errno));
+        goto error;
+    }
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifIndex;
+    if(bind(ring->fd, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+    {
+        RING_ERR("Couldn't bind socket to %s: %s", interface, strerror(errno));
+        goto error;
+    }
+
+    // fanout hash is symmetric (src/dst are sorted before hashing) so query
+    // and its response end up in same socket, defrag flag makes sure all 
+    // fragments of one datagram are hashed same way
+    if(fanoutGroup != 0)
+    {
+        int fanout = (fanoutGroup & 0xffff) | 
+            ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+
+        if(setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0)
+        {
+            RING_ERR("Couldn't join fanout group %u: %s", fanoutGroup, strerror(errno));
+            goto error;
+        }
+    }
+
+    // same as pcap_open_live() with promisc set to true
+    struct packet_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = ifIndex;
+    mreq.mr_type = PACKET_MR_PROMISC;
+    if(setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+    {
+        RING_ERR("Couldn't set %s into promiscuous mode: %s", interface, strerror(errno));
+        goto error;
+    }
+
+    return ring;
+
+error:
+    ringDestroy(ring);
+    return NULL;
+}
+
+/**
+ * @brief Waits until kernel retires current block to the user space
+ *
+ * @param ring Pointer to the RingCapture
+ * @return struct tpacket_block_desc* Retired block or NULL if poll timed
+ * out/was interrupted
+ */
+struct tpacket_block_desc* ringNextBlock(RingCapture* ring)
+{
+    struct tpacket_block_desc* block = (struct tpacket_block_desc*)
+        (ring->map + (size_t) ring->currentBlock * ring->blockSize);
+
+    if((__atomic_load_n(&(block->hdr.bh1.block_status), __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+    {
+        struct pollfd pfd;
+        pfd.fd = ring->fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+
+        poll(&pfd, 1, RING_POLL_TIMEOUT);
+
+        if((__atomic_load_n(&(block->hdr.bh1.block_status), __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+            return NULL;
+    }
+
+    return block;
+}
+
+/**
+ * @brief Returns block back to the kernel and moves to the next one
+ *
+ * @param ring Pointer to the RingCapture
+ * @param block Block returned by ringNextBlock()
+ */
+void ringReleaseBlock(RingCapture* ring, struct tpacket_block_desc* block)
+{
+    __atomic_store_n(&(block->hdr.bh1.block_status), TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+
+    ring->currentBlock = (ring->currentBlock + 1) % ring->blockCount;
+}
+
+/**
+ * @brief Fills pcap_pkthdr from TPACKET_V3 frame header and returns pointer
+ * to the start of frame data (inside ring, no copy)
+ *
+ * @param ring Pointer to the RingCapture
+ * @param frame Frame header inside retired block
+ * @param header Pointer to the header that will be filled
+ * @return const unsigned char* Pointer to the start of link layer header or
+ * NULL if frame should be skipped
+ */
+const unsigned char* ringFrameData(RingCapture* ring, struct tpacket3_hdr* frame, 
+                                    struct pcap_pkthdr* header)
+{
+    // on loopback every packet is seen twice, once as outgoing and once as
+    // incoming, libpcap skips the outgoing copy as well
+    if(ring->loopback)
+    {
+        struct sockaddr_ll* sll = (struct sockaddr_ll*) 
+            ((unsigned char*) frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+        if(sll->sll_pkttype == PACKET_OUTGOING)
+            return NULL;
+    }
+
+    header->ts.tv_sec = frame->tp_sec;
+    header->ts.tv_usec = frame->tp_nsec / 1000;
+    header->caplen = frame->tp_snaplen;
+    header->len = frame->tp_len;
+
+    return ((const unsigned char*) frame) + frame->tp_mac;
+}
+
+/**
+ * @brief Reads kernel drop counters and adds them to ring->stats
+ *
+ * @param ring Pointer to the RingCapture
+ */
+void ringUpdateStats(RingCapture* ring)
+{
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+
+    if(getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+        return;
+
+    // tp_packets contains also dropped packets
+    ring->stats.packets += stats.tp_packets;
+    ring->stats.drops += stats.tp_drops;
+    ring->stats.freezeCount += stats.tp_freeze_q_cnt;
+}
+
+/**
+ * @brief Unmaps ring, closes socket and frees memory
+ *
+ * @param ring Pointer to the RingCapture
+ */
+void ringDestroy(RingCapture* ring)
+{
+    if(ring == NULL)
+        return;
+
+    if(ring->map != MAP_FAILED)
+        munmap(ring->map, ring->mapSize);
+
+    if(ring->fd >= 0)
+        close(ring->fd);
+
+    free(ring);
+}
+
+#undef RING_ERR
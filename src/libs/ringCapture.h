@@ -0,0 +1,130 @@
+/**
+ * @file ringCapture.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Capture backend built directly on AF_PACKET socket with TPACKET_V3
+ * memory-mapped block ring. Kernel fills whole blocks of packets and retires
+ * them to user space, packets are then read in place without any copying.
+ *
+ * Source: https://www.kernel.org/doc/html/latest/networking/packet_mmap.html
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef RING_CAPTURE_H
+#define RING_CAPTURE_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "linux/if_packet.h"
+#include "pcap/pcap.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define RING_DEFAULT_BLOCK_SIZE (1 << 22)   // 4 MiB
+#define RING_DEFAULT_BLOCK_COUNT 64
+#define RING_DEFAULT_RETIRE_TIMEOUT 60      // milliseconds
+#define RING_FRAME_SIZE 2048                // used only for computing frame count
+#define RING_DEFAULT_SNAPLEN 262144         // filter accept length, frames are not cut
+#define RING_POLL_TIMEOUT 1000              // milliseconds
+
+/**
+ * @brief Kernel drop counters, accumulated over whole life of the ring,
+ * because reading PACKET_STATISTICS resets kernel counters
+ */
+typedef struct RingStats {
+    unsigned long long packets;
+    unsigned long long drops;
+    unsigned long long freezeCount;
+} RingStats;
+
+/**
+ * @brief Opened AF_PACKET socket with mapped TPACKET_V3 ring
+ */
+typedef struct RingCapture {
+    int fd;
+    unsigned char* map;
+    size_t mapSize;
+
+    unsigned blockSize;
+    unsigned blockCount;
+    unsigned currentBlock;
+    bool loopback;
+
+    RingStats stats;
+} RingCapture;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Opens AF_PACKET socket on interface, maps TPACKET_V3 ring and
+ * attaches filter to it
+ *
+ * @param interface Name of the network interface
+ * @param blockSize Size of one block in bytes, must be multiple of page size
+ * @param blockCount Number of blocks in ring
+ * @param retireTimeout Timeout in milliseconds after which kernel retires
+ * not full block to user space
+ * @param filter Compiled BPF filter that will be attached to the socket
+ * @param fanoutGroup If not zero socket joins PACKET_FANOUT group with this
+ * id, packets are then distributed between group members by flow hash
+ * @param errbuff Buffer of PCAP_ERRBUF_SIZE where error message is stored
+ * @return RingCapture* Pointer to allocated ring or NULL on error
+ */
+RingCapture* ringSetup(const char* interface, unsigned blockSize,
+                        unsigned blockCount, unsigned retireTimeout,
+                        struct bpf_program* filter, unsigned fanoutGroup,
+                        char* errbuff);
+
+/**
+ * @brief Waits until kernel retires current block to the user space
+ *
+ * @param ring Pointer to the RingCapture
+ * @return struct tpacket_block_desc* Retired block or NULL if poll timed
+ * out/was interrupted
+ */
+struct tpacket_block_desc* ringNextBlock(RingCapture* ring);
+
+/**
+ * @brief Returns block back to the kernel and moves to the next one
+ *
+ * @param ring Pointer to the RingCapture
+ * @param block Block returned by ringNextBlock()
+ */
+void ringReleaseBlock(RingCapture* ring, struct tpacket_block_desc* block);
+
+/**
+ * @brief Fills pcap_pkthdr from TPACKET_V3 frame header and returns pointer
+ * to the start of frame data (inside ring, no copy)
+ *
+ * @param ring Pointer to the RingCapture
+ * @param frame Frame header inside retired block
+ * @param header Pointer to the header that will be filled
+ * @return const unsigned char* Pointer to the start of link layer header or
+ * NULL if frame should be skipped
+ */
+const unsigned char* ringFrameData(RingCapture* ring, struct tpacket3_hdr* frame, 
+                                    struct pcap_pkthdr* header);
+
+/**
+ * @brief Reads kernel drop counters and adds them to ring->stats
+ *
+ * @param ring Pointer to the RingCapture
+ */
+void ringUpdateStats(RingCapture* ring);
+
+/**
+ * @brief Unmaps ring, closes socket and frees memory
+ *
+ * @param ring Pointer to the RingCapture
+ */
+void ringDestroy(RingCapture* ring);
+
+#endif /*RING_CAPTURE_H*/
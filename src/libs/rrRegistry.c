@@ -0,0 +1,923 @@
+/**
+ * @file rrRegistry.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of registry of resource record types
+ *
+ * Source: RFC 1035, RFC 2782, RFC 4034, RFC 6891, RFC 8659, RFC 9460
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "rrRegistry.h"
+#include "packetDissector.h"
+#include "textFormat.h"
+
+#include "string.h"
+#include "strings.h"
+#include "time.h"
+
+#define MX_PREFERENCE_LEN 2
+#define SRV_FIXED_LEN 6                 // priority, weight and port
+#define SOA_NUMBERS_LEN 20              // serial, refresh, retry, expire, minimum
+#define DS_FIXED_LEN 4                  // key tag, algorithm, digest type
+#define DNSKEY_FIXED_LEN 4              // flags, protocol, algorithm
+#define RRSIG_FIXED_LEN 18              // fields before signer name
+#define SVCB_PRIORITY_LEN 2
+#define OPTION_HEADER_LEN 4             // code (key) and length of option
+#define RR_TEXT_CHUNK 64                // bytes formatted at once by rrAddHex()
+
+// SvcParamKeys (RFC 9460)
+#define SVC_MANDATORY 0
+#define SVC_ALPN 1
+#define SVC_NO_DEFAULT_ALPN 2
+#define SVC_PORT 3
+#define SVC_IPV4HINT 4
+#define SVC_ECH 5
+#define SVC_IPV6HINT 6
+
+// ----------------------------------------------------------------------------
+//  Text helpers
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Appends unsigned number in decimal
+ *
+ * @param buffer Buffer where text is appended
+ * @param value Number
+ */
+void rrAddU32(Buffer* buffer, uint32_t value)
+{
+    char text[FORMAT_U32_MAX_LEN];
+    bufferAddBytes(buffer, text, formatU32(text, value));
+}
+
+/**
+ * @brief Appends text followed by unsigned number in decimal
+ *
+ * @param buffer Buffer where text is appended
+ * @param prefix Text written before number
+ * @param value Number
+ */
+void rrAddLabeledU32(Buffer* buffer, const char* prefix, uint32_t value)
+{
+    bufferAddString(buffer, (char*) prefix);
+    rrAddU32(buffer, value);
+}
+
+/**
+ * @brief Appends bytes as upper case hexadecimal digits
+ *
+ * @param buffer Buffer where text is appended
+ * @param data Bytes
+ * @param len Number of bytes
+ */
+void rrAddHex(Buffer* buffer, const unsigned char* data, size_t len)
+{
+    char text[2 * RR_TEXT_CHUNK];
+
+    for(size_t i = 0; i < len; i += RR_TEXT_CHUNK)
+    {
+        size_t chunk = (len - i < RR_TEXT_CHUNK)? len - i : RR_TEXT_CHUNK;
+        bufferAddBytes(buffer, text, formatHexBytes(text, data + i, chunk));
+    }
+}
+
+/**
+ * @brief Appends bytes encoded in base64
+ *
+ * @param buffer Buffer where text is appended
+ * @param data Bytes
+ * @param len Number of bytes
+ */
+void rrAddBase64(Buffer* buffer, const unsigned char* data, size_t len)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for(size_t i = 0; i < len; i += 3)
+    {
+        unsigned long group = (unsigned long) data[i] << 16;
+        if(i + 1 < len)
+            group |= (unsigned long) data[i + 1] << 8;
+        if(i + 2 < len)
+            group |= data[i + 2];
+
+        char quad[4] = {
+            digits[(group >> 18) & 0x3f], digits[(group >> 12) & 0x3f],
+            (i + 1 < len)? digits[(group >> 6) & 0x3f] : '=',
+            (i + 2 < len)? digits[group & 0x3f] : '=',
+        };
+        bufferAddBytes(buffer, quad, 4);
+    }
+}
+
+/**
+ * @brief Appends bytes of character string, quotes and backslashes are
+ * escaped by backslash, non printable bytes are written as \DDD
+ *
+ * @param buffer Buffer where text is appended
+ * @param data Bytes
+ * @param len Number of bytes
+ */
+void rrAddEscaped(Buffer* buffer, const unsigned char* data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        if(data[i] < 0x20 || data[i] > 0x7e)
+        {
+            char text[4] = {'\\'};
+            bufferAddBytes(buffer, text, 1 + formatU32Width(text + 1, data[i], 3));
+        }
+        else
+        {
+            if(data[i] == '"' || data[i] == '\\')
+                bufferAddChar(buffer, '\\');
+            bufferAddChar(buffer, data[i]);
+        }
+    }
+}
+
+/**
+ * @brief Appends name, root name is written as "."
+ *
+ * @param message Pointer to the DnsMessage
+ * @param offset Offset of name in message
+ * @param buffer Buffer where name is appended
+ */
+void rrAddName(const DnsMessage* message, size_t offset, Buffer* buffer)
+{
+    size_t used = buffer->used;
+    dnsNameDecode(message, offset, buffer);
+    if(buffer->used == used)
+        bufferAddChar(buffer, '.');
+}
+
+/**
+ * @brief Appends name of type, unknown type is written as TYPEnnn
+ *
+ * @param buffer Buffer where text is appended
+ * @param type Type of record
+ */
+void rrAddTypeName(Buffer* buffer, unsigned type)
+{
+    const RRTypeInfo* info = rrTypeFind(type);
+    if(info->name != NULL)
+        bufferAddString(buffer, (char*) info->name);
+    else
+        rrAddLabeledU32(buffer, "TYPE", type);
+}
+
+/**
+ * @brief Appends time of signature as YYYYMMDDHHmmSS (UTC)
+ *
+ * @param buffer Buffer where text is appended
+ * @param seconds Seconds since epoch
+ */
+void rrAddTime(Buffer* buffer, uint32_t seconds)
+{
+    time_t time = seconds;
+    struct tm utc;
+    gmtime_r(&time, &utc);
+
+    char text[FORMAT_U32_MAX_LEN + 10];
+    size_t len = formatU32Width(text, utc.tm_year + 1900, 4);
+    len += formatU32Width(text + len, utc.tm_mon + 1, 2);
+    len += formatU32Width(text + len, utc.tm_mday, 2);
+    len += formatU32Width(text + len, utc.tm_hour, 2);
+    len += formatU32Width(text + len, utc.tm_min, 2);
+    len += formatU32Width(text + len, utc.tm_sec, 2);
+    bufferAddBytes(buffer, text, len);
+}
+
+// ----------------------------------------------------------------------------
+//  RDATA checks
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Checks name at start of RDATA (NS, CNAME, PTR)
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckName(const DnsMessage* message, const DnsRecord* record)
+{
+    size_t nameLen = 0;
+    return dnsNameCheck(message->data, message->length, record->rdataOffset, &nameLen);
+}
+
+/**
+ * @brief Checks exchange name of MX after preference
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckMX(const DnsMessage* message, const DnsRecord* record)
+{
+    size_t nameLen = 0;
+    return dnsNameCheck(message->data, message->length,
+                        record->rdataOffset + MX_PREFERENCE_LEN, &nameLen);
+}
+
+/**
+ * @brief Checks target name of SRV after priority, weight and port
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckSRV(const DnsMessage* message, const DnsRecord* record)
+{
+    size_t nameLen = 0;
+    return dnsNameCheck(message->data, message->length,
+                        record->rdataOffset + SRV_FIXED_LEN, &nameLen);
+}
+
+/**
+ * @brief Checks primary name server and mailbox of SOA, then its 5 numbers
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckSOA(const DnsMessage* message, const DnsRecord* record)
+{
+    size_t ptr = record->rdataOffset;
+    size_t nameLen = 0;
+
+    for(unsigned i = 0; i < 2; i++)
+    {
+        if(dnsNameCheck(message->data, message->length, ptr, &nameLen) != DISSECT_OK)
+            return DISSECT_BAD_NAME;
+        ptr += nameLen;
+    }
+
+    return (ptr + SOA_NUMBERS_LEN > message->length)? DISSECT_SHORT_RECORD : DISSECT_OK;
+}
+
+/**
+ * @brief Checks that character strings of TXT fill RDATA
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckTXT(const DnsMessage* message, const DnsRecord* record)
+{
+    size_t ptr = record->rdataOffset;
+    size_t end = ptr + record->rdataLength;
+
+    while(ptr < end)
+        ptr += 1 + message->data[ptr];
+
+    return (ptr > end)? DISSECT_SHORT_RECORD : DISSECT_OK;
+}
+
+/**
+ * @brief Checks that tag of CAA fits into RDATA
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckCAA(const DnsMessage* message, const DnsRecord* record)
+{
+    if(record->rdataLength < 2 ||
+        2 + message->data[record->rdataOffset + 1] > record->rdataLength)
+        return DISSECT_SHORT_RECORD;
+
+    return DISSECT_OK;
+}
+
+/**
+ * @brief Checks fixed fields of DS and DNSKEY
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckKey(const DnsMessage* message, const DnsRecord* record)
+{
+    (void) message;
+
+    // DS_FIXED_LEN and DNSKEY_FIXED_LEN are same
+    return (record->rdataLength < DS_FIXED_LEN)? DISSECT_SHORT_RECORD : DISSECT_OK;
+}
+
+/**
+ * @brief Checks fixed fields and signer name of RRSIG
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckRRSIG(const DnsMessage* message, const DnsRecord* record)
+{
+    if(record->rdataLength < RRSIG_FIXED_LEN)
+        return DISSECT_SHORT_RECORD;
+
+    size_t signer = record->rdataOffset + RRSIG_FIXED_LEN;
+    size_t nameLen = 0;
+    if(dnsNameCheck(message->data, message->length, signer, &nameLen) != DISSECT_OK)
+        return DISSECT_BAD_NAME;
+
+    if(signer + nameLen > (size_t) record->rdataOffset + record->rdataLength)
+        return DISSECT_SHORT_RECORD;
+
+    return DISSECT_OK;
+}
+
+/**
+ * @brief Checks that options (code, length, value) fill area of RDATA
+ *
+ * @param data Start of DNS message
+ * @param ptr Offset of first option
+ * @param end Offset after last option
+ * @return DissectError DISSECT_OK or DISSECT_SHORT_RECORD
+ */
+DissectError rrCheckOptions(const unsigned char* data, size_t ptr, size_t end)
+{
+    while(ptr < end)
+    {
+        if(ptr + OPTION_HEADER_LEN > end)
+            return DISSECT_SHORT_RECORD;
+
+        ptr += OPTION_HEADER_LEN + DNS_READ16(data + ptr + 2);
+    }
+
+    return (ptr > end)? DISSECT_SHORT_RECORD : DISSECT_OK;
+}
+
+/**
+ * @brief Checks priority, target name and parameters of SVCB and HTTPS,
+ * values of known parameters must have their length
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckSVCB(const DnsMessage* message, const DnsRecord* record)
+{
+    const unsigned char* data = message->data;
+    size_t end = (size_t) record->rdataOffset + record->rdataLength;
+
+    if(record->rdataLength < SVCB_PRIORITY_LEN)
+        return DISSECT_SHORT_RECORD;
+
+    size_t ptr = record->rdataOffset + SVCB_PRIORITY_LEN;
+    size_t nameLen = 0;
+    if(dnsNameCheck(data, message->length, ptr, &nameLen) != DISSECT_OK)
+        return DISSECT_BAD_NAME;
+    ptr += nameLen;
+
+    if(ptr > end || rrCheckOptions(data, ptr, end) != DISSECT_OK)
+        return DISSECT_SHORT_RECORD;
+
+    for(; ptr < end; ptr += OPTION_HEADER_LEN + DNS_READ16(data + ptr + 2))
+    {
+        unsigned len = DNS_READ16(data + ptr + 2);
+        size_t value = ptr + OPTION_HEADER_LEN;
+        bool ok = true;
+
+        switch(DNS_READ16(data + ptr))
+        {
+            case SVC_MANDATORY: ok = len % 2 == 0; break;
+            case SVC_PORT: ok = len == 2; break;
+            case SVC_IPV4HINT: ok = len % 4 == 0; break;
+            case SVC_IPV6HINT: ok = len % 16 == 0; break;
+            case SVC_ALPN:
+                // list of character strings
+                while(value < ptr + OPTION_HEADER_LEN + len)
+                    value += 1 + data[value];
+                ok = value == ptr + OPTION_HEADER_LEN + len;
+                break;
+        }
+
+        if(!ok)
+            return DISSECT_SHORT_RECORD;
+    }
+
+    return DISSECT_OK;
+}
+
+/**
+ * @brief Checks options of OPT pseudo record
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+DissectError rrCheckOPT(const DnsMessage* message, const DnsRecord* record)
+{
+    return rrCheckOptions(message->data, record->rdataOffset,
+                        (size_t) record->rdataOffset + record->rdataLength);
+}
+
+// ----------------------------------------------------------------------------
+//  RDATA decoders
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Decodes IPv4 address of A
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeA(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    printIPv4(PACKET_2_UINT(message->data + record->rdataOffset), buffer, output);
+}
+
+/**
+ * @brief Decodes IPv6 address of AAAA
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeAAAA(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    printIPv6((uint32_t*) (message->data + record->rdataOffset), buffer, output);
+}
+
+/**
+ * @brief Decodes name stored in RDATA (NS, CNAME, PTR)
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeName(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+    dnsNameDecode(message, record->rdataOffset, buffer);
+}
+
+/**
+ * @brief Prints preference of MX and decodes its exchange name
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where exchange is appended
+ * @param output Stream where preference is printed
+ */
+void rrDecodeMX(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    if(output != NULL)
+    {
+        char text[FORMAT_U32_MAX_LEN + 1];
+        size_t len = formatU32(text, DNS_READ16(message->data + record->rdataOffset));
+        text[len++] = ' ';
+        fwrite(text, 1, len, output);
+    }
+
+    dnsNameDecode(message, record->rdataOffset + MX_PREFERENCE_LEN, buffer);
+}
+
+/**
+ * @brief Prints priority, weight and port of SRV and decodes its target
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where target is appended
+ * @param output Stream where priority, weight and port are printed
+ */
+void rrDecodeSRV(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    packet_t rdata = message->data + record->rdataOffset;
+
+    if(output != NULL)
+    {
+        // priority, weight and port
+        char text[3 * (FORMAT_U32_MAX_LEN + 1)];
+        size_t len = 0;
+        for(unsigned i = 0; i < SRV_FIXED_LEN; i += 2)
+        {
+            len += formatU32(text + len, DNS_READ16(rdata + i));
+            text[len++] = ' ';
+        }
+        fwrite(text, 1, len, output);
+    }
+
+    dnsNameDecode(message, record->rdataOffset + SRV_FIXED_LEN, buffer);
+}
+
+/**
+ * @brief Decodes primary name server and mailbox of SOA and prints its
+ * serial number, refresh, retry and expire intervals and minimum TTL
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where names are appended
+ * @param output Stream where numbers are printed
+ */
+void rrDecodeSOA(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    size_t ptr = record->rdataOffset;
+    dnsNameDecode(message, ptr, buffer);
+    ptr = dnsNameEnd(message, ptr);
+    dnsNameDecode(message, ptr, buffer);
+    ptr = dnsNameEnd(message, ptr);
+
+    if(output == NULL)
+        return;
+
+    char text[5 * (FORMAT_U32_MAX_LEN + 1)];
+    size_t len = 0;
+    for(unsigned i = 0; i < SOA_NUMBERS_LEN; i += 4)
+    {
+        len += formatU32(text + len, DNS_READ32(message->data + ptr + i));
+        text[len++] = ' ';
+    }
+    fwrite(text, 1, len, output);
+}
+
+/**
+ * @brief Decodes character strings of TXT, every string is quoted
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeTXT(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    const unsigned char* data = message->data;
+    size_t end = (size_t) record->rdataOffset + record->rdataLength;
+
+    for(size_t ptr = record->rdataOffset; ptr < end; ptr += 1 + data[ptr])
+    {
+        if(ptr != record->rdataOffset)
+            bufferAddChar(buffer, ' ');
+
+        bufferAddChar(buffer, '"');
+        rrAddEscaped(buffer, data + ptr + 1, data[ptr]);
+        bufferAddChar(buffer, '"');
+    }
+}
+
+/**
+ * @brief Decodes flags, tag and value of CAA
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeCAA(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    packet_t rdata = message->data + record->rdataOffset;
+    unsigned tagLen = rdata[1];
+
+    rrAddU32(buffer, rdata[0]);
+    bufferAddChar(buffer, ' ');
+    rrAddEscaped(buffer, rdata + 2, tagLen);
+    bufferAddString(buffer, " \"");
+    rrAddEscaped(buffer, rdata + 2 + tagLen, record->rdataLength - 2 - tagLen);
+    bufferAddChar(buffer, '"');
+}
+
+/**
+ * @brief Decodes key tag, algorithm, digest type and digest of DS
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeDS(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    packet_t rdata = message->data + record->rdataOffset;
+
+    rrAddU32(buffer, DNS_READ16(rdata));
+    rrAddLabeledU32(buffer, " ", rdata[2]);
+    rrAddLabeledU32(buffer, " ", rdata[3]);
+    bufferAddChar(buffer, ' ');
+    rrAddHex(buffer, rdata + DS_FIXED_LEN, record->rdataLength - DS_FIXED_LEN);
+}
+
+/**
+ * @brief Decodes flags, protocol, algorithm and public key of DNSKEY
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeDNSKEY(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    packet_t rdata = message->data + record->rdataOffset;
+
+    rrAddU32(buffer, DNS_READ16(rdata));
+    rrAddLabeledU32(buffer, " ", rdata[2]);
+    rrAddLabeledU32(buffer, " ", rdata[3]);
+    bufferAddChar(buffer, ' ');
+    rrAddBase64(buffer, rdata + DNSKEY_FIXED_LEN, record->rdataLength - DNSKEY_FIXED_LEN);
+}
+
+/**
+ * @brief Decodes RRSIG, times are written as YYYYMMDDHHmmSS
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeRRSIG(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    packet_t rdata = message->data + record->rdataOffset;
+
+    // type covered, algorithm, labels, original TTL
+    rrAddTypeName(buffer, DNS_READ16(rdata));
+    rrAddLabeledU32(buffer, " ", rdata[2]);
+    rrAddLabeledU32(buffer, " ", rdata[3]);
+    rrAddLabeledU32(buffer, " ", DNS_READ32(rdata + 4));
+    bufferAddChar(buffer, ' ');
+
+    // signature expiration and inception, key tag
+    rrAddTime(buffer, DNS_READ32(rdata + 8));
+    bufferAddChar(buffer, ' ');
+    rrAddTime(buffer, DNS_READ32(rdata + 12));
+    rrAddLabeledU32(buffer, " ", DNS_READ16(rdata + 16));
+    bufferAddChar(buffer, ' ');
+
+    size_t signer = record->rdataOffset + RRSIG_FIXED_LEN;
+    rrAddName(message, signer, buffer);
+    bufferAddChar(buffer, ' ');
+
+    size_t signature = dnsNameEnd(message, signer);
+    rrAddBase64(buffer, message->data + signature,
+                record->rdataOffset + record->rdataLength - signature);
+}
+
+/**
+ * @brief Decodes priority, target and parameters of SVCB and HTTPS
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeSVCB(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    static const char* keyNames[] = {
+        "mandatory", "alpn", "no-default-alpn", "port", "ipv4hint", "ech", "ipv6hint",
+    };
+
+    const unsigned char* data = message->data;
+    size_t end = (size_t) record->rdataOffset + record->rdataLength;
+
+    rrAddU32(buffer, DNS_READ16(data + record->rdataOffset));
+    bufferAddChar(buffer, ' ');
+    size_t ptr = record->rdataOffset + SVCB_PRIORITY_LEN;
+    rrAddName(message, ptr, buffer);
+    ptr = dnsNameEnd(message, ptr);
+
+    for(; ptr < end; ptr += OPTION_HEADER_LEN + DNS_READ16(data + ptr + 2))
+    {
+        unsigned key = DNS_READ16(data + ptr);
+        unsigned len = DNS_READ16(data + ptr + 2);
+        const unsigned char* value = data + ptr + OPTION_HEADER_LEN;
+
+        bufferAddChar(buffer, ' ');
+        if(key < sizeof(keyNames) / sizeof(keyNames[0]))
+            bufferAddString(buffer, (char*) keyNames[key]);
+        else
+            rrAddLabeledU32(buffer, "key", key);
+
+        if(key == SVC_NO_DEFAULT_ALPN)
+            continue;
+        bufferAddChar(buffer, '=');
+
+        switch(key)
+        {
+            case SVC_MANDATORY:
+                for(unsigned i = 0; i < len; i += 2)
+                {
+                    unsigned mandatory = DNS_READ16(value + i);
+                    if(i > 0)
+                        bufferAddChar(buffer, ',');
+                    if(mandatory < sizeof(keyNames) / sizeof(keyNames[0]))
+                        bufferAddString(buffer, (char*) keyNames[mandatory]);
+                    else
+                        rrAddLabeledU32(buffer, "key", mandatory);
+                }
+                break;
+            case SVC_ALPN:
+                for(unsigned i = 0; i < len; i += 1 + value[i])
+                {
+                    if(i > 0)
+                        bufferAddChar(buffer, ',');
+                    rrAddEscaped(buffer, value + i + 1, value[i]);
+                }
+                break;
+            case SVC_PORT:
+                rrAddU32(buffer, DNS_READ16(value));
+                break;
+            case SVC_IPV4HINT:
+            case SVC_IPV6HINT:;
+                unsigned size = (key == SVC_IPV4HINT)? 4 : 16;
+                for(unsigned i = 0; i < len; i += size)
+                {
+                    if(i > 0)
+                        bufferAddChar(buffer, ',');
+                    if(key == SVC_IPV4HINT)
+                        printIPv4(PACKET_2_UINT(value + i), buffer, NULL);
+                    else
+                        printIPv6((uint32_t*) (value + i), buffer, NULL);
+                }
+                break;
+            case SVC_ECH:
+                rrAddBase64(buffer, value, len);
+                break;
+            default:
+                rrAddHex(buffer, value, len);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Decodes OPT pseudo record, class holds UDP payload size and TTL
+ * extended RCODE, version and flags, client subnet is written as
+ * address/source/scope, cookie and other options as hexadecimal value
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Not used
+ */
+void rrDecodeOPT(const DnsMessage* message, const DnsRecord* record, Buffer* buffer,
+                FILE* output)
+{
+    (void) output;
+
+    const unsigned char* data = message->data;
+    size_t end = (size_t) record->rdataOffset + record->rdataLength;
+
+    rrAddLabeledU32(buffer, "udp=", record->rrClass);
+    rrAddLabeledU32(buffer, " ext-rcode=", record->ttl >> 24);
+    rrAddLabeledU32(buffer, " version=", (record->ttl >> 16) & 0xff);
+    rrAddLabeledU32(buffer, " do=", (record->ttl >> 15) & 1);
+
+    for(size_t ptr = record->rdataOffset; ptr < end;
+        ptr += OPTION_HEADER_LEN + DNS_READ16(data + ptr + 2))
+    {
+        unsigned code = DNS_READ16(data + ptr);
+        unsigned len = DNS_READ16(data + ptr + 2);
+        const unsigned char* value = data + ptr + OPTION_HEADER_LEN;
+
+        if(code == EDNS_OPTION_ECS && len >= 4)
+        {
+            // address is sent only up to source prefix
+            uint32_t address[4] = {0};
+            unsigned family = DNS_READ16(value);
+            memcpy(address, value + 4, (len - 4 < sizeof(address))? len - 4 : sizeof(address));
+
+            bufferAddString(buffer, " ecs=");
+            if(family == EDNS_ECS_FAMILY_IPV4)
+                printIPv4(address[0], buffer, NULL);
+            else if(family == EDNS_ECS_FAMILY_IPV6)
+                printIPv6(address, buffer, NULL);
+            else
+                rrAddLabeledU32(buffer, "family", family);
+            rrAddLabeledU32(buffer, "/", value[2]);
+            rrAddLabeledU32(buffer, "/", value[3]);
+        }
+        else
+        {
+            if(code == EDNS_OPTION_COOKIE)
+                bufferAddString(buffer, " cookie=");
+            else
+            {
+                rrAddLabeledU32(buffer, " opt", code);
+                bufferAddChar(buffer, '=');
+            }
+            rrAddHex(buffer, value, len);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+//  Registry
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Supported types indexed by type number, types without entry are
+ * unknown
+ */
+static const RRTypeInfo rrTypes[RR_TYPE_TABLE_SIZE] = {
+    [RRType_A]      = {"A",      RR_VALID | RR_STORE_DOMAIN | RR_STORE_TRANSLATION,
+                        NULL, rrDecodeA},
+    [RRType_AAAA]   = {"AAAA",   RR_VALID | RR_STORE_DOMAIN | RR_STORE_TRANSLATION,
+                        NULL, rrDecodeAAAA},
+    [RRType_NS]     = {"NS",     RR_VALID | RR_STORE_DOMAIN, rrCheckName, rrDecodeName},
+    [RRType_MX]     = {"MX",     RR_VALID, rrCheckMX, rrDecodeMX},
+    [RRType_SOA]    = {"SOA",    RR_VALID, rrCheckSOA, rrDecodeSOA},
+    [RRType_CNAME]  = {"CNAME",  RR_VALID, rrCheckName, rrDecodeName},
+    [RRType_SRV]    = {"SRV",    RR_VALID, rrCheckSRV, rrDecodeSRV},
+    [RRType_PTR]    = {"PTR",    RR_VALID, rrCheckName, rrDecodeName},
+    [RRType_TXT]    = {"TXT",    RR_VALID, rrCheckTXT, rrDecodeTXT},
+    [RRType_CAA]    = {"CAA",    RR_VALID, rrCheckCAA, rrDecodeCAA},
+    [RRType_DS]     = {"DS",     RR_VALID, rrCheckKey, rrDecodeDS},
+    [RRType_DNSKEY] = {"DNSKEY", RR_VALID, rrCheckKey, rrDecodeDNSKEY},
+    [RRType_RRSIG]  = {"RRSIG",  RR_VALID, rrCheckRRSIG, rrDecodeRRSIG},
+    [RRType_SVCB]   = {"SVCB",   RR_VALID, rrCheckSVCB, rrDecodeSVCB},
+    [RRType_HTTPS]  = {"HTTPS",  RR_VALID, rrCheckSVCB, rrDecodeSVCB},
+    [RRType_OPT]    = {"OPT",    RR_VALID | RR_ANY_CLASS | RR_PSEUDO,
+                        rrCheckOPT, rrDecodeOPT},
+    // question only, known for --qtype
+    [RRType_ANY]    = {"ANY",    0, NULL, NULL},
+};
+
+/**
+ * @brief Returns registry entry of type
+ *
+ * @param type Type of record
+ * @return const RRTypeInfo* Entry, for unknown type entry without name
+ */
+const RRTypeInfo* rrTypeFind(unsigned type)
+{
+    static const RRTypeInfo unknown = {NULL, 0, NULL, NULL};
+
+    return (type < RR_TYPE_TABLE_SIZE)? &(rrTypes[type]) : &unknown;
+}
+
+/**
+ * @brief Finds type by its name (case insensitive)
+ *
+ * @param name Name of type, does not have to end with '\0'
+ * @param len Length of name
+ * @param type Pointer where type is stored
+ * @return true Type was found
+ * @return false Name is unknown
+ */
+bool rrTypeByName(const char* name, size_t len, unsigned* type)
+{
+    for(unsigned i = 0; i < RR_TYPE_TABLE_SIZE; i++)
+    {
+        const char* known = rrTypes[i].name;
+        if(known != NULL && strlen(known) == len && strncasecmp(known, name, len) == 0)
+        {
+            *type = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Checks if records of type and class are printed
+ *
+ * @param type Type of record
+ * @param rrClass Class of record
+ * @return true Type is valid and class is IN (or class is not checked)
+ * @return false Record is not supported
+ */
+bool rrTypeValid(unsigned type, unsigned rrClass)
+{
+    const RRTypeInfo* info = rrTypeFind(type);
+
+    return (info->flags & RR_VALID) &&
+        ((info->flags & RR_ANY_CLASS) || rrClass == RRClass_IN);
+}
+
+#undef MX_PREFERENCE_LEN
+#undef SRV_FIXED_LEN
+#undef SOA_NUMBERS_LEN
+#undef DS_FIXED_LEN
+#undef DNSKEY_FIXED_LEN
+#undef RRSIG_FIXED_LEN
+#undef SVCB_PRIORITY_LEN
+#undef OPTION_HEADER_LEN
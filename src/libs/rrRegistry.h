@@ -0,0 +1,104 @@
+/**
+ * @file rrRegistry.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Registry of resource record types. Every supported type has one
+ * entry in table indexed directly by type number, entry holds name of type,
+ * flags (validity, classes, storing into lists), check of RDATA done by parse
+ * stage and decoder of RDATA into printable text. New type is supported by
+ * adding its entry, dissector itself does not change.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef RR_REGISTRY_H
+#define RR_REGISTRY_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "stdio.h"
+
+#include "utils.h"
+#include "buffer.h"
+#include "dnsMessage.h"
+#include "dissectErrors.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define RR_TYPE_TABLE_SIZE 512          // types above are unknown
+
+#define RR_VALID 0x01                   // records of type are printed
+#define RR_ANY_CLASS 0x02               // class is not checked (OPT)
+#define RR_PSEUDO 0x04                  // owner, TTL and class are printed by decoder
+#define RR_STORE_DOMAIN 0x08            // owner name is stored into domain list
+#define RR_STORE_TRANSLATION 0x10       // owner and RDATA are stored into translations
+
+/**
+ * @brief Checks RDATA of record, called by parse stage, so decoder can read
+ * RDATA without further checks
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is checked
+ * @return DissectError DISSECT_OK or reason why message has to be skipped
+ */
+typedef DissectError (*RRDataCheck)(const DnsMessage* message, const DnsRecord* record);
+
+/**
+ * @brief Decodes RDATA of record
+ *
+ * @param message Pointer to the DnsMessage
+ * @param record Record whose RDATA is decoded
+ * @param buffer Buffer where RDATA text is appended
+ * @param output Stream where fields printed before buffer are written, NULL
+ * when RDATA is only stored
+ */
+typedef void (*RRDataDecoder)(const DnsMessage* message, const DnsRecord* record,
+                            Buffer* buffer, FILE* output);
+
+/**
+ * @brief Entry of registry, unknown types have all members zero
+ */
+typedef struct RRTypeInfo {
+    const char* name;
+    unsigned flags;                 // RR_* flags
+    RRDataCheck check;              // NULL when RDATA needs no check
+    RRDataDecoder decode;           // NULL when RDATA is not printed
+} RRTypeInfo;
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Returns registry entry of type
+ *
+ * @param type Type of record
+ * @return const RRTypeInfo* Entry, for unknown type entry without name
+ */
+const RRTypeInfo* rrTypeFind(unsigned type);
+
+/**
+ * @brief Finds type by its name (case insensitive)
+ *
+ * @param name Name of type, does not have to end with '\0'
+ * @param len Length of name
+ * @param type Pointer where type is stored
+ * @return true Type was found
+ * @return false Name is unknown
+ */
+bool rrTypeByName(const char* name, size_t len, unsigned* type);
+
+/**
+ * @brief Checks if records of type and class are printed
+ *
+ * @param type Type of record
+ * @param rrClass Class of record
+ * @return true Type is valid and class is IN (or class is not checked)
+ * @return false Record is not supported
+ */
+bool rrTypeValid(unsigned type, unsigned rrClass);
+
+#endif /*RR_REGISTRY_H*/
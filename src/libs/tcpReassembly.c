@@ -0,0 +1,454 @@
+/**
+ * @file tcpReassembly.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of DNS over TCP message reassembly
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "tcpReassembly.h"
+
+#include "string.h"
+#include "arpa/inet.h"
+
+#define MIN_FLOW_BUFFER 1024
+
+/**
+ * @brief Allocates empty flow table
+ *
+ * @return TcpFlowTable* Pointer to the table
+ */
+TcpFlowTable* tcpTableCreate()
+{
+    TcpFlowTable* table = (TcpFlowTable*) malloc(sizeof(TcpFlowTable));
+    if(table == NULL)
+        errHandling("Failed to allocate memory for TCP flow table", ERR_MALLOC);
+
+    memset(table, 0, sizeof(TcpFlowTable));
+
+    return table;
+}
+
+/**
+ * @brief Computes hash of flow key (FNV-1a)
+ *
+ * @param key Pointer to the key
+ * @return unsigned Index of bucket
+ */
+unsigned tcpHash(const TcpFlowKey* key)
+{
+    unsigned hash = 2166136261u;
+
+    for(unsigned i = 0; i < 16; i++)
+        hash = (hash ^ key->src[i]) * 16777619u;
+    for(unsigned i = 0; i < 16; i++)
+        hash = (hash ^ key->dst[i]) * 16777619u;
+
+    hash = (hash ^ key->srcPort) * 16777619u;
+    hash = (hash ^ key->dstPort) * 16777619u;
+    hash = (hash ^ key->family) * 16777619u;
+
+    return hash & (TCP_FLOW_BUCKETS - 1);
+}
+
+/**
+ * @brief Compares two flow keys
+ *
+ * @param first First key
+ * @param second Second key
+ * @return true Keys identify same flow
+ * @return false Keys are different
+ */
+bool tcpKeyEqual(const TcpFlowKey* first, const TcpFlowKey* second)
+{
+    return first->srcPort == second->srcPort &&
+        first->dstPort == second->dstPort &&
+        first->family == second->family &&
+        memcmp(first->src, second->src, 16) == 0 &&
+        memcmp(first->dst, second->dst, 16) == 0;
+}
+
+/**
+ * @brief Removes buffered bytes of flow and frees its buffer
+ *
+ * @param table Pointer to the table
+ * @param flow Pointer to the flow
+ */
+void tcpFlowClear(TcpFlowTable* table, TcpFlow* flow)
+{
+    table->memoryUsed -= flow->allocated;
+
+    free(flow->data);
+    flow->data = NULL;
+    flow->used = 0;
+    flow->allocated = 0;
+}
+
+/**
+ * @brief Unlinks flow from list ordered by last use
+ *
+ * @param table Pointer to the table
+ * @param flow Pointer to the flow
+ */
+void tcpLruUnlink(TcpFlowTable* table, TcpFlow* flow)
+{
+    if(flow->lruPrev != NULL)
+        flow->lruPrev->lruNext = flow->lruNext;
+    else
+        table->lruHead = flow->lruNext;
+
+    if(flow->lruNext != NULL)
+        flow->lruNext->lruPrev = flow->lruPrev;
+    else
+        table->lruTail = flow->lruPrev;
+
+    flow->lruPrev = NULL;
+    flow->lruNext = NULL;
+}
+
+/**
+ * @brief Moves flow to the start of list ordered by last use
+ *
+ * @param table Pointer to the table
+ * @param flow Pointer to the flow
+ * @param now Current time in seconds
+ */
+void tcpLruTouch(TcpFlowTable* table, TcpFlow* flow, time_t now)
+{
+    flow->lastSeen = now;
+
+    if(table->lruHead == flow)
+        return;
+
+    // only head has no predecessor, new flow is not linked yet
+    if(flow->lruPrev != NULL)
+        tcpLruUnlink(table, flow);
+
+    flow->lruNext = table->lruHead;
+    if(table->lruHead != NULL)
+        table->lruHead->lruPrev = flow;
+    table->lruHead = flow;
+
+    if(table->lruTail == NULL)
+        table->lruTail = flow;
+}
+
+/**
+ * @brief Removes flow from table and frees it
+ *
+ * @param table Pointer to the table
+ * @param flow Pointer to the flow
+ */
+void tcpRemove(TcpFlowTable* table, TcpFlow* flow)
+{
+    TcpFlow** link = &(table->buckets[tcpHash(&(flow->key))]);
+    while(*link != flow)
+        link = &((*link)->hashNext);
+
+    *link = flow->hashNext;
+
+    tcpLruUnlink(table, flow);
+    tcpFlowClear(table, flow);
+    free(flow);
+
+    table->flowCount--;
+}
+
+/**
+ * @brief Evicts flows that did not receive segment for TCP_FLOW_TIMEOUT
+ *
+ * @param table Pointer to the table
+ * @param now Current time in seconds
+ */
+void tcpExpire(TcpFlowTable* table, time_t now)
+{
+    while(table->lruTail != NULL && table->lruTail->lastSeen + TCP_FLOW_TIMEOUT < now)
+    {
+        tcpRemove(table, table->lruTail);
+        table->evicted++;
+    }
+}
+
+/**
+ * @brief Finds flow in table
+ *
+ * @param table Pointer to the table
+ * @param key Key of the flow
+ * @return TcpFlow* Found flow or NULL
+ */
+TcpFlow* tcpFind(TcpFlowTable* table, const TcpFlowKey* key)
+{
+    TcpFlow* flow = table->buckets[tcpHash(key)];
+    while(flow != NULL && !tcpKeyEqual(&(flow->key), key))
+        flow = flow->hashNext;
+
+    return flow;
+}
+
+/**
+ * @brief Creates new flow, least recently used flow is evicted when table
+ * is full
+ *
+ * @param table Pointer to the table
+ * @param key Key of the flow
+ * @param now Current time in seconds
+ * @return TcpFlow* Created flow
+ */
+TcpFlow* tcpCreate(TcpFlowTable* table, const TcpFlowKey* key, time_t now)
+{
+    if(table->flowCount >= TCP_MAX_FLOWS)
+    {
+        tcpRemove(table, table->lruTail);
+        table->evicted++;
+    }
+
+    TcpFlow* flow = (TcpFlow*) malloc(sizeof(TcpFlow));
+    if(flow == NULL)
+        errHandling("Failed to allocate memory for TCP flow", ERR_MALLOC);
+
+    memset(flow, 0, sizeof(TcpFlow));
+    flow->key = *key;
+
+    unsigned hash = tcpHash(key);
+    flow->hashNext = table->buckets[hash];
+    table->buckets[hash] = flow;
+    table->flowCount++;
+
+    tcpLruTouch(table, flow, now);
+
+    return flow;
+}
+
+/**
+ * @brief Appends bytes to flow buffer, other flows are evicted (least
+ * recently used first) when memory limit would be exceeded
+ *
+ * @param table Pointer to the table
+ * @param flow Pointer to the flow
+ * @param data Bytes to be appended
+ * @param length Number of bytes
+ * @return true Bytes were appended
+ * @return false Memory limit was reached, flow was cleared
+ */
+bool tcpFlowAppend(TcpFlowTable* table, TcpFlow* flow, const unsigned char* data, size_t length)
+{
+    size_t needed = flow->used + length;
+
+    if(needed > flow->allocated)
+    {
+        size_t newSize = (flow->allocated > 0)? flow->allocated : MIN_FLOW_BUFFER;
+        while(newSize < needed)
+            newSize *= 2;
+
+        size_t grow = newSize - flow->allocated;
+        while(table->memoryUsed + grow > TCP_MAX_MEMORY && table->lruTail != flow)
+        {
+            tcpRemove(table, table->lruTail);
+            table->evicted++;
+        }
+
+        if(table->memoryUsed + grow > TCP_MAX_MEMORY)
+        {
+            tcpFlowClear(table, flow);
+            return false;
+        }
+
+        unsigned char* tmp = (unsigned char*) realloc(flow->data, newSize);
+        if(tmp == NULL)
+            errHandling("Failed to reallocate memory for TCP flow", ERR_MALLOC);
+
+        flow->data = tmp;
+        flow->allocated = newSize;
+        table->memoryUsed += grow;
+    }
+
+    memcpy(flow->data + flow->used, data, length);
+    flow->used += length;
+
+    return true;
+}
+
+/**
+ * @brief Splits bytes by length prefix into messages and calls handler for
+ * every complete one
+ *
+ * @param data Stream bytes starting at length prefix
+ * @param length Number of bytes
+ * @param handler Function called for every complete message
+ * @param user User data passed to the handler
+ * @return size_t Number of consumed bytes
+ */
+size_t tcpSplitMessages(const unsigned char* data, size_t length,
+                        TcpMessageHandler handler, void* user)
+{
+    size_t consumed = 0;
+
+    while(length - consumed >= 2)
+    {
+        size_t messageLen = (data[consumed] << 8) | data[consumed + 1];
+        if(length - consumed < messageLen + 2)
+            break;
+
+        handler(data + consumed + 2, messageLen, user);
+        consumed += messageLen + 2;
+    }
+
+    return consumed;
+}
+
+/**
+ * @brief Adds in order bytes to flow and hands complete messages to handler
+ *
+ * @param table Pointer to the table
+ * @param flow Pointer to the flow
+ * @param payload Segment data
+ * @param length Length of segment data
+ * @param handler Function called for every complete message
+ * @param user User data passed to the handler
+ */
+void tcpConsume(TcpFlowTable* table, TcpFlow* flow, const unsigned char* payload,
+                size_t length, TcpMessageHandler handler, void* user)
+{
+    // nothing buffered, messages are read directly from the segment and only
+    // incomplete rest is copied
+    if(flow->used == 0)
+    {
+        size_t consumed = tcpSplitMessages(payload, length, handler, user);
+        if(consumed < length)
+            tcpFlowAppend(table, flow, payload + consumed, length - consumed);
+
+        return;
+    }
+
+    if(!tcpFlowAppend(table, flow, payload, length))
+        return;
+
+    size_t consumed = tcpSplitMessages(flow->data, flow->used, handler, user);
+    if(consumed == flow->used)
+    {
+        tcpFlowClear(table, flow);
+        return;
+    }
+
+    memmove(flow->data, flow->data + consumed, flow->used - consumed);
+    flow->used -= consumed;
+}
+
+/**
+ * @brief Adds TCP segment to its flow and calls handler for every DNS
+ * message completed by it. Segments that arrive out of order restart
+ * reassembly of the flow at their sequence number.
+ *
+ * @param table Pointer to the table
+ * @param key Flow of the segment
+ * @param tcp TCP header of the segment
+ * @param payload Segment data
+ * @param length Length of segment data
+ * @param now Timestamp of the segment in seconds
+ * @param handler Function called for every complete message
+ * @param user User data passed to the handler
+ */
+void tcpTableSegment(TcpFlowTable* table, const TcpFlowKey* key,
+                    const struct tcphdr* tcp, const unsigned char* payload,
+                    size_t length, time_t now, TcpMessageHandler handler,
+                    void* user)
+{
+    tcpExpire(table, now);
+
+    TcpFlow* flow = tcpFind(table, key);
+    unsigned seq = ntohl(tcp->th_seq);
+
+    if(tcp->th_flags & TH_RST)
+    {
+        if(flow != NULL)
+            tcpRemove(table, flow);
+        return;
+    }
+
+    if(tcp->th_flags & TH_SYN)
+    {
+        if(flow == NULL)
+            flow = tcpCreate(table, key, now);
+        else
+            tcpFlowClear(table, flow);
+
+        // SYN takes one sequence number
+        seq++;
+        flow->nextSeq = seq;
+    }
+    else if(flow == NULL)
+    {
+        if(length == 0)
+            return;
+
+        // connection seen from the middle, segment is expected to start
+        // with length prefix
+        flow = tcpCreate(table, key, now);
+        flow->nextSeq = seq;
+    }
+
+    tcpLruTouch(table, flow, now);
+
+    int diff = (int) (flow->nextSeq - seq);
+    if(diff > 0)
+    {
+        // retransmission, skip bytes that were already processed
+        if((size_t) diff >= length)
+            length = 0;
+        else
+        {
+            payload += diff;
+            length -= diff;
+            seq = flow->nextSeq;
+        }
+    }
+    else if(diff < 0)
+    {
+        // bytes were lost or reordered, start again on this segment
+        tcpFlowClear(table, flow);
+    }
+
+    if(length > 0)
+    {
+        flow->nextSeq = seq + length;
+        tcpConsume(table, flow, payload, length, handler, user);
+    }
+
+    if(tcp->th_flags & TH_FIN)
+        tcpRemove(table, flow);
+}
+
+/**
+ * @brief Checks if no flow is open at time now, flows idle for more than
+ * TCP_FLOW_TIMEOUT are evicted first (same as next segment would do)
+ *
+ * @param table Pointer to the table
+ * @param now Current time in seconds
+ * @return true Table holds no flow
+ * @return false Some flow is still open
+ */
+bool tcpTableIdle(TcpFlowTable* table, time_t now)
+{
+    tcpExpire(table, now);
+
+    return table->flowCount == 0;
+}
+
+/**
+ * @brief Frees all flows and table itself
+ *
+ * @param table Pointer to the table, can be NULL
+ */
+void tcpTableDestroy(TcpFlowTable* table)
+{
+    if(table == NULL)
+        return;
+
+    while(table->lruTail != NULL)
+        tcpRemove(table, table->lruTail);
+
+    free(table);
+}
+
+#undef MIN_FLOW_BUFFER
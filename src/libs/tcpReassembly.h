@@ -0,0 +1,136 @@
+/**
+ * @file tcpReassembly.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Reassembly of DNS messages carried over TCP. Every direction of a
+ * connection is one flow in bounded hash table, flow keeps bytes of not yet
+ * complete message and splits stream by 2 byte length prefix (RFC 1035
+ * 4.2.2) into messages, multiple pipelined messages in one segment are
+ * supported. Idle flows are evicted after timeout or when table runs out of
+ * flow slots or memory.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TCP_REASSEMBLY_H
+#define TCP_REASSEMBLY_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "time.h"
+#include "netinet/tcp.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define TCP_FLOW_BUCKETS 1024               // power of two
+#define TCP_MAX_FLOWS 4096
+#define TCP_MAX_MEMORY (32 * 1024 * 1024)   // bytes buffered by all flows
+#define TCP_FLOW_TIMEOUT 60                 // seconds without segment
+
+/**
+ * @brief Identification of one direction of TCP connection, IPv4 addresses
+ * are stored in first 4 bytes
+ */
+typedef struct TcpFlowKey {
+    unsigned char src[16];
+    unsigned char dst[16];
+    unsigned short srcPort;
+    unsigned short dstPort;
+    unsigned char family;
+} TcpFlowKey;
+
+/**
+ * @brief One direction of TCP connection with bytes of incomplete message
+ */
+typedef struct TcpFlow {
+    TcpFlowKey key;
+    unsigned nextSeq;
+
+    unsigned char* data;
+    size_t used;
+    size_t allocated;
+
+    time_t lastSeen;
+
+    struct TcpFlow* hashNext;
+    struct TcpFlow* lruPrev;    // more recently used
+    struct TcpFlow* lruNext;    // less recently used
+} TcpFlow;
+
+/**
+ * @brief Hash table of flows, flows are also kept in list ordered by time
+ * of last segment so oldest can be evicted first
+ */
+typedef struct TcpFlowTable {
+    TcpFlow* buckets[TCP_FLOW_BUCKETS];
+    TcpFlow* lruHead;
+    TcpFlow* lruTail;
+
+    unsigned flowCount;
+    size_t memoryUsed;
+    unsigned long long evicted;
+} TcpFlowTable;
+
+/**
+ * @brief Function called for every reassembled DNS message
+ *
+ * @param message Start of DNS message (after length prefix)
+ * @param length Length of DNS message
+ * @param user User data given to tcpTableSegment()
+ */
+typedef void (*TcpMessageHandler)(const unsigned char* message, size_t length, void* user);
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Allocates empty flow table
+ *
+ * @return TcpFlowTable* Pointer to the table
+ */
+TcpFlowTable* tcpTableCreate();
+
+/**
+ * @brief Frees all flows and table itself
+ *
+ * @param table Pointer to the table, can be NULL
+ */
+void tcpTableDestroy(TcpFlowTable* table);
+
+/**
+ * @brief Adds TCP segment to its flow and calls handler for every DNS
+ * message completed by it. Segments that arrive out of order restart
+ * reassembly of the flow at their sequence number.
+ *
+ * @param table Pointer to the table
+ * @param key Flow of the segment
+ * @param tcp TCP header of the segment
+ * @param payload Segment data
+ * @param length Length of segment data
+ * @param now Timestamp of the segment in seconds
+ * @param handler Function called for every complete message
+ * @param user User data passed to the handler
+ */
+void tcpTableSegment(TcpFlowTable* table, const TcpFlowKey* key,
+                    const struct tcphdr* tcp, const unsigned char* payload,
+                    size_t length, time_t now, TcpMessageHandler handler,
+                    void* user);
+
+/**
+ * @brief Checks if no flow is open at time now, flows idle for more than
+ * TCP_FLOW_TIMEOUT are evicted first (same as next segment would do)
+ *
+ * @param table Pointer to the table
+ * @param now Current time in seconds
+ * @return true Table holds no flow
+ * @return false Some flow is still open
+ */
+bool tcpTableIdle(TcpFlowTable* table, time_t now);
+
+#endif /*TCP_REASSEMBLY_H*/
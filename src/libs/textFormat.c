@@ -0,0 +1,266 @@
+/**
+ * @file textFormat.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Implementation of formatting of numbers and addresses
+ *
+ * Source: RFC 5952
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "textFormat.h"
+
+#define IPV6_GROUPS 8
+
+/**
+ * @brief Decimal digits of numbers 0 - 99, two characters per number
+ */
+static const char digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hexUpper[] = "0123456789ABCDEF";
+static const char hexLower[] = "0123456789abcdef";
+
+/**
+ * @brief Returns number of decimal digits of value, comparisons are summed
+ * instead of branching
+ *
+ * @param value Number
+ * @return size_t Number of digits
+ */
+size_t formatDigitCount(uint32_t value)
+{
+    return 1 + (value >= 10) + (value >= 100) + (value >= 1000) + (value >= 10000) +
+        (value >= 100000) + (value >= 1000000) + (value >= 10000000) +
+        (value >= 100000000) + (value >= 1000000000);
+}
+
+/**
+ * @brief Returns number of hexadecimal digits of value without leading zeros
+ *
+ * @param value Number
+ * @return size_t Number of digits
+ */
+size_t formatHexCount(uint32_t value)
+{
+    return 1 + (value > 0xf) + (value > 0xff) + (value > 0xfff) + (value > 0xffff) +
+        (value > 0xfffff) + (value > 0xffffff) + (value > 0xfffffff);
+}
+
+/**
+ * @brief Writes digits of value so that last digit ends at end
+ *
+ * @param end First byte after the number
+ * @param value Number
+ */
+void formatDigitsBackwards(char* end, uint32_t value)
+{
+    while(value >= 100)
+    {
+        end -= 2;
+        memcpy(end, digitPairs + (value % 100) * 2, 2);
+        value /= 100;
+    }
+
+    if(value >= 10)
+        memcpy(end - 2, digitPairs + value * 2, 2);
+    else
+        end[-1] = '0' + value;
+}
+
+/**
+ * @brief Writes unsigned number in decimal
+ *
+ * @param out Where text is written, at least FORMAT_U32_MAX_LEN bytes
+ * @param value Number (16 bit numbers are written by this too)
+ * @return size_t Number of written characters
+ */
+size_t formatU32(char* out, uint32_t value)
+{
+    size_t len = formatDigitCount(value);
+    formatDigitsBackwards(out + len, value);
+    return len;
+}
+
+/**
+ * @brief Writes unsigned number in decimal, padded by zeros to width
+ *
+ * @param out Where text is written, at least max(width, FORMAT_U32_MAX_LEN)
+ * bytes
+ * @param value Number
+ * @param width Minimal number of digits
+ * @return size_t Number of written characters
+ */
+size_t formatU32Width(char* out, uint32_t value, unsigned width)
+{
+    size_t len = formatDigitCount(value);
+    if(len < width)
+    {
+        memset(out, '0', width - len);
+        len = width;
+    }
+
+    formatDigitsBackwards(out + len, value);
+    return len;
+}
+
+/**
+ * @brief Writes unsigned number in upper case hexadecimal without leading
+ * zeros
+ *
+ * @param out Where text is written, at least FORMAT_HEX_MAX_LEN bytes
+ * @param value Number
+ * @return size_t Number of written characters
+ */
+size_t formatHex(char* out, uint32_t value)
+{
+    size_t len = formatHexCount(value);
+    for(size_t i = len; i > 0; i--, value >>= 4)
+        out[i - 1] = hexUpper[value & 0xf];
+
+    return len;
+}
+
+/**
+ * @brief Writes bytes as pairs of upper case hexadecimal digits
+ *
+ * @param out Where text is written, at least 2 * len bytes
+ * @param data Bytes
+ * @param len Number of bytes
+ * @return size_t Number of written characters
+ */
+size_t formatHexBytes(char* out, const unsigned char* data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        out[2 * i] = hexUpper[data[i] >> 4];
+        out[2 * i + 1] = hexUpper[data[i] & 0xf];
+    }
+
+    return 2 * len;
+}
+
+/**
+ * @brief Writes IPv4 address in dotted-quad notation
+ *
+ * @param out Where text is written, at least FORMAT_IPV4_MAX_LEN bytes
+ * @param address 4 bytes of address in network byte order
+ * @return size_t Number of written characters
+ */
+size_t formatIPv4(char* out, const unsigned char* address)
+{
+    char* ptr = out;
+    for(unsigned i = 0; i < 4; i++)
+    {
+        unsigned octet = address[i];
+        if(i > 0)
+            *ptr++ = '.';
+
+        if(octet >= 100)
+        {
+            *ptr++ = '0' + octet / 100;
+            octet %= 100;
+            memcpy(ptr, digitPairs + octet * 2, 2);
+            ptr += 2;
+        }
+        else if(octet >= 10)
+        {
+            memcpy(ptr, digitPairs + octet * 2, 2);
+            ptr += 2;
+        }
+        else
+            *ptr++ = '0' + octet;
+    }
+
+    return ptr - out;
+}
+
+/**
+ * @brief Writes one group of IPv6 address in lower case hexadecimal without
+ * leading zeros
+ *
+ * @param out Where text is written, at least 4 bytes
+ * @param group Group of address
+ * @return size_t Number of written characters
+ */
+size_t formatIPv6Group(char* out, unsigned group)
+{
+    size_t len = 1 + (group > 0xf) + (group > 0xff) + (group > 0xfff);
+    for(size_t i = len; i > 0; i--, group >>= 4)
+        out[i - 1] = hexLower[group & 0xf];
+
+    return len;
+}
+
+/**
+ * @brief Writes IPv6 address in RFC 5952 notation (lower case, no leading
+ * zeros, first longest run of two or more zero groups replaced by "::"),
+ * IPv4-mapped and IPv4-compatible addresses end with dotted quad, same as
+ * inet_ntop() writes them
+ *
+ * @param out Where text is written, at least FORMAT_IPV6_MAX_LEN bytes
+ * @param address 16 bytes of address in network byte order
+ * @return size_t Number of written characters
+ */
+size_t formatIPv6(char* out, const unsigned char* address)
+{
+    unsigned groups[IPV6_GROUPS];
+    for(unsigned i = 0; i < IPV6_GROUPS; i++)
+        groups[i] = (address[2 * i] << 8) | address[2 * i + 1];
+
+    // first longest run of zero groups
+    unsigned bestStart = 0, bestLen = 0, runLen = 0;
+    for(unsigned i = 0; i < IPV6_GROUPS; i++)
+    {
+        runLen = (groups[i] == 0)? runLen + 1 : 0;
+        if(runLen > bestLen)
+        {
+            bestLen = runLen;
+            bestStart = i + 1 - runLen;
+        }
+    }
+
+    // single zero group is not compressed
+    if(bestLen < 2)
+        bestLen = 0;
+
+    char* ptr = out;
+    for(unsigned i = 0; i < IPV6_GROUPS; i++)
+    {
+        if(bestLen > 0 && i == bestStart)
+        {
+            *ptr++ = ':';
+            i += bestLen - 1;
+            if(i == IPV6_GROUPS - 1)
+                *ptr++ = ':';
+            continue;
+        }
+
+        if(i > 0)
+            *ptr++ = ':';
+
+        // ::a.b.c.d and ::ffff:a.b.c.d
+        if(i == 6 && bestStart == 0 &&
+            (bestLen == 6 || (bestLen == 5 && groups[5] == 0xffff)))
+        {
+            ptr += formatIPv4(ptr, address + 12);
+            break;
+        }
+
+        ptr += formatIPv6Group(ptr, groups[i]);
+    }
+
+    return ptr - out;
+}
+
+#undef IPV6_GROUPS
@@ -0,0 +1,104 @@
+/**
+ * @file textFormat.h
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Formatting of numbers and addresses used by dissector output. Text
+ * is written straight into buffer of caller (without terminating zero) and
+ * its length is returned, so several fields can be joined into one line that
+ * is written by single fwrite(). Decimal numbers are written two digits at
+ * once from table of digit pairs, nothing goes through printf() or
+ * inet_ntop().
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TEXT_FORMAT_H
+#define TEXT_FORMAT_H
+
+// ----------------------------------------------------------------------------
+//  Includes
+// ----------------------------------------------------------------------------
+
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+
+#include "utils.h"
+
+// ----------------------------------------------------------------------------
+//  Structures and enums
+// ----------------------------------------------------------------------------
+
+#define FORMAT_U32_MAX_LEN 10           // 4294967295
+#define FORMAT_HEX_MAX_LEN 8            // ffffffff
+#define FORMAT_IPV4_MAX_LEN 15          // 255.255.255.255
+#define FORMAT_IPV6_MAX_LEN 45          // ffff:...:ffff:255.255.255.255
+
+// copies string literal, returns its length
+#define FORMAT_LITERAL(out, text) (memcpy((out), (text), sizeof(text) - 1), sizeof(text) - 1)
+
+// ----------------------------------------------------------------------------
+//  Functions
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Writes unsigned number in decimal
+ *
+ * @param out Where text is written, at least FORMAT_U32_MAX_LEN bytes
+ * @param value Number (16 bit numbers are written by this too)
+ * @return size_t Number of written characters
+ */
+size_t formatU32(char* out, uint32_t value);
+
+/**
+ * @brief Writes unsigned number in decimal, padded by zeros to width
+ *
+ * @param out Where text is written, at least max(width, FORMAT_U32_MAX_LEN)
+ * bytes
+ * @param value Number
+ * @param width Minimal number of digits
+ * @return size_t Number of written characters
+ */
+size_t formatU32Width(char* out, uint32_t value, unsigned width);
+
+/**
+ * @brief Writes unsigned number in upper case hexadecimal without leading
+ * zeros
+ *
+ * @param out Where text is written, at least FORMAT_HEX_MAX_LEN bytes
+ * @param value Number
+ * @return size_t Number of written characters
+ */
+size_t formatHex(char* out, uint32_t value);
+
+/**
+ * @brief Writes bytes as pairs of upper case hexadecimal digits
+ *
+ * @param out Where text is written, at least 2 * len bytes
+ * @param data Bytes
+ * @param len Number of bytes
+ * @return size_t Number of written characters
+ */
+size_t formatHexBytes(char* out, const unsigned char* data, size_t len);
+
+/**
+ * @brief Writes IPv4 address in dotted-quad notation
+ *
+ * @param out Where text is written, at least FORMAT_IPV4_MAX_LEN bytes
+ * @param address 4 bytes of address in network byte order
+ * @return size_t Number of written characters
+ */
+size_t formatIPv4(char* out, const unsigned char* address);
+
+/**
+ * @brief Writes IPv6 address in RFC 5952 notation (lower case, no leading
+ * zeros, first longest run of two or more zero groups replaced by "::"),
+ * IPv4-mapped and IPv4-compatible addresses end with dotted quad, same as
+ * inet_ntop() writes them
+ *
+ * @param out Where text is written, at least FORMAT_IPV6_MAX_LEN bytes
+ * @param address 16 bytes of address in network byte order
+ * @return size_t Number of written characters
+ */
+size_t formatIPv6(char* out, const unsigned char* address);
+
+#endif /*TEXT_FORMAT_H*/
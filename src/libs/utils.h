@@ -30,6 +30,10 @@
 
 #define RFC3339_TIME_LEN 30 // Length of RFC3339 timestamp including '\0'
 
+// converts value of macro into string literal
+#define STRINGIFY_INNER(x) #x
+#define STRINGIFY(x) STRINGIFY_INNER(x)
+
 typedef enum ErrorCodes
 {
     NO_ERR,
@@ -13,11 +13,26 @@
 #include "libs/programConfig.h"
 #include "libs/argumentHandler.h"
 #include "libs/packetDissector.h"
+#include "libs/packetBatch.h"
+#include "libs/captureTuning.h"
+#include "libs/filePool.h"
+#include "libs/reorderBuffer.h"
+#include "libs/captureIndex.h"
+#include "libs/outputHandler.h"
 
 #include "pcap/pcap.h"
 
 #include "time.h"
 #include "signal.h"
+#include "pthread.h"
+#include "unistd.h"
+#include "errno.h"
+
+// smaller chunks even out workers when some parts of file are slower
+#define CHUNKS_PER_WORKER 4
+
+// ready interfaces returned by one epoll_wait()
+#define LIVE_MAX_EVENTS 16
 
 /**
  * @brief Global Configuration structure that holds all dynamicly allocated data 
@@ -25,26 +40,400 @@
  */
 Config* globalConfig;
 
+/**
+ * @brief Keeps capture loops running, cleared by main thread when workers 
+ * should stop
+ */
+bool captureRunning = true;
+
+/**
+ * @brief Shared state of workers processing multiple capture files
+ */
+typedef struct FileWorkerContext
+{
+    Config* config;
+    FilePool* pool;
+    ReorderBuffer* reorder;     // NULL if output is not ordered
+} FileWorkerContext;
+
+/**
+ * @brief Shared state of workers processing chunks of one capture file
+ */
+typedef struct ChunkWorkerContext
+{
+    Config* config;
+    CaptureIndex* index;
+    CaptureChunk* chunks;
+    unsigned chunkCount;
+    unsigned* nextChunk;        // first chunk that was not taken yet
+    ReorderBuffer* reorder;
+
+    // results of every chunk, merged in order of chunks
+    BufferList** domainLists;
+    BufferList** translationsLists;
+} ChunkWorkerContext;
+
+/**
+ * @brief Prints timestamp and dissection of every DNS message carried by one
+ * received packet
+ * 
+ * @param config Pointer to the Config structure
+ * @param timestamp Already formatted timestamp of the packet
+ * @param header Pcap header of the packet
+ * @param packetData Raw packet data
+ * @param entry Batch entry with already decoded link and network layers, NULL
+ * if packet is decoded here
+ */
+void printPacket(Config* config, const char* timestamp, 
+                const struct pcap_pkthdr* header, const unsigned char* packetData,
+                const BatchEntry* entry)
+{
+    if(config->reorderChunk != NULL)
+        reorderMark(config->reorderChunk, header->ts);
+
+    if(config->writerQueue != NULL)
+        captureWriterPush(config->writerQueue, header->ts, header->caplen, header->len,
+            config->linkType, packetData);
+
+    DissectError error = (entry != NULL)?
+        decodedFrameDissector(packetData, header->caplen, entry->decoded, &(entry->frame),
+                                header->ts, timestamp, config) :
+        frameDissector(packetData, header->caplen, header->ts, timestamp, config);
+
+    // malformed packet is skipped
+    if(error == DISSECT_OK)
+        return;
+
+    config->dissectStats.errors[error]++;
+    if(config->quarantineQueue != NULL)
+    {
+        captureWriterPush(config->quarantineQueue, header->ts, header->caplen, header->len,
+            config->linkType, packetData);
+        config->dissectStats.quarantined++;
+    }
+}
+
+/**
+ * @brief Prints timestamp and dissects one received packet
+ * 
+ * @param config Pointer to the Config structure
+ * @param header Pcap header of the packet
+ * @param packetData Raw packet data
+ */
+void processPacket(Config* config, const struct pcap_pkthdr* header, const unsigned char* packetData)
+{
+    // keep output of one packet together when multiple workers are printing
+    if(config->workerCount > 1)
+        flockfile(config->output);
+
+    printPacket(config, getTimestamp(header->ts, config), header, packetData, NULL);
+
+    if(config->workerCount > 1)
+        funlockfile(config->output);
+}
+
+/**
+ * @brief Processes whole batch of packets, each stage is run over all 
+ * packets before next stage starts
+ * 
+ * @param config Pointer to the Config structure
+ * @param batch Batch of received packets
+ */
+void processBatch(Config* config, PacketBatch* batch)
+{
+    batchFinalize(batch);
+
+    // stage 1: timestamps, packets received in same second share formatted 
+    // string so localtime_r() and strftime() run once per second
+    time_t lastSecond = -1;
+    const char* lastTimestamp = NULL;
+    for(unsigned i = 0; i < batch->count; i++)
+    {
+        BatchEntry* entry = &(batch->entries[i]);
+        if(lastTimestamp != NULL && entry->header.ts.tv_sec == lastSecond)
+        {
+            memcpy(entry->timestamp, lastTimestamp, RFC3339_TIME_LEN);
+            continue;
+        }
+
+        formatTimestamp(entry->header.ts, entry->timestamp);
+        lastSecond = entry->header.ts.tv_sec;
+        lastTimestamp = entry->timestamp;
+    }
+
+    // stage 2: header classification, link and network layers of all packets
+    // are decoded (addresses, transport protocol and offset, fragmentation)
+    // in one pass, header of next packet is prefetched while current one is
+    // decoded
+    for(unsigned i = 0; i < batch->count; i++)
+    {
+        BatchEntry* entry = &(batch->entries[i]);
+        if(i + 1 < batch->count)
+            __builtin_prefetch(batch->entries[i + 1].data);
+
+        entry->decoded = frameDecode(config->linkType, entry->data, entry->header.caplen,
+                                    &(entry->frame));
+    }
+
+    // stage 3: dissection of decoded frames (transport, reassembly, DNS), 
+    // output of whole batch is kept together
+    if(config->workerCount > 1)
+        flockfile(config->output);
+
+    for(unsigned i = 0; i < batch->count; i++)
+    {
+        BatchEntry* entry = &(batch->entries[i]);
+        printPacket(config, entry->timestamp, &(entry->header), entry->data, entry);
+    }
+
+    // stage 4: output, stdout is fully buffered in batch mode and is written
+    // once per batch
+    fflush(config->output);
+
+    if(config->workerCount > 1)
+        funlockfile(config->output);
+}
+
+/**
+ * @brief Function that loops over blocks retired by kernel into TPACKET_V3
+ * ring, packets are dissected in place without copying
+ * 
+ * @param config Pointer to the Config structure
+ */
+void ringPacketLooper(Config* config)
+{
+    RingCapture* ring = config->cleanup.ring;
+    struct pcap_pkthdr header;
+
+    // packets in retired block stay valid until block is released, batch 
+    // therefore only references them
+    PacketBatch batch;
+    if(config->batchSize > 0)
+        batchInit(&batch, config->batchSize);
+
+    while(__atomic_load_n(&captureRunning, __ATOMIC_RELAXED))
+    {
+        // no block is held here, ring can be safely replaced by bigger one
+        if(tunerTick(config))
+            ring = config->cleanup.ring;
+
+        struct tpacket_block_desc* block = ringNextBlock(ring);
+        if(block == NULL)
+            continue; // poll timeout, no block retired yet
+
+        struct tpacket3_hdr* frame = (struct tpacket3_hdr*) 
+            ((unsigned char*) block + block->hdr.bh1.offset_to_first_pkt);
+
+        for(unsigned i = 0; i < block->hdr.bh1.num_pkts; i++)
+        {
+            const unsigned char* packetData = ringFrameData(ring, frame, &header);
+
+            frame = (struct tpacket3_hdr*) ((unsigned char*) frame + frame->tp_next_offset);
+
+            if(packetData == NULL)
+                continue;
+
+            if(config->batchSize == 0)
+            {
+                processPacket(config, &header, packetData);
+                continue;
+            }
+
+            batchAddReference(&batch, &header, packetData);
+            if(batchIsFull(&batch))
+            {
+                processBatch(config, &batch);
+                batchClear(&batch);
+            }
+        }
+
+        // rest of batch must be processed before block goes back to kernel
+        if(config->batchSize > 0 && batch.count > 0)
+        {
+            processBatch(config, &batch);
+            batchClear(&batch);
+        }
+
+        ringReleaseBlock(ring, block);
+    }
+
+    if(config->batchSize > 0)
+        batchDestroy(&batch);
+}
+
+/**
+ * @brief Function that pulls up to config->batchSize packets with single 
+ * pcapDispatch() call and processes them as batch
+ * 
+ * @param config Pointer to the Config structure
+ * @return true Capture ended (end of file or signal)
+ * @return false Packets couldn't be read, error was printed
+ */
+bool batchPacketLooper(Config* config)
+{
+    PacketBatch batch;
+    batchInit(&batch, config->batchSize);
+
+    while(__atomic_load_n(&captureRunning, __ATOMIC_RELAXED))
+    {
+        batchClear(&batch);
+        tunerTick(config);
+
+        int res = pcapDispatch(config, config->batchSize, batchPcapCallback, 
+                                (unsigned char*) &batch);
+
+        if(res == PCAP_ERROR)
+        {
+            fprintf(stderr, "ERR: Failed to read packets: %s\n", pcapGetError(config));
+            batchDestroy(&batch);
+            return false;
+        }
+
+        if(batch.count > 0)
+            processBatch(config, &batch);
+
+        // in offline mode 0 means that file is at the end
+        if(res == PCAP_ERROR_BREAK || (res == 0 && config->captureMode == OFFLINE_MODE))
+            break;
+    }
+
+    batchDestroy(&batch);
+    return true;
+}
+
+/**
+ * @brief Callback of pcap_dispatch() that processes one packet of live 
+ * interface
+ * 
+ * @param user Pointer to the Config structure
+ * @param header Pcap header of the packet
+ * @param packetData Raw packet data
+ */
+void livePcapCallback(unsigned char* user, const struct pcap_pkthdr* header, 
+                    const unsigned char* packetData)
+{
+    processPacket((Config*) user, header, packetData);
+}
+
+/**
+ * @brief Function that waits on epoll instance for any of live interfaces 
+ * and drains packets of those that are readable, all interfaces share one 
+ * dissector state (flows, fragments, lists of domains)
+ * 
+ * @param config Pointer to the Config structure
+ */
+void livePacketLooper(Config* config)
+{
+    PacketBatch batch;
+    if(config->batchSize > 0)
+        batchInit(&batch, config->batchSize);
+
+    // without periodic statistics loop sleeps until packet arrives
+    int timeout = (config->statsInterval > 0)? 1000 : -1;
+    unsigned open = config->cleanup.liveCount;
+    struct epoll_event events[LIVE_MAX_EVENTS];
+
+    while(open > 0 && __atomic_load_n(&captureRunning, __ATOMIC_RELAXED))
+    {
+        // handles can be replaced by ones with bigger buffers here
+        tunerTick(config);
+
+        int ready = epoll_wait(config->cleanup.epollFd, events, LIVE_MAX_EVENTS, timeout);
+        if(ready < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            perror("ERR: epoll_wait");
+            errHandling("", ERR_LIBPCAP);
+        }
+
+        for(int i = 0; i < ready; i++)
+        {
+            LiveHandle* live = &(config->cleanup.live[events[i].data.u32]);
+
+            // frames are decoded and written by link type of their interface
+            config->linkType = live->linkType;
+
+            int res;
+            if(config->batchSize > 0)
+            {
+                batchClear(&batch);
+                res = pcap_dispatch(live->handle, config->batchSize, batchPcapCallback,
+                                    (unsigned char*) &batch);
+                if(batch.count > 0)
+                    processBatch(config, &batch);
+            }
+            else
+            {
+                res = pcap_dispatch(live->handle, -1, livePcapCallback, (unsigned char*) config);
+            }
+
+            if(res == PCAP_ERROR)
+            {
+                fprintf(stderr, "ERR: Failed to read packets from %s: %s\n", live->name,
+                    pcap_geterr(live->handle));
+                errHandling("", ERR_LIBPCAP);
+            }
+
+            // interface went down, others are still captured
+            if(res == PCAP_ERROR_BREAK)
+            {
+                epoll_ctl(config->cleanup.epollFd, EPOLL_CTL_DEL, 
+                    pcap_get_selectable_fd(live->handle), NULL);
+                open--;
+            }
+        }
+    }
+
+    if(config->batchSize > 0)
+        batchDestroy(&batch);
+}
+
 /**
  * @brief Function that loops and receives packets 
  * 
  * @param config Pointer to the Config structure
+ * @return true Capture ended (end of file or signal)
+ * @return false Packets couldn't be read, error was printed
  */
-void packetLooper(Config* config)
+bool packetLooper(Config* config)
 {
+    if(config->cleanup.ring != NULL)
+    {
+        ringPacketLooper(config);
+        return true;
+    }
+
+    if(config->cleanup.live != NULL)
+    {
+        livePacketLooper(config);
+        return true;
+    }
+
+    if(config->batchSize > 0)
+        return batchPacketLooper(config);
+
      // The header that pcap returns
     struct pcap_pkthdr* header;
 
-    unsigned int packetCounter = 0;
-
     // variable holding raw packet data
     const unsigned char* packetData;
 
+    // replay paces packets and measures stages, otherwise NULL
+    ReplayPacer* replay = (config->replay.mode != REPLAY_OFF)? &(config->replay) : NULL;
+    uint64_t readStart = 0;
+
     bool loop = true;
-    while(loop)
+    while(loop && __atomic_load_n(&captureRunning, __ATOMIC_RELAXED))
     {
+        tunerTick(config);
+
+        if(replay != NULL)
+            readStart = replayNow();
+
         // short unsigned int tabsCorrected = 0;
-        int res =  pcap_next_ex(config->cleanup.handle, &header, &packetData);
+        int res = pcapNext(config, &header, &packetData);
 
         switch(res)
         {
@@ -63,20 +452,431 @@ void packetLooper(Config* config)
                     continue;
                 }
                 break;
+            case PCAP_ERROR:
+                fprintf(stderr, "ERR: Failed to read packets: %s\n", pcapGetError(config));
+                return false;
             default:
                 break;
         }
         
-        if(config->verbose)
-            printf("Timestamp: %s\n", getTimestamp(header->ts, config));
-        else
-            printf("%s", getTimestamp(header->ts, config));
+        if(replay != NULL)
+            replayPace(replay, header->ts, readStart);
 
-        frameDissector(packetData, header->len, config);
+        processPacket(config, header, packetData);
 
-        packetCounter++;
-        printf("\n");
+        if(replay != NULL)
+            replayDissected(replay);
     }
+
+    return true;
+}
+
+/**
+ * @brief Thread function of capture worker
+ * 
+ * @param arg Pointer to the worker Config
+ * @return void* Always NULL
+ */
+void* workerLooper(void* arg)
+{
+    ringPacketLooper((Config*) arg);
+
+    return NULL;
+}
+
+/**
+ * @brief Opens one ring per worker in shared PACKET_FANOUT group and runs 
+ * each worker in its own thread until SIGINT/SIGTERM/SIGQUIT is received
+ * 
+ * @param config Pointer to the main Config structure
+ */
+void runWorkers(Config* config)
+{
+    // fanout group id must be unique on system and non zero
+    unsigned fanoutGroup = getpid() & 0xffff;
+    if(fanoutGroup == 0)
+        fanoutGroup = 1;
+
+    config->workers = (Config**) calloc(config->workerCount, sizeof(Config*));
+    if(config->workers == NULL)
+        errHandling("Failed to allocate memory for workers", ERR_MALLOC);
+
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        config->workers[i] = setupWorkerConfig(config, i);
+        config->workers[i]->cleanup.ring = pcapRingSetup(config, fanoutGroup);
+    }
+
+    // workers inherit blocked signals, only main thread receives them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGQUIT);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    pthread_t threads[MAX_WORKERS];
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        if(pthread_create(&threads[i], NULL, workerLooper, config->workers[i]) != 0)
+            errHandling("Failed to create worker thread", ERR_INTERNAL);
+    }
+
+    int receivedSignal;
+    sigwait(&signals, &receivedSignal);
+
+    // workers notice cleared flag at latest after ring poll timeout
+    __atomic_store_n(&captureRunning, false, __ATOMIC_RELAXED);
+
+    for(unsigned i = 0; i < config->workerCount; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/**
+ * @brief Thread function of worker processing capture files, takes files 
+ * from pool until all are processed
+ * 
+ * @param arg Pointer to the FileWorkerContext
+ * @return void* Always NULL
+ */
+void* fileWorkerLooper(void* arg)
+{
+    FileWorkerContext* context = (FileWorkerContext*) arg;
+    Config* config = context->config;
+    unsigned file;
+
+    while(__atomic_load_n(&captureRunning, __ATOMIC_RELAXED) && 
+        filePoolNext(context->pool, config->workerId, &file))
+    {
+        // pcapFileName shares buffer with tmpListEntry, it is read only while
+        // capture is opened
+        bufferClear(config->pcapFileName);
+        bufferAddString(config->pcapFileName, config->pcapFiles[file]);
+        bufferAddChar(config->pcapFileName, '\0');
+
+        // errors of one file must not end the program while other workers 
+        // are running, file is skipped and only main thread tears down config
+        config->cleanup.handle = pcapTryOpen(config, NULL);
+
+        if(context->reorder != NULL)
+        {
+            config->reorderChunk = reorderBegin(context->reorder, file);
+            config->output = config->reorderChunk->stream;
+        }
+
+        bool read = (config->cleanup.handle != NULL) && packetLooper(config);
+
+        if(context->reorder != NULL)
+        {
+            reorderEnd(context->reorder, config->reorderChunk);
+            config->reorderChunk = NULL;
+            config->output = stdout;
+        }
+
+        if(!read)
+            fprintf(stderr, "WARNING: File %s was skipped%s\n", config->pcapFiles[file],
+                (config->cleanup.handle != NULL)? " after read error" : "");
+
+        if(config->cleanup.handle != NULL)
+            pcapClose(config);
+    }
+
+    if(context->reorder != NULL)
+        reorderProducerExit(context->reorder);
+
+    return NULL;
+}
+
+/**
+ * @brief Signal handler used while file workers are running, workers stop 
+ * after current packet and results are saved by main thread
+ * 
+ * @param num Number of signal
+ */
+void stopHandler(int num)
+{
+    if(num) {}
+
+    __atomic_store_n(&captureRunning, false, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Processes all capture files from config by pool of workers, each 
+ * worker has its own dissector state and its results are merged into main 
+ * Config at the end
+ * 
+ * @param config Pointer to the main Config structure
+ */
+void runFileWorkers(Config* config)
+{
+    if(config->workerCount == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        config->workerCount = (cpus > 0 && cpus < MAX_WORKERS)? cpus : MAX_WORKERS;
+    }
+
+    if(config->workerCount > config->pcapFileCount)
+        config->workerCount = config->pcapFileCount;
+
+    struct timeval* bounds = NULL;
+    if(config->ordered)
+    {
+        bounds = (struct timeval*) malloc(sizeof(struct timeval) * config->pcapFileCount);
+        if(bounds == NULL)
+            errHandling("Failed to allocate memory for file order", ERR_MALLOC);
+    }
+
+    filePoolSortFiles(config->pcapFiles, config->pcapFileCount, config->ordered, bounds);
+
+    FileWorkerContext context;
+    context.config = NULL;
+    context.pool = filePoolCreate(config->pcapFileCount, config->workerCount);
+    context.reorder = NULL;
+    if(config->ordered)
+        context.reorder = reorderCreate(bounds, config->pcapFileCount, config->workerCount);
+    free(bounds);
+
+    config->workers = (Config**) calloc(config->workerCount, sizeof(Config*));
+    if(config->workers == NULL)
+        errHandling("Failed to allocate memory for workers", ERR_MALLOC);
+
+    FileWorkerContext contexts[MAX_WORKERS];
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        config->workers[i] = setupWorkerConfig(config, i);
+        contexts[i] = context;
+        contexts[i].config = config->workers[i];
+    }
+
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+    signal(SIGQUIT, stopHandler);
+
+    pthread_t threads[MAX_WORKERS];
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        if(pthread_create(&threads[i], NULL, fileWorkerLooper, &(contexts[i])) != 0)
+            errHandling("Failed to create worker thread", ERR_INTERNAL);
+    }
+
+    if(context.reorder != NULL)
+        reorderDrain(context.reorder, stdout);
+
+    for(unsigned i = 0; i < config->workerCount; i++)
+        pthread_join(threads[i], NULL);
+
+    reorderDestroy(context.reorder);
+    filePoolDestroy(context.pool);
+}
+
+/**
+ * @brief Reads packets of capture file between two record boundaries
+ * 
+ * @param config Pointer to the worker Config with opened file
+ * @param index Index of the file
+ * @param start Offset of first record
+ * @param end Offset where reading stops
+ * @return true Range was read
+ * @return false File changed or its records couldn't be read, error was 
+ * printed
+ */
+bool chunkRangeLooper(Config* config, CaptureIndex* index, size_t start, size_t end)
+{
+    if(!captureFileSeek(config->cleanup.captureFile, start, end, index->headers, 
+        index->headerCount))
+    {
+        fprintf(stderr, "ERR: Capture file changed while it was processed\n");
+        return false;
+    }
+
+    return packetLooper(config);
+}
+
+/**
+ * @brief Thread function of worker processing chunks of capture file, 
+ * chunks are taken in order of file until all are processed
+ * 
+ * @param arg Pointer to the ChunkWorkerContext
+ * @return void* Always NULL
+ */
+void* chunkWorkerLooper(void* arg)
+{
+    ChunkWorkerContext* context = (ChunkWorkerContext*) arg;
+    Config* config = context->config;
+    BufferList* domainList = config->domainList;
+    BufferList* translationsList = config->translationsList;
+
+    // pcapFileName shares buffer with tmpListEntry, which is separate for 
+    // every worker, every worker maps file and compiles filter on its own
+    bufferClear(config->pcapFileName);
+    bufferAddString(config->pcapFileName, config->pcapFiles[0]);
+    bufferAddChar(config->pcapFileName, '\0');
+
+    // errors must not end the program while other workers are running, 
+    // chunks this worker does not take are processed by others
+    config->cleanup.handle = pcapTryOpen(config, NULL);
+    if(config->cleanup.handle != NULL && config->cleanup.captureFile == NULL)
+    {
+        fprintf(stderr, "ERR: Capture file changed while it was processed\n");
+        pcapClose(config);
+    }
+
+    if(config->cleanup.handle == NULL)
+    {
+        fprintf(stderr, "WARNING: Worker %u skipped file %s\n", config->workerId,
+            config->pcapFiles[0]);
+        reorderProducerExit(context->reorder);
+        return NULL;
+    }
+
+    while(__atomic_load_n(&captureRunning, __ATOMIC_RELAXED))
+    {
+        unsigned index = __atomic_fetch_add(context->nextChunk, 1, __ATOMIC_RELAXED);
+        if(index >= context->chunkCount)
+            break;
+
+        CaptureChunk* chunk = &(context->chunks[index]);
+
+        // chunk starts where sequential reading has no reassembly state, 
+        // state left by previous chunk of this worker does not belong here
+        tcpTableDestroy(config->tcpFlows);
+        config->tcpFlows = tcpTableCreate();
+        ipFragTableDestroy(config->ipFrags);
+        config->ipFrags = ipFragTableCreate();
+
+        ReorderChunk* output = reorderBegin(context->reorder, index);
+        config->output = output->stream;
+        config->domainList = context->domainLists[index];
+        config->translationsList = context->translationsLists[index];
+
+        bool read = chunkRangeLooper(config, context->index, chunk->start, chunk->end);
+
+        if(!read)
+            fprintf(stderr, "WARNING: Chunk %u of file %s was skipped or is incomplete\n",
+                index, config->pcapFiles[0]);
+
+        reorderEnd(context->reorder, output);
+        config->output = stdout;
+        config->domainList = domainList;
+        config->translationsList = translationsList;
+    }
+
+    pcapClose(config);
+    reorderProducerExit(context->reorder);
+
+    return NULL;
+}
+
+/**
+ * @brief Allocates empty list for results of one chunk
+ * 
+ * @return BufferList* Initialized list
+ */
+BufferList* chunkListCreate()
+{
+    BufferList* list = (BufferList*) malloc(sizeof(BufferList));
+    if(list == NULL)
+        errHandling("Failed to allocate memory for chunk results", ERR_MALLOC);
+
+    listInit(list);
+
+    return list;
+}
+
+/**
+ * @brief Splits single capture file into chunks processed by pool of 
+ * workers. Output and domain/translation lists of chunks are merged in order
+ * of chunks, so results are same as when whole file is read by one thread.
+ * 
+ * @param config Pointer to the main Config structure
+ * @return true File was processed
+ * @return false File can not be split (pipe, unknown format, too small file
+ * or file where TCP connection or fragmented datagram is open almost all the
+ * time), it has to be read sequentially
+ */
+bool runChunkWorkers(Config* config)
+{
+    CaptureIndex* index = captureIndexGet(config->pcapFileName->data, config->indexCache,
+        config->cleanup.pcapErrbuff);
+    if(index == NULL)
+        return false;
+
+    unsigned chunkCount = config->workerCount * CHUNKS_PER_WORKER;
+    if(chunkCount > index->count)
+        chunkCount = index->count;
+
+    if(chunkCount < 2)
+    {
+        captureIndexDestroy(index);
+        return false;
+    }
+
+    if(config->workerCount > chunkCount)
+        config->workerCount = chunkCount;
+
+    unsigned nextChunk = 0;
+    ChunkWorkerContext context;
+    context.config = NULL;
+    context.index = index;
+    context.chunks = captureIndexSplit(index, chunkCount);
+    context.chunkCount = chunkCount;
+    context.nextChunk = &nextChunk;
+    context.reorder = reorderCreate(NULL, chunkCount, config->workerCount);
+    context.domainLists = (BufferList**) malloc(sizeof(BufferList*) * chunkCount);
+    context.translationsLists = (BufferList**) malloc(sizeof(BufferList*) * chunkCount);
+    if(context.domainLists == NULL || context.translationsLists == NULL)
+        errHandling("Failed to allocate memory for chunk results", ERR_MALLOC);
+
+    for(unsigned i = 0; i < chunkCount; i++)
+    {
+        context.domainLists[i] = chunkListCreate();
+        context.translationsLists[i] = chunkListCreate();
+    }
+
+    config->workers = (Config**) calloc(config->workerCount, sizeof(Config*));
+    if(config->workers == NULL)
+        errHandling("Failed to allocate memory for workers", ERR_MALLOC);
+
+    ChunkWorkerContext contexts[MAX_WORKERS];
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        config->workers[i] = setupWorkerConfig(config, i);
+        contexts[i] = context;
+        contexts[i].config = config->workers[i];
+    }
+
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+    signal(SIGQUIT, stopHandler);
+
+    pthread_t threads[MAX_WORKERS];
+    for(unsigned i = 0; i < config->workerCount; i++)
+    {
+        if(pthread_create(&threads[i], NULL, chunkWorkerLooper, &(contexts[i])) != 0)
+            errHandling("Failed to create worker thread", ERR_INTERNAL);
+    }
+
+    reorderDrainInOrder(context.reorder, stdout);
+
+    for(unsigned i = 0; i < config->workerCount; i++)
+        pthread_join(threads[i], NULL);
+
+    // first occurrences keep order in which sequential reading finds them
+    for(unsigned i = 0; i < chunkCount; i++)
+    {
+        mergeList(config->domainList, context.domainLists[i]);
+        mergeList(config->translationsList, context.translationsLists[i]);
+        listDestroy(context.domainLists[i]);
+        listDestroy(context.translationsLists[i]);
+    }
+
+    free(context.domainLists);
+    free(context.translationsLists);
+    reorderDestroy(context.reorder);
+    free(context.chunks);
+    captureIndexDestroy(index);
+
+    return true;
 }
 
 /**
@@ -123,11 +923,68 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    // messages are dissected only as far as output, lists and statistics need
+    config->dnsNeeds = dissectorNeeds(config);
+
+    // return value of ring filter is snapshot length, so ring is not limited
+    // by BUFSIZ of libpcap handle
+    if(config->snaplen == 0)
+        config->snaplen = (config->useRing)? RING_DEFAULT_SNAPLEN : DEFAULT_SNAPLEN;
+
+    // savefiles have no snapshot length of their own, 0 means unlimited
+    if(config->writePath != NULL)
+    {
+        config->writer = captureWriterCreate(config->writePath, 
+            (unsigned long) config->rotateSize * 1024 * 1024, config->rotateTime,
+            config->rotateCount, (config->captureMode == ONLINE_MODE)? config->snaplen : 0);
+        config->writerQueue = captureWriterQueue(config->writer);
+    }
+
+    if(config->quarantinePath != NULL)
+    {
+        config->quarantine = captureWriterCreate(config->quarantinePath, 0, 0, 0,
+            (config->captureMode == ONLINE_MODE)? config->snaplen : 0);
+        config->quarantineQueue = captureWriterQueue(config->quarantine);
+    }
+
+    // output is flushed explicitly after every batch
+    if(config->batchSize > 0)
+        setvbuf(stdout, NULL, _IOFBF, BUFSIZ * 16);
+
+    if(config->captureMode == OFFLINE_MODE && config->pcapFileCount > 1)
+    {
+        runFileWorkers(config);
+        destroyConfig(config);
+        return 0;
+    }
+
+    // single file is split into chunks, unless it can only be read in order
+    // or its packets are written into file in same order
+    if(config->captureMode == OFFLINE_MODE && config->workerCount > 1 && 
+        config->writer == NULL && runChunkWorkers(config))
+    {
+        destroyConfig(config);
+        return 0;
+    }
+
+    if(config->workerCount > 1 && config->captureMode == ONLINE_MODE)
+    {
+        runWorkers(config);
+        destroyConfig(config);
+        return 0;
+    }
+
     // Setup pcap file/network interface and apply filters
-    config->cleanup.handle = pcapSetup(config);
+    if(config->useRing)
+        config->cleanup.ring = pcapRingSetup(config, 0);
+    else if(config->captureMode == ONLINE_MODE)
+        pcapLiveSetup(config);
+    else
+        config->cleanup.handle = pcapSetup(config);
 
     // loop through received packet/packets that will be received
-    packetLooper(config);
+    if(!packetLooper(config))
+        errHandling("", ERR_LIBPCAP);
 
     // memory clean up
     destroyConfig(config);
@@ -0,0 +1,253 @@
+/**
+ * @file nameCheckBench.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Benchmark of dnsNameCheck() against check used before name limits
+ * were enforced (pointer hops limited only by length of message, no label
+ * and name length limits). Both checks walk same set of names: plain name,
+ * names ending by compression pointer, pointer chains and name of maximal
+ * length, results of both must agree on all of them.
+ *
+ *      nameCheckBench [ITERATIONS]
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "string.h"
+#include "time.h"
+
+#include "utils.h"
+#include "programConfig.h"
+#include "dnsMessage.h"
+
+#define BENCH_MESSAGE_LEN 2048
+#define BENCH_MAX_NAMES 64
+#define BENCH_ROUNDS 3
+#define BENCH_DEFAULT_ITERATIONS 200000
+
+// errHandling() destroys global configuration before exiting
+Config* globalConfig = NULL;
+
+/**
+ * @brief DNS message and offsets of names inside of it
+ */
+typedef struct BenchMessage {
+    unsigned char data[BENCH_MESSAGE_LEN];
+    size_t length;
+    size_t names[BENCH_MAX_NAMES];
+    unsigned count;
+} BenchMessage;
+
+/**
+ * @brief Name check used before limits were enforced, kept as baseline
+ *
+ * @param data Start of DNS message
+ * @param length Length of DNS message
+ * @param offset Offset of name in message
+ * @param nameLen Pointer where length of name at offset is stored
+ * @return DissectError DISSECT_OK or DISSECT_BAD_NAME
+ */
+DissectError legacyNameCheck(const unsigned char* data, size_t length, size_t offset,
+                        size_t* nameLen)
+{
+    size_t start = offset;
+    bool jumped = false;
+
+    // name without loop visits every 2 byte pointer of message at most once
+    size_t hops = 0;
+
+    while(true)
+    {
+        if(offset >= length)
+            return DISSECT_BAD_NAME;
+
+        unsigned char lengthOctet = data[offset];
+        if(lengthOctet == 0)
+        {
+            if(!jumped)
+                *nameLen = offset + 1 - start;
+            return DISSECT_OK;
+        }
+
+        // also reserved label types 01 and 10 are read as pointers
+        if(lengthOctet & 0xc0)
+        {
+            if(offset + 1 >= length || ++hops > length / 2)
+                return DISSECT_BAD_NAME;
+
+            if(!jumped)
+                *nameLen = offset + 2 - start;
+            jumped = true;
+
+            offset = DNS_READ16(data + offset) & 0x3fff;
+            continue;
+        }
+
+        offset += 1 + lengthOctet;
+    }
+}
+
+/**
+ * @brief Appends bytes to the message
+ *
+ * @param message Pointer to the BenchMessage
+ * @param bytes Appended bytes
+ * @param length Number of bytes
+ */
+void benchAppend(BenchMessage* message, const void* bytes, size_t length)
+{
+    memcpy(message->data + message->length, bytes, length);
+    message->length += length;
+}
+
+/**
+ * @brief Appends compression pointer to offset
+ *
+ * @param message Pointer to the BenchMessage
+ * @param offset Offset the pointer points to
+ */
+void benchAppendPointer(BenchMessage* message, size_t offset)
+{
+    unsigned char pointer[2] = {0xc0 | (offset >> 8), offset & 0xff};
+    benchAppend(message, pointer, sizeof(pointer));
+}
+
+/**
+ * @brief Builds message with names of typical shapes of answers
+ *
+ * @param message Pointer to the BenchMessage
+ */
+void benchBuildMessage(BenchMessage* message)
+{
+    memset(message, 0, sizeof(BenchMessage));
+    message->length = DNS_HEADER_LEN;
+
+    // www.example.com
+    size_t base = message->length;
+    message->names[message->count++] = base;
+    benchAppend(message, "\3www\7example\3com", 17);
+
+    // mail<i>.example.com, label followed by pointer
+    for(unsigned i = 0; i < 20; i++)
+    {
+        message->names[message->count++] = message->length;
+        char label[6] = {5, 'm', 'a', 'i', 'l', 'a' + i};
+        benchAppend(message, label, sizeof(label));
+        benchAppendPointer(message, base + 4);
+    }
+
+    // pointers only, as in answers repeating owner name
+    for(unsigned i = 0; i < 20; i++)
+    {
+        message->names[message->count++] = message->length;
+        benchAppendPointer(message, message->names[1 + i]);
+    }
+
+    // chain of DNS_NAME_MAX_HOPS pointers, each adding one label
+    size_t previous = base;
+    for(unsigned i = 0; i < DNS_NAME_MAX_HOPS - 1; i++)
+    {
+        size_t offset = message->length;
+        benchAppend(message, "\1x", 2);
+        benchAppendPointer(message, previous);
+        previous = offset;
+    }
+    message->names[message->count++] = previous;
+
+    // name of DNS_NAME_MAX_LEN bytes (four labels of 63 bytes and root)
+    message->names[message->count++] = message->length;
+    for(unsigned i = 0; i < 4; i++)
+    {
+        unsigned char label[DNS_LABEL_MAX_LEN + 1];
+        label[0] = (i < 3)? DNS_LABEL_MAX_LEN : DNS_NAME_MAX_LEN - 1 - 3 * (DNS_LABEL_MAX_LEN + 1) - 1;
+        memset(label + 1, 'a', DNS_LABEL_MAX_LEN);
+        benchAppend(message, label, label[0] + 1);
+    }
+    benchAppend(message, "", 1);
+}
+
+/**
+ * @brief Returns monotonic time in nanoseconds
+ *
+ * @return uint64_t Time
+ */
+uint64_t benchNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * @brief Checks all names of message iterations times
+ *
+ * @param message Pointer to the BenchMessage
+ * @param iterations Number of passes over names
+ * @param legacy Use legacyNameCheck() instead of dnsNameCheck()
+ * @return double Nanoseconds per name
+ */
+double benchRun(const BenchMessage* message, unsigned long iterations, bool legacy)
+{
+    volatile unsigned sink = 0;
+    size_t nameLen;
+
+    uint64_t start = benchNow();
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        for(unsigned j = 0; j < message->count; j++)
+        {
+            sink += legacy?
+                legacyNameCheck(message->data, message->length, message->names[j], &nameLen) :
+                dnsNameCheck(message->data, message->length, message->names[j], &nameLen);
+        }
+    }
+    uint64_t elapsed = benchNow() - start;
+
+    return (double) elapsed / ((double) iterations * message->count);
+}
+
+/**
+ * @brief Checks that both checks accept all names with same lengths and
+ * prints time per name of both
+ *
+ * @param argc Number of arguments
+ * @param argv Number of iterations (optional)
+ * @return int 0 on success, 1 when checks disagree
+ */
+int main(int argc, char* argv[])
+{
+    unsigned long iterations = (argc > 1)? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    if(iterations == 0)
+        iterations = BENCH_DEFAULT_ITERATIONS;
+
+    static BenchMessage message;
+    benchBuildMessage(&message);
+
+    for(unsigned i = 0; i < message.count; i++)
+    {
+        size_t legacyLen = 0, nameLen = 0;
+        DissectError legacy = legacyNameCheck(message.data, message.length, message.names[i],
+                                                &legacyLen);
+        DissectError current = dnsNameCheck(message.data, message.length, message.names[i],
+                                                &nameLen);
+
+        if(legacy != DISSECT_OK || current != DISSECT_OK || legacyLen != nameLen)
+        {
+            fprintf(stderr, "Checks disagree on name at offset %zu\n", message.names[i]);
+            return 1;
+        }
+    }
+
+    printf("Names: %u, iterations: %lu\n", message.count, iterations);
+    for(unsigned round = 0; round < BENCH_ROUNDS; round++)
+    {
+        double legacy = benchRun(&message, iterations, true);
+        double current = benchRun(&message, iterations, false);
+        printf("  legacy %6.2f ns/name, dnsNameCheck %6.2f ns/name\n", legacy, current);
+    }
+
+    return 0;
+}
@@ -0,0 +1,586 @@
+/**
+ * @file fuzzDissector.c
+ * @author Denis Fekete (xfeket01@vutbr.cz)
+ * @brief Fuzzing harness of frameDissector(). Input starts with mode byte
+ * (verbose output, storing of names, EDNS statistics and datalink type)
+ * followed by frames prefixed by their 2 byte length (big endian), so one
+ * input can carry several TCP segments or IP fragments. State of dissector
+ * (reassembly tables, domain lists) is emptied before every input.
+ *
+ * With FUZZ_LIBFUZZER the file is libFuzzer target, slowest input seen
+ * during fuzzing is saved into file (FUZZ_SLOWEST environment variable,
+ * fuzz-slowest.bin by default). Without it, main() replays files and
+ * directories of corpus (also usable by AFL with @@), every input is
+ * dissected several times and the slowest run is reported, or splits
+ * captures into seed corpus:
+ *
+ *      fuzzDissector [--repeat N] [--top N] [--limit-us N] FILE|DIR...
+ *      fuzzDissector --seed DIR CAPTURE...
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "string.h"
+#include "time.h"
+#include "dirent.h"
+#include "sys/stat.h"
+
+#include "utils.h"
+#include "programConfig.h"
+#include "packetDissector.h"
+#include "captureFile.h"
+
+#define FUZZ_MODE_VERBOSE 0x01          // -v
+#define FUZZ_MODE_STORE 0x02            // -d and -t
+#define FUZZ_MODE_EDNS 0x04             // --edns-stats
+#define FUZZ_MODE_LINK_SHIFT 4          // index into fuzzLinkTypes
+#define FUZZ_MODE_ALL (FUZZ_MODE_VERBOSE | FUZZ_MODE_STORE | FUZZ_MODE_EDNS)
+
+#define FUZZ_FRAME_HEADER_LEN 2
+#define FUZZ_FRAME_MAX_LEN 0xffff
+#define FUZZ_MAX_INPUT (1024 * 1024)    // bigger inputs (and seeds) are cut
+#define FUZZ_TIMESTAMP "2024-01-01T00:00:00.000000+00:00"
+#define FUZZ_FIRST_SECOND 1700000000
+
+#define FUZZ_DEFAULT_REPEAT 20
+#define FUZZ_DEFAULT_TOP 10
+
+// errHandling() destroys global configuration before exiting
+Config* globalConfig = NULL;
+
+/**
+ * @brief Datalink types selected by bits 4 - 6 of mode byte
+ */
+static const int fuzzLinkTypes[] = {
+    DLT_EN10MB, DLT_LINUX_SLL,
+#ifdef DLT_LINUX_SLL2
+    DLT_LINUX_SLL2,
+#else
+    DLT_EN10MB,
+#endif
+    DLT_RAW, DLT_IPV4, DLT_IPV6, DLT_NULL, DLT_LOOP,
+};
+
+#define FUZZ_LINK_TYPES (sizeof(fuzzLinkTypes) / sizeof(fuzzLinkTypes[0]))
+
+/**
+ * @brief Timing of one corpus input
+ */
+typedef struct FuzzResult {
+    char* path;
+    size_t size;
+    uint64_t minNs;
+    uint64_t maxNs;
+} FuzzResult;
+
+/**
+ * @brief Harness state, created once
+ */
+typedef struct FuzzHarness {
+    Config* config;
+    Buffer* noFile;                 // domainsFile of Config (no lists)
+    Buffer listFile;                // domainsFile used when names are stored
+} FuzzHarness;
+
+static FuzzHarness harness;
+
+// ----------------------------------------------------------------------------
+//  Harness
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Returns monotonic time in nanoseconds
+ *
+ * @return uint64_t Time
+ */
+uint64_t fuzzNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * @brief Creates configuration of dissector, output is thrown away
+ */
+void fuzzInit()
+{
+    Config* config = (Config*) malloc(sizeof(Config));
+    if(config == NULL)
+        errHandling("Memory allocation for ProgramConfiguration failed", ERR_MALLOC);
+
+    setupConfig(config);
+    globalConfig = config;
+
+    config->output = fopen("/dev/null", "w");
+    if(config->output == NULL)
+        errHandling("Failed to open /dev/null", ERR_NONEXISTING_FILE);
+
+    harness.config = config;
+    harness.noFile = config->domainsFile;
+    bufferInit(&(harness.listFile));
+    bufferAddString(&(harness.listFile), "fuzz");
+}
+
+/**
+ * @brief Empties reassembly tables and lists, so every input is dissected
+ * from same state
+ */
+void fuzzReset()
+{
+    Config* config = harness.config;
+
+    tcpTableDestroy(config->tcpFlows);
+    config->tcpFlows = tcpTableCreate();
+    ipFragTableDestroy(config->ipFrags);
+    config->ipFrags = ipFragTableCreate();
+
+    listClear(config->domainList);
+    listClear(config->translationsList);
+}
+
+/**
+ * @brief Sets program arguments selected by mode byte
+ *
+ * @param mode Mode byte of input
+ */
+void fuzzSetMode(uint8_t mode)
+{
+    Config* config = harness.config;
+
+    config->verbose = mode & FUZZ_MODE_VERBOSE;
+    config->domainsFile = (mode & FUZZ_MODE_STORE)? &(harness.listFile) : harness.noFile;
+    config->ednsReport = mode & FUZZ_MODE_EDNS;
+    config->linkType = fuzzLinkTypes[(mode >> FUZZ_MODE_LINK_SHIFT) % FUZZ_LINK_TYPES];
+    config->dnsNeeds = dissectorNeeds(config);
+}
+
+/**
+ * @brief Dissects all frames of input
+ *
+ * @param data Input
+ * @param size Length of input
+ */
+void fuzzDissect(const uint8_t* data, size_t size)
+{
+    if(size == 0)
+        return;
+
+    fuzzSetMode(data[0]);
+
+    struct timeval ts = {FUZZ_FIRST_SECOND, 0};
+    size_t ptr = 1;
+    while(ptr + FUZZ_FRAME_HEADER_LEN <= size)
+    {
+        size_t length = (data[ptr] << 8) | data[ptr + 1];
+        ptr += FUZZ_FRAME_HEADER_LEN;
+        if(length > size - ptr)
+            length = size - ptr;
+
+        // malformed frames are counted same as by capture loop
+        DissectError error = frameDissector(data + ptr, length, ts, FUZZ_TIMESTAMP,
+                                            harness.config);
+        harness.config->dissectStats.errors[error]++;
+
+        ptr += length;
+        ts.tv_usec++;
+    }
+
+    // lists are freed by fuzzReset(), Config keeps its own domainsFile
+    harness.config->domainsFile = harness.noFile;
+}
+
+/**
+ * @brief Dissects input from clean state and returns time of dissection
+ *
+ * @param data Input
+ * @param size Length of input
+ * @return uint64_t Nanoseconds spent in dissector
+ */
+uint64_t fuzzRun(const uint8_t* data, size_t size)
+{
+    fuzzReset();
+
+    uint64_t start = fuzzNow();
+    fuzzDissect(data, size);
+    return fuzzNow() - start;
+}
+
+#ifdef FUZZ_LIBFUZZER
+
+// ----------------------------------------------------------------------------
+//  libFuzzer target
+// ----------------------------------------------------------------------------
+
+int LLVMFuzzerInitialize(int* argc, char*** argv);
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+/**
+ * @brief Creates configuration before first input
+ *
+ * @param argc Not used
+ * @param argv Not used
+ * @return int Always 0
+ */
+int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    (void) argc;
+    (void) argv;
+
+    fuzzInit();
+    return 0;
+}
+
+/**
+ * @brief Dissects one input, input that took longest so far is saved
+ *
+ * @param data Input
+ * @param size Length of input
+ * @return int Always 0
+ */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static uint64_t slowestNs = 0;
+
+    uint64_t elapsed = fuzzRun(data, size);
+    if(elapsed <= slowestNs)
+        return 0;
+
+    slowestNs = elapsed;
+
+    const char* path = getenv("FUZZ_SLOWEST");
+    if(path == NULL)
+        path = "fuzz-slowest.bin";
+
+    FILE* file = fopen(path, "wb");
+    if(file != NULL)
+    {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+
+    fprintf(stderr, "fuzz: slowest input %.1f us (%zu B) saved into %s\n",
+        elapsed / 1000.0, size, path);
+    return 0;
+}
+
+#else
+
+// ----------------------------------------------------------------------------
+//  Corpus replay and seeding
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Reads whole file, files longer than FUZZ_MAX_INPUT are cut
+ *
+ * @param path Path to the file
+ * @param size Pointer where length of data is stored
+ * @return uint8_t* Allocated data or NULL when file can not be read
+ */
+uint8_t* fuzzReadFile(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+        return NULL;
+
+    uint8_t* data = (uint8_t*) malloc(FUZZ_MAX_INPUT);
+    if(data == NULL)
+        errHandling("Failed to allocate memory for fuzzing input", ERR_MALLOC);
+
+    *size = fread(data, 1, FUZZ_MAX_INPUT, file);
+    fclose(file);
+    return data;
+}
+
+/**
+ * @brief Dissects input repeat times and stores its fastest and slowest run
+ *
+ * @param path Path to the input
+ * @param repeat Number of runs
+ * @param result Pointer where timing is stored
+ * @return bool False when input can not be read
+ */
+bool fuzzTimeInput(const char* path, unsigned repeat, FuzzResult* result)
+{
+    size_t size = 0;
+    uint8_t* data = fuzzReadFile(path, &size);
+    if(data == NULL)
+    {
+        fprintf(stderr, "fuzz: can not read %s\n", path);
+        return false;
+    }
+
+    result->path = strdup(path);
+    result->size = size;
+    result->minNs = UINT64_MAX;
+    result->maxNs = 0;
+
+    for(unsigned i = 0; i < repeat; i++)
+    {
+        uint64_t elapsed = fuzzRun(data, size);
+        if(elapsed < result->minNs)
+            result->minNs = elapsed;
+        if(elapsed > result->maxNs)
+            result->maxNs = elapsed;
+    }
+
+    free(data);
+    return true;
+}
+
+/**
+ * @brief Appends timing of input or of every file of directory (not
+ * recursively) into results
+ *
+ * @param path File or directory
+ * @param repeat Number of runs of every input
+ * @param results Pointer to the array of results, array is reallocated
+ * @param count Pointer to the number of results
+ */
+void fuzzTimePath(const char* path, unsigned repeat, FuzzResult** results, size_t* count)
+{
+    struct stat info;
+    if(stat(path, &info) != 0)
+    {
+        fprintf(stderr, "fuzz: can not read %s\n", path);
+        return;
+    }
+
+    if(!S_ISDIR(info.st_mode))
+    {
+        *results = (FuzzResult*) realloc(*results, (*count + 1) * sizeof(FuzzResult));
+        if(*results == NULL)
+            errHandling("Failed to allocate memory for fuzzing results", ERR_MALLOC);
+
+        if(fuzzTimeInput(path, repeat, &((*results)[*count])))
+            (*count)++;
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if(dir == NULL)
+        return;
+
+    struct dirent* entry;
+    while((entry = readdir(dir)) != NULL)
+    {
+        if(entry->d_name[0] == '.')
+            continue;
+
+        char child[PATH_MAX];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if(stat(child, &info) == 0 && S_ISREG(info.st_mode))
+            fuzzTimePath(child, repeat, results, count);
+    }
+
+    closedir(dir);
+}
+
+/**
+ * @brief Orders results from the slowest one
+ *
+ * @param a First FuzzResult
+ * @param b Second FuzzResult
+ * @return int Result of comparison for qsort()
+ */
+int fuzzCompareResults(const void* a, const void* b)
+{
+    uint64_t first = ((const FuzzResult*) a)->maxNs;
+    uint64_t second = ((const FuzzResult*) b)->maxNs;
+    return (first < second) - (first > second);
+}
+
+/**
+ * @brief Prints throughput and slowest inputs, inputs over limit are marked
+ *
+ * @param results Timing of inputs
+ * @param count Number of results
+ * @param repeat Number of runs of every input
+ * @param top Number of printed slowest inputs
+ * @param limitNs Slowest allowed run, 0 = no limit
+ * @return unsigned Number of inputs over limit
+ */
+unsigned fuzzReport(FuzzResult* results, size_t count, unsigned repeat, unsigned top,
+                    uint64_t limitNs)
+{
+    uint64_t totalNs = 0;
+    size_t totalBytes = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        totalNs += results[i].minNs;
+        totalBytes += results[i].size;
+    }
+
+    qsort(results, count, sizeof(FuzzResult), fuzzCompareResults);
+
+    printf("Inputs: %zu (%zu B), runs per input: %u\n", count, totalBytes, repeat);
+    if(totalNs > 0)
+        printf("Fastest runs together: %.3f ms, %.1f MB/s\n", totalNs / 1e6,
+            totalBytes * 1e3 / totalNs);
+
+    printf("Slowest inputs (slowest run, fastest run, size):\n");
+    unsigned over = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        bool slow = limitNs > 0 && results[i].maxNs > limitNs;
+        over += slow;
+
+        if(i < top || slow)
+            printf("  %10.1f us %10.1f us %8zu B  %s%s\n", results[i].maxNs / 1e3,
+                results[i].minNs / 1e3, results[i].size, results[i].path,
+                slow? "  OVER LIMIT" : "");
+    }
+
+    if(over > 0)
+        printf("%u inputs over limit of %.1f us\n", over, limitNs / 1e3);
+
+    return over;
+}
+
+/**
+ * @brief Writes one seed input (mode byte and frames)
+ *
+ * @param path Path of seed file
+ * @param seed Frames of seed, without mode byte
+ * @param mode Mode byte
+ */
+void fuzzWriteSeed(const char* path, const Buffer* seed, uint8_t mode)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        fprintf(stderr, "fuzz: can not write %s\n", path);
+        return;
+    }
+
+    fputc(mode, file);
+    fwrite(seed->data, 1, seed->used, file);
+    fclose(file);
+}
+
+/**
+ * @brief Splits capture into seeds, one seed per frame and one seed with all
+ * frames (up to FUZZ_MAX_INPUT) for TCP streams and IP fragments
+ *
+ * @param dir Directory of corpus
+ * @param capture Path to pcap or pcapng file
+ * @return unsigned Number of written seeds
+ */
+unsigned fuzzSeedCapture(const char* dir, const char* capture)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    CaptureFile* file = captureFileOpen(capture, errbuf);
+    if(file == NULL)
+    {
+        fprintf(stderr, "fuzz: %s: %s\n", capture, errbuf);
+        return 0;
+    }
+
+    unsigned link = 0;
+    while(link < FUZZ_LINK_TYPES && fuzzLinkTypes[link] != file->linkType)
+        link++;
+    if(link == FUZZ_LINK_TYPES)
+    {
+        fprintf(stderr, "fuzz: %s: unsupported datalink %d\n", capture, file->linkType);
+        captureFileClose(file);
+        return 0;
+    }
+
+    uint8_t mode = FUZZ_MODE_ALL | (link << FUZZ_MODE_LINK_SHIFT);
+    const char* name = strrchr(capture, '/');
+    name = (name == NULL)? capture : name + 1;
+
+    Buffer frame, all;
+    bufferInit(&frame);
+    bufferInit(&all);
+
+    unsigned seeds = 0;
+    struct pcap_pkthdr* header;
+    const unsigned char* data;
+    while(captureFileNext(file, &header, &data) == 1)
+    {
+        size_t length = (header->caplen < FUZZ_FRAME_MAX_LEN)? header->caplen : FUZZ_FRAME_MAX_LEN;
+        char prefix[FUZZ_FRAME_HEADER_LEN] = {length >> 8, length & 0xff};
+
+        bufferClear(&frame);
+        bufferAddBytes(&frame, prefix, FUZZ_FRAME_HEADER_LEN);
+        bufferAddBytes(&frame, (const char*) data, length);
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s-%04u", dir, name, seeds);
+        fuzzWriteSeed(path, &frame, mode);
+        seeds++;
+
+        if(all.used + frame.used < FUZZ_MAX_INPUT)
+            bufferAddBytes(&all, frame.data, frame.used);
+    }
+
+    if(all.used > 0)
+    {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s-all", dir, name);
+        fuzzWriteSeed(path, &all, mode);
+        seeds++;
+    }
+
+    bufferDestroy(&frame);
+    bufferDestroy(&all);
+    captureFileClose(file);
+    return seeds;
+}
+
+/**
+ * @brief Seeds corpus from captures or replays corpus and reports timing
+ *
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @return int 0 on success, 1 when some input was over time limit
+ */
+int main(int argc, char* argv[])
+{
+    fuzzInit();
+
+    if(argc > 2 && strcmp(argv[1], "--seed") == 0)
+    {
+        mkdir(argv[2], 0755);
+
+        unsigned seeds = 0;
+        for(int i = 3; i < argc; i++)
+            seeds += fuzzSeedCapture(argv[2], argv[i]);
+
+        printf("Seeds written into %s: %u\n", argv[2], seeds);
+        return 0;
+    }
+
+    unsigned repeat = FUZZ_DEFAULT_REPEAT;
+    unsigned top = FUZZ_DEFAULT_TOP;
+    uint64_t limitNs = 0;
+
+    FuzzResult* results = NULL;
+    size_t count = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = strtoul(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            top = strtoul(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--limit-us") == 0 && i + 1 < argc)
+            limitNs = strtoull(argv[++i], NULL, 10) * 1000;
+        else
+            fuzzTimePath(argv[i], (repeat > 0)? repeat : 1, &results, &count);
+    }
+
+    unsigned over = fuzzReport(results, count, repeat, top, limitNs);
+
+    for(size_t i = 0; i < count; i++)
+        free(results[i].path);
+    free(results);
+
+    return (over > 0)? 1 : 0;
+}
+
+#endif
@@ -3,6 +3,9 @@
 if [ -z "$1" ]; then
     echo "Usage: $0 <keyword>"
     echo "Example: $0 test1"
+    echo "         $0 bench [FILE]"
+    echo "         $0 bench-names"
+    echo "         $0 chunks [FILE]"
     exit 1
 fi
 
@@ -20,6 +23,47 @@ test_case() {
     status=$?
 }
 
+# Runs offline processing of file with given batch size and prints throughput
+bench_case() {
+    local file=$1
+    local batch=$2
+    local repeat=${BENCH_REPEAT:-20}
+
+    # packets of input file, output lines would count printed records
+    local packets=$(tcpdump -nn -r ${file} 2>/dev/null | wc -l)
+
+    local start=$(date +%s%N)
+    for ((i = 0; i < repeat; i++)); do
+        ./../dns-monitor -p ${file} --batch ${batch} > /dev/null
+    done
+    local end=$(date +%s%N)
+
+    local elapsed_ms=$(( (end - start) / 1000000 ))
+    [ ${elapsed_ms} -eq 0 ] && elapsed_ms=1
+    local pps=$(( packets * repeat * 1000 / elapsed_ms ))
+
+    printf "batch=%-6s packets=%-8s runs=%-4s time=%6sms  %s pkt/s\n" \
+        ${batch} ${packets} ${repeat} ${elapsed_ms} ${pps}
+}
+
+# Compares output of file read by one thread and split into chunks of workers
+chunks_case() {
+    local file=$1
+    local sequential="./../build/chunks_sequential.txt"
+    local chunked="./../build/chunks_workers.txt"
+
+    ./../dns-monitor -p ${file} -v > ${sequential} 2>&1
+    ./../dns-monitor -p ${file} -v --workers 4 > ${chunked} 2>&1
+
+    if cmp -s ${sequential} ${chunked}; then
+        echo "PASS: ${file}"
+    else
+        echo "FAIL: ${file}, output of --workers 4 differs"
+        diff ${sequential} ${chunked} | head -n 20
+        exit 1
+    fi
+}
+
 case "$1" in
     all) 
         echo "#################################################"
@@ -52,6 +96,25 @@ case "$1" in
     mx)
         test_case "dns_mx"
         ;;
+    bench)
+        # throughput comparison of packet by packet and batched processing
+        file=${2:-dns_seznam.pcapng}
+        echo "#################################################"
+        echo "Benchmark: ${file} (BENCH_REPEAT=${BENCH_REPEAT:-20})"
+        echo "#################################################"
+        for batch in 0 1 16 64 256; do
+            bench_case ${file} ${batch}
+        done
+        ;;
+    chunks)
+        # DNS over TCP connection open for minutes and IP fragments sent
+        # 25 s apart, no chunk may start while either of them is open
+        chunks_case ${2:-dns_tcp_long.pcap}
+        ;;
+    bench-names)
+        # time per name of dnsNameCheck() against check without name limits
+        make -C .. bench-names
+        ;;
     offline)
         sudo ./../dns-monitor -p dns_a_aaaa_ns.pcapng -v -d ./../build/domain_names_offline.txt -t ./../build/translated_offline.txt 
         ;;